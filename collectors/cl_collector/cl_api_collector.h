@@ -1,6 +1,7 @@
 #ifndef FTRACE_TOOLS_COLLECTORS_CL_COLLECTOR_CL_API_COLLECTOR_H_
 #define FTRACE_TOOLS_COLLECTORS_CL_COLLECTOR_API_COLLECTOR_H_
 
+#include <atomic>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
@@ -11,13 +12,16 @@
 #include "cl_api_tracer.h"
 #include "cl_utils.h"
 #include "correlator.h"
+#include "latency_histogram.h"
 #include "trace_guard.h"
+#include "tracer_overhead.h"
 
 struct ClFunction {
   uint64_t total_time;
   uint64_t min_time;
   uint64_t max_time;
   uint64_t call_count;
+  LatencyHistogram histogram;
 
   bool operator>(const ClFunction& r) const {
     if (total_time != r.total_time) {
@@ -76,6 +80,7 @@ class ClApiCollector {
       return nullptr;
     }
 
+    collector->Calibrate(device);
     collector->EnableTracing(tracer);
     return collector;
   }
@@ -96,6 +101,16 @@ class ClApiCollector {
     return function_info_map_;
   }
 
+  ClFunctionInfoMap GetFunctionInfoMapSnapshot() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    return function_info_map_;
+  }
+
+  // Calibration baseline, subtracted from reported times with a clamp
+  uint64_t GetCallOverhead() const {
+    return options_.raw_time ? 0 : call_overhead_;
+  }
+
   uint64_t GetKernelId() const {
     FTRACE_ASSERT(correlator_ != nullptr);
     return correlator_->GetKernelId();
@@ -122,9 +137,11 @@ class ClApiCollector {
   ClApiCollector& operator=(const ClApiCollector& copy) = delete;
 
   void PrintFunctionsTable() const {
+    ClFunctionInfoMap function_info_map =
+      utils::CompensateCallOverhead(function_info_map_, GetCallOverhead());
     std::set< std::pair<std::string, ClFunction>,
               utils::Comparator > sorted_list(
-        function_info_map_.begin(), function_info_map_.end());
+        function_info_map.begin(), function_info_map.end());
 
     uint64_t total_duration = 0;
     size_t max_name_length = kFunctionLength;
@@ -140,13 +157,23 @@ class ClApiCollector {
     }
 
     std::stringstream stream;
+    if (GetCallOverhead() > 0) {
+      stream << "Calibration baseline (fastest traced clGetDeviceInfo) of " <<
+        GetCallOverhead() << " ns is subtracted from each call, " <<
+        "at most half of the fastest call of a function" << std::endl;
+      stream << std::endl;
+    }
     stream << std::setw(max_name_length) << "Function" << "," <<
       std::setw(kCallsLength) << "Calls" << "," <<
       std::setw(kTimeLength) << "Time (ns)" << "," <<
       std::setw(kPercentLength) << "Time (%)" << "," <<
       std::setw(kTimeLength) << "Average (ns)" << "," <<
       std::setw(kTimeLength) << "Min (ns)" << "," <<
-      std::setw(kTimeLength) << "Max (ns)" << std::endl;
+      std::setw(kTimeLength) << "Max (ns)" << "," <<
+      std::setw(kTimeLength) << "p50 (ns)" << "," <<
+      std::setw(kTimeLength) << "p90 (ns)" << "," <<
+      std::setw(kTimeLength) << "p99 (ns)" << "," <<
+      std::setw(kTimeLength) << "p99.9 (ns)" << std::endl;
 
     for (auto& value : sorted_list) {
       const std::string& function = value.first;
@@ -155,6 +182,7 @@ class ClApiCollector {
       uint64_t avg_duration = duration / call_count;
       uint64_t min_duration = value.second.min_time;
       uint64_t max_duration = value.second.max_time;
+      const LatencyHistogram& histogram = value.second.histogram;
       float percent_duration = 100.0f * duration / total_duration;
       stream << std::setw(max_name_length) << function << "," <<
         std::setw(kCallsLength) << call_count << "," <<
@@ -163,7 +191,32 @@ class ClApiCollector {
           std::fixed << percent_duration << "," <<
         std::setw(kTimeLength) << avg_duration << "," <<
         std::setw(kTimeLength) << min_duration << "," <<
-        std::setw(kTimeLength) << max_duration << std::endl;
+        std::setw(kTimeLength) << max_duration << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(50.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(90.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.9) << std::endl;
+    }
+
+    FTRACE_ASSERT(correlator_ != nullptr);
+    correlator_->Log(stream.str());
+  }
+
+  void PrintHistograms() const {
+    ClFunctionInfoMap function_info_map =
+      utils::CompensateCallOverhead(function_info_map_, GetCallOverhead());
+    std::set< std::pair<std::string, ClFunction>,
+              utils::Comparator > sorted_list(
+        function_info_map.begin(), function_info_map.end());
+    if (sorted_list.empty()) {
+      return;
+    }
+
+    std::stringstream stream;
+    for (auto& value : sorted_list) {
+      stream << "Function: " << value.first << std::endl;
+      stream << value.second.histogram.GetBucketTable();
+      stream << std::endl;
     }
 
     FTRACE_ASSERT(correlator_ != nullptr);
@@ -201,6 +254,36 @@ class ClApiCollector {
     FTRACE_ASSERT(enabled);
   }
 
+  // Measures the fastest traced clGetDeviceInfo call: the part of tracing
+  // dispatch that falls in between start and end timestamps of the
+  // regular callback plus the cheapest driver call, which can not be told
+  // apart, see CompensateCallOverhead
+  void Calibrate(cl_device_id device) {
+    FTRACE_ASSERT(device != nullptr);
+
+    ClApiTracer tracer(device, CalibrationCallback, this);
+    if (!tracer.IsValid() ||
+        !tracer.SetTracingFunction(CL_FUNCTION_clGetDeviceInfo) ||
+        !tracer.Enable()) {
+      std::cerr << "[WARNING] Unable to calibrate OpenCL tracing overhead" <<
+        std::endl;
+      return;
+    }
+
+    for (uint32_t i = 0; i < kCalibrationCount; ++i) {
+      cl_device_type type = CL_DEVICE_TYPE_ALL;
+      cl_int status = clGetDeviceInfo(
+          device, CL_DEVICE_TYPE, sizeof(type), &type, nullptr);
+      FTRACE_ASSERT(status == CL_SUCCESS);
+    }
+
+    bool disabled = tracer.Disable();
+    FTRACE_ASSERT(disabled);
+
+    uint64_t probe_time = calibration_time_.load(std::memory_order_relaxed);
+    call_overhead_ = (probe_time == UINT64_MAX) ? 0 : probe_time;
+  }
+
   uint64_t GetTimestamp() const {
     FTRACE_ASSERT(correlator_ != nullptr);
     return correlator_->GetTimestamp();
@@ -209,7 +292,12 @@ class ClApiCollector {
   void AddFunctionTime(const std::string& name, uint64_t time) {
     const std::lock_guard<std::mutex> lock(lock_);
     if (function_info_map_.count(name) == 0) {
-      function_info_map_[name] = {time, time, time, 1};
+      ClFunction& function = function_info_map_[name];
+      function.total_time = time;
+      function.min_time = time;
+      function.max_time = time;
+      function.call_count = 1;
+      function.histogram.Record(time);
     } else {
       ClFunction& function = function_info_map_[name];
       function.total_time += time;
@@ -220,15 +308,67 @@ class ClApiCollector {
         function.max_time = time;
       }
       ++function.call_count;
+      function.histogram.Record(time);
     }
   }
 
  private: // Callbacks
+  static void CalibrationCallback(
+      cl_function_id function,
+      cl_callback_data* callback_data,
+      void* user_data) {
+    ClApiCollector* collector = reinterpret_cast<ClApiCollector*>(user_data);
+    FTRACE_ASSERT(collector != nullptr);
+    FTRACE_ASSERT(callback_data != nullptr);
+    FTRACE_ASSERT(callback_data->correlationData != nullptr);
+
+    uint64_t& start_time = *reinterpret_cast<uint64_t*>(
+        callback_data->correlationData);
+    if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+      start_time = collector->GetTimestamp();
+    } else {
+      uint64_t end_time = collector->GetTimestamp();
+      FTRACE_ASSERT(start_time <= end_time);
+
+      uint64_t time = end_time - start_time;
+      uint64_t min_time = collector->calibration_time_.load(
+          std::memory_order_relaxed);
+      while (time < min_time &&
+             !collector->calibration_time_.compare_exchange_weak(
+                 min_time, time, std::memory_order_relaxed)) {}
+    }
+  }
+
+  // Functions tracked as device activities by the kernel collector
+  static bool IsEnqueueFunction(cl_function_id function) {
+    switch (function) {
+      case CL_FUNCTION_clEnqueueNDRangeKernel:
+      case CL_FUNCTION_clEnqueueTask:
+      case CL_FUNCTION_clEnqueueReadBuffer:
+      case CL_FUNCTION_clEnqueueWriteBuffer:
+      case CL_FUNCTION_clEnqueueReadBufferRect:
+      case CL_FUNCTION_clEnqueueWriteBufferRect:
+      case CL_FUNCTION_clEnqueueCopyBuffer:
+      case CL_FUNCTION_clEnqueueCopyBufferRect:
+      case CL_FUNCTION_clEnqueueFillBuffer:
+      case CL_FUNCTION_clEnqueueReadImage:
+      case CL_FUNCTION_clEnqueueWriteImage:
+      case CL_FUNCTION_clEnqueueCopyImage:
+      case CL_FUNCTION_clEnqueueFillImage:
+      case CL_FUNCTION_clEnqueueCopyImageToBuffer:
+      case CL_FUNCTION_clEnqueueCopyBufferToImage:
+        return true;
+      default:
+        return false;
+    }
+  }
+
   static void Callback(
       cl_function_id function,
       cl_callback_data* callback_data,
       void* user_data) {
     if (TraceGuard::Inactive()) return;
+    TracerOverheadScope overhead(TRACER_HOOK_CL_API);
 
     ClApiCollector* collector = reinterpret_cast<ClApiCollector*>(user_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -249,6 +389,13 @@ class ClApiCollector {
       uint64_t& start_time = *reinterpret_cast<uint64_t*>(
           callback_data->correlationData);
       start_time = collector->GetTimestamp();
+      collector->correlator_->EnterApiCall(
+          callback_data->functionName, start_time);
+
+      // Kernel collector sets the id again if the command is enqueued
+      if (IsEnqueueFunction(function)) {
+        collector->correlator_->SetKernelId(0);
+      }
     } else {
       uint64_t end_time = collector->GetTimestamp();
       uint64_t& start_time = *reinterpret_cast<uint64_t*>(
@@ -258,8 +405,11 @@ class ClApiCollector {
         return;
       }
 
+      FTRACE_ASSERT(collector->correlator_ != nullptr);
+      uint64_t nested_time = collector->correlator_->ExitApiCall(
+          callback_data->functionName, end_time);
       collector->AddFunctionTime(
-        callback_data->functionName, end_time - start_time);
+        callback_data->functionName, end_time - start_time - nested_time);
 
       if (collector->options_.call_tracing) {
         OnExitFunction(
@@ -268,9 +418,7 @@ class ClApiCollector {
 
       if (collector->callback_ != nullptr) {
         uint64_t kernel_id = 0;
-        if (function == CL_FUNCTION_clEnqueueNDRangeKernel ||
-            function == CL_FUNCTION_clEnqueueReadBuffer ||
-            function == CL_FUNCTION_clEnqueueWriteBuffer) {
+        if (IsEnqueueFunction(function)) {
           FTRACE_ASSERT(collector->correlator_ != nullptr);
           kernel_id = collector->correlator_->GetKernelId();
         }
@@ -305,6 +453,7 @@ class ClApiCollector {
         SET_EXTENSION_FUNCTION(clGetMemAllocInfoINTEL);
         SET_EXTENSION_FUNCTION(clSetKernelArgMemPointerINTEL);
         SET_EXTENSION_FUNCTION(clEnqueueMemcpyINTEL);
+        SET_EXTENSION_FUNCTION(clEnqueueMemFillINTEL);
         SET_EXTENSION_FUNCTION(clGetDeviceGlobalVariablePointerINTEL);
         SET_EXTENSION_FUNCTION(clGetKernelSuggestedLocalWorkSizeINTEL);
       } else if (function ==
@@ -320,6 +469,7 @@ class ClApiCollector {
         SET_EXTENSION_FUNCTION(clGetMemAllocInfoINTEL);
         SET_EXTENSION_FUNCTION(clSetKernelArgMemPointerINTEL);
         SET_EXTENSION_FUNCTION(clEnqueueMemcpyINTEL);
+        SET_EXTENSION_FUNCTION(clEnqueueMemFillINTEL);
         SET_EXTENSION_FUNCTION(clGetDeviceGlobalVariablePointerINTEL);
         SET_EXTENSION_FUNCTION(clGetKernelSuggestedLocalWorkSizeINTEL);
       }
@@ -339,10 +489,14 @@ class ClApiCollector {
   std::mutex lock_;
   ClFunctionInfoMap function_info_map_;
 
+  std::atomic<uint64_t> calibration_time_{UINT64_MAX};
+  uint64_t call_overhead_ = 0;
+
   static const uint32_t kFunctionLength = 10;
   static const uint32_t kCallsLength = 12;
   static const uint32_t kTimeLength = 20;
   static const uint32_t kPercentLength = 10;
+  static const uint32_t kCalibrationCount = 1000;
 
   friend class ClExtCollector;
 };
@@ -1,16 +1,21 @@
 #ifndef FTRACE_TOOLS_COLLECTORS_CL_COLLECTOR_CL_EXT_CALLBACKS_H_
 #define FTRACE_TOOLS_COLLECTORS_CL_COLLECTOR_CL_EXT_CALLBACKS_H_
 
+#include <atomic>
 #include <sstream>
 
 #include <CL/cl.h>
 #include <CL/cl_ext_private.h>
 
+#include "alloc_index.h"
 #include "cl_ext_collector.h"
 #include "cl_utils.h"
+#include "memory_tracker.h"
 #include "trace_guard.h"
+#include "tracer_overhead.h"
 
 static void* GetFunctionAddress(const char* function_name, cl_device_type device_type) {
+  TraceGuard guard;
   cl_int status = CL_SUCCESS;
 
   cl_device_id device = utils::cl::GetIntelDevice(device_type);
@@ -27,6 +32,123 @@ static void* GetFunctionAddress(const char* function_name, cl_device_type device
   return clGetExtensionFunctionAddressForPlatform(platform, function_name);
 }
 
+static void AddMemAlloc(
+    void* ptr, size_t size, AllocType alloc_type, MemoryType memory_type,
+    cl_device_id device, cl_context context, const char* function_name) {
+  if (ptr != nullptr) {
+    AllocIndex::Add(ptr, size, alloc_type, device, context);
+    MemoryTracker::Add(
+        ptr, size, memory_type, device, context, function_name);
+  }
+}
+
+// Removed before the release, so the address is not reused meanwhile
+static void RemoveMemAlloc(void* ptr) {
+  if (ptr != nullptr) {
+    AllocIndex::Remove(ptr);
+    MemoryTracker::Remove(ptr);
+  }
+}
+
+// Kernel collectors get device time of USM transfers enqueued through
+// extension functions with these hooks. Begin may substitute the event
+// and returns the data passed to end, fills have no source
+typedef void* (*OnClExtTransferBegin)(void* user_data, cl_event** event);
+typedef void (*OnClExtTransferEnd)(
+    void* user_data, void* transfer_data, cl_int result,
+    const char* function_name, const void* dst, const void* src,
+    size_t size, cl_event* event);
+
+struct ClExtTransferHooks {
+  OnClExtTransferBegin begin;
+  OnClExtTransferEnd end;
+  void* user_data;
+};
+
+template <cl_device_type DEVICE_TYPE>
+inline std::atomic<const ClExtTransferHooks*>& GetTransferHooks() {
+  static std::atomic<const ClExtTransferHooks*> hooks{nullptr};
+  return hooks;
+}
+
+template <cl_device_type DEVICE_TYPE>
+static cl_int EnqueueMemcpyINTEL(
+    TracerOverheadScope& overhead,
+    cl_command_queue command_queue,
+    cl_bool blocking,
+    void* dst_ptr,
+    const void* src_ptr,
+    size_t size,
+    cl_uint num_events_in_wait_list,
+    const cl_event* event_wait_list,
+    cl_event* event) {
+  const char* function_name = "clEnqueueMemcpyINTEL";
+  typedef cl_int (*Function)(
+      cl_command_queue, cl_bool, void*, const void*, size_t,
+      cl_uint, const cl_event*, cl_event*);
+  Function function = reinterpret_cast<Function>(
+      GetFunctionAddress(function_name, DEVICE_TYPE));
+
+  const ClExtTransferHooks* hooks =
+    GetTransferHooks<DEVICE_TYPE>().load(std::memory_order_acquire);
+  void* transfer_data = nullptr;
+  if (hooks != nullptr) {
+    transfer_data = hooks->begin(hooks->user_data, &event);
+  }
+
+  overhead.Suspend();
+  cl_int result = function(
+      command_queue, blocking, dst_ptr, src_ptr,
+      size, num_events_in_wait_list, event_wait_list, event);
+  overhead.Resume();
+
+  if (hooks != nullptr) {
+    hooks->end(
+        hooks->user_data, transfer_data, result, function_name,
+        dst_ptr, src_ptr, size, event);
+  }
+  return result;
+}
+
+template <cl_device_type DEVICE_TYPE>
+static cl_int EnqueueMemFillINTEL(
+    TracerOverheadScope& overhead,
+    cl_command_queue command_queue,
+    void* dst_ptr,
+    const void* pattern,
+    size_t pattern_size,
+    size_t size,
+    cl_uint num_events_in_wait_list,
+    const cl_event* event_wait_list,
+    cl_event* event) {
+  const char* function_name = "clEnqueueMemFillINTEL";
+  typedef cl_int (*Function)(
+      cl_command_queue, void*, const void*, size_t, size_t,
+      cl_uint, const cl_event*, cl_event*);
+  Function function = reinterpret_cast<Function>(
+      GetFunctionAddress(function_name, DEVICE_TYPE));
+
+  const ClExtTransferHooks* hooks =
+    GetTransferHooks<DEVICE_TYPE>().load(std::memory_order_acquire);
+  void* transfer_data = nullptr;
+  if (hooks != nullptr) {
+    transfer_data = hooks->begin(hooks->user_data, &event);
+  }
+
+  overhead.Suspend();
+  cl_int result = function(
+      command_queue, dst_ptr, pattern, pattern_size,
+      size, num_events_in_wait_list, event_wait_list, event);
+  overhead.Resume();
+
+  if (hooks != nullptr) {
+    hooks->end(
+        hooks->user_data, transfer_data, result, function_name,
+        dst_ptr, nullptr, size, event);
+  }
+  return result;
+}
+
 template <cl_device_type DEVICE_TYPE>
 static void* clHostMemAllocINTEL(
     cl_context context,
@@ -34,15 +156,25 @@ static void* clHostMemAllocINTEL(
     size_t size,
     cl_uint alignment,
     cl_int* errcode_ret) {
-  TraceGuard guard;
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
   const char* function_name = "clHostMemAllocINTEL";
 
-  ClExtCollector* collector = ClExtCollector::GetInstance();
-  FTRACE_ASSERT(collector != nullptr);
+  ClExtCollector* collector = ClExtCollector::GetInstance<DEVICE_TYPE>();
+  if (collector == nullptr) {
+    void* result = reinterpret_cast<
+        decltype(clHostMemAllocINTEL<DEVICE_TYPE>)*>(
+            GetFunctionAddress(function_name, DEVICE_TYPE))(
+                context, properties, size, alignment, errcode_ret);
+    AddMemAlloc(
+        result, size, ALLOC_TYPE_HOST, MEMORY_TYPE_HOST,
+        nullptr, context, function_name);
+    return result;
+  }
 
   cl_int current_error = CL_SUCCESS;
 
   uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -72,10 +204,18 @@ static void* clHostMemAllocINTEL(
   decltype(clHostMemAllocINTEL<DEVICE_TYPE>)* function =
     reinterpret_cast<decltype(clHostMemAllocINTEL<DEVICE_TYPE>)*>(
         GetFunctionAddress(function_name, DEVICE_TYPE));
+  overhead.Suspend();
   void* result = function(context, properties, size, alignment, errcode_ret);
+  overhead.Resume();
+  AddMemAlloc(
+      result, size, ALLOC_TYPE_HOST, MEMORY_TYPE_HOST,
+      nullptr, context, function_name);
 
   uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
-  collector->AddFunctionTime<DEVICE_TYPE>(function_name, end - start);
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -112,15 +252,25 @@ static void* clDeviceMemAllocINTEL(
     size_t size,
     cl_uint alignment,
     cl_int* errcode_ret) {
-  TraceGuard guard;
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
   const char* function_name = "clDeviceMemAllocINTEL";
 
-  ClExtCollector* collector = ClExtCollector::GetInstance();
-  FTRACE_ASSERT(collector != nullptr);
+  ClExtCollector* collector = ClExtCollector::GetInstance<DEVICE_TYPE>();
+  if (collector == nullptr) {
+    void* result = reinterpret_cast<
+        decltype(clDeviceMemAllocINTEL<DEVICE_TYPE>)*>(
+            GetFunctionAddress(function_name, DEVICE_TYPE))(
+                context, device, properties, size, alignment, errcode_ret);
+    AddMemAlloc(
+        result, size, ALLOC_TYPE_DEVICE, MEMORY_TYPE_DEVICE,
+        device, context, function_name);
+    return result;
+  }
 
   cl_int current_error = CL_SUCCESS;
 
   uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -151,11 +301,19 @@ static void* clDeviceMemAllocINTEL(
   decltype(clDeviceMemAllocINTEL<DEVICE_TYPE>)* function =
     reinterpret_cast<decltype(clDeviceMemAllocINTEL<DEVICE_TYPE>)*>(
         GetFunctionAddress(function_name, DEVICE_TYPE));
+  overhead.Suspend();
   void* result = function(
       context, device, properties, size, alignment, errcode_ret);
+  overhead.Resume();
+  AddMemAlloc(
+      result, size, ALLOC_TYPE_DEVICE, MEMORY_TYPE_DEVICE,
+      device, context, function_name);
 
   uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
-  collector->AddFunctionTime<DEVICE_TYPE>(function_name, end - start);
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -192,15 +350,25 @@ static void* clSharedMemAllocINTEL(
     size_t size,
     cl_uint alignment,
     cl_int* errcode_ret) {
-  TraceGuard guard;
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
   const char* function_name = "clSharedMemAllocINTEL";
 
-  ClExtCollector* collector = ClExtCollector::GetInstance();
-  FTRACE_ASSERT(collector != nullptr);
+  ClExtCollector* collector = ClExtCollector::GetInstance<DEVICE_TYPE>();
+  if (collector == nullptr) {
+    void* result = reinterpret_cast<
+        decltype(clSharedMemAllocINTEL<DEVICE_TYPE>)*>(
+            GetFunctionAddress(function_name, DEVICE_TYPE))(
+                context, device, properties, size, alignment, errcode_ret);
+    AddMemAlloc(
+        result, size, ALLOC_TYPE_SHARED, MEMORY_TYPE_SHARED,
+        device, context, function_name);
+    return result;
+  }
 
   cl_int current_error = CL_SUCCESS;
 
   uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -231,11 +399,19 @@ static void* clSharedMemAllocINTEL(
   decltype(clSharedMemAllocINTEL<DEVICE_TYPE>)* function =
     reinterpret_cast<decltype(clSharedMemAllocINTEL<DEVICE_TYPE>)*>(
         GetFunctionAddress(function_name, DEVICE_TYPE));
+  overhead.Suspend();
   void* result = function(
       context, device, properties, size, alignment, errcode_ret);
+  overhead.Resume();
+  AddMemAlloc(
+      result, size, ALLOC_TYPE_SHARED, MEMORY_TYPE_SHARED,
+      device, context, function_name);
 
   uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
-  collector->AddFunctionTime<DEVICE_TYPE>(function_name, end - start);
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -268,15 +444,20 @@ template <cl_device_type DEVICE_TYPE>
 static cl_int clMemFreeINTEL(
     cl_context context,
     void* ptr) {
-  TraceGuard guard;
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
   const char* function_name = "clMemFreeINTEL";
 
-  ClExtCollector* collector = ClExtCollector::GetInstance();
-  FTRACE_ASSERT(collector != nullptr);
+  ClExtCollector* collector = ClExtCollector::GetInstance<DEVICE_TYPE>();
+  if (collector == nullptr) {
+    RemoveMemAlloc(ptr);
+    return reinterpret_cast<decltype(clMemFreeINTEL<DEVICE_TYPE>)*>(
+        GetFunctionAddress(function_name, DEVICE_TYPE))(context, ptr);
+  }
 
   cl_int current_error = CL_SUCCESS;
 
   uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -299,10 +480,16 @@ static cl_int clMemFreeINTEL(
   decltype(clMemFreeINTEL<DEVICE_TYPE>)* function =
     reinterpret_cast<decltype(clMemFreeINTEL<DEVICE_TYPE>)*>(
         GetFunctionAddress(function_name, DEVICE_TYPE));
+  RemoveMemAlloc(ptr);
+  overhead.Suspend();
   cl_int result = function(context, ptr);
+  overhead.Resume();
 
   uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
-  collector->AddFunctionTime<DEVICE_TYPE>(function_name, end - start);
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -336,7 +523,7 @@ static cl_int clGetMemAllocInfoINTEL(
     size_t param_value_size,
     void* param_value,
     size_t* param_value_size_ret) {
-  TraceGuard guard;
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
   const char* function_name = "clGetMemAllocInfoINTEL";
 
   ClExtCollector* collector = ClExtCollector::GetInstance();
@@ -345,6 +532,7 @@ static cl_int clGetMemAllocInfoINTEL(
   cl_int current_error = CL_SUCCESS;
 
   uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -371,12 +559,17 @@ static cl_int clGetMemAllocInfoINTEL(
   decltype(clGetMemAllocInfoINTEL<DEVICE_TYPE>)* function =
     reinterpret_cast<decltype(clGetMemAllocInfoINTEL<DEVICE_TYPE>)*>(
         GetFunctionAddress(function_name, DEVICE_TYPE));
+  overhead.Suspend();
   cl_int result = function(
       context, ptr, param_name, param_value_size,
       param_value, param_value_size_ret);
+  overhead.Resume();
 
   uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
-  collector->AddFunctionTime<DEVICE_TYPE>(function_name, end - start);
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -407,7 +600,7 @@ static cl_int clSetKernelArgMemPointerINTEL(
     cl_kernel kernel,
     cl_uint arg_index,
     const void* arg_value) {
-  TraceGuard guard;
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
   const char* function_name = "clSetKernelArgMemPointerINTEL";
 
   ClExtCollector* collector = ClExtCollector::GetInstance();
@@ -416,6 +609,7 @@ static cl_int clSetKernelArgMemPointerINTEL(
   cl_int current_error = CL_SUCCESS;
 
   uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -439,10 +633,15 @@ static cl_int clSetKernelArgMemPointerINTEL(
   decltype(clSetKernelArgMemPointerINTEL<DEVICE_TYPE>)* function =
     reinterpret_cast<decltype(clSetKernelArgMemPointerINTEL<DEVICE_TYPE>)*>(
         GetFunctionAddress(function_name, DEVICE_TYPE));
+  overhead.Suspend();
   cl_int result = function(kernel, arg_index, arg_value);
+  overhead.Resume();
 
   uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
-  collector->AddFunctionTime<DEVICE_TYPE>(function_name, end - start);
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -478,15 +677,20 @@ static cl_int clEnqueueMemcpyINTEL(
     cl_uint num_events_in_wait_list,
     const cl_event* event_wait_list,
     cl_event* event) {
-  TraceGuard guard;
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
   const char* function_name = "clEnqueueMemcpyINTEL";
 
-  ClExtCollector* collector = ClExtCollector::GetInstance();
-  FTRACE_ASSERT(collector != nullptr);
+  ClExtCollector* collector = ClExtCollector::GetInstance<DEVICE_TYPE>();
+  if (collector == nullptr) {
+    return EnqueueMemcpyINTEL<DEVICE_TYPE>(
+        overhead, command_queue, blocking, dst_ptr, src_ptr,
+        size, num_events_in_wait_list, event_wait_list, event);
+  }
 
   cl_int current_error = CL_SUCCESS;
 
   uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -512,15 +716,96 @@ static cl_int clEnqueueMemcpyINTEL(
     collector->Log<DEVICE_TYPE>(stream.str());
   }
 
-  decltype(clEnqueueMemcpyINTEL<DEVICE_TYPE>)* function =
-    reinterpret_cast<decltype(clEnqueueMemcpyINTEL<DEVICE_TYPE>)*>(
-        GetFunctionAddress(function_name, DEVICE_TYPE));
-  cl_int result = function(
-      command_queue, blocking, dst_ptr, src_ptr,
+  cl_int result = EnqueueMemcpyINTEL<DEVICE_TYPE>(
+      overhead, command_queue, blocking, dst_ptr, src_ptr,
       size, num_events_in_wait_list, event_wait_list, event);
 
   uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
-  collector->AddFunctionTime<DEVICE_TYPE>(function_name, end - start);
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
+
+  if (collector->IsCallTracing<DEVICE_TYPE>()) {
+    std::stringstream stream;
+    stream << "<<<< [" << end << "] ";
+    if (collector->NeedPid<DEVICE_TYPE>()) {
+      stream << "<PID:" << utils::GetPid() << "> ";
+    }
+    if (collector->NeedTid<DEVICE_TYPE>()) {
+      stream << "<TID:" << utils::GetTid() << "> ";
+    }
+    stream << function_name;
+    stream << " [" << (end - start) << " ns]";
+
+    stream << " -> " << utils::cl::GetErrorString(result);
+    stream << " (" << result << ")";
+    stream << std::endl;
+
+    collector->Log<DEVICE_TYPE>(stream.str());
+  }
+
+  collector->Callback<DEVICE_TYPE>(function_name, start, end);
+
+  return result;
+}
+
+template <cl_device_type DEVICE_TYPE>
+static cl_int clEnqueueMemFillINTEL(
+    cl_command_queue command_queue,
+    void* dst_ptr,
+    const void* pattern,
+    size_t pattern_size,
+    size_t size,
+    cl_uint num_events_in_wait_list,
+    const cl_event* event_wait_list,
+    cl_event* event) {
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
+  const char* function_name = "clEnqueueMemFillINTEL";
+
+  ClExtCollector* collector = ClExtCollector::GetInstance<DEVICE_TYPE>();
+  if (collector == nullptr) {
+    return EnqueueMemFillINTEL<DEVICE_TYPE>(
+        overhead, command_queue, dst_ptr, pattern, pattern_size,
+        size, num_events_in_wait_list, event_wait_list, event);
+  }
+
+  uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
+
+  if (collector->IsCallTracing<DEVICE_TYPE>()) {
+    std::stringstream stream;
+    stream << ">>>> [" << start << "] ";
+    if (collector->NeedPid<DEVICE_TYPE>()) {
+      stream << "<PID:" << utils::GetPid() << "> ";
+    }
+    if (collector->NeedTid<DEVICE_TYPE>()) {
+      stream << "<TID:" << utils::GetTid() << "> ";
+    }
+    stream << function_name << ":";
+
+    stream << " command_queue = " << command_queue;
+    stream << " dst_ptr = " << dst_ptr;
+    stream << " pattern = " << pattern;
+    stream << " pattern_size = " << pattern_size;
+    stream << " size = " << size;
+    stream << " num_events_in_wait_list = " << num_events_in_wait_list;
+    stream << " event_wait_list = " << event_wait_list;
+    stream << " event = " << event;
+    stream << std::endl;
+
+    collector->Log<DEVICE_TYPE>(stream.str());
+  }
+
+  cl_int result = EnqueueMemFillINTEL<DEVICE_TYPE>(
+      overhead, command_queue, dst_ptr, pattern, pattern_size,
+      size, num_events_in_wait_list, event_wait_list, event);
+
+  uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -553,7 +838,7 @@ static cl_int clGetDeviceGlobalVariablePointerINTEL(
     const char* global_variable_name,
     size_t* global_variable_size_ret,
     void** global_variable_pointer_ret) {
-  TraceGuard guard;
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
   const char* function_name = "clGetDeviceGlobalVariablePointerINTEL";
 
   ClExtCollector* collector = ClExtCollector::GetInstance();
@@ -562,6 +847,7 @@ static cl_int clGetDeviceGlobalVariablePointerINTEL(
   cl_int current_error = CL_SUCCESS;
 
   uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -588,12 +874,17 @@ static cl_int clGetDeviceGlobalVariablePointerINTEL(
     reinterpret_cast<decltype(
           clGetDeviceGlobalVariablePointerINTEL<DEVICE_TYPE>)*>(
               GetFunctionAddress(function_name, DEVICE_TYPE));
+  overhead.Suspend();
   cl_int result = function(
       device, program, global_variable_name,
       global_variable_size_ret, global_variable_pointer_ret);
+  overhead.Resume();
 
   uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
-  collector->AddFunctionTime<DEVICE_TYPE>(function_name, end - start);
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -627,7 +918,7 @@ static cl_int clGetKernelSuggestedLocalWorkSizeINTEL(
     const size_t* global_work_offset,
     const size_t* global_work_size,
     size_t* suggested_local_work_size) {
-  TraceGuard guard;
+  TracerOverheadScope overhead(TRACER_HOOK_CL_EXT);
   const char* function_name = "clGetKernelSuggestedLocalWorkSizeINTEL";
 
   ClExtCollector* collector = ClExtCollector::GetInstance();
@@ -636,6 +927,7 @@ static cl_int clGetKernelSuggestedLocalWorkSizeINTEL(
   cl_int current_error = CL_SUCCESS;
 
   uint64_t start = collector->GetTimestamp<DEVICE_TYPE>();
+  collector->EnterFunction<DEVICE_TYPE>(function_name, start);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
@@ -663,12 +955,17 @@ static cl_int clGetKernelSuggestedLocalWorkSizeINTEL(
     reinterpret_cast<decltype(
           clGetKernelSuggestedLocalWorkSizeINTEL<DEVICE_TYPE>)*>(
               GetFunctionAddress(function_name, DEVICE_TYPE));
+  overhead.Suspend();
   cl_int result = function(
       command_queue, kernel, workDim, global_work_offset,
       global_work_size, suggested_local_work_size);
+  overhead.Resume();
 
   uint64_t end = collector->GetTimestamp<DEVICE_TYPE>();
-  collector->AddFunctionTime<DEVICE_TYPE>(function_name, end - start);
+  uint64_t nested_time =
+    collector->ExitFunction<DEVICE_TYPE>(function_name, end);
+  collector->AddFunctionTime<DEVICE_TYPE>(
+      function_name, end - start - nested_time);
 
   if (collector->IsCallTracing<DEVICE_TYPE>()) {
     std::stringstream stream;
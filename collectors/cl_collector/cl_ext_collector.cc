@@ -23,6 +23,26 @@ void ClExtCollector::AddFunctionTimeGPU(
   gpu_collector_->AddFunctionTime(function_name, time);
 }
 
+void ClExtCollector::EnterFunctionCPU(
+    const char* function_name, uint64_t start) {
+  cpu_collector_->correlator_->EnterApiCall(function_name, start);
+}
+
+void ClExtCollector::EnterFunctionGPU(
+    const char* function_name, uint64_t start) {
+  gpu_collector_->correlator_->EnterApiCall(function_name, start);
+}
+
+uint64_t ClExtCollector::ExitFunctionCPU(
+    const char* function_name, uint64_t end) {
+  return cpu_collector_->correlator_->ExitApiCall(function_name, end);
+}
+
+uint64_t ClExtCollector::ExitFunctionGPU(
+    const char* function_name, uint64_t end) {
+  return gpu_collector_->correlator_->ExitApiCall(function_name, end);
+}
+
 bool ClExtCollector::IsCallTracingCPU() const {
   return cpu_collector_->options_.call_tracing;
 }
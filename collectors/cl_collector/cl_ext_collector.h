@@ -22,6 +22,7 @@ class ClExtCollector {
   static void Destroy() {
     if (instance_ != nullptr) {
       delete instance_;
+      instance_ = nullptr;
     }
   }
 
@@ -29,6 +30,19 @@ class ClExtCollector {
     return instance_;
   }
 
+  // USM wrappers are also installed by kernel collectors to track memory,
+  // null means API calls are not timed for the device type
+  template <cl_device_type DEVICE_TYPE>
+  static ClExtCollector* GetInstance() {
+    if (instance_ == nullptr) {
+      return nullptr;
+    }
+    if (DEVICE_TYPE == CL_DEVICE_TYPE_GPU) {
+      return (instance_->gpu_collector_ != nullptr) ? instance_ : nullptr;
+    }
+    return (instance_->cpu_collector_ != nullptr) ? instance_ : nullptr;
+  }
+
   template <cl_device_type DEVICE_TYPE>
   uint64_t GetTimestamp() const {
     if (DEVICE_TYPE == CL_DEVICE_TYPE_GPU) {
@@ -57,6 +71,35 @@ class ClExtCollector {
   void AddFunctionTimeCPU(const char* function_name, uint64_t time);
   void AddFunctionTimeGPU(const char* function_name, uint64_t time);
 
+  template <cl_device_type DEVICE_TYPE>
+  void EnterFunction(const char* function_name, uint64_t start) {
+    if (DEVICE_TYPE == CL_DEVICE_TYPE_GPU) {
+      FTRACE_ASSERT(gpu_collector_ != nullptr);
+      EnterFunctionGPU(function_name, start);
+    } else {
+      FTRACE_ASSERT(cpu_collector_ != nullptr);
+      EnterFunctionCPU(function_name, start);
+    }
+  }
+
+  void EnterFunctionCPU(const char* function_name, uint64_t start);
+  void EnterFunctionGPU(const char* function_name, uint64_t start);
+
+  // Returns the time of traced calls made from inside of the function
+  template <cl_device_type DEVICE_TYPE>
+  uint64_t ExitFunction(const char* function_name, uint64_t end) {
+    if (DEVICE_TYPE == CL_DEVICE_TYPE_GPU) {
+      FTRACE_ASSERT(gpu_collector_ != nullptr);
+      return ExitFunctionGPU(function_name, end);
+    } else {
+      FTRACE_ASSERT(cpu_collector_ != nullptr);
+      return ExitFunctionCPU(function_name, end);
+    }
+  }
+
+  uint64_t ExitFunctionCPU(const char* function_name, uint64_t end);
+  uint64_t ExitFunctionGPU(const char* function_name, uint64_t end);
+
   template <cl_device_type DEVICE_TYPE>
   bool IsCallTracing() const {
     if (DEVICE_TYPE == CL_DEVICE_TYPE_GPU) {
@@ -0,0 +1,3 @@
+#include "cl_kernel_collector.h"
+
+std::atomic<uint64_t> ClKernelCollector::kernel_id_(1);
@@ -2,6 +2,7 @@
 #define FTRACE_TOOLS_COLLECTORS_CL_COLLECTOR_CL_KERNEL_COLLECTOR_H_
 
 #include <atomic>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <list>
@@ -11,10 +12,28 @@
 #include <string>
 #include <vector>
 
+#include "alloc_index.h"
 #include "cl_api_tracer.h"
+#include "cl_ext_callbacks.h"
 #include "cl_utils.h"
 #include "correlator.h"
+#include "dependency_graph.h"
+#include "device_utilization.h"
+#include "host_stall.h"
+#include "iteration_detector.h"
+#include "kernel_resources.h"
+#include "kernel_key.h"
+#include "latency_histogram.h"
+#include "launch_statistics.h"
+#include "memory_tracker.h"
+#include "module_builds.h"
+#include "object_churn.h"
+#include "occupancy.h"
+#include "scaling_model.h"
 #include "trace_guard.h"
+#include "tracer_overhead.h"
+#include "transfer_advisor.h"
+#include "transfer_statistics.h"
 
 #ifdef FTRACE_KERNEL_INTERVALS
 #include "prof_utils.h"
@@ -39,15 +58,20 @@ struct ClKernelProps {
   size_t bytes_transferred;
   size_t global_size[3];
   size_t local_size[3];
+  uint64_t local_memory; // Zero if kernel resources are not captured
 };
 
 struct ClKernelInstance {
   cl_event event = nullptr;
   ClKernelProps props;
   uint64_t kernel_id = 0;
+  uint32_t name_id = 0;
   cl_ulong host_sync = 0;
   cl_ulong device_sync = 0;
+  uint64_t launch_id = 0;
+  size_t dependency_node = DependencyGraph::kNoNode;
   bool need_to_process = true;
+  TransferPattern transfer;
 };
 
 struct ClKernelInfo {
@@ -57,6 +81,8 @@ struct ClKernelInfo {
   uint64_t min_time;
   uint64_t max_time;
   uint64_t call_count;
+  LatencyHistogram submit_histogram;
+  LatencyHistogram execute_histogram;
 
   bool operator>(const ClKernelInfo& r) const {
     if (execute_time != r.execute_time) {
@@ -73,8 +99,18 @@ struct ClKernelInfo {
   }
 };
 
+// Program sources, IL or binaries and specialization constants
+struct ClProgramInput {
+  uint64_t hash;
+  uint64_t size;
+  std::map<cl_uint, uint64_t> constant_map;
+};
+
 using ClKernelInfoMap = std::map<std::string, ClKernelInfo>;
 using ClKernelInstanceList = std::list<ClKernelInstance*>;
+using ClProgramInputMap = std::map<cl_program, ClProgramInput>;
+using ClKernelResourceMap =
+  std::map<cl_kernel, std::pair<std::string, KernelResources>>;
 
 #ifdef FTRACE_KERNEL_INTERVALS
 
@@ -113,13 +149,16 @@ class ClKernelCollector {
       Correlator* correlator,
       KernelCollectorOptions options,
       OnClKernelFinishCallback callback = nullptr,
-      void* callback_data = nullptr) {
+      void* callback_data = nullptr,
+      OnHostStallCallback stall_callback = nullptr,
+      OnIterationCallback iteration_callback = nullptr) {
     FTRACE_ASSERT(device != nullptr);
     FTRACE_ASSERT(correlator != nullptr);
     TraceGuard guard;
 
     ClKernelCollector* collector = new ClKernelCollector(
-        device, correlator, options, callback, callback_data);
+        device, correlator, options, callback, callback_data,
+        stall_callback, iteration_callback);
     FTRACE_ASSERT(collector != nullptr);
 
     ClApiTracer* tracer = new ClApiTracer(device, Callback, collector);
@@ -134,6 +173,7 @@ class ClKernelCollector {
     }
 
     collector->EnableTracing(tracer);
+    collector->SetTransferHooks(&collector->transfer_hooks_);
     return collector;
   }
 
@@ -150,10 +190,107 @@ class ClKernelCollector {
     FTRACE_ASSERT(tracer_ != nullptr);
     bool disabled = tracer_->Disable();
     FTRACE_ASSERT(disabled);
+    SetTransferHooks(nullptr);
+  }
+
+  // Aggregation level of the summary tables, there are no per tile parts
+  // for OpenCL(TM)
+  uint32_t GetSummaryLevel() const {
+    return options_.verbose ? KERNEL_KEY_CONFIG : KERNEL_KEY_NAME;
+  }
+
+  ClKernelInfoMap GetKernelInfoMap() const {
+    return GetKernelInfoMap(GetSummaryLevel());
+  }
+
+  ClKernelInfoMap GetKernelInfoMap(uint32_t level) const {
+    return RollUpKernelKeys(
+        kernel_info_map_, level,
+        [this](const KernelKey& key, uint32_t key_level) {
+          return GetKeyName(key, key_level);
+        },
+        MergeKernelInfo);
+  }
+
+  ClKernelInfoMap GetKernelInfoMapSnapshot() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    return GetKernelInfoMap();
+  }
+
+  void PrintSteadyStateTable() const {
+    std::set<const void*> device_set;
+    for (auto& value : launch_stats_map_) {
+      device_set.insert(value.first.device);
+    }
+    uint32_t level = GetSummaryLevel() | KERNEL_KEY_CONFIG;
+    if (device_set.size() > 1) {
+      level |= KERNEL_KEY_DEVICE;
+    }
+
+    std::map<std::string, LaunchStatistics> stats_map;
+    for (auto& value : launch_stats_map_) {
+      stats_map[GetKeyName(value.first, level)] = value.second;
+    }
+
+    std::string table = LaunchStatistics::GetSteadyStateTable(stats_map);
+    if (!table.empty()) {
+      FTRACE_ASSERT(correlator_ != nullptr);
+      correlator_->Log(table);
+    }
+  }
+
+  HostStallInfoMap GetHostStallInfoMap() const {
+    return host_stalls_.GetStallInfoMap();
+  }
+
+  void PrintCriticalPathTable() {
+    PrintTable([this]() { return dependency_graph_.GetCriticalPathTable(); });
+  }
+
+  void ExportGraph(ExecGraph* graph) {
+    FTRACE_ASSERT(graph != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    dependency_graph_.Export(graph, "CL");
+  }
+
+  void PrintUtilizationTable() {
+    PrintTable([this]() { return utilization_.GetUtilizationTable(); });
+  }
+
+  void PrintIterationTable() {
+    PrintTable([this]() { return iterations_.GetIterationTable(); });
+  }
+
+  void PrintTransferTable() {
+    PrintTable([this]() { return transfers_.GetTransferTable(); });
   }
 
-  const ClKernelInfoMap& GetKernelInfoMap() const {
-    return kernel_info_map_;
+  void PrintKernelResourceTable() {
+    PrintTable([this]() { return kernel_resources_.GetResourceTable(); });
+  }
+
+  void PrintOccupancyTable() {
+    PrintTable([this]() { return occupancy_.GetOccupancyTable(); });
+  }
+
+  void PrintScalingTable() {
+    PrintTable([this]() { return scaling_.GetScalingTable(); });
+  }
+
+  void PrintObjectChurnTable() {
+    PrintTable([this]() { return object_churn_.GetChurnTable(); });
+  }
+
+  void PrintTransferAdviceTable() {
+    PrintTable([this]() { return transfer_advisor_.GetAdviceTable(); });
+  }
+
+  void PrintHostStallTable() const {
+    std::string table = host_stalls_.GetStallTable();
+    if (!table.empty()) {
+      FTRACE_ASSERT(correlator_ != nullptr);
+      correlator_->Log(table);
+    }
   }
 
 #ifdef FTRACE_KERNEL_INTERVALS
@@ -166,9 +303,14 @@ class ClKernelCollector {
   ClKernelCollector& operator=(const ClKernelCollector& copy) = delete;
 
   void PrintKernelsTable() const {
+    PrintKernelsTable(GetSummaryLevel());
+  }
+
+  void PrintKernelsTable(uint32_t level) const {
+    ClKernelInfoMap kernel_info_map = GetKernelInfoMap(level);
     std::set< std::pair<std::string, ClKernelInfo>,
               utils::Comparator > sorted_list(
-        kernel_info_map_.begin(), kernel_info_map_.end());
+        kernel_info_map.begin(), kernel_info_map.end());
 
     uint64_t total_duration = 0;
     size_t max_name_length = kKernelLength;
@@ -190,7 +332,11 @@ class ClKernelCollector {
       std::setw(kPercentLength) << "Time (%)" << "," <<
       std::setw(kTimeLength) << "Average (ns)" << "," <<
       std::setw(kTimeLength) << "Min (ns)" << "," <<
-      std::setw(kTimeLength) << "Max (ns)" << std::endl;
+      std::setw(kTimeLength) << "Max (ns)" << "," <<
+      std::setw(kTimeLength) << "p50 (ns)" << "," <<
+      std::setw(kTimeLength) << "p90 (ns)" << "," <<
+      std::setw(kTimeLength) << "p99 (ns)" << "," <<
+      std::setw(kTimeLength) << "p99.9 (ns)" << std::endl;
 
     for (auto& value : sorted_list) {
       const std::string& function = value.first;
@@ -199,6 +345,7 @@ class ClKernelCollector {
       uint64_t avg_duration = duration / call_count;
       uint64_t min_duration = value.second.min_time;
       uint64_t max_duration = value.second.max_time;
+      const LatencyHistogram& histogram = value.second.execute_histogram;
       float percent_duration = 100.0f * duration / total_duration;
       stream << std::setw(max_name_length) << function << "," <<
         std::setw(kCallsLength) << call_count << "," <<
@@ -207,7 +354,11 @@ class ClKernelCollector {
           std::fixed << percent_duration << "," <<
         std::setw(kTimeLength) << avg_duration << "," <<
         std::setw(kTimeLength) << min_duration << "," <<
-        std::setw(kTimeLength) << max_duration << std::endl;
+        std::setw(kTimeLength) << max_duration << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(50.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(90.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.9) << std::endl;
     }
 
     FTRACE_ASSERT(correlator_ != nullptr);
@@ -215,9 +366,10 @@ class ClKernelCollector {
   }
 
   void PrintSubmissionTable() const {
+    ClKernelInfoMap kernel_info_map = GetKernelInfoMap();
     std::set< std::pair<std::string, ClKernelInfo>,
               utils::Comparator > sorted_list(
-        kernel_info_map_.begin(), kernel_info_map_.end());
+        kernel_info_map.begin(), kernel_info_map.end());
 
     uint64_t total_queued_duration = 0;
     uint64_t total_submit_duration = 0;
@@ -244,7 +396,11 @@ class ClKernelCollector {
       std::setw(kTimeLength) << "Submit (ns)" << "," <<
       std::setw(kPercentLength) << "Submit (%)" << "," <<
       std::setw(kTimeLength) << "Execute (ns)" << "," <<
-      std::setw(kPercentLength) << "Execute (%)" << "," << std::endl;
+      std::setw(kPercentLength) << "Execute (%)" << "," <<
+      std::setw(kTimeLength) << "Submit p50 (ns)" << "," <<
+      std::setw(kTimeLength) << "Submit p90 (ns)" << "," <<
+      std::setw(kTimeLength) << "Submit p99 (ns)" << "," <<
+      std::setw(kTimeLength) << "Submit p99.9 (ns)" << "," << std::endl;
 
     for (auto& value : sorted_list) {
       const std::string& function = value.first;
@@ -258,6 +414,7 @@ class ClKernelCollector {
       uint64_t execute_duration = value.second.execute_time;
       float execute_percent =
         100.0f * execute_duration / total_execute_duration;
+      const LatencyHistogram& histogram = value.second.submit_histogram;
       stream << std::setw(max_name_length) << function << "," <<
         std::setw(kCallsLength) << call_count << "," <<
         std::setw(kTimeLength) << queued_duration << "," <<
@@ -268,7 +425,32 @@ class ClKernelCollector {
           std::fixed << submit_percent << "," <<
         std::setw(kTimeLength) << execute_duration << "," <<
         std::setw(kPercentLength) << std::setprecision(2) <<
-          std::fixed << execute_percent << "," << std::endl;
+          std::fixed << execute_percent << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(50.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(90.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.9) << "," <<
+        std::endl;
+    }
+
+    FTRACE_ASSERT(correlator_ != nullptr);
+    correlator_->Log(stream.str());
+  }
+
+  void PrintHistograms() const {
+    ClKernelInfoMap kernel_info_map = GetKernelInfoMap();
+    std::set< std::pair<std::string, ClKernelInfo>,
+              utils::Comparator > sorted_list(
+        kernel_info_map.begin(), kernel_info_map.end());
+    if (sorted_list.empty()) {
+      return;
+    }
+
+    std::stringstream stream;
+    for (auto& value : sorted_list) {
+      stream << "Kernel: " << value.first << std::endl;
+      stream << value.second.execute_histogram.GetBucketTable();
+      stream << std::endl;
     }
 
     FTRACE_ASSERT(correlator_ != nullptr);
@@ -276,20 +458,43 @@ class ClKernelCollector {
   }
 
  private: // Implementation Details
+  // Tables are built under the lock and logged out of it
+  template <class Builder>
+  void PrintTable(Builder builder) {
+    std::string table;
+    {
+      const std::lock_guard<std::mutex> lock(lock_);
+      table = builder();
+    }
+    if (!table.empty()) {
+      FTRACE_ASSERT(correlator_ != nullptr);
+      correlator_->Log(table);
+    }
+  }
+
   ClKernelCollector(
       cl_device_id device,
       Correlator* correlator,
       KernelCollectorOptions options,
       OnClKernelFinishCallback callback,
-      void* callback_data)
+      void* callback_data,
+      OnHostStallCallback stall_callback,
+      OnIterationCallback iteration_callback)
       : device_(device),
         correlator_(correlator),
         options_(options),
         callback_(callback),
         callback_data_(callback_data),
-        kernel_id_(1) {
+        stall_callback_(stall_callback),
+        iterations_(iteration_callback, callback_data) {
     FTRACE_ASSERT(device_ != nullptr);
     FTRACE_ASSERT(correlator_ != nullptr);
+    if (options_.occupancy) {
+      device_layout_ = GetDeviceLayout(device_);
+    }
+    if (options_.record_graph) {
+      dependency_graph_.SetWindowSize(0);
+    }
 #ifdef FTRACE_KERNEL_INTERVALS
     ze_device_ = GetZeDevice(device_);
     FTRACE_ASSERT(ze_device_ != nullptr);
@@ -322,6 +527,19 @@ class ClKernelCollector {
   }
 #endif // FTRACE_KERNEL_INTERVALS
 
+  // One collector per device type, hooks are reset before it is deleted
+  void SetTransferHooks(const ClExtTransferHooks* hooks) {
+    cl_device_type type = utils::cl::GetDeviceType(device_);
+    if (type == CL_DEVICE_TYPE_GPU) {
+      GetTransferHooks<CL_DEVICE_TYPE_GPU>().store(
+          hooks, std::memory_order_release);
+    } else {
+      FTRACE_ASSERT(type == CL_DEVICE_TYPE_CPU);
+      GetTransferHooks<CL_DEVICE_TYPE_CPU>().store(
+          hooks, std::memory_order_release);
+    }
+  }
+
   void EnableTracing(ClApiTracer* tracer) {
     FTRACE_ASSERT(tracer != nullptr);
     tracer_ = tracer;
@@ -365,6 +583,20 @@ class ClKernelCollector {
         CL_FUNCTION_clEnqueueCopyImageToBuffer);
     set = set && tracer->SetTracingFunction(
         CL_FUNCTION_clEnqueueCopyBufferToImage);
+    set = set && tracer->SetTracingFunction(
+        CL_FUNCTION_clEnqueueSVMMemcpy);
+    set = set && tracer->SetTracingFunction(
+        CL_FUNCTION_clEnqueueSVMMemFill);
+    FTRACE_ASSERT(set);
+
+    set = set && tracer->SetTracingFunction(
+        CL_FUNCTION_clSVMAlloc);
+    set = set && tracer->SetTracingFunction(
+        CL_FUNCTION_clSVMFree);
+    set = set && tracer->SetTracingFunction(
+        CL_FUNCTION_clGetExtensionFunctionAddress);
+    set = set && tracer->SetTracingFunction(
+        CL_FUNCTION_clGetExtensionFunctionAddressForPlatform);
     FTRACE_ASSERT(set);
 
     set = set && tracer->SetTracingFunction(
@@ -377,14 +609,237 @@ class ClKernelCollector {
         CL_FUNCTION_clWaitForEvents);
     FTRACE_ASSERT(set);
 
+    if (options_.memory || options_.object_churn) {
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clCreateBuffer);
+      FTRACE_ASSERT(set);
+    }
+
+    if (options_.object_churn) {
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clCreateKernel);
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clReleaseKernel);
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clReleaseMemObject);
+      FTRACE_ASSERT(set);
+    }
+
+    if (options_.module_builds || options_.object_churn) {
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clCreateProgramWithSource);
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clCreateProgramWithIL);
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clCreateProgramWithBinary);
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clBuildProgram);
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clCompileProgram);
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clLinkProgram);
+      set = set && tracer->SetTracingFunction(
+          CL_FUNCTION_clReleaseProgram);
+      FTRACE_ASSERT(set);
+      // Not traced by older runtimes, constants are not captured then
+      tracer->SetTracingFunction(
+          CL_FUNCTION_clSetProgramSpecializationConstant);
+    }
+
     bool enabled = tracer_->Enable();
     FTRACE_ASSERT(enabled);
   }
 
+  void AddProgramInput(cl_program program, const ClProgramInput& input) {
+    FTRACE_ASSERT(program != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    program_input_map_[program] = input;
+  }
+
+  // Constants set later for the same id replace the previous ones
+  void AddProgramConstant(
+      cl_program program, cl_uint id, const void* value, size_t size) {
+    FTRACE_ASSERT(program != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    auto it = program_input_map_.find(program);
+    if (it != program_input_map_.end()) {
+      it->second.constant_map[id] =
+        ModuleBuilds::GetConstantHash(id, value, size);
+    }
+  }
+
+  // Returns false for programs created by other means, e.g. from
+  // built-in kernels. Constants are folded into the hash
+  bool GetProgramInput(cl_program program, ClProgramInput& input) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    auto it = program_input_map_.find(program);
+    if (it == program_input_map_.end()) {
+      return false;
+    }
+    input = it->second;
+    for (auto& constant : input.constant_map) {
+      input.hash = ModuleBuilds::GetFingerprint(
+          input.hash ^ constant.second, nullptr);
+    }
+    input.constant_map.clear();
+    return true;
+  }
+
+  void RemoveProgramInput(cl_program program) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    program_input_map_.erase(program);
+  }
+
+  void AddObject(
+      ObjectType type, const void* handle, uint64_t fingerprint,
+      const std::string& label, uint64_t time) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    object_churn_.AddObject(type, handle, fingerprint, label, time);
+  }
+
+  uint64_t GetObjectFingerprint(const void* handle) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    return object_churn_.GetFingerprint(handle);
+  }
+
+  void AddObjectCommand(
+      const void* handle, uint64_t fingerprint, uint64_t time) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    object_churn_.AddCommand(handle, fingerprint, time);
+  }
+
+  void RemoveObject(const void* handle, uint64_t time) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    object_churn_.RemoveObject(handle, time);
+  }
+
+  // Kernel release is not traced, so the handle may be reused by another
+  // kernel: properties are queried again if the name differs
+  KernelResources CaptureKernelResources(
+      cl_device_id device, cl_kernel kernel, const std::string& name) {
+    FTRACE_ASSERT(device != nullptr);
+    FTRACE_ASSERT(kernel != nullptr);
+    {
+      const std::lock_guard<std::mutex> lock(lock_);
+      auto it = kernel_resource_map_.find(kernel);
+      if (it != kernel_resource_map_.end() && it->second.first == name) {
+        return it->second.second;
+      }
+    }
+
+    KernelResources resources;
+    resources.private_memory = utils::cl::GetKernelMemorySize(
+        device, kernel, CL_KERNEL_PRIVATE_MEM_SIZE);
+    resources.spill_memory = utils::cl::GetKernelMemorySize(
+        device, kernel, CL_KERNEL_SPILL_MEM_SIZE_INTEL);
+    resources.local_memory = utils::cl::GetKernelMemorySize(
+        device, kernel, CL_KERNEL_LOCAL_MEM_SIZE);
+    resources.required_subgroup_size = static_cast<uint32_t>(
+        utils::cl::GetKernelRequiredSubgroupSize(device, kernel));
+    resources.grf_count = KernelResourceTable::GetGrfCount(
+        utils::cl::GetProgramBuildOptions(device, kernel).c_str());
+
+    const std::lock_guard<std::mutex> lock(lock_);
+    kernel_resource_map_[kernel] = std::make_pair(name, resources);
+    kernel_resources_.AddKernel(name, resources);
+    return resources;
+  }
+
+  // Layout is known for Intel(R) GPUs only, for other devices launches
+  // are not analyzed
+  static DeviceLayout GetDeviceLayout(cl_device_id device) {
+    FTRACE_ASSERT(device != nullptr);
+    DeviceLayout layout;
+    layout.subslice_count =
+      utils::cl::GetDeviceAttribute(device, CL_DEVICE_NUM_SLICES_INTEL) *
+      utils::cl::GetDeviceAttribute(
+          device, CL_DEVICE_NUM_SUB_SLICES_PER_SLICE_INTEL);
+    layout.threads_per_subslice =
+      utils::cl::GetDeviceAttribute(
+          device, CL_DEVICE_NUM_EUS_PER_SUB_SLICE_INTEL) *
+      utils::cl::GetDeviceAttribute(
+          device, CL_DEVICE_NUM_THREADS_PER_EU_INTEL);
+
+    cl_ulong local_memory = 0;
+    cl_int status = clGetDeviceInfo(
+        device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong),
+        &local_memory, nullptr);
+    FTRACE_ASSERT(status == CL_SUCCESS);
+    layout.local_memory = local_memory;
+    return layout;
+  }
+
+  // Work-items for kernels and bytes for transfers
+  static uint64_t GetLaunchSize(const ClKernelProps& props) {
+    if (props.simd_width == 0) {
+      return props.bytes_transferred;
+    }
+    uint64_t size = 1;
+    for (int i = 0; i < 3; ++i) {
+      size *= props.global_size[i];
+    }
+    return size;
+  }
+
+  // Launches with local size chosen by the driver are not analyzed
+  static LaunchShape GetLaunchShape(const ClKernelProps& props) {
+    LaunchShape shape{};
+    shape.group_count = 1;
+    for (int i = 0; i < 3; ++i) {
+      shape.group_size[i] = static_cast<uint32_t>(props.local_size[i]);
+      if (props.local_size[i] == 0) {
+        shape.group_count = 0;
+      } else {
+        shape.group_count *=
+          (props.global_size[i] + props.local_size[i] - 1) /
+          props.local_size[i];
+      }
+    }
+    shape.simd_width = static_cast<uint32_t>(props.simd_width);
+    shape.local_memory = props.local_memory;
+    return shape;
+  }
+
   void AddKernelInstance(ClKernelInstance* instance) {
     FTRACE_ASSERT(instance != nullptr);
     const std::lock_guard<std::mutex> lock(lock_);
+    instance->name_id = kernel_names_.GetId(instance->props.name);
+    if (options_.iterations) {
+      instance->launch_id =
+        iterations_.AddLaunch(instance->name_id, instance->host_sync);
+    }
+    if (options_.critical_path) {
+      AddDependencyNode(instance);
+    }
+    if (options_.transfer_advice) {
+      cl_command_queue queue = utils::cl::GetCommandQueue(instance->event);
+      FTRACE_ASSERT(queue != nullptr);
+      if (instance->props.bytes_transferred > 0) {
+        transfer_advisor_.AddTransfer(
+            queue, instance->props.name,
+            instance->props.bytes_transferred, instance->transfer);
+      } else {
+        transfer_advisor_.AddCommand(queue);
+      }
+    }
     kernel_instance_list_.push_back(instance);
+    TracerOverhead::AddMemory(sizeof(ClKernelInstance));
+    TracerOverhead::UpdatePendingDepth(kernel_instance_list_.size());
+  }
+
+  // Each command is a separate submission to an in-order queue,
+  // event wait lists are not captured, so signal events are not kept
+  void AddDependencyNode(ClKernelInstance* instance) {
+    FTRACE_ASSERT(instance != nullptr);
+    FTRACE_ASSERT(instance->event != nullptr);
+    cl_command_queue queue = utils::cl::GetCommandQueue(instance->event);
+    FTRACE_ASSERT(queue != nullptr);
+
+    dependency_graph_.BeginSubmission(queue);
+    instance->dependency_node = dependency_graph_.AddNode(
+        queue, instance->host_sync, nullptr,
+        std::vector<const void*>(), false);
+    TracerOverhead::AddMemory(sizeof(DependencyNode));
   }
 
   static void ComputeHostTimestamps(
@@ -445,13 +900,6 @@ class ClKernelCollector {
       FTRACE_ASSERT(device != nullptr);
       AddKernelInterval(instance, device, started, ended);
 #else // FTRACE_KERNEL_INTERVALS
-      std::string name = instance->props.name;
-      FTRACE_ASSERT(!name.empty());
-
-      if (options_.verbose) {
-        name = GetVerboseName(&(instance->props));
-      }
-
       uint64_t host_queued = 0, host_submitted = 0;
       uint64_t host_started = 0, host_ended = 0;
       ComputeHostTimestamps(
@@ -460,11 +908,72 @@ class ClKernelCollector {
           host_queued, host_submitted,
           host_started, host_ended);
 
+      KernelKey key = GetKernelKey(instance);
       AddKernelInfo(
-        name,
+        key,
         host_submitted - host_queued,
         host_started - host_submitted,
         host_ended - host_started);
+      if (options_.steady_state) {
+        launch_stats_map_[key].Record(
+            host_ended - host_started, instance->kernel_id, 0,
+            options_.warm_up_count);
+      }
+      if (options_.iterations) {
+        iterations_.AddDeviceTime(
+            instance->launch_id, host_ended - host_started);
+      }
+      if (options_.transfers && instance->props.bytes_transferred > 0) {
+        transfers_.Add(
+            GetTransferDirection(instance->props.name), device_,
+            instance->props.bytes_transferred, host_ended - host_started);
+      }
+      if (options_.transfer_advice &&
+          instance->props.bytes_transferred > 0) {
+        transfer_advisor_.AddTime(
+            instance->transfer, host_ended - host_started);
+      }
+      if (options_.kernel_resources && instance->props.simd_width > 0) {
+        kernel_resources_.AddTime(
+            instance->props.name, host_ended - host_started);
+      }
+      if (options_.occupancy && instance->props.simd_width > 0) {
+        occupancy_.AddLaunch(
+            instance->props.name, device_layout_,
+            GetLaunchShape(instance->props), host_ended - host_started);
+      }
+      if (options_.scaling) {
+        scaling_.AddLaunch(
+            instance->props.name, device_, instance->props.simd_width == 0,
+            GetLaunchSize(instance->props), host_ended - host_started);
+      }
+
+      std::string name = instance->props.name;
+      FTRACE_ASSERT(!name.empty());
+
+      if (options_.verbose) {
+        name = GetVerboseName(&(instance->props));
+      }
+
+      if (instance->dependency_node != DependencyGraph::kNoNode) {
+        dependency_graph_.CompleteNode(
+            instance->dependency_node, name, host_started, host_ended);
+      }
+
+      if (options_.utilization) {
+        std::stringstream stream;
+        stream << "Queue " << std::hex << queue;
+        utilization_.AddInterval(
+            {stream.str()}, GetUtilizationKind(&(instance->props)),
+            host_queued, host_started, host_ended);
+        TracerOverhead::AddMemory(2 * sizeof(UtilizationInterval));
+      }
+
+      if (host_stalls_.IsWaiting()) {
+        host_stalls_.AddCompletion(
+            name, std::to_string(instance->kernel_id),
+            host_started, host_ended);
+      }
 
       if (callback_ != nullptr) {
         std::stringstream stream;
@@ -483,6 +992,7 @@ class ClKernelCollector {
     FTRACE_ASSERT(status == CL_SUCCESS);
 
     delete instance;
+    TracerOverhead::RemoveMemory(sizeof(ClKernelInstance));
   }
 
   void ProcessKernelInstance(cl_event event) {
@@ -525,7 +1035,78 @@ class ClKernelCollector {
     }
   }
 
-  std::string GetVerboseName(const ClKernelProps* props) {
+  static UtilizationKind GetUtilizationKind(const ClKernelProps* props) {
+    FTRACE_ASSERT(props != nullptr);
+    if (props->simd_width > 0) {
+      return UTILIZATION_COMPUTE;
+    }
+    if (props->bytes_transferred > 0) {
+      return UTILIZATION_TRANSFER;
+    }
+    return UTILIZATION_OTHER;
+  }
+
+  KernelKey GetKernelKey(const ClKernelInstance* instance) const {
+    FTRACE_ASSERT(instance != nullptr);
+    KernelKey key{};
+    key.name_id = instance->name_id;
+    key.tile = -1;
+    key.simd_width = instance->props.simd_width;
+    key.bytes_transferred = instance->props.bytes_transferred;
+    if (instance->props.simd_width > 0) {
+      for (size_t i = 0; i < 3; ++i) {
+        key.size[i] = instance->props.global_size[i];
+        key.size[i + 3] = instance->props.local_size[i];
+      }
+    }
+    key.device = device_;
+    return key;
+  }
+
+  std::string GetKeyName(const KernelKey& key, uint32_t level) const {
+    std::string name = kernel_names_.GetName(key.name_id);
+    if (level & KERNEL_KEY_CONFIG) {
+      ClKernelProps props{};
+      props.name = name;
+      props.simd_width = key.simd_width;
+      props.bytes_transferred = key.bytes_transferred;
+      for (size_t i = 0; i < 3; ++i) {
+        props.global_size[i] = key.size[i];
+        props.local_size[i] = key.size[i + 3];
+      }
+      name = GetVerboseName(&props);
+    }
+    if (level & KERNEL_KEY_DEVICE) {
+      std::stringstream stream;
+      stream << name << " on Device " << key.device;
+      name = stream.str();
+    }
+    return name;
+  }
+
+  // Buffers and images live on the device, the other side of read and
+  // write is host memory. USM and SVM transfers have the letters in their
+  // names already
+  static std::string GetTransferDirection(const std::string& name) {
+    if (name.find('(') != std::string::npos) {
+      return TransferStatistics::GetDirection(name);
+    }
+    if (name.find("Fill") != std::string::npos) {
+      return "Fill D";
+    }
+    if (name.find("Read") != std::string::npos) {
+      return "D2M";
+    }
+    if (name.find("Write") != std::string::npos) {
+      return "M2D";
+    }
+    if (name.find("Copy") != std::string::npos) {
+      return "D2D";
+    }
+    return name;
+  }
+
+  std::string GetVerboseName(const ClKernelProps* props) const {
     FTRACE_ASSERT(props != nullptr);
     FTRACE_ASSERT(!props->name.empty());
 
@@ -554,11 +1135,10 @@ class ClKernelCollector {
   }
 
   void AddKernelInfo(
-      std::string name, uint64_t queued_time,
+      const KernelKey& key, uint64_t queued_time,
       uint64_t submit_time, uint64_t execute_time) {
-    FTRACE_ASSERT(!name.empty());
-
-    if (kernel_info_map_.count(name) == 0) {
+    auto it = kernel_info_map_.find(key);
+    if (it == kernel_info_map_.end()) {
       ClKernelInfo info;
       info.queued_time = queued_time;
       info.submit_time = submit_time;
@@ -566,9 +1146,11 @@ class ClKernelCollector {
       info.min_time = execute_time;
       info.max_time = execute_time;
       info.call_count = 1;
-      kernel_info_map_[name] = info;
+      info.submit_histogram.Record(submit_time);
+      info.execute_histogram.Record(execute_time);
+      kernel_info_map_[key] = info;
     } else {
-      ClKernelInfo& kernel = kernel_info_map_[name];
+      ClKernelInfo& kernel = it->second;
       kernel.queued_time += queued_time;
       kernel.submit_time += submit_time;
       kernel.execute_time += execute_time;
@@ -579,7 +1161,24 @@ class ClKernelCollector {
         kernel.min_time = execute_time;
       }
       kernel.call_count += 1;
+      kernel.submit_histogram.Record(submit_time);
+      kernel.execute_histogram.Record(execute_time);
+    }
+  }
+
+  static void MergeKernelInfo(ClKernelInfo& info, const ClKernelInfo& other) {
+    info.queued_time += other.queued_time;
+    info.submit_time += other.submit_time;
+    info.execute_time += other.execute_time;
+    if (other.max_time > info.max_time) {
+      info.max_time = other.max_time;
+    }
+    if (other.min_time < info.min_time) {
+      info.min_time = other.min_time;
     }
+    info.call_count += other.call_count;
+    info.submit_histogram.Merge(other.submit_histogram);
+    info.execute_histogram.Merge(other.execute_histogram);
   }
 
 #ifdef FTRACE_KERNEL_INTERVALS
@@ -793,15 +1392,7 @@ class ClKernelCollector {
     FTRACE_ASSERT(collector != nullptr);
     FTRACE_ASSERT(collector->device_ != nullptr);
 
-    ClEnqueueData* enqueue_data = new ClEnqueueData;
-    enqueue_data->event = nullptr;
-
-    cl_ulong host_timestamp = 0;
-    utils::cl::GetTimestamps(
-        collector->device_, &enqueue_data->host_sync, &enqueue_data->device_sync);
-    FTRACE_ASSERT(collector->correlator_ != nullptr);
-    enqueue_data->host_sync =
-      collector->correlator_->GetTimestamp(enqueue_data->host_sync);
+    ClEnqueueData* enqueue_data = CreateEnqueueData(collector);
 
     const T* params = reinterpret_cast<const T*>(data->functionParams);
     FTRACE_ASSERT(params != nullptr);
@@ -852,6 +1443,13 @@ class ClKernelCollector {
 
       instance->props.simd_width = simd_width;
       instance->props.bytes_transferred = 0;
+      instance->props.local_memory = 0;
+
+      if (collector->options_.kernel_resources ||
+          collector->options_.occupancy) {
+        instance->props.local_memory = collector->CaptureKernelResources(
+            device, kernel, instance->props.name).local_memory;
+      }
 
       collector->CalculateKernelGlobalSize(params, &instance->props);
       collector->CalculateKernelLocalSize(params, &instance->props);
@@ -876,9 +1474,25 @@ class ClKernelCollector {
     }
   }
 
+  static ClEnqueueData* CreateEnqueueData(ClKernelCollector* collector) {
+    FTRACE_ASSERT(collector != nullptr);
+    ClEnqueueData* enqueue_data = new ClEnqueueData;
+    FTRACE_ASSERT(enqueue_data != nullptr);
+    enqueue_data->event = nullptr;
+
+    utils::cl::GetTimestamps(
+        collector->device_,
+        &enqueue_data->host_sync, &enqueue_data->device_sync);
+    FTRACE_ASSERT(collector->correlator_ != nullptr);
+    enqueue_data->host_sync =
+      collector->correlator_->GetTimestamp(enqueue_data->host_sync);
+    return enqueue_data;
+  }
+
   static void OnExitEnqueueTransfer(
       std::string name, size_t bytes_transferred, cl_event* event,
-      cl_callback_data* data, ClKernelCollector* collector) {
+      cl_callback_data* data, ClKernelCollector* collector,
+      const TransferPattern& transfer = TransferPattern()) {
     FTRACE_ASSERT(event != nullptr);
     FTRACE_ASSERT(data != nullptr);
     FTRACE_ASSERT(collector != nullptr);
@@ -888,13 +1502,28 @@ class ClKernelCollector {
       FTRACE_ASSERT(status == CL_SUCCESS);
     }
 
+    AddTransferInstance(
+        name, bytes_transferred, *event,
+        reinterpret_cast<ClEnqueueData*>(data->correlationData[0]),
+        collector, transfer);
+  }
+
+  static void AddTransferInstance(
+      const std::string& name, size_t bytes_transferred, cl_event event,
+      ClEnqueueData* enqueue_data, ClKernelCollector* collector,
+      const TransferPattern& transfer) {
+    FTRACE_ASSERT(event != nullptr);
+    FTRACE_ASSERT(enqueue_data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
     ClKernelInstance* instance = new ClKernelInstance;
     FTRACE_ASSERT(instance != nullptr);
-    instance->event = *event;
+    instance->event = event;
     instance->props.name = name;
 
     instance->props.simd_width = 0;
     instance->props.bytes_transferred = bytes_transferred;
+    instance->transfer = transfer;
 
     instance->kernel_id =
       collector->kernel_id_.fetch_add(
@@ -904,9 +1533,6 @@ class ClKernelCollector {
     instance->need_to_process =
         collector->correlator_->IsCollectionEnabled();
 
-    ClEnqueueData* enqueue_data =
-      reinterpret_cast<ClEnqueueData*>(data->correlationData[0]);
-    FTRACE_ASSERT(enqueue_data != nullptr);
     instance->device_sync = enqueue_data->device_sync;
     instance->host_sync = enqueue_data->host_sync;
 
@@ -915,7 +1541,22 @@ class ClKernelCollector {
     delete enqueue_data;
   }
 
-  static void OnExitEnqueueReadBuffer(
+  // USM and SVM transfers are named after the memory type of their
+  // pointers, e.g. clEnqueueSVMMemcpy(S2D), fills have destination only
+  static std::string GetUsmTransferName(
+      const char* function_name, const void* dst, const void* src) {
+    FTRACE_ASSERT(function_name != nullptr);
+    std::string direction;
+    if (src != nullptr) {
+      direction.push_back(
+          AllocIndex::GetTypeLetter(AllocIndex::GetType(src)));
+      direction.push_back('2');
+    }
+    direction.push_back(AllocIndex::GetTypeLetter(AllocIndex::GetType(dst)));
+    return std::string(function_name) + "(" + direction + ")";
+  }
+
+  static void OnExitEnqueueSVMMemcpy(
       cl_callback_data* data, ClKernelCollector* collector) {
     FTRACE_ASSERT(data != nullptr);
     FTRACE_ASSERT(collector != nullptr);
@@ -923,22 +1564,23 @@ class ClKernelCollector {
     cl_int* return_value = reinterpret_cast<cl_int*>(
         data->functionReturnValue);
     if (*return_value == CL_SUCCESS) {
-      const cl_params_clEnqueueReadBuffer* params =
-        reinterpret_cast<const cl_params_clEnqueueReadBuffer*>(
+      const cl_params_clEnqueueSVMMemcpy* params =
+        reinterpret_cast<const cl_params_clEnqueueSVMMemcpy*>(
             data->functionParams);
       FTRACE_ASSERT(params != nullptr);
 
       OnExitEnqueueTransfer(
-          "clEnqueueReadBuffer", *(params->cb),
-          *(params->event), data, collector);
+          GetUsmTransferName(
+              "clEnqueueSVMMemcpy", *(params->dstPtr), *(params->srcPtr)),
+          *(params->size), *(params->event), data, collector);
 
-      if (*params->blockingRead) {
+      if (*params->blockingCopy) {
         collector->ProcessKernelInstances();
       }
     }
   }
 
-  static void OnExitEnqueueWriteBuffer(
+  static void OnExitEnqueueSVMMemFill(
       cl_callback_data* data, ClKernelCollector* collector) {
     FTRACE_ASSERT(data != nullptr);
     FTRACE_ASSERT(collector != nullptr);
@@ -946,37 +1588,178 @@ class ClKernelCollector {
     cl_int* return_value = reinterpret_cast<cl_int*>(
         data->functionReturnValue);
     if (*return_value == CL_SUCCESS) {
-      const cl_params_clEnqueueWriteBuffer* params =
-        reinterpret_cast<const cl_params_clEnqueueWriteBuffer*>(
+      const cl_params_clEnqueueSVMMemFill* params =
+        reinterpret_cast<const cl_params_clEnqueueSVMMemFill*>(
             data->functionParams);
       FTRACE_ASSERT(params != nullptr);
 
       OnExitEnqueueTransfer(
-          "clEnqueueWriteBuffer", *(params->cb),
-          *(params->event), data, collector);
-
-      if (*params->blockingWrite) {
-        collector->ProcessKernelInstances();
-      }
+          GetUsmTransferName(
+              "clEnqueueSVMMemFill", *(params->svmPtr), nullptr),
+          *(params->size), *(params->event), data, collector);
     }
   }
 
-  static void OnExitEnqueueCopyBuffer(
-      cl_callback_data* data, ClKernelCollector* collector) {
-    FTRACE_ASSERT(data != nullptr);
+  // Extension functions are not seen by the tracing layer, so their
+  // wrappers call back here, see GetTransferHooks
+  static void* OnExtTransferBegin(void* user_data, cl_event** event) {
+    ClKernelCollector* collector =
+      reinterpret_cast<ClKernelCollector*>(user_data);
     FTRACE_ASSERT(collector != nullptr);
+    FTRACE_ASSERT(event != nullptr);
 
-    cl_int* return_value = reinterpret_cast<cl_int*>(
-        data->functionReturnValue);
-    if (*return_value == CL_SUCCESS) {
+    ClEnqueueData* enqueue_data = CreateEnqueueData(collector);
+    if (*event == nullptr) {
+      *event = &(enqueue_data->event);
+    }
+    return enqueue_data;
+  }
+
+  static void OnExtTransferEnd(
+      void* user_data, void* transfer_data, cl_int result,
+      const char* function_name, const void* dst, const void* src,
+      size_t size, cl_event* event) {
+    ClKernelCollector* collector =
+      reinterpret_cast<ClKernelCollector*>(user_data);
+    FTRACE_ASSERT(collector != nullptr);
+    ClEnqueueData* enqueue_data =
+      reinterpret_cast<ClEnqueueData*>(transfer_data);
+    FTRACE_ASSERT(enqueue_data != nullptr);
+    FTRACE_ASSERT(event != nullptr);
+
+    if (result != CL_SUCCESS) {
+      delete enqueue_data;
+      return;
+    }
+
+    // Event of the application is released by it as well
+    if (event != &(enqueue_data->event)) {
+      cl_int status = clRetainEvent(*event);
+      FTRACE_ASSERT(status == CL_SUCCESS);
+    }
+
+    AddTransferInstance(
+        GetUsmTransferName(function_name, dst, src), size, *event,
+        enqueue_data, collector, TransferPattern());
+  }
+
+  static void OnExitSVMAlloc(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    void** ptr = reinterpret_cast<void**>(data->functionReturnValue);
+    if (*ptr == nullptr) {
+      return;
+    }
+
+    const cl_params_clSVMAlloc* params =
+      reinterpret_cast<const cl_params_clSVMAlloc*>(data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+
+    // SVM is migrated between host and device as shared USM is
+    AllocIndex::Add(
+        *ptr, *(params->size), ALLOC_TYPE_SHARED,
+        collector->device_, *(params->context));
+  }
+
+  static void OnEnterSVMFree(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+
+    const cl_params_clSVMFree* params =
+      reinterpret_cast<const cl_params_clSVMFree*>(data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+    if (*(params->svmPointer) != nullptr) {
+      AllocIndex::Remove(*(params->svmPointer));
+    }
+  }
+
+  static void OnExitEnqueueReadBuffer(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_int* return_value = reinterpret_cast<cl_int*>(
+        data->functionReturnValue);
+    if (*return_value == CL_SUCCESS) {
+      const cl_params_clEnqueueReadBuffer* params =
+        reinterpret_cast<const cl_params_clEnqueueReadBuffer*>(
+            data->functionParams);
+      FTRACE_ASSERT(params != nullptr);
+
+      TransferPattern transfer;
+      if (collector->options_.transfer_advice) {
+        transfer.src = {*(params->buffer), *(params->offset)};
+        transfer.dst = {
+            nullptr, reinterpret_cast<uintptr_t>(*(params->ptr))};
+      }
+
+      OnExitEnqueueTransfer(
+          "clEnqueueReadBuffer", *(params->cb),
+          *(params->event), data, collector, transfer);
+
+      if (*params->blockingRead) {
+        collector->ProcessKernelInstances();
+      }
+    }
+  }
+
+  static void OnExitEnqueueWriteBuffer(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_int* return_value = reinterpret_cast<cl_int*>(
+        data->functionReturnValue);
+    if (*return_value == CL_SUCCESS) {
+      const cl_params_clEnqueueWriteBuffer* params =
+        reinterpret_cast<const cl_params_clEnqueueWriteBuffer*>(
+            data->functionParams);
+      FTRACE_ASSERT(params != nullptr);
+
+      TransferPattern transfer;
+      if (collector->options_.transfer_advice &&
+          *(params->ptr) != nullptr) {
+        transfer.src = {
+            nullptr, reinterpret_cast<uintptr_t>(*(params->ptr))};
+        transfer.dst = {*(params->buffer), *(params->offset)};
+        transfer.fingerprint =
+          TransferAdvisor::GetFingerprint(*(params->ptr), *(params->cb));
+      }
+
+      OnExitEnqueueTransfer(
+          "clEnqueueWriteBuffer", *(params->cb),
+          *(params->event), data, collector, transfer);
+
+      if (*params->blockingWrite) {
+        collector->ProcessKernelInstances();
+      }
+    }
+  }
+
+  static void OnExitEnqueueCopyBuffer(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_int* return_value = reinterpret_cast<cl_int*>(
+        data->functionReturnValue);
+    if (*return_value == CL_SUCCESS) {
       const cl_params_clEnqueueCopyBuffer* params =
         reinterpret_cast<const cl_params_clEnqueueCopyBuffer*>(
             data->functionParams);
       FTRACE_ASSERT(params != nullptr);
 
+      TransferPattern transfer;
+      if (collector->options_.transfer_advice) {
+        transfer.src = {*(params->srcBuffer), *(params->srcOffset)};
+        transfer.dst = {*(params->dstBuffer), *(params->dstOffset)};
+      }
+
       OnExitEnqueueTransfer(
           "clEnqueueCopyBuffer", *(params->cb),
-          *(params->event), data, collector);
+          *(params->event), data, collector, transfer);
     }
   }
 
@@ -1247,9 +2030,46 @@ class ClKernelCollector {
     }
   }
 
-  static void OnExitFinish(ClKernelCollector* collector) {
+  void BeginHostWait(cl_callback_data* data) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(correlator_ != nullptr);
+    uint64_t start = correlator_->GetTimestamp();
+    host_stalls_.BeginWait(start);
+    data->correlationData[0] = start;
+  }
+
+  void EndHostWait(cl_callback_data* data, uint64_t end) {
+    FTRACE_ASSERT(data != nullptr);
+    uint64_t start = data->correlationData[0];
+    host_stalls_.EndWait(start, end, stall_callback_, callback_data_);
+    if (options_.critical_path || options_.utilization) {
+      const std::lock_guard<std::mutex> lock(lock_);
+      if (options_.critical_path) {
+        dependency_graph_.AddHostWait(start, end);
+      }
+      if (options_.utilization) {
+        utilization_.AddHostWait(start, end);
+      }
+    }
+  }
+
+  static void OnEnterFinish(
+      cl_callback_data* data, ClKernelCollector* collector) {
     FTRACE_ASSERT(collector != nullptr);
+    if (collector->options_.host_stalls) {
+      collector->BeginHostWait(data);
+    }
+  }
+
+  static void OnExitFinish(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(collector != nullptr);
+    FTRACE_ASSERT(collector->correlator_ != nullptr);
+    uint64_t end = collector->correlator_->GetTimestamp();
     collector->ProcessKernelInstances();
+    if (collector->options_.host_stalls) {
+      collector->EndHostWait(data, end);
+    }
   }
 
   static void OnExitReleaseCommandQueue(ClKernelCollector* collector) {
@@ -1257,6 +2077,480 @@ class ClKernelCollector {
     collector->ProcessKernelInstances();
   }
 
+  // Buffer is released when its reference count drops to zero, so the
+  // destructor callback is used instead of clReleaseMemObject
+  static void OnExitCreateBuffer(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_mem* buffer = reinterpret_cast<cl_mem*>(data->functionReturnValue);
+    if (*buffer == nullptr) {
+      return;
+    }
+
+    const cl_params_clCreateBuffer* params =
+      reinterpret_cast<const cl_params_clCreateBuffer*>(
+          data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+
+    if (collector->options_.object_churn) {
+      uint64_t fingerprint = ObjectChurn::kOffsetBasis;
+      ObjectChurn::Combine(fingerprint, *(params->flags));
+      ObjectChurn::Combine(fingerprint, *(params->size));
+      collector->AddObject(
+          OBJECT_TYPE_BUFFER, *buffer, fingerprint,
+          std::to_string(*(params->size)) + " bytes",
+          GetCallTime(data, collector));
+    }
+
+    if (collector->options_.memory) {
+      MemoryTracker::Add(
+          *buffer, *(params->size), MEMORY_TYPE_BUFFER,
+          collector->device_, *(params->context), "clCreateBuffer");
+      cl_int status = clSetMemObjectDestructorCallback(
+          *buffer, OnBufferDestroyed, nullptr);
+      FTRACE_ASSERT(status == CL_SUCCESS);
+    }
+  }
+
+  static void CL_CALLBACK OnBufferDestroyed(cl_mem buffer, void* user_data) {
+    MemoryTracker::Remove(buffer);
+  }
+
+  template <cl_device_type DEVICE_TYPE>
+  static void SetExtensionFunction(const char* name, void** function) {
+    FTRACE_ASSERT(function != nullptr);
+    if (name == nullptr || *function == nullptr) {
+      return;
+    }
+    if (strcmp(name, "clHostMemAllocINTEL") == 0) {
+      *function = reinterpret_cast<void*>(&clHostMemAllocINTEL<DEVICE_TYPE>);
+    } else if (strcmp(name, "clDeviceMemAllocINTEL") == 0) {
+      *function =
+        reinterpret_cast<void*>(&clDeviceMemAllocINTEL<DEVICE_TYPE>);
+    } else if (strcmp(name, "clSharedMemAllocINTEL") == 0) {
+      *function =
+        reinterpret_cast<void*>(&clSharedMemAllocINTEL<DEVICE_TYPE>);
+    } else if (strcmp(name, "clMemFreeINTEL") == 0) {
+      *function = reinterpret_cast<void*>(&clMemFreeINTEL<DEVICE_TYPE>);
+    } else if (strcmp(name, "clEnqueueMemcpyINTEL") == 0) {
+      *function =
+        reinterpret_cast<void*>(&clEnqueueMemcpyINTEL<DEVICE_TYPE>);
+    } else if (strcmp(name, "clEnqueueMemFillINTEL") == 0) {
+      *function =
+        reinterpret_cast<void*>(&clEnqueueMemFillINTEL<DEVICE_TYPE>);
+    }
+  }
+
+  // USM functions are wrapped here as well, so allocations are indexed
+  // and transfers are tracked without API collectors, the wrappers time
+  // the calls only if those exist
+  template <class Params>
+  static void OnExitGetExtensionFunctionAddress(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    const Params* params =
+      reinterpret_cast<const Params*>(data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+    void** function = reinterpret_cast<void**>(data->functionReturnValue);
+
+    cl_device_type type = utils::cl::GetDeviceType(collector->device_);
+    if (type == CL_DEVICE_TYPE_GPU) {
+      SetExtensionFunction<CL_DEVICE_TYPE_GPU>(
+          *(params->funcName), function);
+    } else {
+      FTRACE_ASSERT(type == CL_DEVICE_TYPE_CPU);
+      SetExtensionFunction<CL_DEVICE_TYPE_CPU>(
+          *(params->funcName), function);
+    }
+  }
+
+  static void OnExitCreateProgramWithSource(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_program* program =
+      reinterpret_cast<cl_program*>(data->functionReturnValue);
+    if (*program == nullptr) {
+      return;
+    }
+
+    const cl_params_clCreateProgramWithSource* params =
+      reinterpret_cast<const cl_params_clCreateProgramWithSource*>(
+          data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+
+    ClProgramInput input{ModuleBuilds::GetFingerprint(0, nullptr), 0, {}};
+    const char** strings = *(params->strings);
+    const size_t* lengths = *(params->lengths);
+    for (cl_uint i = 0; i < *(params->count); ++i) {
+      FTRACE_ASSERT(strings[i] != nullptr);
+      size_t length = (lengths != nullptr && lengths[i] > 0) ?
+        lengths[i] : strlen(strings[i]);
+      input.hash = ModuleBuilds::GetFingerprint(
+          input.hash ^ TransferAdvisor::GetHash(strings[i], length),
+          nullptr);
+      input.size += length;
+    }
+    AddProgram(data, collector, *program, input);
+  }
+
+  static void OnExitCreateProgramWithIL(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_program* program =
+      reinterpret_cast<cl_program*>(data->functionReturnValue);
+    if (*program == nullptr) {
+      return;
+    }
+
+    const cl_params_clCreateProgramWithIL* params =
+      reinterpret_cast<const cl_params_clCreateProgramWithIL*>(
+          data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+    FTRACE_ASSERT(*(params->il) != nullptr);
+
+    ClProgramInput input{
+        TransferAdvisor::GetHash(*(params->il), *(params->length)),
+        *(params->length), {}};
+    AddProgram(data, collector, *program, input);
+  }
+
+  // Binaries for all the devices form the input
+  static void OnExitCreateProgramWithBinary(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_program* program =
+      reinterpret_cast<cl_program*>(data->functionReturnValue);
+    if (*program == nullptr) {
+      return;
+    }
+
+    const cl_params_clCreateProgramWithBinary* params =
+      reinterpret_cast<const cl_params_clCreateProgramWithBinary*>(
+          data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+
+    ClProgramInput input{ModuleBuilds::GetFingerprint(0, nullptr), 0, {}};
+    const unsigned char** binaries = *(params->binaries);
+    const size_t* lengths = *(params->lengths);
+    for (cl_uint i = 0; i < *(params->numDevices); ++i) {
+      FTRACE_ASSERT(binaries[i] != nullptr);
+      input.hash = ModuleBuilds::GetFingerprint(
+          input.hash ^ TransferAdvisor::GetHash(binaries[i], lengths[i]),
+          nullptr);
+      input.size += lengths[i];
+    }
+    AddProgram(data, collector, *program, input);
+  }
+
+  static void OnExitSetProgramSpecializationConstant(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_int* return_value =
+      reinterpret_cast<cl_int*>(data->functionReturnValue);
+    if (*return_value != CL_SUCCESS) {
+      return;
+    }
+
+    const cl_params_clSetProgramSpecializationConstant* params =
+      reinterpret_cast<const cl_params_clSetProgramSpecializationConstant*>(
+          data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+
+    collector->AddProgramConstant(
+        *(params->program), *(params->specId),
+        *(params->specValue), *(params->specSize));
+  }
+
+  // Start of the call is kept for its exit callback, used for calls
+  // whose host time is measured, e.g. builds and object creation
+  static void OnEnterTimedCall(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+    FTRACE_ASSERT(collector->correlator_ != nullptr);
+    data->correlationData[0] = collector->correlator_->GetTimestamp();
+  }
+
+  static uint64_t GetCallTime(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+    FTRACE_ASSERT(collector->correlator_ != nullptr);
+    uint64_t end = collector->correlator_->GetTimestamp();
+    uint64_t start = data->correlationData[0];
+    return (end > start) ? end - start : 0;
+  }
+
+  // With notification callback build may continue asynchronously,
+  // only the time of the call itself is taken then. For object churn
+  // builds are commands of the program
+  static void OnExitBuildProgram(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_int* return_value =
+      reinterpret_cast<cl_int*>(data->functionReturnValue);
+    if (*return_value != CL_SUCCESS) {
+      return;
+    }
+
+    uint64_t time = GetCallTime(data, collector);
+
+    const cl_params_clBuildProgram* params =
+      reinterpret_cast<const cl_params_clBuildProgram*>(
+          data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+
+    if (collector->options_.object_churn) {
+      collector->AddObjectCommand(
+          *(params->program),
+          ModuleBuilds::GetFingerprint(0, *(params->options)), time);
+    }
+
+    // Builds of programs with unknown input can not be told apart
+    ClProgramInput input;
+    if (!collector->options_.module_builds ||
+        !collector->GetProgramInput(*(params->program), input)) {
+      return;
+    }
+    ModuleBuilds::AddBuild(
+        "clBuildProgram",
+        ModuleBuilds::GetFingerprint(input.hash, *(params->options)),
+        input.size, collector->device_, time);
+  }
+
+  // Compiled program is taken as an input of later link by the hash of
+  // its sources, headers and options
+  static void OnExitCompileProgram(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_int* return_value =
+      reinterpret_cast<cl_int*>(data->functionReturnValue);
+    if (*return_value != CL_SUCCESS) {
+      return;
+    }
+
+    uint64_t time = GetCallTime(data, collector);
+
+    const cl_params_clCompileProgram* params =
+      reinterpret_cast<const cl_params_clCompileProgram*>(
+          data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+
+    if (collector->options_.object_churn) {
+      collector->AddObjectCommand(
+          *(params->program),
+          ModuleBuilds::GetFingerprint(0, *(params->options)), time);
+    }
+
+    ClProgramInput input;
+    if (!collector->GetProgramInput(*(params->program), input)) {
+      return;
+    }
+    const cl_program* headers = *(params->inputHeaders);
+    for (cl_uint i = 0; i < *(params->numInputHeaders); ++i) {
+      ClProgramInput header;
+      if (!collector->GetProgramInput(headers[i], header)) {
+        return;
+      }
+      input.hash = ModuleBuilds::GetFingerprint(
+          input.hash ^ header.hash, nullptr);
+      input.size += header.size;
+    }
+    input.hash = ModuleBuilds::GetFingerprint(input.hash, *(params->options));
+    if (collector->options_.module_builds) {
+      ModuleBuilds::AddBuild(
+          "clCompileProgram", input.hash, input.size,
+          collector->device_, time);
+    }
+    collector->AddProgramInput(*(params->program), input);
+  }
+
+  static void OnExitLinkProgram(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_program* program =
+      reinterpret_cast<cl_program*>(data->functionReturnValue);
+    if (*program == nullptr) {
+      return;
+    }
+
+    const cl_params_clLinkProgram* params =
+      reinterpret_cast<const cl_params_clLinkProgram*>(
+          data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+
+    ClProgramInput input{ModuleBuilds::GetFingerprint(0, nullptr), 0, {}};
+    const cl_program* programs = *(params->inputPrograms);
+    for (cl_uint i = 0; i < *(params->numInputPrograms); ++i) {
+      ClProgramInput part;
+      if (!collector->GetProgramInput(programs[i], part)) {
+        return;
+      }
+      input.hash = ModuleBuilds::GetFingerprint(
+          input.hash ^ part.hash, nullptr);
+      input.size += part.size;
+    }
+    input.hash = ModuleBuilds::GetFingerprint(input.hash, *(params->options));
+    if (collector->options_.module_builds) {
+      ModuleBuilds::AddBuild(
+          "clLinkProgram", input.hash, input.size, collector->device_,
+          GetCallTime(data, collector));
+    }
+    AddProgram(data, collector, *program, input);
+  }
+
+  static void AddProgram(
+      cl_callback_data* data, ClKernelCollector* collector,
+      cl_program program, const ClProgramInput& input) {
+    FTRACE_ASSERT(collector != nullptr);
+    collector->AddProgramInput(program, input);
+    if (collector->options_.object_churn) {
+      collector->AddObject(
+          OBJECT_TYPE_PROGRAM, program, input.hash,
+          std::to_string(input.size) + " bytes",
+          GetCallTime(data, collector));
+    }
+  }
+
+  // Objects are dropped with the last reference, so maps do not grow and
+  // reused handles do not get stale data. Start of the call is kept only
+  // for the last release
+  template <typename Params>
+  static void OnEnterReleaseObject(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+    data->correlationData[0] = 0;
+
+    const Params* params =
+      reinterpret_cast<const Params*>(data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+    auto object = GetReleasedObject(params);
+    if (object != nullptr && GetReferenceCount(object) == 1) {
+      OnEnterTimedCall(data, collector);
+    }
+  }
+
+  template <typename Params>
+  static void OnExitReleaseObject(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+    if (data->correlationData[0] == 0) { // Not the last reference
+      return;
+    }
+
+    cl_int* return_value =
+      reinterpret_cast<cl_int*>(data->functionReturnValue);
+    if (*return_value != CL_SUCCESS) {
+      return;
+    }
+
+    const Params* params =
+      reinterpret_cast<const Params*>(data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+    ReleaseObject(
+        collector, GetReleasedObject(params), GetCallTime(data, collector));
+  }
+
+  static void ReleaseObject(
+      ClKernelCollector* collector, cl_program program, uint64_t time) {
+    collector->RemoveProgramInput(program);
+    if (collector->options_.object_churn) {
+      collector->RemoveObject(program, time);
+    }
+  }
+
+  template <typename Object>
+  static void ReleaseObject(
+      ClKernelCollector* collector, Object object, uint64_t time) {
+    if (collector->options_.object_churn) {
+      collector->RemoveObject(object, time);
+    }
+  }
+
+  static cl_program GetReleasedObject(
+      const cl_params_clReleaseProgram* params) {
+    return *(params->program);
+  }
+
+  static cl_kernel GetReleasedObject(const cl_params_clReleaseKernel* params) {
+    return *(params->kernel);
+  }
+
+  static cl_mem GetReleasedObject(const cl_params_clReleaseMemObject* params) {
+    return *(params->memobj);
+  }
+
+  // Zero if the count can not be queried
+  static cl_uint GetReferenceCount(cl_program program) {
+    cl_uint count = 0;
+    cl_int status = clGetProgramInfo(
+        program, CL_PROGRAM_REFERENCE_COUNT, sizeof(cl_uint), &count,
+        nullptr);
+    return (status == CL_SUCCESS) ? count : 0;
+  }
+
+  static cl_uint GetReferenceCount(cl_kernel kernel) {
+    cl_uint count = 0;
+    cl_int status = clGetKernelInfo(
+        kernel, CL_KERNEL_REFERENCE_COUNT, sizeof(cl_uint), &count,
+        nullptr);
+    return (status == CL_SUCCESS) ? count : 0;
+  }
+
+  static cl_uint GetReferenceCount(cl_mem mem) {
+    cl_uint count = 0;
+    cl_int status = clGetMemObjectInfo(
+        mem, CL_MEM_REFERENCE_COUNT, sizeof(cl_uint), &count, nullptr);
+    return (status == CL_SUCCESS) ? count : 0;
+  }
+
+  static void OnExitCreateKernel(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(data != nullptr);
+    FTRACE_ASSERT(collector != nullptr);
+
+    cl_kernel* kernel =
+      reinterpret_cast<cl_kernel*>(data->functionReturnValue);
+    if (*kernel == nullptr) {
+      return;
+    }
+
+    const cl_params_clCreateKernel* params =
+      reinterpret_cast<const cl_params_clCreateKernel*>(
+          data->functionParams);
+    FTRACE_ASSERT(params != nullptr);
+    FTRACE_ASSERT(*(params->kernelName) != nullptr);
+
+    std::string name = *(params->kernelName);
+    uint64_t fingerprint = ObjectChurn::kOffsetBasis;
+    ObjectChurn::Combine(
+        fingerprint, collector->GetObjectFingerprint(*(params->program)));
+    ObjectChurn::Combine(fingerprint, std::hash<std::string>()(name));
+    collector->AddObject(
+        OBJECT_TYPE_KERNEL, *kernel, fingerprint, name,
+        GetCallTime(data, collector));
+  }
+
   static void OnEnterReleaseEvent(
       cl_callback_data* data, ClKernelCollector* collector) {
     FTRACE_ASSERT(data != nullptr);
@@ -1272,10 +2566,20 @@ class ClKernelCollector {
     }
   }
 
+  static void OnEnterWaitForEvents(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    FTRACE_ASSERT(collector != nullptr);
+    if (collector->options_.host_stalls) {
+      collector->BeginHostWait(data);
+    }
+  }
+
   static void OnExitWaitForEvents(
       cl_callback_data* data, ClKernelCollector* collector) {
     FTRACE_ASSERT(data != nullptr);
     FTRACE_ASSERT(collector != nullptr);
+    FTRACE_ASSERT(collector->correlator_ != nullptr);
+    uint64_t end = collector->correlator_->GetTimestamp();
 
     cl_int* return_value = reinterpret_cast<cl_int*>(
         data->functionReturnValue);
@@ -1292,6 +2596,10 @@ class ClKernelCollector {
         }
       }
     }
+
+    if (collector->options_.host_stalls) {
+      collector->EndHostWait(data, end);
+    }
   }
 
   static void Callback(cl_function_id function,
@@ -1299,6 +2607,7 @@ class ClKernelCollector {
                       void* user_data) {
     if (TraceGuard::Inactive()) return;
     TraceGuard guard;
+    TracerOverheadScope overhead(TRACER_HOOK_CL_KERNEL);
 
     ClKernelCollector* collector =
       reinterpret_cast<ClKernelCollector*>(user_data);
@@ -1330,6 +2639,28 @@ class ClKernelCollector {
         OnExitEnqueueKernel<cl_params_clEnqueueTask>(
             callback_data, collector);
       }
+    } else if (function == CL_FUNCTION_clEnqueueSVMMemcpy) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterEnqueueKernel<cl_params_clEnqueueSVMMemcpy>(
+            callback_data, collector);
+      } else {
+        OnExitEnqueueSVMMemcpy(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clEnqueueSVMMemFill) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterEnqueueKernel<cl_params_clEnqueueSVMMemFill>(
+            callback_data, collector);
+      } else {
+        OnExitEnqueueSVMMemFill(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clSVMAlloc) {
+      if (callback_data->site == CL_CALLBACK_SITE_EXIT) {
+        OnExitSVMAlloc(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clSVMFree) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterSVMFree(callback_data, collector);
+      }
     } else if (function == CL_FUNCTION_clEnqueueReadBuffer) {
       if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
         OnEnterEnqueueKernel<cl_params_clEnqueueReadBuffer>(
@@ -1415,19 +2746,112 @@ class ClKernelCollector {
         OnExitEnqueueCopyBufferToImage(callback_data, collector);
       }
     } else if (function == CL_FUNCTION_clFinish) {
-      if (callback_data->site == CL_CALLBACK_SITE_EXIT) {
-        OnExitFinish(collector);
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterFinish(callback_data, collector);
+      } else {
+        OnExitFinish(callback_data, collector);
       }
     } else if (function == CL_FUNCTION_clReleaseCommandQueue) {
       if (callback_data->site == CL_CALLBACK_SITE_EXIT) {
         OnExitReleaseCommandQueue(collector);
       }
+    } else if (function == CL_FUNCTION_clCreateBuffer) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterTimedCall(callback_data, collector);
+      } else {
+        OnExitCreateBuffer(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clGetExtensionFunctionAddress) {
+      if (callback_data->site == CL_CALLBACK_SITE_EXIT) {
+        OnExitGetExtensionFunctionAddress<
+            cl_params_clGetExtensionFunctionAddress>(
+                callback_data, collector);
+      }
+    } else if (function ==
+               CL_FUNCTION_clGetExtensionFunctionAddressForPlatform) {
+      if (callback_data->site == CL_CALLBACK_SITE_EXIT) {
+        OnExitGetExtensionFunctionAddress<
+            cl_params_clGetExtensionFunctionAddressForPlatform>(
+                callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clCreateProgramWithSource) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterTimedCall(callback_data, collector);
+      } else {
+        OnExitCreateProgramWithSource(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clCreateProgramWithIL) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterTimedCall(callback_data, collector);
+      } else {
+        OnExitCreateProgramWithIL(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clCreateProgramWithBinary) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterTimedCall(callback_data, collector);
+      } else {
+        OnExitCreateProgramWithBinary(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clSetProgramSpecializationConstant) {
+      if (callback_data->site == CL_CALLBACK_SITE_EXIT) {
+        OnExitSetProgramSpecializationConstant(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clBuildProgram) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterTimedCall(callback_data, collector);
+      } else {
+        OnExitBuildProgram(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clCompileProgram) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterTimedCall(callback_data, collector);
+      } else {
+        OnExitCompileProgram(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clLinkProgram) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterTimedCall(callback_data, collector);
+      } else {
+        OnExitLinkProgram(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clReleaseProgram) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterReleaseObject<cl_params_clReleaseProgram>(
+            callback_data, collector);
+      } else {
+        OnExitReleaseObject<cl_params_clReleaseProgram>(
+            callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clCreateKernel) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterTimedCall(callback_data, collector);
+      } else {
+        OnExitCreateKernel(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clReleaseKernel) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterReleaseObject<cl_params_clReleaseKernel>(
+            callback_data, collector);
+      } else {
+        OnExitReleaseObject<cl_params_clReleaseKernel>(
+            callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clReleaseMemObject) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterReleaseObject<cl_params_clReleaseMemObject>(
+            callback_data, collector);
+      } else {
+        OnExitReleaseObject<cl_params_clReleaseMemObject>(
+            callback_data, collector);
+      }
     } else if (function == CL_FUNCTION_clReleaseEvent) {
       if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
         OnEnterReleaseEvent(callback_data, collector);
       }
     } else if (function == CL_FUNCTION_clWaitForEvents) {
-      if (callback_data->site == CL_CALLBACK_SITE_EXIT) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterWaitForEvents(callback_data, collector);
+      } else {
         OnExitWaitForEvents(callback_data, collector);
       }
     }
@@ -1439,15 +2863,34 @@ class ClKernelCollector {
 
   KernelCollectorOptions options_;
 
-  std::atomic<uint64_t> kernel_id_;
+  // Shared by CPU and GPU collectors, so ids are unique within the process
+  static std::atomic<uint64_t> kernel_id_;
   cl_device_id device_ = nullptr;
 
   OnClKernelFinishCallback callback_ = nullptr;
   void* callback_data_ = nullptr;
+  OnHostStallCallback stall_callback_ = nullptr;
 
   std::mutex lock_;
-  ClKernelInfoMap kernel_info_map_;
+  KernelKeyMap<ClKernelInfo> kernel_info_map_;
+  KernelKeyMap<LaunchStatistics> launch_stats_map_;
+  KernelNameTable kernel_names_;
   ClKernelInstanceList kernel_instance_list_;
+  ClProgramInputMap program_input_map_;
+  ClKernelResourceMap kernel_resource_map_;
+  KernelResourceTable kernel_resources_;
+  DeviceLayout device_layout_;
+  OccupancyTable occupancy_;
+  ScalingModel scaling_;
+  HostStallTracker host_stalls_;
+  DependencyGraph dependency_graph_;
+  DeviceUtilization utilization_;
+  IterationDetector iterations_;
+  TransferStatistics transfers_;
+  TransferAdvisor transfer_advisor_;
+  ObjectChurn object_churn_;
+  ClExtTransferHooks transfer_hooks_{
+      OnExtTransferBegin, OnExtTransferEnd, this};
 
 #ifdef FTRACE_KERNEL_INTERVALS
   ze_device_handle_t ze_device_;
@@ -310,6 +310,7 @@ def gen_enum(f, enum_map, enum_name, param_name):
   f.write("    }\n")
 
 def gen_enter_callback(f, func, params, enum_map):
+  f.write("  TracerOverheadScope overhead(TRACER_HOOK_ZE_API);\n")
   f.write("  ZeApiCollector* collector =\n")
   f.write("    reinterpret_cast<ZeApiCollector*>(global_user_data);\n")
   f.write("  FTRACE_ASSERT(collector != nullptr);\n")
@@ -526,8 +527,10 @@ def gen_enter_callback(f, func, params, enum_map):
   f.write("  }\n")
   f.write("  uint64_t& start_time = *reinterpret_cast<uint64_t*>(instance_user_data);\n")
   f.write("  start_time = collector->GetTimestamp();\n")
+  f.write("  collector->correlator_->EnterApiCall(\"" + func + "\", start_time);\n")
 
 def gen_exit_callback(f, func, params, enum_map):
+  f.write("  TracerOverheadScope overhead(TRACER_HOOK_ZE_API);\n")
   f.write("  ZeApiCollector* collector =\n")
   f.write("    reinterpret_cast<ZeApiCollector*>(global_user_data);\n")
   f.write("  FTRACE_ASSERT(collector != nullptr);\n")
@@ -542,7 +545,9 @@ def gen_exit_callback(f, func, params, enum_map):
   f.write("\n")
   f.write("  FTRACE_ASSERT(start_time <= end_time);\n")
   f.write("  uint64_t time = end_time - start_time;\n")
-  f.write("  collector->AddFunctionTime(\"" + func + "\", time);\n")
+  f.write("  uint64_t nested_time =\n")
+  f.write("    collector->correlator_->ExitApiCall(\"" + func + "\", end_time);\n")
+  f.write("  collector->AddFunctionTime(\"" + func + "\", time - nested_time);\n")
   f.write("  if (collector->options_.call_tracing) {\n")
   f.write("    std::stringstream stream;\n")
   f.write("    stream << \"<<<< [\" << end_time << \"] \";\n")
@@ -650,9 +655,14 @@ def gen_exit_callback(f, func, params, enum_map):
      func == "zeCommandListAppendImageCopyRegion" or\
      func == "zeCommandListAppendImageCopyToMemory" or\
      func == "zeCommandListAppendImageCopyFromMemory":
+    f.write("    std::string kernel_call_id =\n")
+    f.write("      std::to_string(collector->correlator_->GetKernelId());\n")
+    f.write("    if (collector->correlator_->GetCallId() > 0) {\n")
+    f.write("      kernel_call_id += \".\" +\n")
+    f.write("        std::to_string(collector->correlator_->GetCallId());\n")
+    f.write("    }\n")
     f.write("    collector->callback_(\n")
-    f.write("        collector->callback_data_,\n")
-    f.write("        std::to_string(collector->correlator_->GetKernelId()),\n")
+    f.write("        collector->callback_data_, kernel_call_id,\n")
     f.write("        \"" + func + "\",\n")
     f.write("        start_time, end_time);\n")
   elif func == "zeCommandQueueExecuteCommandLists":
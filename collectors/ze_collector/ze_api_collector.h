@@ -1,6 +1,7 @@
 #ifndef FTRACE_TOOLS_COLLECTORS_ZE_COLLECTOR_ZE_API_COLLECTOR_H_
 #define FTRACE_TOOLS_COLLECTORS_ZE_COLLECTOR_ZE_API_COLLECTOR_H_
 
+#include <atomic>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
@@ -11,6 +12,8 @@
 #include <level_zero/layers/zel_tracing_api.h>
 
 #include "correlator.h"
+#include "latency_histogram.h"
+#include "tracer_overhead.h"
 #include "utils.h"
 #include "ze_utils.h"
 
@@ -19,6 +22,7 @@ struct ZeFunction {
   uint64_t min_time;
   uint64_t max_time;
   uint64_t call_count;
+  LatencyHistogram histogram;
 
   bool operator>(const ZeFunction& r) const {
     if (total_time != r.total_time) {
@@ -66,6 +70,7 @@ class ZeApiCollector {
     }
 
     collector->tracer_ = tracer;
+    collector->Calibrate();
     SetTracingAPIs(tracer);
 
     status = zelTracerSetEnabled(tracer, true);
@@ -86,10 +91,22 @@ class ZeApiCollector {
     return function_info_map_;
   }
 
+  ZeFunctionInfoMap GetFunctionInfoMapSnapshot() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    return function_info_map_;
+  }
+
+  // Calibration baseline, subtracted from reported times with a clamp
+  uint64_t GetCallOverhead() const {
+    return options_.raw_time ? 0 : call_overhead_;
+  }
+
   void PrintFunctionsTable() const {
+    ZeFunctionInfoMap function_info_map =
+      utils::CompensateCallOverhead(function_info_map_, GetCallOverhead());
     std::set< std::pair<std::string, ZeFunction>,
               utils::Comparator > sorted_list(
-        function_info_map_.begin(), function_info_map_.end());
+        function_info_map.begin(), function_info_map.end());
 
     uint64_t total_duration = 0;
     size_t max_name_length = kFunctionLength;
@@ -105,13 +122,23 @@ class ZeApiCollector {
     }
 
     std::stringstream stream;
+    if (GetCallOverhead() > 0) {
+      stream << "Calibration baseline (fastest traced zeDriverGet) of " <<
+        GetCallOverhead() << " ns is subtracted from each call, " <<
+        "at most half of the fastest call of a function" << std::endl;
+      stream << std::endl;
+    }
     stream << std::setw(max_name_length) << "Function" << "," <<
       std::setw(kCallsLength) << "Calls" << "," <<
       std::setw(kTimeLength) << "Time (ns)" << "," <<
       std::setw(kPercentLength) << "Time (%)" << "," <<
       std::setw(kTimeLength) << "Average (ns)" << "," <<
       std::setw(kTimeLength) << "Min (ns)" << "," <<
-      std::setw(kTimeLength) << "Max (ns)" << std::endl;
+      std::setw(kTimeLength) << "Max (ns)" << "," <<
+      std::setw(kTimeLength) << "p50 (ns)" << "," <<
+      std::setw(kTimeLength) << "p90 (ns)" << "," <<
+      std::setw(kTimeLength) << "p99 (ns)" << "," <<
+      std::setw(kTimeLength) << "p99.9 (ns)" << std::endl;
 
     for (auto& value : sorted_list) {
       const std::string& function = value.first;
@@ -120,6 +147,7 @@ class ZeApiCollector {
       uint64_t avg_duration = duration / call_count;
       uint64_t min_duration = value.second.min_time;
       uint64_t max_duration = value.second.max_time;
+      const LatencyHistogram& histogram = value.second.histogram;
       float percent_duration = 100.0f * duration / total_duration;
       stream << std::setw(max_name_length) << function << "," <<
         std::setw(kCallsLength) << call_count << "," <<
@@ -128,7 +156,32 @@ class ZeApiCollector {
           std::fixed << percent_duration << "," <<
         std::setw(kTimeLength) << avg_duration << "," <<
         std::setw(kTimeLength) << min_duration << "," <<
-        std::setw(kTimeLength) << max_duration << std::endl;
+        std::setw(kTimeLength) << max_duration << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(50.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(90.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.9) << std::endl;
+    }
+
+    FTRACE_ASSERT(correlator_ != nullptr);
+    correlator_->Log(stream.str());
+  }
+
+  void PrintHistograms() const {
+    ZeFunctionInfoMap function_info_map =
+      utils::CompensateCallOverhead(function_info_map_, GetCallOverhead());
+    std::set< std::pair<std::string, ZeFunction>,
+              utils::Comparator > sorted_list(
+        function_info_map.begin(), function_info_map.end());
+    if (sorted_list.empty()) {
+      return;
+    }
+
+    std::stringstream stream;
+    for (auto& value : sorted_list) {
+      stream << "Function: " << value.first << std::endl;
+      stream << value.second.histogram.GetBucketTable();
+      stream << std::endl;
     }
 
     FTRACE_ASSERT(correlator_ != nullptr);
@@ -153,7 +206,12 @@ class ZeApiCollector {
   void AddFunctionTime(const std::string& name, uint64_t time) {
     const std::lock_guard<std::mutex> lock(lock_);
     if (function_info_map_.count(name) == 0) {
-      function_info_map_[name] = {time, time, time, 1};
+      ZeFunction& function = function_info_map_[name];
+      function.total_time = time;
+      function.min_time = time;
+      function.max_time = time;
+      function.call_count = 1;
+      function.histogram.Record(time);
     } else {
       ZeFunction& function = function_info_map_[name];
       function.total_time += time;
@@ -164,6 +222,7 @@ class ZeApiCollector {
         function.max_time = time;
       }
       ++function.call_count;
+      function.histogram.Record(time);
     }
   }
 
@@ -176,6 +235,67 @@ class ZeApiCollector {
     FTRACE_ASSERT(correlator_ != nullptr);
   }
 
+  // Measures the fastest traced zeDriverGet call: the part of tracing
+  // layer dispatch that falls in between start and end timestamps of the
+  // regular callbacks plus the cheapest driver call, which can not be
+  // told apart, see CompensateCallOverhead
+  void Calibrate() {
+    FTRACE_ASSERT(tracer_ != nullptr);
+
+    zet_core_callbacks_t prologue = {};
+    zet_core_callbacks_t epilogue = {};
+    prologue.Driver.pfnGetCb = OnEnterCalibrationProbe;
+    epilogue.Driver.pfnGetCb = OnExitCalibrationProbe;
+
+    ze_result_t status = ZE_RESULT_SUCCESS;
+    status = zelTracerSetPrologues(tracer_, &prologue);
+    FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+    status = zelTracerSetEpilogues(tracer_, &epilogue);
+    FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+    status = zelTracerSetEnabled(tracer_, true);
+    FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+
+    for (uint32_t i = 0; i < kCalibrationCount; ++i) {
+      uint32_t driver_count = 0;
+      status = zeDriverGet(&driver_count, nullptr);
+      FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+    }
+
+    status = zelTracerSetEnabled(tracer_, false);
+    FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+
+    uint64_t probe_time = calibration_time_.load(std::memory_order_relaxed);
+    call_overhead_ = (probe_time == UINT64_MAX) ? 0 : probe_time;
+  }
+
+  static void OnEnterCalibrationProbe(
+      ze_driver_get_params_t* params, ze_result_t result,
+      void* global_user_data, void** instance_user_data) {
+    ZeApiCollector* collector =
+      reinterpret_cast<ZeApiCollector*>(global_user_data);
+    FTRACE_ASSERT(collector != nullptr);
+    uint64_t& start_time = *reinterpret_cast<uint64_t*>(instance_user_data);
+    start_time = collector->GetTimestamp();
+  }
+
+  static void OnExitCalibrationProbe(
+      ze_driver_get_params_t* params, ze_result_t result,
+      void* global_user_data, void** instance_user_data) {
+    ZeApiCollector* collector =
+      reinterpret_cast<ZeApiCollector*>(global_user_data);
+    FTRACE_ASSERT(collector != nullptr);
+    uint64_t end_time = collector->GetTimestamp();
+    uint64_t start_time = *reinterpret_cast<uint64_t*>(instance_user_data);
+    FTRACE_ASSERT(start_time <= end_time);
+
+    uint64_t time = end_time - start_time;
+    uint64_t min_time = collector->calibration_time_.load(
+        std::memory_order_relaxed);
+    while (time < min_time &&
+           !collector->calibration_time_.compare_exchange_weak(
+               min_time, time, std::memory_order_relaxed)) {}
+  }
+
   #include <tracing.gen> // Auto-generated callbacks
 
  private: // Data
@@ -184,6 +304,9 @@ class ZeApiCollector {
   ZeFunctionInfoMap function_info_map_;
   std::mutex lock_;
 
+  std::atomic<uint64_t> calibration_time_{UINT64_MAX};
+  uint64_t call_overhead_ = 0;
+
   Correlator* correlator_ = nullptr;
   ApiCollectorOptions options_;
 
@@ -194,6 +317,7 @@ class ZeApiCollector {
   static const uint32_t kCallsLength = 12;
   static const uint32_t kTimeLength = 20;
   static const uint32_t kPercentLength = 10;
+  static const uint32_t kCalibrationCount = 1000;
 };
 
 #endif // FTRACE_TOOLS_COLLECTORS_ZE_COLLECTOR_ZE_API_COLLECTOR_H_
\ No newline at end of file
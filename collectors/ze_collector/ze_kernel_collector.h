@@ -14,7 +14,25 @@
 
 #include <level_zero/layers/zel_tracing_api.h>
 
+#include "alloc_index.h"
 #include "correlator.h"
+#include "dependency_graph.h"
+#include "device_utilization.h"
+#include "host_stall.h"
+#include "iteration_detector.h"
+#include "kernel_resources.h"
+#include "kernel_key.h"
+#include "latency_histogram.h"
+#include "launch_statistics.h"
+#include "memory_tracker.h"
+#include "module_builds.h"
+#include "object_churn.h"
+#include "occupancy.h"
+#include "scaling_model.h"
+#include "tile_balance.h"
+#include "tracer_overhead.h"
+#include "transfer_advisor.h"
+#include "transfer_statistics.h"
 #include "utils.h"
 #include "ze_event_cache.h"
 #include "ze_utils.h"
@@ -36,6 +54,7 @@ struct ZeKernelProps {
   size_t bytes_transferred;
   uint32_t group_count[3];
   uint32_t group_size[3];
+  uint64_t local_memory; // Zero if kernel resources are not captured
 };
 
 struct ZeKernelCommand {
@@ -43,10 +62,14 @@ struct ZeKernelCommand {
   ze_event_handle_t event = nullptr;
   ze_device_handle_t device = nullptr;
   uint64_t kernel_id = 0;
+  uint32_t name_id = 0;
   uint64_t append_time = 0;
   uint64_t call_count = 0;
   uint64_t timer_frequency = 0;
   uint64_t timer_mask = 0;
+  std::vector<ze_event_handle_t> wait_event_list;
+  bool barrier = false;
+  TransferPattern transfer;
 };
 
 struct ZeKernelCall {
@@ -56,6 +79,8 @@ struct ZeKernelCall {
   uint64_t submit_time = 0;
   uint64_t device_submit_time = 0;
   uint64_t call_id = 0;
+  uint64_t launch_id = 0;
+  size_t dependency_node = DependencyGraph::kNoNode;
   bool need_to_process = true;
 };
 
@@ -66,6 +91,8 @@ struct ZeKernelInfo {
   uint64_t min_time;
   uint64_t max_time;
   uint64_t call_count;
+  LatencyHistogram submit_histogram;
+  LatencyHistogram execute_histogram;
 
   bool operator>(const ZeKernelInfo& r) const {
     if (execute_time != r.execute_time) {
@@ -82,11 +109,27 @@ struct ZeKernelInfo {
   }
 };
 
+struct ZeQueueEngine {
+  std::string group;
+  uint32_t index;
+};
+
+struct ZeEventPoolCreateData {
+  ze_event_pool_desc_t desc;
+  uint64_t start;
+};
+
+struct ZeKernelResources {
+  KernelResources resources;
+  bool captured; // Properties are queried at the first append
+};
+
 struct ZeCommandListInfo {
   std::vector<ZeKernelCommand*> kernel_command_list;
   ze_context_handle_t context;
   ze_device_handle_t device;
   bool immediate;
+  bool in_order;
 };
 
 #ifdef FTRACE_KERNEL_INTERVALS
@@ -108,9 +151,21 @@ using ZeKernelIntervalList = std::vector<ZeKernelInterval>;
 #endif // FTRACE_KERNEL_INTERVALS
 
 using ZeKernelGroupSizeMap = std::map<ze_kernel_handle_t, ZeKernelGroupSize>;
+using ZeKernelResourceMap = std::map<ze_kernel_handle_t, ZeKernelResources>;
+using ZeModuleGrfMap = std::map<ze_module_handle_t, uint32_t>;
+using ZeDeviceLayoutMap = std::map<ze_device_handle_t, DeviceLayout>;
 using ZeKernelInfoMap = std::map<std::string, ZeKernelInfo>;
+using ZeKernelTimestampList =
+  std::vector< std::pair<int, ze_kernel_timestamp_result_t> >;
+using ZeQueueEngineMap = std::map<const void*, ZeQueueEngine>;
 using ZeCommandListMap = std::map<ze_command_list_handle_t, ZeCommandListInfo>;
 using ZeImageSizeMap = std::map<ze_image_handle_t, size_t>;
+struct ZeMemoryType {
+  bool known; // False if the driver query failed
+  ze_memory_type_t type;
+};
+
+using ZeMemoryTypeMap = std::map<const void*, ZeMemoryType>;
 using ZeDeviceMap = std::map<
     ze_device_handle_t, std::vector<ze_device_handle_t> >;
 
@@ -131,7 +186,9 @@ class ZeKernelCollector {
       Correlator* correlator,
       KernelCollectorOptions options,
       OnZeKernelFinishCallback callback = nullptr,
-      void* callback_data = nullptr) {
+      void* callback_data = nullptr,
+      OnHostStallCallback stall_callback = nullptr,
+      OnIterationCallback iteration_callback = nullptr) {
     ze_api_version_t version = utils::ze::GetVersion();
     FTRACE_ASSERT(
         ZE_MAJOR_VERSION(version) >= 1 &&
@@ -139,7 +196,8 @@ class ZeKernelCollector {
 
     FTRACE_ASSERT(correlator != nullptr);
     ZeKernelCollector* collector = new ZeKernelCollector(
-        correlator, options, callback, callback_data);
+        correlator, options, callback, callback_data,
+        stall_callback, iteration_callback);
     FTRACE_ASSERT(collector != nullptr);
 
     ze_result_t status = ZE_RESULT_SUCCESS;
@@ -167,9 +225,14 @@ class ZeKernelCollector {
   }
 
   void PrintKernelsTable() const {
+    PrintKernelsTable(GetSummaryLevel());
+  }
+
+  void PrintKernelsTable(uint32_t level) const {
+    ZeKernelInfoMap kernel_info_map = GetKernelInfoMap(level);
     std::set< std::pair<std::string, ZeKernelInfo>,
               utils::Comparator > sorted_list(
-        kernel_info_map_.begin(), kernel_info_map_.end());
+        kernel_info_map.begin(), kernel_info_map.end());
 
     uint64_t total_duration = 0;
     size_t max_name_length = kKernelLength;
@@ -191,7 +254,11 @@ class ZeKernelCollector {
       std::setw(kPercentLength) << "Time (%)" << "," <<
       std::setw(kTimeLength) << "Average (ns)" << "," <<
       std::setw(kTimeLength) << "Min (ns)" << "," <<
-      std::setw(kTimeLength) << "Max (ns)" << std::endl;
+      std::setw(kTimeLength) << "Max (ns)" << "," <<
+      std::setw(kTimeLength) << "p50 (ns)" << "," <<
+      std::setw(kTimeLength) << "p90 (ns)" << "," <<
+      std::setw(kTimeLength) << "p99 (ns)" << "," <<
+      std::setw(kTimeLength) << "p99.9 (ns)" << std::endl;
 
     for (auto& value : sorted_list) {
       const std::string& function = value.first;
@@ -200,6 +267,7 @@ class ZeKernelCollector {
       uint64_t avg_duration = duration / call_count;
       uint64_t min_duration = value.second.min_time;
       uint64_t max_duration = value.second.max_time;
+      const LatencyHistogram& histogram = value.second.execute_histogram;
       float percent_duration = 100.0f * duration / total_duration;
       stream << std::setw(max_name_length) << function << "," <<
         std::setw(kCallsLength) << call_count << "," <<
@@ -208,7 +276,11 @@ class ZeKernelCollector {
           std::fixed << percent_duration << "," <<
         std::setw(kTimeLength) << avg_duration << "," <<
         std::setw(kTimeLength) << min_duration << "," <<
-        std::setw(kTimeLength) << max_duration << std::endl;
+        std::setw(kTimeLength) << max_duration << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(50.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(90.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.9) << std::endl;
     }
 
     FTRACE_ASSERT(correlator_ != nullptr);
@@ -216,9 +288,10 @@ class ZeKernelCollector {
   }
 
   void PrintSubmissionTable() const {
+    ZeKernelInfoMap kernel_info_map = GetKernelInfoMap();
     std::set< std::pair<std::string, ZeKernelInfo>,
               utils::Comparator > sorted_list(
-        kernel_info_map_.begin(), kernel_info_map_.end());
+        kernel_info_map.begin(), kernel_info_map.end());
 
     uint64_t total_append_duration = 0;
     uint64_t total_submit_duration = 0;
@@ -245,7 +318,11 @@ class ZeKernelCollector {
       std::setw(kTimeLength) << "Submit (ns)" << "," <<
       std::setw(kPercentLength) << "Submit (%)" << "," <<
       std::setw(kTimeLength) << "Execute (ns)" << "," <<
-      std::setw(kPercentLength) << "Execute (%)" << "," << std::endl;
+      std::setw(kPercentLength) << "Execute (%)" << "," <<
+      std::setw(kTimeLength) << "Submit p50 (ns)" << "," <<
+      std::setw(kTimeLength) << "Submit p90 (ns)" << "," <<
+      std::setw(kTimeLength) << "Submit p99 (ns)" << "," <<
+      std::setw(kTimeLength) << "Submit p99.9 (ns)" << "," << std::endl;
 
     for (auto& value : sorted_list) {
       const std::string& function = value.first;
@@ -259,6 +336,7 @@ class ZeKernelCollector {
       uint64_t execute_duration = value.second.execute_time;
       float execute_percent =
         100.0f * execute_duration / total_execute_duration;
+      const LatencyHistogram& histogram = value.second.submit_histogram;
       stream << std::setw(max_name_length) << function << "," <<
         std::setw(kCallsLength) << call_count << "," <<
         std::setw(kTimeLength) << append_duration << "," <<
@@ -269,7 +347,32 @@ class ZeKernelCollector {
           std::fixed << submit_percent << "," <<
         std::setw(kTimeLength) << execute_duration << "," <<
         std::setw(kPercentLength) << std::setprecision(2) <<
-          std::fixed << execute_percent << "," << std::endl;
+          std::fixed << execute_percent << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(50.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(90.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.0) << "," <<
+        std::setw(kTimeLength) << histogram.GetPercentile(99.9) << "," <<
+        std::endl;
+    }
+
+    FTRACE_ASSERT(correlator_ != nullptr);
+    correlator_->Log(stream.str());
+  }
+
+  void PrintHistograms() const {
+    ZeKernelInfoMap kernel_info_map = GetKernelInfoMap();
+    std::set< std::pair<std::string, ZeKernelInfo>,
+              utils::Comparator > sorted_list(
+        kernel_info_map.begin(), kernel_info_map.end());
+    if (sorted_list.empty()) {
+      return;
+    }
+
+    std::stringstream stream;
+    for (auto& value : sorted_list) {
+      stream << "Kernel: " << value.first << std::endl;
+      stream << value.second.execute_histogram.GetBucketTable();
+      stream << std::endl;
     }
 
     FTRACE_ASSERT(correlator_ != nullptr);
@@ -284,8 +387,115 @@ class ZeKernelCollector {
 #endif
   }
 
-  const ZeKernelInfoMap& GetKernelInfoMap() const {
-    return kernel_info_map_;
+  // Aggregation level of the summary tables, set by verbose and per tile
+  // options
+  uint32_t GetSummaryLevel() const {
+    uint32_t level = KERNEL_KEY_NAME;
+    if (options_.verbose) {
+      level |= KERNEL_KEY_CONFIG;
+    }
+    if (options_.kernels_per_tile) {
+      level |= KERNEL_KEY_TILE;
+    }
+    return level;
+  }
+
+  ZeKernelInfoMap GetKernelInfoMap() const {
+    return GetKernelInfoMap(GetSummaryLevel());
+  }
+
+  ZeKernelInfoMap GetKernelInfoMap(uint32_t level) const {
+    return RollUpKernelKeys(
+        kernel_info_map_, level,
+        [this](const KernelKey& key, uint32_t key_level) {
+          return GetKeyName(key, key_level);
+        },
+        MergeKernelInfo);
+  }
+
+  ZeKernelInfoMap GetKernelInfoMapSnapshot() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    return GetKernelInfoMap();
+  }
+
+  void PrintSteadyStateTable() const {
+    std::set<const void*> device_set;
+    for (auto& value : launch_stats_map_) {
+      device_set.insert(value.first.device);
+    }
+    uint32_t level = GetSummaryLevel() | KERNEL_KEY_CONFIG;
+    if (device_set.size() > 1) {
+      level |= KERNEL_KEY_DEVICE;
+    }
+
+    std::map<std::string, LaunchStatistics> stats_map;
+    for (auto& value : launch_stats_map_) {
+      stats_map[GetKeyName(value.first, level)] = value.second;
+    }
+
+    std::string table = LaunchStatistics::GetSteadyStateTable(stats_map);
+    if (!table.empty()) {
+      FTRACE_ASSERT(correlator_ != nullptr);
+      correlator_->Log(table);
+    }
+  }
+
+  HostStallInfoMap GetHostStallInfoMap() const {
+    return host_stalls_.GetStallInfoMap();
+  }
+
+  void PrintCriticalPathTable() {
+    PrintTable([this]() { return dependency_graph_.GetCriticalPathTable(); });
+  }
+
+  void ExportGraph(ExecGraph* graph) {
+    FTRACE_ASSERT(graph != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    dependency_graph_.Export(graph, "L0");
+  }
+
+  void PrintUtilizationTable() {
+    PrintTable([this]() { return utilization_.GetUtilizationTable(); });
+  }
+
+  void PrintIterationTable() {
+    PrintTable([this]() { return iterations_.GetIterationTable(); });
+  }
+
+  void PrintTransferTable() {
+    PrintTable([this]() { return transfers_.GetTransferTable(); });
+  }
+
+  void PrintTransferAdviceTable() {
+    PrintTable([this]() { return transfer_advisor_.GetAdviceTable(); });
+  }
+
+  void PrintKernelResourceTable() {
+    PrintTable([this]() { return kernel_resources_.GetResourceTable(); });
+  }
+
+  void PrintOccupancyTable() {
+    PrintTable([this]() { return occupancy_.GetOccupancyTable(); });
+  }
+
+  void PrintTileBalanceTable() {
+    PrintTable([this]() { return tile_balance_.GetBalanceTable(); });
+  }
+
+  void PrintScalingTable() {
+    PrintTable([this]() { return scaling_.GetScalingTable(); });
+  }
+
+  void PrintObjectChurnTable() {
+    PrintTable([this]() { return object_churn_.GetChurnTable(); });
+  }
+
+  void PrintHostStallTable() const {
+    std::string table = host_stalls_.GetStallTable();
+    if (!table.empty()) {
+      FTRACE_ASSERT(correlator_ != nullptr);
+      correlator_->Log(table);
+    }
   }
 
 #ifdef FTRACE_KERNEL_INTERVALS
@@ -296,18 +506,39 @@ class ZeKernelCollector {
 
  private: // Implementation
 
+  // Tables are built under the lock and logged out of it
+  template <class Builder>
+  void PrintTable(Builder builder) {
+    std::string table;
+    {
+      const std::lock_guard<std::mutex> lock(lock_);
+      table = builder();
+    }
+    if (!table.empty()) {
+      FTRACE_ASSERT(correlator_ != nullptr);
+      correlator_->Log(table);
+    }
+  }
+
   ZeKernelCollector(
       Correlator* correlator,
       KernelCollectorOptions options,
       OnZeKernelFinishCallback callback,
-      void* callback_data)
+      void* callback_data,
+      OnHostStallCallback stall_callback,
+      OnIterationCallback iteration_callback)
       : correlator_(correlator),
         options_(options),
         callback_(callback),
         callback_data_(callback_data),
+        stall_callback_(stall_callback),
         kernel_id_(1),
-        event_cache_(ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP) {
+        event_cache_(ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP),
+        iterations_(iteration_callback, callback_data) {
     FTRACE_ASSERT(correlator_ != nullptr);
+    if (options_.record_graph) {
+      dependency_graph_.SetWindowSize(0);
+    }
     CreateDeviceMap();
 #ifdef FTRACE_KERNEL_INTERVALS
     SetSyncPoints();
@@ -491,6 +722,8 @@ class ZeKernelCollector {
     epilogue_callbacks.CommandList.pfnResetCb =
       OnExitCommandListReset;
 
+    epilogue_callbacks.CommandQueue.pfnCreateCb =
+      OnExitCommandQueueCreate;
     epilogue_callbacks.CommandQueue.pfnSynchronizeCb =
       OnExitCommandQueueSynchronize;
     epilogue_callbacks.CommandQueue.pfnDestroyCb =
@@ -498,9 +731,24 @@ class ZeKernelCollector {
 
     epilogue_callbacks.Image.pfnCreateCb =
       OnExitImageCreate;
+    prologue_callbacks.Image.pfnDestroyCb =
+      OnEnterImageDestroy;
     epilogue_callbacks.Image.pfnDestroyCb =
       OnExitImageDestroy;
 
+    epilogue_callbacks.Mem.pfnAllocHostCb =
+      OnExitMemAllocHost;
+    epilogue_callbacks.Mem.pfnAllocDeviceCb =
+      OnExitMemAllocDevice;
+    epilogue_callbacks.Mem.pfnAllocSharedCb =
+      OnExitMemAllocShared;
+    epilogue_callbacks.Mem.pfnOpenIpcHandleCb =
+      OnExitMemOpenIpcHandle;
+    prologue_callbacks.Mem.pfnFreeCb =
+      OnEnterMemFree;
+    prologue_callbacks.Mem.pfnCloseIpcHandleCb =
+      OnEnterMemCloseIpcHandle;
+
     epilogue_callbacks.Kernel.pfnSetGroupSizeCb =
       OnExitKernelSetGroupSize;
     epilogue_callbacks.Kernel.pfnDestroyCb =
@@ -509,12 +757,57 @@ class ZeKernelCollector {
     epilogue_callbacks.Event.pfnHostSynchronizeCb =
       OnExitEventHostSynchronize;
 
+    if (options_.host_stalls) {
+      prologue_callbacks.Event.pfnHostSynchronizeCb =
+        OnEnterEventHostSynchronize;
+      prologue_callbacks.Fence.pfnHostSynchronizeCb =
+        OnEnterFenceHostSynchronize;
+      prologue_callbacks.CommandQueue.pfnSynchronizeCb =
+        OnEnterCommandQueueSynchronize;
+    }
+
     epilogue_callbacks.Fence.pfnHostSynchronizeCb =
       OnExitFenceHostSynchronize;
 
     epilogue_callbacks.Context.pfnDestroyCb =
       OnExitContextDestroy;
 
+    if (options_.object_churn || options_.module_builds ||
+        options_.kernel_resources) {
+      prologue_callbacks.Module.pfnCreateCb =
+        OnEnterObjectCall<ze_module_create_params_t>;
+      epilogue_callbacks.Module.pfnCreateCb =
+        OnExitModuleCreate;
+    }
+
+    if (options_.object_churn || options_.kernel_resources) {
+      prologue_callbacks.Kernel.pfnCreateCb =
+        OnEnterObjectCall<ze_kernel_create_params_t>;
+      epilogue_callbacks.Kernel.pfnCreateCb =
+        OnExitKernelCreate;
+    }
+
+    if (options_.object_churn) {
+      prologue_callbacks.CommandList.pfnCreateCb =
+        OnEnterObjectCall<ze_command_list_create_params_t>;
+      prologue_callbacks.CommandList.pfnCreateImmediateCb =
+        OnEnterObjectCall<ze_command_list_create_immediate_params_t>;
+      prologue_callbacks.CommandList.pfnDestroyCb =
+        OnEnterObjectCall<ze_command_list_destroy_params_t>;
+      prologue_callbacks.CommandList.pfnResetCb =
+        OnEnterObjectCall<ze_command_list_reset_params_t>;
+      prologue_callbacks.EventPool.pfnDestroyCb =
+        OnEnterObjectCall<ze_event_pool_destroy_params_t>;
+      epilogue_callbacks.EventPool.pfnDestroyCb =
+        OnExitEventPoolDestroy;
+      prologue_callbacks.Module.pfnDestroyCb =
+        OnEnterObjectCall<ze_module_destroy_params_t>;
+      epilogue_callbacks.Module.pfnDestroyCb =
+        OnExitModuleDestroy;
+      prologue_callbacks.Kernel.pfnDestroyCb =
+        OnEnterObjectCall<ze_kernel_destroy_params_t>;
+    }
+
     ze_result_t status = ZE_RESULT_SUCCESS;
     status = zelTracerSetPrologues(tracer_, &prologue_callbacks);
     FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
@@ -533,13 +826,32 @@ class ZeKernelCollector {
 
     command->kernel_id =
       kernel_id_.fetch_add(1, std::memory_order::memory_order_relaxed);
+    command->name_id = kernel_names_.GetId(command->props.name);
     FTRACE_ASSERT(correlator_ != nullptr);
     correlator_->SetKernelId(command->kernel_id);
+    correlator_->SetCallId(0);
     correlator_->AddKernelId(command_list, command->kernel_id);
 
     FTRACE_ASSERT(command_list_map_.count(command_list) == 1);
     ZeCommandListInfo& command_list_info = command_list_map_[command_list];
     command_list_info.kernel_command_list.push_back(command);
+    TracerOverhead::AddMemory(sizeof(ZeKernelCommand));
+
+    if (options_.object_churn) {
+      object_churn_.AddCommand(
+          command_list, GetCommandFingerprint(command),
+          GetHostTimestamp() - command->append_time);
+    }
+
+    if (options_.transfer_advice) {
+      if (command->props.bytes_transferred > 0) {
+        transfer_advisor_.AddTransfer(
+            command_list, command->props.name,
+            command->props.bytes_transferred, command->transfer);
+      } else {
+        transfer_advisor_.AddCommand(command_list);
+      }
+    }
   }
 
   void AddKernelCall(
@@ -553,15 +865,28 @@ class ZeKernelCollector {
     FTRACE_ASSERT(command != nullptr);
     ++(command->call_count);
     call->call_id = command->call_count;
+    if (options_.iterations) {
+      call->launch_id =
+        iterations_.AddLaunch(command->name_id, call->submit_time);
+    }
+
+    if (options_.critical_path) {
+      dependency_graph_.BeginSubmission(call->queue);
+      AddDependencyNode(call);
+    }
 
     kernel_call_list_.push_back(call);
+    TracerOverhead::AddMemory(sizeof(ZeKernelCall));
+    TracerOverhead::UpdatePendingDepth(kernel_call_list_.size());
 
     FTRACE_ASSERT(correlator_ != nullptr);
+    correlator_->SetCallId(call->call_id);
     correlator_->AddCallId(command_list, call->call_id);
   }
 
   void ProcessCall(std::string callname, ze_event_handle_t event) {
     FTRACE_ASSERT(event != nullptr);
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_PROCESS_CALLS);
     const std::lock_guard<std::mutex> lock(lock_);
 
     ze_result_t status = ZE_RESULT_SUCCESS;
@@ -587,6 +912,7 @@ class ZeKernelCollector {
 
   void ProcessCall(std::string callname, ze_fence_handle_t fence) {
     FTRACE_ASSERT(fence != nullptr);
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_PROCESS_CALLS);
     const std::lock_guard<std::mutex> lock(lock_);
 
     ze_result_t status = ZE_RESULT_SUCCESS;
@@ -730,10 +1056,10 @@ class ZeKernelCollector {
     host_end = host_start + duration;
   }
 
-  void ProcessCall(
+  void AddKernelInfo(
       const ZeKernelCall* call,
       const ze_kernel_timestamp_result_t& timestamp,
-      int tile, bool in_summary) {
+      int tile) {
     FTRACE_ASSERT(call != nullptr);
 
     ZeKernelCommand* command = call->command;
@@ -741,53 +1067,249 @@ class ZeKernelCollector {
 
     uint64_t host_start = 0, host_end = 0;
     GetHostTime(call, timestamp, host_start, host_end);
+
+    FTRACE_ASSERT(command->append_time > 0);
+    FTRACE_ASSERT(command->append_time <= call->submit_time);
+    uint64_t append_time = call->submit_time - command->append_time;
+    FTRACE_ASSERT(call->submit_time <= host_start);
+    uint64_t submit_time = host_start - call->submit_time;
     FTRACE_ASSERT(host_start <= host_end);
+    uint64_t execute_time = host_end - host_start;
+
+    KernelKey key = GetKernelKey(command, tile);
+    AddKernelInfo(key, append_time, submit_time, execute_time);
+    if (options_.steady_state && tile < 0) {
+      launch_stats_map_[key].Record(
+          execute_time, command->kernel_id, call->call_id,
+          options_.warm_up_count);
+    }
+    if (options_.iterations && tile < 0) {
+      iterations_.AddDeviceTime(call->launch_id, execute_time);
+    }
+    if (options_.transfers && tile < 0 &&
+        command->props.bytes_transferred > 0) {
+      transfers_.Add(
+          TransferStatistics::GetDirection(command->props.name),
+          command->device, command->props.bytes_transferred, execute_time);
+    }
+    if (options_.transfer_advice && tile < 0 &&
+        command->props.bytes_transferred > 0) {
+      transfer_advisor_.AddTime(command->transfer, execute_time);
+    }
+    if (options_.kernel_resources && tile < 0 &&
+        command->props.simd_width > 0) {
+      kernel_resources_.AddTime(command->props.name, execute_time);
+    }
+    if (options_.occupancy && tile < 0 && command->props.simd_width > 0) {
+      FTRACE_ASSERT(command->device != nullptr);
+      LaunchShape shape{};
+      shape.group_count = static_cast<uint64_t>(
+          command->props.group_count[0]) *
+        command->props.group_count[1] * command->props.group_count[2];
+      for (int i = 0; i < 3; ++i) {
+        shape.group_size[i] = command->props.group_size[i];
+      }
+      shape.simd_width = static_cast<uint32_t>(command->props.simd_width);
+      shape.local_memory = command->props.local_memory;
+      occupancy_.AddLaunch(
+          command->props.name, GetDeviceLayout(command->device), shape,
+          execute_time);
+    }
+    if (options_.scaling && tile < 0) {
+      scaling_.AddLaunch(
+          command->props.name, command->device,
+          command->props.simd_width == 0, GetLaunchSize(command),
+          execute_time);
+    }
+  }
 
-    std::string name = command->props.name;
-    FTRACE_ASSERT(!name.empty());
+  void ProcessCall(
+      const ZeKernelCall* call,
+      const ze_kernel_timestamp_result_t& timestamp,
+      int tile) {
+    FTRACE_ASSERT(call != nullptr);
 
-    if (options_.verbose) {
-      name = GetVerboseName(&command->props);
-    }
+    ZeKernelCommand* command = call->command;
+    FTRACE_ASSERT(command != nullptr);
 
-    if (tile >= 0) {
-      name += "(" + std::to_string(tile) + "T)";
-    }
+    uint64_t host_start = 0, host_end = 0;
+    GetHostTime(call, timestamp, host_start, host_end);
+    FTRACE_ASSERT(host_start <= host_end);
 
-    if (in_summary) {
-      FTRACE_ASSERT(command->append_time > 0);
-      FTRACE_ASSERT(command->append_time <= call->submit_time);
-      uint64_t append_time = call->submit_time - command->append_time;
-      FTRACE_ASSERT(call->submit_time <= host_start);
-      uint64_t submit_time = host_start - call->submit_time;
-      FTRACE_ASSERT(host_start <= host_end);
-      uint64_t execute_time = host_end - host_start;
-      AddKernelInfo(append_time, submit_time, execute_time, name);
+    if (tile >= 0) {
+      // Per tile part of implicitly scaled kernel, whole kernel is already
+      // counted for the device
+      auto it = device_map_.find(command->device);
+      if (options_.utilization &&
+          it != device_map_.end() && !it->second.empty()) {
+        std::vector<std::string> path = GetTrackPath(call, tile);
+        utilization_.AddTrackInterval(
+            path, 1, GetUtilizationKind(command->props),
+            call->submit_time, host_start, host_end);
+        TracerOverhead::AddMemory(
+            (path.size() - 1) * sizeof(UtilizationInterval));
+      }
     }
 
     if (callback_ != nullptr) {
       FTRACE_ASSERT(command->append_time > 0);
       FTRACE_ASSERT(command->append_time <= call->submit_time);
 
+      std::string name = command->props.name;
+      FTRACE_ASSERT(!name.empty());
+      if (options_.verbose) {
+        name = GetVerboseName(&command->props);
+      }
+      if (tile >= 0) {
+        name += "(" + std::to_string(tile) + "T)";
+      }
+
       FTRACE_ASSERT(call->queue != nullptr);
       FTRACE_ASSERT(!command->props.name.empty());
       std::string id = std::to_string(command->kernel_id) + "." +
         std::to_string(call->call_id);
 
-      std::stringstream stream;
-      stream << std::hex << call->queue;
-      if (tile >= 0) {
-        stream << "." << std::dec << tile;
+      std::string queue;
+      if (options_.engine_on_device) {
+        std::vector<std::string> path = GetTrackPath(call, tile);
+        queue = DeviceUtilization::GetTrackName(path, path.size());
+      } else {
+        std::stringstream stream;
+        stream << std::hex << call->queue;
+        if (tile >= 0) {
+          stream << "." << std::dec << tile;
+        }
+        queue = stream.str();
       }
 
       callback_(
-          callback_data_, stream.str(), id, name,
+          callback_data_, queue, id, name,
           command->append_time, call->submit_time,
           host_start, host_end);
     }
   }
+
+  void CompleteCall(
+      const ZeKernelCall* call,
+      const ze_kernel_timestamp_result_t& timestamp) {
+    FTRACE_ASSERT(call != nullptr);
+
+    ZeKernelCommand* command = call->command;
+    FTRACE_ASSERT(command != nullptr);
+
+    uint64_t host_start = 0, host_end = 0;
+    GetHostTime(call, timestamp, host_start, host_end);
+
+    std::string name = command->props.name;
+    FTRACE_ASSERT(!name.empty());
+    if (options_.verbose) {
+      name = GetVerboseName(&command->props);
+    }
+
+    if (call->dependency_node != DependencyGraph::kNoNode) {
+      dependency_graph_.CompleteNode(
+          call->dependency_node, name, host_start, host_end);
+    }
+
+    if (host_stalls_.IsWaiting()) {
+      std::string id = std::to_string(command->kernel_id) + "." +
+        std::to_string(call->call_id);
+      host_stalls_.AddCompletion(name, id, host_start, host_end);
+    }
+
+    if (options_.utilization) {
+      std::vector<std::string> path = GetTrackPath(call, -1);
+      utilization_.AddInterval(
+          path, GetUtilizationKind(command->props),
+          call->submit_time, host_start, host_end);
+      TracerOverhead::AddMemory(
+          (path.size() + 1) * sizeof(UtilizationInterval));
+    }
+  }
 #endif // FTRACE_KERNEL_INTERVALS
 
+  void BeginHostWait(void** instance_data) {
+    FTRACE_ASSERT(instance_data != nullptr);
+    uint64_t start = GetHostTimestamp();
+    host_stalls_.BeginWait(start);
+    *reinterpret_cast<uint64_t*>(instance_data) = start;
+  }
+
+  void EndHostWait(void** instance_data, uint64_t end) {
+    FTRACE_ASSERT(instance_data != nullptr);
+    uint64_t start = *reinterpret_cast<uint64_t*>(instance_data);
+    host_stalls_.EndWait(start, end, stall_callback_, callback_data_);
+    if (options_.critical_path || options_.utilization) {
+      const std::lock_guard<std::mutex> lock(lock_);
+      if (options_.critical_path) {
+        dependency_graph_.AddHostWait(start, end);
+      }
+      if (options_.utilization) {
+        utilization_.AddHostWait(start, end);
+      }
+    }
+  }
+
+  static UtilizationKind GetUtilizationKind(const ZeKernelProps& props) {
+    if (props.simd_width > 0) {
+      return UTILIZATION_COMPUTE;
+    }
+    if (props.bytes_transferred > 0) {
+      return UTILIZATION_TRANSFER;
+    }
+    return UTILIZATION_OTHER;
+  }
+
+  void SetQueueEngine(
+      const void* queue, ze_device_handle_t device,
+      uint32_t ordinal, uint32_t index) {
+    FTRACE_ASSERT(queue != nullptr);
+    FTRACE_ASSERT(device != nullptr);
+    ZeQueueEngine engine{
+        utils::ze::GetCommandQueueGroupName(device, ordinal), index};
+    const std::lock_guard<std::mutex> lock(lock_);
+    queue_engine_map_[queue] = engine;
+  }
+
+  // Device -> tile -> engine group -> engine -> queue, subdevice is shown
+  // as a tile of its root device
+  std::vector<std::string> GetTrackPath(
+      const ZeKernelCall* call, int tile) const {
+    FTRACE_ASSERT(call != nullptr);
+    FTRACE_ASSERT(call->queue != nullptr);
+    FTRACE_ASSERT(call->command != nullptr);
+
+    ze_device_handle_t device = call->command->device;
+    if (device_map_.count(device) == 0) { // Subdevice
+      ze_device_handle_t root_device = GetDeviceForSubDevice(device);
+      if (root_device != nullptr) {
+        if (tile < 0) {
+          tile = GetSubDeviceId(device);
+        }
+        device = root_device;
+      }
+    }
+
+    std::vector<std::string> path;
+    std::stringstream stream;
+    stream << "Device " << std::hex << device;
+    path.push_back(stream.str());
+    if (tile >= 0) {
+      path.push_back("Tile " + std::to_string(tile));
+    }
+
+    auto it = queue_engine_map_.find(call->queue);
+    if (it != queue_engine_map_.end()) {
+      path.push_back(it->second.group);
+      path.push_back("Engine " + std::to_string(it->second.index));
+    }
+
+    stream.str(std::string());
+    stream << "Queue " << std::hex << call->queue;
+    path.push_back(stream.str());
+    return path;
+  }
+
   void ProcessCall(std::string callname, const ZeKernelCall* call) {
     FTRACE_ASSERT(call != nullptr);
     ZeKernelCommand* command = call->command;
@@ -805,39 +1327,38 @@ class ZeKernelCollector {
       status = zeEventQueryKernelTimestamp(command->event, &timestamp);
       FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
 
-      if (options_.kernels_per_tile && command->props.simd_width > 0) {
-        if (device_map_.count(command->device) == 1 &&
-            !device_map_[command->device].empty()) { // Implicit Scaling
-          uint32_t count = 0;
-          status = zeEventQueryTimestampsExp(
-              command->event, command->device, &count, nullptr);
-          FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
-          FTRACE_ASSERT(count > 0);
-
-          std::vector<ze_kernel_timestamp_result_t> timestamps(count);
-          status = zeEventQueryTimestampsExp(
-              command->event, command->device, &count, timestamps.data());
-          FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
-
-          if (count == 1) { // First tile is used only
-            ProcessCall(call, timestamp, 0, true);
-          } else {
-            ProcessCall(call, timestamp, -1, false);
-            for (uint32_t i = 0; i < count; ++i) {
-              ProcessCall(call, timestamps[i], static_cast<int>(i), true);
-            }
+      if (host_stalls_.IsWaiting() ||
+          call->dependency_node != DependencyGraph::kNoNode ||
+          options_.utilization) {
+        CompleteCall(call, timestamp);
+      }
+
+      AddKernelInfo(call, timestamp, -1);
+      if ((options_.kernels_per_tile || options_.drill_down ||
+           options_.tile_balance) && command->props.simd_width > 0) {
+        ZeKernelTimestampList tile_list;
+        bool split = GetTileTimestamps(command, timestamp, tile_list);
+        if (options_.tile_balance && split) {
+          AddTileBalance(call, tile_list);
+        }
+        if (options_.kernels_per_tile || options_.drill_down) {
+          for (auto& tile : tile_list) {
+            AddKernelInfo(call, tile.second, tile.first);
+          }
+        }
+
+        if (options_.kernels_per_tile) {
+          if (split) {
+            ProcessCall(call, timestamp, -1);
           }
-        } else { // Explicit Scaling
-          if (device_map_.count(command->device) == 0) { // Subdevice
-            int sub_device_id = GetSubDeviceId(command->device);
-            FTRACE_ASSERT(sub_device_id >= 0);
-            ProcessCall(call, timestamp, sub_device_id, true);
-          } else { // Device with no subdevices
-            ProcessCall(call, timestamp, 0, true);
+          for (auto& tile : tile_list) {
+            ProcessCall(call, tile.second, tile.first);
           }
+        } else {
+          ProcessCall(call, timestamp, -1);
         }
       } else {
-        ProcessCall(call, timestamp, -1, true);
+        ProcessCall(call, timestamp, -1);
       }
 #endif // FTRACE_KERNEL_INTERVALS
     }
@@ -845,9 +1366,11 @@ class ZeKernelCollector {
     //DO NOT RESET EVENT 
     //event_cache_.ResetEvent(command->event);
     delete call;
+    TracerOverhead::RemoveMemory(sizeof(ZeKernelCall));
   }
 
   void ProcessCalls(std::string callname) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_PROCESS_CALLS);
     ze_result_t status = ZE_RESULT_SUCCESS;
     const std::lock_guard<std::mutex> lock(lock_);
 
@@ -872,6 +1395,118 @@ class ZeKernelCollector {
     }
   }
 
+  // Returns true if the kernel was split between several tiles (Implicit
+  // Scaling), so it has both whole and per tile parts
+  bool GetTileTimestamps(
+      const ZeKernelCommand* command,
+      const ze_kernel_timestamp_result_t& timestamp,
+      ZeKernelTimestampList& tile_list) {
+    FTRACE_ASSERT(command != nullptr);
+
+    auto it = device_map_.find(command->device);
+    if (it != device_map_.end() && !it->second.empty()) { // Implicit Scaling
+      uint32_t count = 0;
+      ze_result_t status = zeEventQueryTimestampsExp(
+          command->event, command->device, &count, nullptr);
+      FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+      FTRACE_ASSERT(count > 0);
+
+      std::vector<ze_kernel_timestamp_result_t> timestamps(count);
+      status = zeEventQueryTimestampsExp(
+          command->event, command->device, &count, timestamps.data());
+      FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+
+      if (count == 1) { // First tile is used only
+        tile_list.push_back(std::make_pair(0, timestamp));
+        return false;
+      }
+      for (uint32_t i = 0; i < count; ++i) {
+        tile_list.push_back(
+            std::make_pair(static_cast<int>(i), timestamps[i]));
+      }
+      return true;
+    }
+
+    // Explicit Scaling
+    if (it == device_map_.end()) { // Subdevice
+      int sub_device_id = GetSubDeviceId(command->device);
+      FTRACE_ASSERT(sub_device_id >= 0);
+      tile_list.push_back(std::make_pair(sub_device_id, timestamp));
+    } else { // Device with no subdevices
+      tile_list.push_back(std::make_pair(0, timestamp));
+    }
+    return false;
+  }
+
+  // Work-items for kernels and bytes for transfers
+  static uint64_t GetLaunchSize(const ZeKernelCommand* command) {
+    FTRACE_ASSERT(command != nullptr);
+    if (command->props.simd_width == 0) {
+      return command->props.bytes_transferred;
+    }
+    uint64_t size = 1;
+    for (int i = 0; i < 3; ++i) {
+      size *= static_cast<uint64_t>(command->props.group_count[i]) *
+        command->props.group_size[i];
+    }
+    return size;
+  }
+
+  void AddTileBalance(
+      const ZeKernelCall* call, const ZeKernelTimestampList& tile_list) {
+    FTRACE_ASSERT(call != nullptr);
+    FTRACE_ASSERT(call->command != nullptr);
+
+    std::vector<TileInterval> interval_list;
+    for (auto& tile : tile_list) {
+      TileInterval interval{tile.first, 0, 0};
+      GetHostTime(call, tile.second, interval.start, interval.end);
+      interval_list.push_back(interval);
+    }
+    tile_balance_.AddLaunch(call->command->props.name, interval_list);
+  }
+
+  static KernelKey GetKernelKey(const ZeKernelCommand* command, int tile) {
+    FTRACE_ASSERT(command != nullptr);
+    KernelKey key{};
+    key.name_id = command->name_id;
+    key.tile = tile;
+    key.simd_width = command->props.simd_width;
+    key.bytes_transferred = command->props.bytes_transferred;
+    if (command->props.simd_width > 0) {
+      for (size_t i = 0; i < 3; ++i) {
+        key.size[i] = command->props.group_count[i];
+        key.size[i + 3] = command->props.group_size[i];
+      }
+    }
+    key.device = command->device;
+    return key;
+  }
+
+  std::string GetKeyName(const KernelKey& key, uint32_t level) const {
+    std::string name = kernel_names_.GetName(key.name_id);
+    if (level & KERNEL_KEY_CONFIG) {
+      ZeKernelProps props{};
+      props.name = name;
+      props.simd_width = key.simd_width;
+      props.bytes_transferred = key.bytes_transferred;
+      for (size_t i = 0; i < 3; ++i) {
+        props.group_count[i] = static_cast<uint32_t>(key.size[i]);
+        props.group_size[i] = static_cast<uint32_t>(key.size[i + 3]);
+      }
+      name = GetVerboseName(&props);
+    }
+    if ((level & KERNEL_KEY_TILE) && key.tile >= 0) {
+      name += "(" + std::to_string(key.tile) + "T)";
+    }
+    if (level & KERNEL_KEY_DEVICE) {
+      std::stringstream stream;
+      stream << name << " on Device " << key.device;
+      name = stream.str();
+    }
+    return name;
+  }
+
   static std::string GetVerboseName(const ZeKernelProps* props) {
     FTRACE_ASSERT(props != nullptr);
     FTRACE_ASSERT(!props->name.empty());
@@ -900,11 +1535,10 @@ class ZeKernelCollector {
   }
 
   void AddKernelInfo(
-      uint64_t append_time, uint64_t submit_time,
-      uint64_t execute_time, const std::string& name) {
-    FTRACE_ASSERT(!name.empty());
-
-    if (kernel_info_map_.count(name) == 0) {
+      const KernelKey& key, uint64_t append_time,
+      uint64_t submit_time, uint64_t execute_time) {
+    auto it = kernel_info_map_.find(key);
+    if (it == kernel_info_map_.end()) {
       ZeKernelInfo info;
       info.append_time = append_time;
       info.submit_time = submit_time;
@@ -912,9 +1546,11 @@ class ZeKernelCollector {
       info.min_time = execute_time;
       info.max_time = execute_time;
       info.call_count = 1;
-      kernel_info_map_[name] = info;
+      info.submit_histogram.Record(submit_time);
+      info.execute_histogram.Record(execute_time);
+      kernel_info_map_[key] = info;
     } else {
-      ZeKernelInfo& kernel = kernel_info_map_[name];
+      ZeKernelInfo& kernel = it->second;
       kernel.append_time += append_time;
       kernel.submit_time +=  submit_time;
       kernel.execute_time += execute_time;
@@ -925,7 +1561,24 @@ class ZeKernelCollector {
         kernel.min_time = execute_time;
       }
       kernel.call_count += 1;
+      kernel.submit_histogram.Record(submit_time);
+      kernel.execute_histogram.Record(execute_time);
+    }
+  }
+
+  static void MergeKernelInfo(ZeKernelInfo& info, const ZeKernelInfo& other) {
+    info.append_time += other.append_time;
+    info.submit_time += other.submit_time;
+    info.execute_time += other.execute_time;
+    if (other.max_time > info.max_time) {
+      info.max_time = other.max_time;
     }
+    if (other.min_time < info.min_time) {
+      info.min_time = other.min_time;
+    }
+    info.call_count += other.call_count;
+    info.submit_histogram.Merge(other.submit_histogram);
+    info.execute_histogram.Merge(other.execute_histogram);
   }
 
 #ifdef FTRACE_KERNEL_INTERVALS
@@ -1012,13 +1665,14 @@ class ZeKernelCollector {
       ze_command_list_handle_t command_list,
       ze_context_handle_t context,
       ze_device_handle_t device,
-      bool immediate) {
+      bool immediate,
+      bool in_order) {
     FTRACE_ASSERT(command_list != nullptr);
     FTRACE_ASSERT(context != nullptr);
     const std::lock_guard<std::mutex> lock(lock_);
     FTRACE_ASSERT(command_list_map_.count(command_list) == 0);
     command_list_map_[command_list] =
-      {std::vector<ZeKernelCommand*>(), context, device, immediate};
+      {std::vector<ZeKernelCommand*>(), context, device, immediate, in_order};
 
     FTRACE_ASSERT(correlator_ != nullptr);
     correlator_->CreateKernelIdList(command_list);
@@ -1036,6 +1690,7 @@ class ZeKernelCollector {
       }
       event_cache_.ReleaseEvent(command->event);
       delete command;
+      TracerOverhead::RemoveMemory(sizeof(ZeKernelCommand));
     }
     info.kernel_command_list.clear();
   }
@@ -1047,6 +1702,10 @@ class ZeKernelCollector {
 
     RemoveKernelCommands(command_list);
     command_list_map_.erase(command_list);
+    transfer_advisor_.AddCommand(command_list);
+    if (options_.critical_path) { // Immediate list is a queue of its own
+      dependency_graph_.RemoveQueue(command_list);
+    }
 
     FTRACE_ASSERT(correlator_ != nullptr);
     correlator_->RemoveKernelIdList(command_list);
@@ -1059,6 +1718,7 @@ class ZeKernelCollector {
     const std::lock_guard<std::mutex> lock(lock_);
 
     RemoveKernelCommands(command_list);
+    transfer_advisor_.AddCommand(command_list);
 
     FTRACE_ASSERT(correlator_ != nullptr);
     correlator_->ResetKernelIdList(command_list);
@@ -1079,6 +1739,10 @@ class ZeKernelCollector {
     FTRACE_ASSERT(correlator_ != nullptr);
     correlator_->ResetCallIdList(command_list);
 
+    if (options_.critical_path) {
+      dependency_graph_.BeginSubmission(queue);
+    }
+
     for (ZeKernelCommand* command : info.kernel_command_list) {
       ZeKernelCall* call = new ZeKernelCall;
       FTRACE_ASSERT(call != nullptr);
@@ -1092,10 +1756,33 @@ class ZeKernelCollector {
       call->call_id = command->call_count;
       call->need_to_process = correlator_->IsCollectionEnabled();
       call->fence = fence;
+      if (options_.iterations) {
+        call->launch_id =
+          iterations_.AddLaunch(command->name_id, call->submit_time);
+      }
+
+      if (options_.critical_path) {
+        AddDependencyNode(call);
+      }
 
       kernel_call_list_.push_back(call);
+      TracerOverhead::AddMemory(sizeof(ZeKernelCall));
       correlator_->AddCallId(command_list, call->call_id);
     }
+    TracerOverhead::UpdatePendingDepth(kernel_call_list_.size());
+  }
+
+  void AddDependencyNode(ZeKernelCall* call) {
+    FTRACE_ASSERT(call != nullptr);
+    ZeKernelCommand* command = call->command;
+    FTRACE_ASSERT(command != nullptr);
+
+    std::vector<const void*> wait_event_list(
+        command->wait_event_list.begin(), command->wait_event_list.end());
+    call->dependency_node = dependency_graph_.AddNode(
+        call->queue, call->submit_time, command->event,
+        wait_event_list, command->barrier);
+    TracerOverhead::AddMemory(sizeof(DependencyNode));
   }
 
   ze_context_handle_t GetCommandListContext(
@@ -1107,6 +1794,55 @@ class ZeKernelCollector {
     return command_list_info.context;
   }
 
+  // Pointers not known by AllocIndex are asked about once, the cache is
+  // dropped when it grows too large. Returns false if the driver query
+  // failed, such memory can not be safely read from host
+  bool GetMemoryType(
+      ze_context_handle_t context, const void* ptr, ze_memory_type_t* type) {
+    FTRACE_ASSERT(ptr != nullptr);
+    FTRACE_ASSERT(type != nullptr);
+    {
+      const std::lock_guard<std::mutex> lock(lock_);
+      auto it = memory_type_map_.find(ptr);
+      if (it != memory_type_map_.end()) {
+        *type = it->second.type;
+        return it->second.known;
+      }
+    }
+
+    ze_memory_allocation_properties_t props{
+        ZE_STRUCTURE_TYPE_MEMORY_ALLOCATION_PROPERTIES,};
+    bool known = (context != nullptr &&
+        zeMemGetAllocProperties(
+            context, ptr, &props, nullptr) == ZE_RESULT_SUCCESS);
+
+    const std::lock_guard<std::mutex> lock(lock_);
+    if (memory_type_map_.size() >= kMemoryTypeCacheSize) {
+      memory_type_map_.clear();
+    }
+    memory_type_map_[ptr] = {known, props.type};
+    *type = props.type;
+    return known;
+  }
+
+  // Falls back to the driver for pointers not known by AllocIndex, e.g.
+  // imported or allocated before tracing started
+  AllocType GetPointerType(ze_context_handle_t context, const void* ptr) {
+    AllocType type = AllocIndex::GetType(ptr);
+    if (type == ALLOC_TYPE_UNKNOWN) {
+      ze_memory_type_t memory_type = ZE_MEMORY_TYPE_UNKNOWN;
+      if (GetMemoryType(context, ptr, &memory_type)) {
+        type = GetAllocType(memory_type);
+      }
+    }
+    return type;
+  }
+
+  void RemoveMemoryType(const void* ptr) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    memory_type_map_.erase(ptr);
+  }
+
   ze_device_handle_t GetCommandListDevice(
       ze_command_list_handle_t command_list) {
     FTRACE_ASSERT(command_list != nullptr);
@@ -1116,7 +1852,124 @@ class ZeKernelCollector {
     return command_list_info.device;
   }
 
-  bool IsCommandListImmediate(ze_command_list_handle_t command_list) {
+  // Start of the call is stored by OnEnterObjectCall
+  uint64_t GetObjectCallTime(void** instance_data) const {
+    FTRACE_ASSERT(instance_data != nullptr);
+    uint64_t start = *reinterpret_cast<uint64_t*>(instance_data);
+    uint64_t end = GetHostTimestamp();
+    return (end > start) ? end - start : 0;
+  }
+
+  void AddObject(
+      ObjectType type, const void* handle, uint64_t fingerprint,
+      const std::string& label, uint64_t time) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    object_churn_.AddObject(type, handle, fingerprint, label, time);
+  }
+
+  uint64_t GetObjectFingerprint(const void* handle) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    return object_churn_.GetFingerprint(handle);
+  }
+
+  void ResetObject(const void* handle, uint64_t time) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    object_churn_.ResetObject(handle, time);
+  }
+
+  void RemoveObject(const void* handle, uint64_t time) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    object_churn_.RemoveObject(handle, time);
+  }
+
+  void AddModuleGrfCount(ze_module_handle_t module, uint32_t grf_count) {
+    FTRACE_ASSERT(module != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    module_grf_map_[module] = grf_count;
+  }
+
+  void AddKernelModule(ze_kernel_handle_t kernel, ze_module_handle_t module) {
+    FTRACE_ASSERT(kernel != nullptr);
+    FTRACE_ASSERT(module != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    ZeKernelResources& info = kernel_resource_map_[kernel];
+    info = ZeKernelResources{};
+    auto it = module_grf_map_.find(module);
+    if (it != module_grf_map_.end()) {
+      info.resources.grf_count = it->second;
+    }
+  }
+
+  // Kernel properties do not change after creation, so they are queried
+  // once per kernel handle
+  KernelResources CaptureKernelResources(
+      ze_kernel_handle_t kernel, const std::string& name) {
+    FTRACE_ASSERT(kernel != nullptr);
+    {
+      const std::lock_guard<std::mutex> lock(lock_);
+      auto it = kernel_resource_map_.find(kernel);
+      if (it != kernel_resource_map_.end() && it->second.captured) {
+        return it->second.resources;
+      }
+    }
+
+    ze_kernel_properties_t props = utils::ze::GetKernelProperties(kernel);
+
+    const std::lock_guard<std::mutex> lock(lock_);
+    ZeKernelResources& info = kernel_resource_map_[kernel];
+    info.resources.private_memory = props.privateMemSize;
+    info.resources.spill_memory = props.spillMemSize;
+    info.resources.local_memory = props.localMemSize;
+    info.resources.required_subgroup_size = props.requiredSubgroupSize;
+    info.captured = true;
+    kernel_resources_.AddKernel(name, info.resources);
+    return info.resources;
+  }
+
+  // Device layout is queried once per device, caller should hold lock_
+  const DeviceLayout& GetDeviceLayout(ze_device_handle_t device) {
+    FTRACE_ASSERT(device != nullptr);
+    auto it = device_layout_map_.find(device);
+    if (it != device_layout_map_.end()) {
+      return it->second;
+    }
+
+    ze_device_properties_t props{ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES, };
+    ze_result_t status = zeDeviceGetProperties(device, &props);
+    FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+
+    ze_device_compute_properties_t compute_props{
+        ZE_STRUCTURE_TYPE_DEVICE_COMPUTE_PROPERTIES, };
+    status = zeDeviceGetComputeProperties(device, &compute_props);
+    FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+
+    DeviceLayout& layout = device_layout_map_[device];
+    layout.subslice_count = props.numSlices * props.numSubslicesPerSlice;
+    layout.threads_per_subslice =
+      props.numEUsPerSubslice * props.numThreadsPerEU;
+    layout.local_memory = compute_props.maxSharedLocalMemory;
+    return layout;
+  }
+
+  void RemoveKernelResources(ze_kernel_handle_t kernel) {
+    FTRACE_ASSERT(kernel != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    kernel_resource_map_.erase(kernel);
+  }
+
+  static uint64_t GetCommandFingerprint(const ZeKernelCommand* command) {
+    FTRACE_ASSERT(command != nullptr);
+    uint64_t fingerprint = ObjectChurn::kOffsetBasis;
+    ObjectChurn::Combine(fingerprint, command->name_id);
+    ObjectChurn::Combine(fingerprint, command->props.bytes_transferred);
+    for (int i = 0; i < 3; ++i) {
+      ObjectChurn::Combine(fingerprint, command->props.group_count[i]);
+      ObjectChurn::Combine(fingerprint, command->props.group_size[i]);
+    }
+    return fingerprint;
+  }
+
+  bool IsCommandListImmediate(ze_command_list_handle_t command_list) {
     FTRACE_ASSERT(command_list != nullptr);
     const std::lock_guard<std::mutex> lock(lock_);
     FTRACE_ASSERT(command_list_map_.count(command_list) == 1);
@@ -1124,6 +1977,26 @@ class ZeKernelCollector {
     return command_list_info.immediate;
   }
 
+  bool IsCommandListInOrder(ze_command_list_handle_t command_list) {
+    FTRACE_ASSERT(command_list != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    FTRACE_ASSERT(command_list_map_.count(command_list) == 1);
+    ZeCommandListInfo& command_list_info = command_list_map_[command_list];
+    return command_list_info.in_order;
+  }
+
+  void RemoveDependencyEvent(ze_event_handle_t event) {
+    FTRACE_ASSERT(event != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    dependency_graph_.RemoveEvent(event);
+  }
+
+  void RemoveDependencyQueue(ze_command_queue_handle_t queue) {
+    FTRACE_ASSERT(queue != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+    dependency_graph_.RemoveQueue(queue);
+  }
+
   void AddImage(ze_image_handle_t image, size_t size) {
     FTRACE_ASSERT(image != nullptr);
     const std::lock_guard<std::mutex> lock(lock_);
@@ -1175,16 +2048,29 @@ class ZeKernelCollector {
                                      ze_result_t result,
                                      void *global_data,
                                      void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+
     const ze_event_pool_desc_t* desc = *(params->pdesc);
-    if (desc == nullptr) {
+    bool profiling =
+      (desc != nullptr) && !(desc->flags & ZE_EVENT_POOL_FLAG_IPC);
+    if (!profiling && !collector->options_.object_churn) {
       return;
     }
-    if (desc->flags & ZE_EVENT_POOL_FLAG_IPC) {
+
+    ZeEventPoolCreateData* create_data = new ZeEventPoolCreateData{};
+    FTRACE_ASSERT(create_data != nullptr);
+    if (collector->options_.object_churn) {
+      create_data->start = collector->GetHostTimestamp();
+    }
+    *instance_data = create_data;
+    if (!profiling) {
       return;
     }
 
-    ze_event_pool_desc_t* profiling_desc = new ze_event_pool_desc_t;
-    FTRACE_ASSERT(profiling_desc != nullptr);
+    ze_event_pool_desc_t* profiling_desc = &create_data->desc;
     profiling_desc->stype = desc->stype;
     // FTRACE_ASSERT(profiling_desc->stype == ZE_STRUCTURE_TYPE_EVENT_POOL_DESC);
     profiling_desc->pNext = desc->pNext;
@@ -1194,72 +2080,266 @@ class ZeKernelCollector {
     profiling_desc->count = desc->count;
 
     *(params->pdesc) = profiling_desc;
-    *instance_data = profiling_desc;
   }
 
   static void OnExitEventPoolCreate(ze_event_pool_create_params_t *params,
                                     ze_result_t result,
                                     void *global_data,
                                     void **instance_data) {
-    ze_event_pool_desc_t* desc =
-      static_cast<ze_event_pool_desc_t*>(*instance_data);
-    if (desc != nullptr) {
-      delete desc;
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    ZeEventPoolCreateData* create_data =
+      static_cast<ZeEventPoolCreateData*>(*instance_data);
+    if (create_data == nullptr) {
+      return;
+    }
+
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+    const ze_event_pool_desc_t* desc = *(params->pdesc);
+    if (collector->options_.object_churn && result == ZE_RESULT_SUCCESS &&
+        desc != nullptr) {
+      FTRACE_ASSERT(**(params->pphEventPool) != nullptr);
+      uint64_t time = collector->GetHostTimestamp() - create_data->start;
+      uint64_t fingerprint = ObjectChurn::kOffsetBasis;
+      ObjectChurn::Combine(fingerprint, desc->flags);
+      ObjectChurn::Combine(fingerprint, desc->count);
+      collector->AddObject(
+          OBJECT_TYPE_EVENT_POOL, **(params->pphEventPool), fingerprint,
+          std::to_string(desc->count) + " events", time);
+    }
+    delete create_data;
+  }
+
+  static void OnExitEventPoolDestroy(
+      ze_event_pool_destroy_params_t* params,
+      ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    if (result == ZE_RESULT_SUCCESS) {
+      ZeKernelCollector* collector =
+        reinterpret_cast<ZeKernelCollector*>(global_data);
+      FTRACE_ASSERT(collector != nullptr);
+      collector->RemoveObject(
+          *(params->phEventPool),
+          collector->GetObjectCallTime(instance_data));
+    }
+  }
+
+  template <typename T>
+  static void OnEnterObjectCall(
+      T* params, ze_result_t result,
+      void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+    *reinterpret_cast<uint64_t*>(instance_data) =
+      collector->GetHostTimestamp();
+  }
+
+  static void OnExitModuleCreate(
+      ze_module_create_params_t* params,
+      ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    if (result == ZE_RESULT_SUCCESS) {
+      ZeKernelCollector* collector =
+        reinterpret_cast<ZeKernelCollector*>(global_data);
+      FTRACE_ASSERT(collector != nullptr);
+      uint64_t time = collector->GetObjectCallTime(instance_data);
+
+      const ze_module_desc_t* desc = *(params->pdesc);
+      FTRACE_ASSERT(desc != nullptr);
+      FTRACE_ASSERT(**(params->pphModule) != nullptr);
+
+      if (collector->options_.kernel_resources) {
+        collector->AddModuleGrfCount(
+            **(params->pphModule),
+            KernelResourceTable::GetGrfCount(desc->pBuildFlags));
+      }
+
+      if (!collector->options_.module_builds &&
+          !collector->options_.object_churn) {
+        return;
+      }
+
+      uint64_t input_hash = desc->format;
+      if (desc->pInputModule != nullptr && desc->inputSize > 0) {
+        ObjectChurn::Combine(
+            input_hash,
+            TransferAdvisor::GetHash(desc->pInputModule, desc->inputSize));
+      }
+      // Size of constant values is defined by the module and not known
+      // here, so only ids are taken: builds differing in values only are
+      // reported as duplicates
+      const ze_module_constants_t* constants = desc->pConstants;
+      if (constants != nullptr) {
+        for (uint32_t i = 0; i < constants->numConstants; ++i) {
+          ObjectChurn::Combine(
+              input_hash,
+              ModuleBuilds::GetConstantHash(
+                  constants->pConstantIds[i], nullptr, 0));
+        }
+      }
+      uint64_t fingerprint =
+        ModuleBuilds::GetFingerprint(input_hash, desc->pBuildFlags);
+
+      if (collector->options_.module_builds) {
+        ModuleBuilds::AddBuild(
+            "zeModuleCreate", fingerprint, desc->inputSize,
+            *(params->phDevice), time);
+      }
+
+      if (collector->options_.object_churn) {
+        ObjectChurn::Combine(
+            fingerprint, reinterpret_cast<uintptr_t>(*(params->phDevice)));
+        collector->AddObject(
+            OBJECT_TYPE_MODULE, **(params->pphModule), fingerprint,
+            std::to_string(desc->inputSize) + " bytes", time);
+      }
+    }
+  }
+
+  static void OnExitModuleDestroy(
+      ze_module_destroy_params_t* params,
+      ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    if (result == ZE_RESULT_SUCCESS) {
+      ZeKernelCollector* collector =
+        reinterpret_cast<ZeKernelCollector*>(global_data);
+      FTRACE_ASSERT(collector != nullptr);
+      collector->RemoveObject(
+          *(params->phModule), collector->GetObjectCallTime(instance_data));
+    }
+  }
+
+  // Kernels of identical modules are the same kernel
+  static void OnExitKernelCreate(
+      ze_kernel_create_params_t* params,
+      ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    if (result == ZE_RESULT_SUCCESS) {
+      ZeKernelCollector* collector =
+        reinterpret_cast<ZeKernelCollector*>(global_data);
+      FTRACE_ASSERT(collector != nullptr);
+      uint64_t time = collector->GetObjectCallTime(instance_data);
+
+      const ze_kernel_desc_t* desc = *(params->pdesc);
+      FTRACE_ASSERT(desc != nullptr);
+      FTRACE_ASSERT(**(params->pphKernel) != nullptr);
+
+      if (collector->options_.kernel_resources) {
+        collector->AddKernelModule(
+            **(params->pphKernel), *(params->phModule));
+      }
+
+      if (!collector->options_.object_churn) {
+        return;
+      }
+
+      std::string name =
+        (desc->pKernelName != nullptr) ? desc->pKernelName : "";
+
+      uint64_t fingerprint = ObjectChurn::kOffsetBasis;
+      ObjectChurn::Combine(
+          fingerprint, collector->GetObjectFingerprint(*(params->phModule)));
+      ObjectChurn::Combine(fingerprint, std::hash<std::string>()(name));
+
+      collector->AddObject(
+          OBJECT_TYPE_KERNEL, **(params->pphKernel), fingerprint, name, time);
     }
   }
 
   static void OnEnterEventDestroy(
       ze_event_destroy_params_t *params,
       ze_result_t result, void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
 
     if (*(params->phEvent) != nullptr) {
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
       FTRACE_ASSERT(collector != nullptr);
       collector->ProcessCall("EventDestroy", *(params->phEvent));
+      if (collector->options_.critical_path) {
+        collector->RemoveDependencyEvent(*(params->phEvent));
+      }
     }
   }
 
   static void OnEnterEventHostReset(
       ze_event_host_reset_params_t *params, ze_result_t result,
       void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     if (*(params->phEvent) != nullptr) {
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
       FTRACE_ASSERT(collector != nullptr);
       collector->ProcessCall("EventHostReset", *(params->phEvent));
+      if (collector->options_.critical_path) {
+        collector->RemoveDependencyEvent(*(params->phEvent));
+      }
     }
   }
 
+  static void OnEnterEventHostSynchronize(
+      ze_event_host_synchronize_params_t *params,
+      ze_result_t result, void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+    collector->BeginHostWait(instance_data);
+  }
+
   static void OnExitEventHostSynchronize(
       ze_event_host_synchronize_params_t *params,
       ze_result_t result, void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+    uint64_t end = collector->GetHostTimestamp();
     if (result == ZE_RESULT_SUCCESS) {
       FTRACE_ASSERT(*(params->phEvent) != nullptr);
-      ZeKernelCollector* collector =
-        reinterpret_cast<ZeKernelCollector*>(global_data);
-      FTRACE_ASSERT(collector != nullptr);
       collector->ProcessCall("EventHostSynchronize", *(params->phEvent));
       collector->ProcessCalls("EventHostSynchronize");
     }
+    if (collector->options_.host_stalls) {
+      collector->EndHostWait(instance_data, end);
+    }
+  }
+
+  static void OnEnterFenceHostSynchronize(
+      ze_fence_host_synchronize_params_t *params,
+      ze_result_t result, void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+    collector->BeginHostWait(instance_data);
   }
 
   static void OnExitFenceHostSynchronize(
       ze_fence_host_synchronize_params_t *params,
       ze_result_t result, void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+    uint64_t end = collector->GetHostTimestamp();
     if (result == ZE_RESULT_SUCCESS) {
       FTRACE_ASSERT(*(params->phFence) != nullptr);
-      ZeKernelCollector* collector =
-        reinterpret_cast<ZeKernelCollector*>(global_data);
-      FTRACE_ASSERT(collector != nullptr);
       collector->ProcessCall("FenceHostSynchronize", *(params->phFence));
       collector->ProcessCalls("FenceHostSynchronize");
     }
+    if (collector->options_.host_stalls) {
+      collector->EndHostWait(instance_data, end);
+    }
   }
 
   static void OnExitImageCreate(
       ze_image_create_params_t *params, ze_result_t result,
       void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       ZeKernelCollector* collector =
           reinterpret_cast<ZeKernelCollector*>(global_data);
@@ -1293,12 +2373,23 @@ class ZeKernelCollector {
       }
 
       collector->AddImage(**(params->pphImage), image_size);
+      MemoryTracker::Add(
+          **(params->pphImage), image_size, MEMORY_TYPE_IMAGE,
+          *(params->phDevice), *(params->phContext), "zeImageCreate");
     }
   }
 
+  static void OnEnterImageDestroy(
+      ze_image_destroy_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
+    MemoryTracker::Remove(*(params->phImage));
+  }
+
   static void OnExitImageDestroy(
       ze_image_destroy_params_t *params, ze_result_t result,
       void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
@@ -1307,14 +2398,133 @@ class ZeKernelCollector {
     }
   }
 
+  static void OnExitMemAllocHost(
+      ze_mem_alloc_host_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    if (result == ZE_RESULT_SUCCESS) {
+      AllocIndex::Add(
+          **(params->ppptr), *(params->psize), ALLOC_TYPE_HOST,
+          nullptr, *(params->phContext));
+      MemoryTracker::Add(
+          **(params->ppptr), *(params->psize), MEMORY_TYPE_HOST,
+          nullptr, *(params->phContext), "zeMemAllocHost");
+    }
+  }
+
+  static void OnExitMemAllocDevice(
+      ze_mem_alloc_device_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    if (result == ZE_RESULT_SUCCESS) {
+      AllocIndex::Add(
+          **(params->ppptr), *(params->psize), ALLOC_TYPE_DEVICE,
+          *(params->phDevice), *(params->phContext));
+      MemoryTracker::Add(
+          **(params->ppptr), *(params->psize), MEMORY_TYPE_DEVICE,
+          *(params->phDevice), *(params->phContext), "zeMemAllocDevice");
+    }
+  }
+
+  static void OnExitMemAllocShared(
+      ze_mem_alloc_shared_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    if (result == ZE_RESULT_SUCCESS) {
+      AllocIndex::Add(
+          **(params->ppptr), *(params->psize), ALLOC_TYPE_SHARED,
+          *(params->phDevice), *(params->phContext));
+      MemoryTracker::Add(
+          **(params->ppptr), *(params->psize), MEMORY_TYPE_SHARED,
+          *(params->phDevice), *(params->phContext), "zeMemAllocShared");
+    }
+  }
+
+  // Imported allocation size and type are not known from the parameters,
+  // so the driver is asked once here instead of on every transfer
+  static void OnExitMemOpenIpcHandle(
+      ze_mem_open_ipc_handle_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    if (result == ZE_RESULT_SUCCESS) {
+      ze_context_handle_t context = *(params->phContext);
+      void* ptr = **(params->ppptr);
+
+      // Range is left out of the index if the driver can not describe it
+      size_t size = 0;
+      ze_result_t status = zeMemGetAddressRange(context, ptr, nullptr, &size);
+      if (status != ZE_RESULT_SUCCESS) {
+        return;
+      }
+
+      ze_memory_allocation_properties_t props{
+          ZE_STRUCTURE_TYPE_MEMORY_ALLOCATION_PROPERTIES,};
+      status = zeMemGetAllocProperties(context, ptr, &props, nullptr);
+      if (status != ZE_RESULT_SUCCESS) {
+        return;
+      }
+
+      AllocIndex::Add(
+          ptr, size, GetAllocType(props.type),
+          *(params->phDevice), context);
+    }
+  }
+
+  // Allocation is removed before it is released, so the address can not be
+  // reused by another allocation in the meantime
+  static void OnEnterMemFree(
+      ze_mem_free_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+    if (*(params->pptr) != nullptr) {
+      AllocIndex::Remove(*(params->pptr));
+      MemoryTracker::Remove(*(params->pptr));
+      collector->RemoveMemoryType(*(params->pptr));
+    }
+  }
+
+  static void OnEnterMemCloseIpcHandle(
+      ze_mem_close_ipc_handle_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
+    if (*(params->pptr) != nullptr) {
+      AllocIndex::Remove(*(params->pptr));
+    }
+  }
+
+  static AllocType GetAllocType(ze_memory_type_t type) {
+    switch (type) {
+      case ZE_MEMORY_TYPE_HOST:
+        return ALLOC_TYPE_HOST;
+      case ZE_MEMORY_TYPE_DEVICE:
+        return ALLOC_TYPE_DEVICE;
+      case ZE_MEMORY_TYPE_SHARED:
+        return ALLOC_TYPE_SHARED;
+      default:
+        break;
+    }
+    return ALLOC_TYPE_UNKNOWN;
+  }
+
   static void OnEnterKernelAppend(
       ZeKernelCollector* collector,
       const ZeKernelProps& props,
       ze_event_handle_t& signal_event,
+      uint32_t wait_event_count,
+      const ze_event_handle_t* wait_event_list,
       ze_command_list_handle_t command_list,
-      void** instance_data) {
+      void** instance_data,
+      bool barrier = false) {
     FTRACE_ASSERT(collector != nullptr);
 
+    // Ids are set again only if the append succeeds
+    FTRACE_ASSERT(collector->correlator_ != nullptr);
+    collector->correlator_->SetKernelId(0);
+    collector->correlator_->SetCallId(0);
+
     if (command_list == nullptr) {
       return;
     }
@@ -1350,6 +2560,15 @@ class ZeKernelCollector {
       command->event = signal_event;
     }
 
+    if (collector->options_.critical_path) {
+      if (wait_event_list != nullptr) {
+        command->wait_event_list.assign(
+            wait_event_list, wait_event_list + wait_event_count);
+      }
+      command->barrier =
+        barrier || collector->IsCommandListInOrder(command_list);
+    }
+
     ZeKernelCall* call = new ZeKernelCall{};
     FTRACE_ASSERT(call != nullptr);
     call->command = command;
@@ -1420,6 +2639,12 @@ class ZeKernelCollector {
     props.group_size[1] = group_size.y;
     props.group_size[2] = group_size.z;
 
+    if (collector->options_.kernel_resources ||
+        collector->options_.occupancy) {
+      props.local_memory =
+        collector->CaptureKernelResources(kernel, props.name).local_memory;
+    }
+
     if (group_count != nullptr) {
       props.group_count[0] = group_count->groupCountX;
       props.group_count[1] = group_count->groupCountY;
@@ -1429,6 +2654,9 @@ class ZeKernelCollector {
     return props;
   }
 
+  // Direction letters come from the allocation index, allocations made
+  // through Level Zero and OpenCL(TM) USM calls are tracked there, other
+  // pointers are looked up in the driver once
   static ZeKernelProps GetTransferProps(
       ZeKernelCollector* collector,
       std::string name,
@@ -1443,53 +2671,14 @@ class ZeKernelCollector {
     std::string direction;
 
     if (src_context != nullptr && src != nullptr) {
-      ze_memory_allocation_properties_t props{
-          ZE_STRUCTURE_TYPE_MEMORY_ALLOCATION_PROPERTIES,};
-      ze_result_t status =
-        zeMemGetAllocProperties(src_context, src, &props, nullptr);
-      FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
-
-      switch (props.type) {
-        case ZE_MEMORY_TYPE_UNKNOWN:
-          direction.push_back('M');
-          break;
-        case ZE_MEMORY_TYPE_HOST:
-          direction.push_back('H');
-          break;
-        case ZE_MEMORY_TYPE_DEVICE:
-          direction.push_back('D');
-          break;
-        case ZE_MEMORY_TYPE_SHARED:
-          direction.push_back('S');
-          break;
-        default:
-          break;
-      }
+      direction.push_back(AllocIndex::GetTypeLetter(
+          collector->GetPointerType(src_context, src)));
     }
 
     if (dst_context != nullptr && dst != nullptr) {
-      ze_memory_allocation_properties_t props{
-          ZE_STRUCTURE_TYPE_MEMORY_ALLOCATION_PROPERTIES,};
-      ze_result_t status = zeMemGetAllocProperties(dst_context, dst, &props, nullptr);
-      FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
-
       direction.push_back('2');
-      switch (props.type) {
-        case ZE_MEMORY_TYPE_UNKNOWN:
-          direction.push_back('M');
-          break;
-        case ZE_MEMORY_TYPE_HOST:
-          direction.push_back('H');
-          break;
-        case ZE_MEMORY_TYPE_DEVICE:
-          direction.push_back('D');
-          break;
-        case ZE_MEMORY_TYPE_SHARED:
-          direction.push_back('S');
-          break;
-        default:
-          break;
-      }
+      direction.push_back(AllocIndex::GetTypeLetter(
+          collector->GetPointerType(dst_context, dst)));
     }
 
     if (!direction.empty()) {
@@ -1502,9 +2691,42 @@ class ZeKernelCollector {
     return props;
   }
 
+  // Only plain host memory and host USM are fingerprinted, reading
+  // shared allocations from host would migrate them. Sources not known
+  // by AllocIndex may be device USM allocated before tracing started
+  static void SetTransferPattern(
+      ZeKernelCollector* collector, ze_context_handle_t context,
+      ZeKernelCommand* command, const void* src, const void* dst,
+      size_t size) {
+    FTRACE_ASSERT(collector != nullptr);
+    FTRACE_ASSERT(command != nullptr);
+    if (src == nullptr || dst == nullptr || size == 0) {
+      return;
+    }
+
+    command->transfer.src.offset = reinterpret_cast<uintptr_t>(src);
+    command->transfer.dst.offset = reinterpret_cast<uintptr_t>(dst);
+
+    AllocType type = AllocIndex::GetType(src);
+    if (type == ALLOC_TYPE_UNKNOWN) {
+      ze_memory_type_t memory_type = ZE_MEMORY_TYPE_UNKNOWN;
+      if (!collector->GetMemoryType(context, src, &memory_type) ||
+          (memory_type != ZE_MEMORY_TYPE_UNKNOWN &&
+           memory_type != ZE_MEMORY_TYPE_HOST)) {
+        return;
+      }
+      type = ALLOC_TYPE_HOST;
+    }
+    if (type == ALLOC_TYPE_HOST) {
+      command->transfer.fingerprint =
+        TransferAdvisor::GetFingerprint(src, size);
+    }
+  }
+
   static void OnEnterCommandListAppendLaunchKernel(
       ze_command_list_append_launch_kernel_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1516,6 +2738,8 @@ class ZeKernelCollector {
             *(params->phKernel),
             *(params->ppLaunchFuncArgs)),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1523,6 +2747,7 @@ class ZeKernelCollector {
   static void OnEnterCommandListAppendLaunchCooperativeKernel(
       ze_command_list_append_launch_cooperative_kernel_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1534,6 +2759,8 @@ class ZeKernelCollector {
             *(params->phKernel),
             *(params->ppLaunchFuncArgs)),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1541,6 +2768,7 @@ class ZeKernelCollector {
   static void OnEnterCommandListAppendLaunchKernelIndirect(
       ze_command_list_append_launch_kernel_indirect_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1552,6 +2780,8 @@ class ZeKernelCollector {
             *(params->phKernel),
             *(params->ppLaunchArgumentsBuffer)),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1559,6 +2789,7 @@ class ZeKernelCollector {
   static void OnEnterCommandListAppendMemoryCopy(
       ze_command_list_append_memory_copy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1575,13 +2806,23 @@ class ZeKernelCollector {
             collector, "zeCommandListAppendMemoryCopy", *(params->psize),
             context, *(params->psrcptr), context, *(params->pdstptr)),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
+
+    ZeKernelCall* call = static_cast<ZeKernelCall*>(*instance_data);
+    if (call != nullptr && collector->options_.transfer_advice) {
+      SetTransferPattern(
+          collector, context, call->command,
+          *(params->psrcptr), *(params->pdstptr), *(params->psize));
+    }
   }
 
   static void OnEnterCommandListAppendMemoryFill(
       ze_command_list_append_memory_fill_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1598,6 +2839,8 @@ class ZeKernelCollector {
             collector, "zeCommandListAppendMemoryFill", *(params->psize),
             context, *(params->pptr), nullptr, nullptr),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1605,6 +2848,7 @@ class ZeKernelCollector {
   static void OnEnterCommandListAppendMemoryCopyFromContext(
       ze_command_list_append_memory_copy_from_context_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1623,6 +2867,8 @@ class ZeKernelCollector {
             *(params->psize), src_context, *(params->psrcptr),
             dst_context, *(params->pdstptr)),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1630,6 +2876,7 @@ class ZeKernelCollector {
   static void OnEnterCommandListAppendBarrier(
       ze_command_list_append_barrier_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1640,13 +2887,17 @@ class ZeKernelCollector {
             collector, "zeCommandListAppendBarrier", 0,
             nullptr, nullptr, nullptr, nullptr),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
-        instance_data);
+        instance_data,
+        true);
   }
 
   static void OnEnterCommandListAppendMemoryRangesBarrier(
       ze_command_list_append_memory_ranges_barrier_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1657,13 +2908,17 @@ class ZeKernelCollector {
             collector, "zeCommandListAppendMemoryRangesBarrier", 0,
             nullptr, nullptr, nullptr, nullptr),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
-        instance_data);
+        instance_data,
+        true);
   }
 
   static void OnEnterCommandListAppendMemoryCopyRegion(
       ze_command_list_append_memory_copy_region_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1692,6 +2947,8 @@ class ZeKernelCollector {
             bytes_transferred, context, *(params->psrcptr),
             context, *(params->pdstptr)),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1699,6 +2956,7 @@ class ZeKernelCollector {
   static void OnEnterCommandListAppendImageCopy(
       ze_command_list_append_image_copy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1710,6 +2968,8 @@ class ZeKernelCollector {
             collector, "zeCommandListAppendImageCopy", bytes_transferred,
             nullptr, nullptr, nullptr, nullptr),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1717,6 +2977,7 @@ class ZeKernelCollector {
   static void OnEnterCommandListAppendImageCopyRegion(
       ze_command_list_append_image_copy_region_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1728,6 +2989,8 @@ class ZeKernelCollector {
             collector, "zeCommandListAppendImageCopyRegion",
             bytes_transferred, nullptr, nullptr, nullptr, nullptr),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1735,6 +2998,7 @@ class ZeKernelCollector {
   static void OnEnterCommandListAppendImageCopyToMemory(
       ze_command_list_append_image_copy_to_memory_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1753,6 +3017,8 @@ class ZeKernelCollector {
             bytes_transferred, nullptr, nullptr,
             context, *(params->pdstptr)),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1760,6 +3026,7 @@ class ZeKernelCollector {
   static void OnEnterCommandListAppendImageCopyFromMemory(
       ze_command_list_append_image_copy_from_memory_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1786,6 +3053,8 @@ class ZeKernelCollector {
             bytes_transferred, context, *(params->psrcptr),
             nullptr, nullptr),
         *(params->phSignalEvent),
+        *(params->pnumWaitEvents),
+        *(params->pphWaitEvents),
         *(params->phCommandList),
         instance_data);
   }
@@ -1793,6 +3062,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendLaunchKernel(
       ze_command_list_append_launch_kernel_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1801,6 +3071,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendLaunchCooperativeKernel(
       ze_command_list_append_launch_cooperative_kernel_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1809,6 +3080,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendLaunchKernelIndirect(
       ze_command_list_append_launch_kernel_indirect_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1817,6 +3089,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendMemoryCopy(
       ze_command_list_append_memory_copy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1825,6 +3098,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendMemoryFill(
       ze_command_list_append_memory_fill_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1833,6 +3107,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendBarrier(
       ze_command_list_append_barrier_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1841,6 +3116,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendMemoryRangesBarrier(
       ze_command_list_append_memory_ranges_barrier_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1849,6 +3125,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendMemoryCopyRegion(
       ze_command_list_append_memory_copy_region_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1857,6 +3134,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendMemoryCopyFromContext(
       ze_command_list_append_memory_copy_from_context_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1865,6 +3143,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendImageCopy(
       ze_command_list_append_image_copy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1873,6 +3152,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendImageCopyRegion(
       ze_command_list_append_image_copy_region_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1881,6 +3161,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendImageCopyToMemory(
       ze_command_list_append_image_copy_to_memory_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1889,6 +3170,7 @@ class ZeKernelCollector {
   static void OnExitCommandListAppendImageCopyFromMemory(
       ze_command_list_append_image_copy_from_memory_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     FTRACE_ASSERT(*(params->phSignalEvent) != nullptr);
     OnExitKernelAppend(*params->phCommandList, global_data,
                        instance_data, result);
@@ -1897,64 +3179,127 @@ class ZeKernelCollector {
   static void OnExitCommandListCreate(
       ze_command_list_create_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       FTRACE_ASSERT(**params->pphCommandList != nullptr);
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
       FTRACE_ASSERT(collector != nullptr);
+      // Commands of an in-order list are ordered as if separated by barriers
+      const ze_command_list_desc_t* list_desc = *(params->pdesc);
       collector->AddCommandList(
           **(params->pphCommandList),
           *(params->phContext),
           *(params->phDevice),
-          false);
+          false,
+          list_desc != nullptr &&
+            (list_desc->flags & ZE_COMMAND_LIST_FLAG_IN_ORDER));
+
+      if (collector->options_.object_churn) {
+        uint64_t fingerprint = ObjectChurn::kOffsetBasis;
+        ObjectChurn::Combine(
+            fingerprint, reinterpret_cast<uintptr_t>(*(params->phDevice)));
+        const ze_command_list_desc_t* desc = *(params->pdesc);
+        if (desc != nullptr) {
+          ObjectChurn::Combine(fingerprint, desc->commandQueueGroupOrdinal);
+          ObjectChurn::Combine(fingerprint, desc->flags);
+        }
+        collector->AddObject(
+            OBJECT_TYPE_COMMAND_LIST, **(params->pphCommandList),
+            fingerprint, "Regular",
+            collector->GetObjectCallTime(instance_data));
+      }
     }
   }
 
   static void OnExitCommandListCreateImmediate(
       ze_command_list_create_immediate_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       FTRACE_ASSERT(**params->pphCommandList != nullptr);
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
       FTRACE_ASSERT(collector != nullptr);
+      // Each command is a separate submission, so ordered anyway
       collector->AddCommandList(
           **(params->pphCommandList),
           *(params->phContext),
           *(params->phDevice),
-          true);
+          true,
+          false);
+      if (*(params->paltdesc) != nullptr) {
+        collector->SetQueueEngine(
+            **(params->pphCommandList), *(params->phDevice),
+            (*(params->paltdesc))->ordinal, (*(params->paltdesc))->index);
+      }
+
+      if (collector->options_.object_churn) {
+        uint64_t fingerprint = ObjectChurn::kOffsetBasis;
+        ObjectChurn::Combine(
+            fingerprint, reinterpret_cast<uintptr_t>(*(params->phDevice)));
+        const ze_command_queue_desc_t* desc = *(params->paltdesc);
+        if (desc != nullptr) {
+          ObjectChurn::Combine(fingerprint, desc->ordinal);
+          ObjectChurn::Combine(fingerprint, desc->index);
+          ObjectChurn::Combine(fingerprint, desc->flags);
+          ObjectChurn::Combine(fingerprint, desc->mode);
+          ObjectChurn::Combine(fingerprint, desc->priority);
+        }
+        collector->AddObject(
+            OBJECT_TYPE_COMMAND_LIST, **(params->pphCommandList),
+            fingerprint, "Immediate",
+            collector->GetObjectCallTime(instance_data));
+      }
     }
   }
 
   static void OnExitCommandListDestroy(
       ze_command_list_destroy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       FTRACE_ASSERT(*params->phCommandList != nullptr);
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
       FTRACE_ASSERT(collector != nullptr);
+      uint64_t time = 0;
+      if (collector->options_.object_churn) {
+        time = collector->GetObjectCallTime(instance_data);
+      }
       collector->ProcessCalls("CommandListDestroy");
       collector->RemoveCommandList(*params->phCommandList);
+      if (collector->options_.object_churn) {
+        collector->RemoveObject(*params->phCommandList, time);
+      }
     }
   }
 
   static void OnExitCommandListReset(
       ze_command_list_reset_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       FTRACE_ASSERT(*params->phCommandList != nullptr);
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
       FTRACE_ASSERT(collector != nullptr);
+      uint64_t time = 0;
+      if (collector->options_.object_churn) {
+        time = collector->GetObjectCallTime(instance_data);
+      }
       collector->ProcessCalls("CommandListReset");
       collector->ResetCommandList(*params->phCommandList);
+      if (collector->options_.object_churn) {
+        collector->ResetObject(*params->phCommandList, time);
+      }
     }
   }
 
   static void OnEnterCommandQueueExecuteCommandLists(
       ze_command_queue_execute_command_lists_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
     ZeKernelCollector* collector =
       reinterpret_cast<ZeKernelCollector*>(global_data);
     FTRACE_ASSERT(collector != nullptr);
@@ -1990,6 +3335,7 @@ class ZeKernelCollector {
   static void OnExitCommandQueueExecuteCommandLists(
       ze_command_queue_execute_command_lists_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     std::vector<ZeSyncPoint>* submit_data_list =
       *reinterpret_cast<std::vector<ZeSyncPoint>**>(instance_data);
     FTRACE_ASSERT(submit_data_list != nullptr);
@@ -2015,31 +3361,69 @@ class ZeKernelCollector {
     delete submit_data_list;
   }
 
-  static void OnExitCommandQueueSynchronize(
-      ze_command_queue_synchronize_params_t* params,
+  static void OnExitCommandQueueCreate(
+      ze_command_queue_create_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
+      FTRACE_ASSERT(**params->pphCommandQueue != nullptr);
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
       FTRACE_ASSERT(collector != nullptr);
+      if (*(params->pdesc) != nullptr) {
+        collector->SetQueueEngine(
+            **(params->pphCommandQueue), *(params->phDevice),
+            (*(params->pdesc))->ordinal, (*(params->pdesc))->index);
+      }
+    }
+  }
+
+  static void OnEnterCommandQueueSynchronize(
+      ze_command_queue_synchronize_params_t* params,
+      ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_ENTER);
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+    collector->BeginHostWait(instance_data);
+  }
+
+  static void OnExitCommandQueueSynchronize(
+      ze_command_queue_synchronize_params_t* params,
+      ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
+    ZeKernelCollector* collector =
+      reinterpret_cast<ZeKernelCollector*>(global_data);
+    FTRACE_ASSERT(collector != nullptr);
+    uint64_t end = collector->GetHostTimestamp();
+    if (result == ZE_RESULT_SUCCESS) {
       collector->ProcessCalls("CommandQueueSynchronize");
     }
+    if (collector->options_.host_stalls) {
+      collector->EndHostWait(instance_data, end);
+    }
   }
 
   static void OnExitCommandQueueDestroy(
       ze_command_queue_destroy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
       FTRACE_ASSERT(collector != nullptr);
       collector->ProcessCalls("CommandQueueDestroy");
+      if (collector->options_.critical_path) {
+        FTRACE_ASSERT(*(params->phCommandQueue) != nullptr);
+        collector->RemoveDependencyQueue(*(params->phCommandQueue));
+      }
     }
   }
 
   static void OnExitKernelSetGroupSize(
       ze_kernel_set_group_size_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
@@ -2055,17 +3439,27 @@ class ZeKernelCollector {
   static void OnExitKernelDestroy(
       ze_kernel_destroy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
       FTRACE_ASSERT(collector != nullptr);
       collector->RemoveKernelGroupSize(*(params->phKernel));
+      if (collector->options_.kernel_resources) {
+        collector->RemoveKernelResources(*(params->phKernel));
+      }
+      if (collector->options_.object_churn) {
+        collector->RemoveObject(
+            *(params->phKernel),
+            collector->GetObjectCallTime(instance_data));
+      }
     }
   }
 
   static void OnExitContextDestroy(
       ze_context_destroy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data) {
+    TracerOverheadScope overhead(TRACER_HOOK_ZE_KERNEL_EXIT);
     if (result == ZE_RESULT_SUCCESS) {
       ZeKernelCollector* collector =
         reinterpret_cast<ZeKernelCollector*>(global_data);
@@ -2084,16 +3478,35 @@ class ZeKernelCollector {
 
   OnZeKernelFinishCallback callback_ = nullptr;
   void* callback_data_ = nullptr;
+  OnHostStallCallback stall_callback_ = nullptr;
 
   std::mutex lock_;
-  ZeKernelInfoMap kernel_info_map_;
+  KernelKeyMap<ZeKernelInfo> kernel_info_map_;
+  KernelKeyMap<LaunchStatistics> launch_stats_map_;
+  KernelNameTable kernel_names_;
   std::list<ZeKernelCall*> kernel_call_list_;
   ZeCommandListMap command_list_map_;
   ZeImageSizeMap image_size_map_;
+  ZeMemoryTypeMap memory_type_map_;
   ZeKernelGroupSizeMap kernel_group_size_map_;
+  ZeKernelResourceMap kernel_resource_map_;
+  ZeModuleGrfMap module_grf_map_;
+  ZeDeviceLayoutMap device_layout_map_;
   ZeDeviceMap device_map_;
 
   ZeEventCache event_cache_;
+  HostStallTracker host_stalls_;
+  DependencyGraph dependency_graph_;
+  DeviceUtilization utilization_;
+  ZeQueueEngineMap queue_engine_map_;
+  IterationDetector iterations_;
+  TransferStatistics transfers_;
+  TransferAdvisor transfer_advisor_;
+  ObjectChurn object_churn_;
+  KernelResourceTable kernel_resources_;
+  OccupancyTable occupancy_;
+  TileBalance tile_balance_;
+  ScalingModel scaling_;
 
 #ifdef FTRACE_KERNEL_INTERVALS
   ZeKernelIntervalList kernel_interval_list_;
@@ -2101,6 +3514,7 @@ class ZeKernelCollector {
 #endif // FTRACE_KERNEL_INTERVALS
 
   static const uint32_t kKernelLength = 10;
+  static const size_t kMemoryTypeCacheSize = 4096;
   static const uint32_t kCallsLength = 12;
   static const uint32_t kTimeLength = 20;
   static const uint32_t kPercentLength = 12;
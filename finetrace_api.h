@@ -0,0 +1,26 @@
+#ifndef FTRACE_TOOLS_FINETRACE_API_H_
+#define FTRACE_TOOLS_FINETRACE_API_H_
+
+// Collection control API exported by the finetrace_tool library.
+// Functions are declared weak, so the application may call them only if
+// the tool is loaded, e.g.: if (ftraceStart) ftraceStart();
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+void ftraceStart();
+void ftraceStop();
+void ftraceMark(const char* label);
+#else
+void ftraceStart() __attribute__((weak));
+void ftraceStop() __attribute__((weak));
+void ftraceMark(const char* label) __attribute__((weak));
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FTRACE_TOOLS_FINETRACE_API_H_
@@ -0,0 +1,94 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "alloc_index.h"
+#include "finetrace_assert.h"
+
+static const void* kDevice = reinterpret_cast<const void*>(0x1);
+static const void* kContext = reinterpret_cast<const void*>(0x2);
+
+static const void* GetPointer(uintptr_t address) {
+  return reinterpret_cast<const void*>(address);
+}
+
+static void TestFind() {
+  AllocIndex::Add(GetPointer(0x1000), 0x100, ALLOC_TYPE_DEVICE,
+                  kDevice, kContext);
+  AllocIndex::Add(GetPointer(0x2000), 0x100, ALLOC_TYPE_HOST,
+                  nullptr, kContext);
+
+  AllocRange range{};
+  FTRACE_ASSERT(AllocIndex::Find(GetPointer(0x1000), &range));
+  FTRACE_ASSERT(range.base == 0x1000 && range.size == 0x100);
+  FTRACE_ASSERT(range.device == kDevice && range.context == kContext);
+  FTRACE_ASSERT(AllocIndex::Find(GetPointer(0x10ff), &range));
+  FTRACE_ASSERT(range.type == ALLOC_TYPE_DEVICE);
+  FTRACE_ASSERT(!AllocIndex::Find(GetPointer(0x1100), &range));
+  FTRACE_ASSERT(!AllocIndex::Find(GetPointer(0xfff), &range));
+
+  FTRACE_ASSERT(AllocIndex::GetType(GetPointer(0x2080)) == ALLOC_TYPE_HOST);
+  FTRACE_ASSERT(AllocIndex::GetType(GetPointer(0x3000)) ==
+                ALLOC_TYPE_UNKNOWN);
+
+  FTRACE_ASSERT(!AllocIndex::Remove(GetPointer(0x1080)));
+  FTRACE_ASSERT(AllocIndex::Remove(GetPointer(0x1000), &range));
+  FTRACE_ASSERT(range.type == ALLOC_TYPE_DEVICE);
+  FTRACE_ASSERT(AllocIndex::GetType(GetPointer(0x1000)) ==
+                ALLOC_TYPE_UNKNOWN);
+  FTRACE_ASSERT(AllocIndex::Remove(GetPointer(0x2000)));
+}
+
+// Zero-sized allocation still holds its base address
+static void TestZeroSize() {
+  AllocIndex::Add(GetPointer(0x4000), 0, ALLOC_TYPE_SHARED,
+                  kDevice, kContext);
+  FTRACE_ASSERT(AllocIndex::GetType(GetPointer(0x4000)) ==
+                ALLOC_TYPE_SHARED);
+  FTRACE_ASSERT(AllocIndex::GetType(GetPointer(0x4001)) ==
+                ALLOC_TYPE_UNKNOWN);
+  FTRACE_ASSERT(AllocIndex::Remove(GetPointer(0x4000)));
+}
+
+static void TestTypeLetter() {
+  FTRACE_ASSERT(AllocIndex::GetTypeLetter(ALLOC_TYPE_HOST) == 'H');
+  FTRACE_ASSERT(AllocIndex::GetTypeLetter(ALLOC_TYPE_DEVICE) == 'D');
+  FTRACE_ASSERT(AllocIndex::GetTypeLetter(ALLOC_TYPE_SHARED) == 'S');
+  FTRACE_ASSERT(AllocIndex::GetTypeLetter(ALLOC_TYPE_UNKNOWN) == 'M');
+}
+
+// Every thread owns its own address range
+static void TestThreads() {
+  const uintptr_t kThreadCount = 4;
+  const uintptr_t kAllocCount = 1000;
+  std::vector<std::thread> thread_list;
+  for (uintptr_t t = 0; t < kThreadCount; ++t) {
+    thread_list.emplace_back([t, kAllocCount]() {
+      uintptr_t base = 0x100000 * (t + 1);
+      for (uintptr_t i = 0; i < kAllocCount; ++i) {
+        AllocIndex::Add(GetPointer(base + 0x10 * i), 0x10,
+                        ALLOC_TYPE_DEVICE, kDevice, kContext);
+      }
+      for (uintptr_t i = 0; i < kAllocCount; ++i) {
+        AllocRange range{};
+        FTRACE_ASSERT(AllocIndex::Find(GetPointer(base + 0x10 * i + 8),
+                                       &range));
+        FTRACE_ASSERT(range.base == base + 0x10 * i);
+        FTRACE_ASSERT(AllocIndex::Remove(GetPointer(range.base)));
+      }
+    });
+  }
+  for (std::thread& thread : thread_list) {
+    thread.join();
+  }
+  FTRACE_ASSERT(AllocIndex::GetType(GetPointer(0x100008)) ==
+                ALLOC_TYPE_UNKNOWN);
+}
+
+int main() {
+  TestFind();
+  TestZeroSize();
+  TestTypeLetter();
+  TestThreads();
+  return 0;
+}
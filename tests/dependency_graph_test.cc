@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dependency_graph.h"
+#include "exec_graph.h"
+#include "finetrace_assert.h"
+#include "test_utils.h"
+
+static const void* kQueue = reinterpret_cast<const void*>(0x10);
+static const void* kOtherQueue = reinterpret_cast<const void*>(0x20);
+static const void* kEvent = reinterpret_cast<const void*>(0x30);
+
+static const std::vector<const void*> kNoEvents;
+
+// Commands of one submission are unordered, the next submission waits
+// for all of them
+static void TestSubmission() {
+  DependencyGraph graph;
+  graph.BeginSubmission(kQueue);
+  size_t a = graph.AddNode(kQueue, 0, nullptr, kNoEvents, false);
+  size_t b = graph.AddNode(kQueue, 0, nullptr, kNoEvents, false);
+  graph.BeginSubmission(kQueue);
+  size_t c = graph.AddNode(kQueue, 0, nullptr, kNoEvents, false);
+  FTRACE_ASSERT(graph.GetNodeCount() == 4); // With the join
+  graph.CompleteNode(a, "A", 0, 100);
+  graph.CompleteNode(b, "B", 0, 50);
+  graph.CompleteNode(c, "C", 100, 200);
+
+  uint64_t span = 0, path_time = 0;
+  CriticalPathInfoMap info_map = graph.Analyze(span, path_time);
+  FTRACE_ASSERT(span == 200 && path_time == 200);
+  FTRACE_ASSERT(info_map["A"].path_count == 1);
+  FTRACE_ASSERT(info_map["A"].min_slack == 0);
+  FTRACE_ASSERT(info_map["B"].path_count == 0);
+  FTRACE_ASSERT(info_map["B"].min_slack == 50);
+  FTRACE_ASSERT(info_map["C"].path_count == 1);
+  FTRACE_ASSERT(info_map["C"].path_time == 100);
+
+  std::string table = graph.GetCriticalPathTable();
+  FTRACE_ASSERT(test_utils::Contains(
+      table, "Device Span (ns): 200, Critical Path Busy Time (ns): 200"));
+  std::vector<std::string> row = test_utils::GetTableRow(table, "B");
+  FTRACE_ASSERT(row.size() == 8);
+  FTRACE_ASSERT(row[1] == "1" && row[3] == "0" && row[6] == "50");
+}
+
+static void TestBarrier() {
+  DependencyGraph graph;
+  graph.SetWindowSize(0);
+  size_t a = graph.AddNode(kQueue, 0, nullptr, kNoEvents, false);
+  size_t b = graph.AddNode(kQueue, 0, nullptr, kNoEvents, true);
+  size_t c = graph.AddNode(kQueue, 0, nullptr, kNoEvents, false);
+  graph.CompleteNode(a, "A", 0, 10);
+  graph.CompleteNode(b, "B", 10, 20);
+  graph.CompleteNode(c, "C", 20, 30);
+
+  ExecGraph exported;
+  graph.Export(&exported, "L0");
+  const std::vector<ExecGraphNode>& node_list = exported.GetNodeList();
+  FTRACE_ASSERT(node_list.size() == 3);
+  FTRACE_ASSERT(node_list[b].order_pred_list == std::vector<size_t>{a});
+  FTRACE_ASSERT(node_list[c].order_pred_list == std::vector<size_t>{b});
+}
+
+// Event is removed on reset, so later waits do not depend on old signals
+static void TestEvents() {
+  DependencyGraph graph;
+  graph.SetWindowSize(0);
+  size_t a = graph.AddNode(kQueue, 0, kEvent, kNoEvents, false);
+  size_t b = graph.AddNode(kOtherQueue, 0, nullptr, {kEvent}, false);
+  graph.RemoveEvent(kEvent);
+  size_t c = graph.AddNode(kOtherQueue, 0, nullptr, {kEvent}, true);
+  graph.CompleteNode(a, "A", 0, 100);
+  graph.CompleteNode(b, "B", 150, 250);
+  graph.CompleteNode(c, "C", 250, 260);
+  graph.AddHostWait(0, 260);
+
+  uint64_t span = 0, path_time = 0;
+  CriticalPathInfoMap info_map = graph.Analyze(span, path_time);
+  FTRACE_ASSERT(info_map["A"].path_count == 1);
+  FTRACE_ASSERT(path_time == 210);
+
+  ExecGraph exported;
+  graph.Export(&exported, "L0");
+  const std::vector<ExecGraphNode>& node_list = exported.GetNodeList();
+  FTRACE_ASSERT(node_list.size() == 3);
+  FTRACE_ASSERT(node_list[b].event_pred_list == std::vector<size_t>{a});
+  FTRACE_ASSERT(node_list[b].order_pred_list.empty());
+  FTRACE_ASSERT(node_list[c].event_pred_list.empty());
+  FTRACE_ASSERT(node_list[c].order_pred_list == std::vector<size_t>{b});
+  FTRACE_ASSERT(exported.GetWaitList().size() == 1);
+}
+
+// Retired windows are still counted in the report
+static void TestWindows() {
+  DependencyGraph graph;
+  graph.SetWindowSize(16);
+  for (uint64_t i = 0; i < 100; ++i) {
+    size_t node = graph.AddNode(kQueue, 0, nullptr, kNoEvents, true);
+    graph.CompleteNode(node, "K", 10 * i, 10 * i + 10);
+  }
+  FTRACE_ASSERT(graph.GetNodeCount() == 100);
+
+  uint64_t span = 0, path_time = 0;
+  CriticalPathInfoMap info_map = graph.Analyze(span, path_time);
+  FTRACE_ASSERT(span == 1000 && path_time == 1000);
+  FTRACE_ASSERT(info_map["K"].call_count == 100);
+  FTRACE_ASSERT(info_map["K"].path_count == 100);
+
+  std::string table = graph.GetCriticalPathTable();
+  FTRACE_ASSERT(test_utils::Contains(
+      table, "Analyzed by windows of 16 activities, 80 of 100 retired"));
+}
+
+int main() {
+  TestSubmission();
+  TestBarrier();
+  TestEvents();
+  TestWindows();
+  return 0;
+}
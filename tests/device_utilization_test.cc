@@ -0,0 +1,79 @@
+#include <string>
+#include <vector>
+
+#include "device_utilization.h"
+#include "finetrace_assert.h"
+#include "test_utils.h"
+
+static void TestEmpty() {
+  DeviceUtilization utilization;
+  FTRACE_ASSERT(utilization.GetUtilizationTable().empty());
+}
+
+static void TestGaps() {
+  const std::vector<std::string> queue0 = {"GPU", "Queue 0"};
+  const std::vector<std::string> queue1 = {"GPU", "Queue 1"};
+  DeviceUtilization utilization;
+
+  utilization.AddInterval(queue0, UTILIZATION_COMPUTE, 0, 0, 100);
+  utilization.AddInterval(queue1, UTILIZATION_TRANSFER, 0, 50, 150);
+  // Submitted after a host wait ended on the idle queue
+  utilization.AddHostWait(90, 120);
+  utilization.AddInterval(queue0, UTILIZATION_COMPUTE, 150, 200, 300);
+  // Submitted in time, but started later
+  utilization.AddInterval(queue0, UTILIZATION_COMPUTE, 250, 400, 500);
+  // Submitted late
+  utilization.AddInterval(queue0, UTILIZATION_COMPUTE, 600, 700, 800);
+
+  std::string table = utilization.GetUtilizationTable();
+  FTRACE_ASSERT(test_utils::Contains(
+      table, "Device Span (ns): 800, Busy (ns): 450, Busy (%): 56.25"));
+  FTRACE_ASSERT(test_utils::Contains(table, "Max Concurrency: 2"));
+  FTRACE_ASSERT(test_utils::Contains(
+      table, "Compute (ns): 400, Transfer (ns): 100, "
+      "Overlapped Transfer (ns): 50, Exposed Transfer (ns): 50"));
+
+  std::vector<std::string> row = test_utils::GetTableRow(table, "0");
+  FTRACE_ASSERT(row.size() == 3 && row[1] == "350");
+  row = test_utils::GetTableRow(table, "1");
+  FTRACE_ASSERT(row.size() == 3 && row[1] == "400");
+  row = test_utils::GetTableRow(table, "2");
+  FTRACE_ASSERT(row.size() == 3 && row[1] == "50");
+
+  // Busy, Busy (%), Idle Gaps, Max Gap, Submission, Sync, Dependency
+  row = test_utils::GetTableRow(table, "GPU / Queue 0");
+  FTRACE_ASSERT(row.size() == 8);
+  FTRACE_ASSERT(row[1] == "400" && row[2] == "50.00");
+  FTRACE_ASSERT(row[3] == "3" && row[4] == "200");
+  FTRACE_ASSERT(row[5] == "200" && row[6] == "100" && row[7] == "100");
+
+  row = test_utils::GetTableRow(table, "GPU");
+  FTRACE_ASSERT(row.size() == 8);
+  FTRACE_ASSERT(row[1] == "450" && row[3] == "3");
+  FTRACE_ASSERT(row[5] == "200" && row[6] == "0" && row[7] == "150");
+}
+
+// Track intervals extend deeper tracks only, device busy time is the same
+static void TestTrackInterval() {
+  const std::vector<std::string> queue = {"GPU", "Queue 0"};
+  const std::vector<std::string> tile = {"GPU", "Tile 0"};
+  DeviceUtilization utilization;
+  utilization.AddInterval(queue, UTILIZATION_COMPUTE, 0, 0, 100);
+  utilization.AddTrackInterval(tile, 1, UTILIZATION_COMPUTE, 0, 0, 40);
+  utilization.AddInterval(queue, UTILIZATION_OTHER, 100, 200, 300);
+
+  std::string table = utilization.GetUtilizationTable();
+  FTRACE_ASSERT(test_utils::Contains(table, "Busy (ns): 200,"));
+  std::vector<std::string> row =
+    test_utils::GetTableRow(table, "GPU / Tile 0");
+  FTRACE_ASSERT(row.size() == 8 && row[1] == "40");
+  row = test_utils::GetTableRow(table, "GPU");
+  FTRACE_ASSERT(row.size() == 8 && row[1] == "200");
+}
+
+int main() {
+  TestEmpty();
+  TestGaps();
+  TestTrackInterval();
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "finetrace_assert.h"
+#include "iteration_detector.h"
+#include "test_utils.h"
+
+static void OnIteration(void* data, uint64_t iteration, uint64_t timestamp) {
+  uint64_t* count = reinterpret_cast<uint64_t*>(data);
+  FTRACE_ASSERT(iteration == *count + 1);
+  FTRACE_ASSERT(timestamp > 0);
+  *count = iteration;
+}
+
+// Launches are 100 ns apart and take 50 ns on device, setup launches
+// before the loop are not a part of any iteration
+static uint64_t RunLoop(
+    IterationDetector& detector, const std::vector<uint32_t>& pattern,
+    uint64_t iteration_count, uint64_t substituted) {
+  uint64_t timestamp = 100;
+  for (int i = 0; i < 3; ++i) {
+    uint64_t launch = detector.AddLaunch(9, timestamp);
+    detector.AddDeviceTime(launch, 50);
+    timestamp += 100;
+  }
+  for (uint64_t i = 0; i < iteration_count; ++i) {
+    for (size_t j = 0; j < pattern.size(); ++j) {
+      uint32_t name_id = pattern[j];
+      if (i == substituted && j + 1 == pattern.size()) {
+        name_id = 7;
+      }
+      uint64_t launch = detector.AddLaunch(name_id, timestamp);
+      detector.AddDeviceTime(launch, 50);
+      timestamp += 100;
+    }
+  }
+  return timestamp;
+}
+
+static void TestPeriod() {
+  uint64_t count = 0;
+  IterationDetector detector(OnIteration, &count);
+  RunLoop(detector, {1, 2, 3}, 2000, UINT64_MAX);
+  FTRACE_ASSERT(count == 2000);
+
+  std::string table = detector.GetIterationTable();
+  FTRACE_ASSERT(test_utils::Contains(
+      table, "Period (launches): 3, Iterations: 1999, Iterations/s: "));
+  FTRACE_ASSERT(test_utils::Contains(table, "Unmatched Launches: 0"));
+  FTRACE_ASSERT(test_utils::Contains(
+      table, "Drift (first vs last 100 iterations, %): +0.00"));
+
+  std::vector<std::string> row =
+    test_utils::GetTableRow(table, "Wall Time");
+  FTRACE_ASSERT(row.size() == 3);
+  FTRACE_ASSERT(row[1] == "300" && row[2] == "0");
+  row = test_utils::GetTableRow(table, "Device Time");
+  FTRACE_ASSERT(row.size() == 3 && row[1] == "150");
+  row = test_utils::GetTableRow(table, "Host Overhead");
+  FTRACE_ASSERT(row.size() == 3 && row[1] == "150");
+}
+
+static void TestSubstitution() {
+  IterationDetector detector(nullptr, nullptr);
+  RunLoop(detector, {1, 2, 3, 4}, 2000, 1500);
+  std::string table = detector.GetIterationTable();
+  FTRACE_ASSERT(test_utils::Contains(table, "Period (launches): 4"));
+  FTRACE_ASSERT(test_utils::Contains(table, "Unmatched Launches: 1"));
+}
+
+// Detection runs on the buffered launches if the run is short
+static void TestShortRun() {
+  uint64_t count = 0;
+  IterationDetector detector(OnIteration, &count);
+  RunLoop(detector, {1, 2}, 10, UINT64_MAX);
+  FTRACE_ASSERT(count == 0);
+  std::string table = detector.GetIterationTable();
+  FTRACE_ASSERT(test_utils::Contains(
+      table, "Period (launches): 2, Iterations: 9,"));
+  FTRACE_ASSERT(count == 10);
+}
+
+static void TestNoPeriod() {
+  IterationDetector detector(nullptr, nullptr);
+  for (uint32_t i = 0; i < 5000; ++i) {
+    detector.AddLaunch(i, 100 * (i + 1));
+  }
+  FTRACE_ASSERT(detector.GetIterationTable().empty());
+}
+
+int main() {
+  TestPeriod();
+  TestSubstitution();
+  TestShortRun();
+  TestNoPeriod();
+  return 0;
+}
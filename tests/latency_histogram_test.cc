@@ -0,0 +1,91 @@
+#include <cstdint>
+
+#include "finetrace_assert.h"
+#include "latency_histogram.h"
+#include "test_utils.h"
+
+static void TestEmpty() {
+  LatencyHistogram histogram;
+  FTRACE_ASSERT(histogram.GetCount() == 0);
+  FTRACE_ASSERT(histogram.GetPercentile(50.0) == 0);
+}
+
+// Values below two sub-bucket ranges have buckets of their own
+static void TestExactValues() {
+  LatencyHistogram histogram;
+  for (uint64_t value = 0; value < 32; ++value) {
+    histogram.Record(value);
+  }
+  FTRACE_ASSERT(histogram.GetCount() == 32);
+  FTRACE_ASSERT(histogram.GetPercentile(0.0) == 0);
+  FTRACE_ASSERT(histogram.GetPercentile(50.0) == 15);
+  FTRACE_ASSERT(histogram.GetPercentile(100.0) == 31);
+}
+
+static void TestRelativeError() {
+  LatencyHistogram histogram;
+  for (uint64_t i = 1; i <= 100; ++i) {
+    histogram.Record(i * 1000);
+  }
+  const double percentile_list[] = {10.0, 50.0, 90.0, 99.0};
+  for (double percentile : percentile_list) {
+    uint64_t expected = static_cast<uint64_t>(percentile) * 1000;
+    uint64_t value = histogram.GetPercentile(percentile);
+    FTRACE_ASSERT(value >= expected);
+    FTRACE_ASSERT(value <= expected + expected / 16);
+  }
+  FTRACE_ASSERT(histogram.GetPercentile(100.0) == 100000);
+}
+
+static void TestOverflow() {
+  LatencyHistogram histogram;
+  uint64_t large = 1ull << 50;
+  histogram.Record(10);
+  histogram.Record(large);
+  FTRACE_ASSERT(histogram.GetCount() == 2);
+  FTRACE_ASSERT(histogram.GetPercentile(50.0) == 10);
+  FTRACE_ASSERT(histogram.GetPercentile(100.0) == large);
+
+  std::vector<std::string> row = test_utils::GetTableRow(
+      histogram.GetBucketTable(), std::to_string(1ull << 40));
+  FTRACE_ASSERT(row.size() == 5);
+  FTRACE_ASSERT(row[1] == std::to_string(large));
+  FTRACE_ASSERT(row[2] == "1");
+  FTRACE_ASSERT(row[4] == "100.00");
+}
+
+static void TestMerge() {
+  LatencyHistogram first, second;
+  first.Record(5);
+  first.Record(7);
+  second.Record(3);
+  second.Record(1ull << 45);
+  first.Merge(second);
+  FTRACE_ASSERT(first.GetCount() == 4);
+  FTRACE_ASSERT(first.GetPercentile(0.0) == 3);
+  FTRACE_ASSERT(first.GetPercentile(50.0) == 5);
+  FTRACE_ASSERT(first.GetPercentile(100.0) == (1ull << 45));
+
+  LatencyHistogram empty;
+  first.Merge(empty);
+  FTRACE_ASSERT(first.GetCount() == 4);
+}
+
+static void TestSubtract() {
+  LatencyHistogram histogram;
+  histogram.Subtract(10);
+  histogram.Record(5);
+  histogram.Record(25);
+  FTRACE_ASSERT(histogram.GetPercentile(0.0) == 0);
+  FTRACE_ASSERT(histogram.GetPercentile(100.0) == 15);
+}
+
+int main() {
+  TestEmpty();
+  TestExactValues();
+  TestRelativeError();
+  TestOverflow();
+  TestMerge();
+  TestSubtract();
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "finetrace_assert.h"
+#include "occupancy.h"
+#include "test_utils.h"
+
+static bool IsNear(double value, double expected) {
+  return std::fabs(value - expected) < 1e-9;
+}
+
+static DeviceLayout GetLayout() {
+  DeviceLayout layout;
+  layout.subslice_count = 8;
+  layout.threads_per_subslice = 56;
+  layout.local_memory = 65536;
+  return layout;
+}
+
+static void TestUnknown() {
+  Occupancy result{};
+  LaunchShape shape{{256, 1, 1}, 128, 32, 0};
+  FTRACE_ASSERT(!OccupancyTable::GetOccupancy(DeviceLayout(), shape, result));
+
+  shape.simd_width = 0;
+  FTRACE_ASSERT(!OccupancyTable::GetOccupancy(GetLayout(), shape, result));
+}
+
+static void TestFullWaves() {
+  // 8 threads per group, 7 groups per subslice, 56 groups per wave
+  Occupancy result{};
+  LaunchShape shape{{256, 1, 1}, 112, 32, 0};
+  FTRACE_ASSERT(OccupancyTable::GetOccupancy(GetLayout(), shape, result));
+  FTRACE_ASSERT(result.resident);
+  FTRACE_ASSERT(!result.upper_bound);
+  FTRACE_ASSERT(IsNear(result.occupancy, 1.0));
+  FTRACE_ASSERT(IsNear(result.wave_efficiency, 1.0));
+  FTRACE_ASSERT(IsNear(result.lane_utilization, 1.0));
+}
+
+static void TestPartialWave() {
+  // 4 threads per group with 100 of 128 lanes busy, 14 groups per
+  // subslice, 112 groups per wave, so 2 waves for 120 groups
+  Occupancy result{};
+  LaunchShape shape{{10, 10, 1}, 120, 32, 1024};
+  FTRACE_ASSERT(OccupancyTable::GetOccupancy(GetLayout(), shape, result));
+  FTRACE_ASSERT(result.resident);
+  FTRACE_ASSERT(result.upper_bound);
+  FTRACE_ASSERT(IsNear(result.occupancy, 1.0));
+  FTRACE_ASSERT(IsNear(result.wave_efficiency, 120.0 / 224.0));
+  FTRACE_ASSERT(IsNear(result.lane_utilization, 100.0 / 128.0));
+}
+
+static void TestLowOccupancy() {
+  // 32 threads per group, only one group fits into 56 threads
+  Occupancy result{};
+  LaunchShape shape{{1024, 1, 1}, 8, 32, 0};
+  FTRACE_ASSERT(OccupancyTable::GetOccupancy(GetLayout(), shape, result));
+  FTRACE_ASSERT(result.resident);
+  FTRACE_ASSERT(IsNear(result.occupancy, 32.0 / 56.0));
+  FTRACE_ASSERT(IsNear(result.wave_efficiency, 1.0));
+}
+
+static void TestNotResident() {
+  Occupancy result{};
+  LaunchShape shape{{1024, 1, 1}, 8, 8, 0};
+  FTRACE_ASSERT(OccupancyTable::GetOccupancy(GetLayout(), shape, result));
+  FTRACE_ASSERT(!result.resident);
+
+  shape.simd_width = 32;
+  shape.local_memory = 2 * GetLayout().local_memory;
+  FTRACE_ASSERT(OccupancyTable::GetOccupancy(GetLayout(), shape, result));
+  FTRACE_ASSERT(!result.resident);
+}
+
+static void TestTable() {
+  OccupancyTable table;
+  FTRACE_ASSERT(table.GetOccupancyTable().empty());
+
+  LaunchShape large{{1024, 1, 1}, 8, 32, 0};
+  table.AddLaunch("Unknown", DeviceLayout(), large, 1000);
+  FTRACE_ASSERT(table.GetOccupancyTable().empty());
+
+  // Loss of the large group launch is (1 - 32 / 56) of its time
+  LaunchShape small{{256, 1, 1}, 112, 32, 0};
+  table.AddLaunch("Reduce", GetLayout(), large, 1000);
+  table.AddLaunch("Reduce", GetLayout(), small, 1000);
+  std::string text = table.GetOccupancyTable();
+  FTRACE_ASSERT(test_utils::Contains(
+      text, "Occupancy Loss (ns): 428 of 3000 (14.27%)"));
+
+  std::vector<std::string> row = test_utils::GetTableRow(text, "Reduce");
+  FTRACE_ASSERT(row.size() == 10);
+  FTRACE_ASSERT(row[1] == "2");
+  FTRACE_ASSERT(row[3] == "78.57");
+  FTRACE_ASSERT(row[6] == "428");
+  FTRACE_ASSERT(row[9] == "0");
+  FTRACE_ASSERT(test_utils::Contains(
+      text, "Kernels Launched with Different Group Sizes:"));
+  FTRACE_ASSERT(test_utils::Contains(text, "1024x1x1"));
+  FTRACE_ASSERT(test_utils::Contains(text, "256x1x1"));
+}
+
+int main() {
+  TestUnknown();
+  TestFullWaves();
+  TestPartialWave();
+  TestLowOccupancy();
+  TestNotResident();
+  TestTable();
+  return 0;
+}
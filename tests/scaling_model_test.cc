@@ -0,0 +1,73 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "finetrace_assert.h"
+#include "scaling_model.h"
+#include "test_utils.h"
+
+static const void* kDevice = reinterpret_cast<const void*>(0x1);
+
+static void TestEmpty() {
+  ScalingModel model;
+  FTRACE_ASSERT(model.GetScalingTable().empty());
+  model.AddLaunch("Kernel", kDevice, false, 0, 100);
+  FTRACE_ASSERT(model.GetScalingTable().empty());
+}
+
+static void TestLinear() {
+  ScalingModel model;
+  for (uint64_t size = 100; size <= 1000; size += 100) {
+    model.AddLaunch("Copy", kDevice, true, size, 1000 + 2 * size);
+  }
+  std::vector<std::string> row =
+    test_utils::GetTableRow(model.GetScalingTable(), "Copy");
+  FTRACE_ASSERT(row.size() == 11);
+  FTRACE_ASSERT(row[2] == "bytes");
+  FTRACE_ASSERT(row[3] == "10");
+  FTRACE_ASSERT(row[4] == "100");
+  FTRACE_ASSERT(row[5] == "1000");
+  FTRACE_ASSERT(row[6] == "1000.00");
+  FTRACE_ASSERT(row[7] == "2.000000");
+  FTRACE_ASSERT(row[8] == "1.0000");
+  FTRACE_ASSERT(row[10] == "linear");
+}
+
+static void TestSuperLinear() {
+  ScalingModel model;
+  for (uint64_t size = 1000; size <= 10000; size += 1000) {
+    uint64_t scaled = size / 1000;
+    model.AddLaunch("Sort", kDevice, false, size, 100 * scaled * scaled);
+  }
+  std::vector<std::string> row =
+    test_utils::GetTableRow(model.GetScalingTable(), "Sort");
+  FTRACE_ASSERT(row.size() == 11);
+  FTRACE_ASSERT(row[2] == "items");
+  FTRACE_ASSERT(row[10] == "super-linear");
+}
+
+// Line is not fitted if sizes do not vary or launches are too few
+static void TestNoFit() {
+  ScalingModel model;
+  for (int i = 0; i < 10; ++i) {
+    model.AddLaunch("Fixed", kDevice, false, 64, 100 + i);
+  }
+  model.AddLaunch("Rare", kDevice, false, 64, 100);
+  model.AddLaunch("Rare", kDevice, false, 128, 200);
+
+  std::string table = model.GetScalingTable();
+  std::vector<std::string> row = test_utils::GetTableRow(table, "Fixed");
+  FTRACE_ASSERT(row.size() == 11);
+  FTRACE_ASSERT(row[6] == "-" && row[10] == "-");
+  row = test_utils::GetTableRow(table, "Rare");
+  FTRACE_ASSERT(row.size() == 11);
+  FTRACE_ASSERT(row[6] == "-" && row[10] == "-");
+}
+
+int main() {
+  TestEmpty();
+  TestLinear();
+  TestSuperLinear();
+  TestNoFit();
+  return 0;
+}
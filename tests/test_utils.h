@@ -0,0 +1,39 @@
+#ifndef FTRACE_TOOLS_TESTS_TEST_UTILS_H_
+#define FTRACE_TOOLS_TESTS_TEST_UTILS_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace test_utils {
+
+// Fields of the first CSV table row with the given first field, empty
+// if there is no such row
+inline std::vector<std::string> GetTableRow(
+    const std::string& table, const std::string& name) {
+  std::stringstream stream(table);
+  std::string line;
+  while (std::getline(stream, line)) {
+    std::vector<std::string> field_list;
+    std::stringstream line_stream(line);
+    std::string field;
+    while (std::getline(line_stream, field, ',')) {
+      size_t first = field.find_first_not_of(' ');
+      size_t last = field.find_last_not_of(' ');
+      field_list.push_back((first == std::string::npos) ?
+        std::string() : field.substr(first, last - first + 1));
+    }
+    if (!field_list.empty() && field_list[0] == name) {
+      return field_list;
+    }
+  }
+  return std::vector<std::string>();
+}
+
+inline bool Contains(const std::string& text, const std::string& part) {
+  return text.find(part) != std::string::npos;
+}
+
+} // namespace test_utils
+
+#endif // FTRACE_TOOLS_TESTS_TEST_UTILS_H_
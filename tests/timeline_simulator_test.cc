@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "exec_graph.h"
+#include "finetrace_assert.h"
+#include "test_utils.h"
+#include "timeline_simulator.h"
+
+static ExecGraphNode GetNode(
+    const std::string& name, const std::string& queue,
+    uint64_t submitted, uint64_t start, uint64_t end,
+    const std::vector<size_t>& order_pred_list) {
+  ExecGraphNode node;
+  node.name = name;
+  node.queue = queue;
+  node.submitted = submitted;
+  node.start = start;
+  node.end = end;
+  node.order_pred_list = order_pred_list;
+  return node;
+}
+
+static uint64_t GetPathTime(
+    const SimulationResult& result, const std::string& name) {
+  auto it = result.path_info_map.find(name);
+  return (it == result.path_info_map.end()) ? 0 : it->second.path_time;
+}
+
+// Unchanged replay gives the recorded timeline back
+static void TestReplay() {
+  ExecGraph graph;
+  graph.AddNode(GetNode("A", "Q", 0, 0, 100, {}));
+  graph.AddNode(GetNode("B", "Q", 0, 100, 300, {0}));
+
+  TimelineSimulator simulator(graph);
+  FTRACE_ASSERT(simulator.GetRecordedTime() == 300);
+  SimulationResult result = simulator.Simulate(WhatIfOptions());
+  FTRACE_ASSERT(result.wall_time == 300);
+  FTRACE_ASSERT(GetPathTime(result, "A") == 100);
+  FTRACE_ASSERT(GetPathTime(result, "B") == 200);
+
+  std::vector<std::string> row = test_utils::GetTableRow(
+      TimelineSimulator::GetPathTable(result), "B");
+  FTRACE_ASSERT(row.size() == 4);
+  FTRACE_ASSERT(row[1] == "1" && row[2] == "200" && row[3] == "66.67");
+}
+
+static void TestScale() {
+  ExecGraph graph;
+  graph.AddNode(GetNode("A", "Q", 0, 0, 100, {}));
+  graph.AddNode(GetNode("B", "Q", 0, 100, 300, {0}));
+
+  WhatIfOptions options;
+  options.scale_list.push_back({"B", 0.5});
+  TimelineSimulator simulator(graph);
+  SimulationResult result = simulator.Simulate(options);
+  FTRACE_ASSERT(result.wall_time == 200);
+  FTRACE_ASSERT(GetPathTime(result, "B") == 100);
+}
+
+// Asynchronous activity leaves its queue, but its successors still wait
+static void TestAsync() {
+  ExecGraph graph;
+  graph.AddNode(GetNode("Kernel", "Q", 0, 0, 100, {}));
+  graph.AddNode(GetNode("Copy", "Q", 0, 100, 200, {0}));
+  graph.AddNode(GetNode("Next", "Q", 0, 200, 250, {1}));
+
+  WhatIfOptions options;
+  options.async_list.push_back("Copy");
+  TimelineSimulator simulator(graph);
+  SimulationResult result = simulator.Simulate(options);
+  FTRACE_ASSERT(result.wall_time == 150);
+  // Both finish at 100, so either of them is on the path
+  FTRACE_ASSERT(
+      GetPathTime(result, "Kernel") + GetPathTime(result, "Copy") == 100);
+  FTRACE_ASSERT(GetPathTime(result, "Next") == 50);
+}
+
+// Host waits for A with 50 ns wake-up latency, then works for 50 ns
+// before submitting B
+static void TestHostWait() {
+  ExecGraph graph;
+  graph.AddNode(GetNode("A", "Q", 0, 0, 100, {}));
+  graph.AddNode(GetNode("B", "Q", 200, 200, 300, {0}));
+  graph.AddWait(0, 150);
+
+  TimelineSimulator simulator(graph);
+  SimulationResult result = simulator.Simulate(WhatIfOptions());
+  FTRACE_ASSERT(result.wall_time == 300);
+  FTRACE_ASSERT(GetPathTime(result, kHostActivityName) == 100);
+
+  WhatIfOptions options;
+  options.scale_list.push_back({"A", 0.5});
+  result = simulator.Simulate(options);
+  FTRACE_ASSERT(result.wall_time == 250);
+
+  options = WhatIfOptions();
+  options.no_host_waits = true;
+  result = simulator.Simulate(options);
+  FTRACE_ASSERT(result.wall_time == 200);
+}
+
+int main() {
+  TestReplay();
+  TestScale();
+  TestAsync();
+  TestHostWait();
+  return 0;
+}
@@ -1,8 +1,14 @@
 #include <iostream>
+#include <mutex>
+
+#include <stdlib.h>
 
 #include "unified_tracer.h"
 
+// Collection control may be called from any application thread, so the
+// tracer is accessed only under the lock and deleted after it is cleared
 static UnifiedTracer* tracer = nullptr;
+static std::mutex tracer_lock;
 
 extern "C" FTRACE_EXPORT
 void Usage() {
@@ -46,6 +52,10 @@ void Usage() {
     "--chrome-device-stages         " <<
     "Dump device activities by stages to JSON file" <<
     std::endl;
+  std::cout <<
+    "--chrome-no-engine-on-device   " <<
+    "Show L0 device activities per queue, not per device engine" <<
+    std::endl;
   std::cout <<
     "--verbose [-v]                 " <<
     "Enable verbose mode to show more kernel information" <<
@@ -74,6 +84,98 @@ void Usage() {
     "--conditional-collection       " <<
     "Enable conditional collection mode" <<
     std::endl;
+  std::cout <<
+    "--control-signals              " <<
+    "Start/stop collection on SIGUSR1/SIGUSR2" <<
+    std::endl;
+  std::cout <<
+    "--control-fifo <filename>      " <<
+    "Read start/stop/mark commands from the named FIFO" <<
+    std::endl;
+  std::cout <<
+    "--host-stalls                  " <<
+    "Attribute host synchronization time to the kernels being waited on" <<
+    std::endl;
+  std::cout <<
+    "--critical-path                " <<
+    "Report device critical path and slack per kernel" <<
+    std::endl;
+  std::cout <<
+    "--record-graph                 " <<
+    "Store execution graph for finetrace-whatif" <<
+    std::endl;
+  std::cout <<
+    "--utilization                  " <<
+    "Report device busy time, idle gaps and copy/compute overlap" <<
+    std::endl;
+  std::cout <<
+    "--steady-state                 " <<
+    "Separate kernel warm-up from steady state and report outliers" <<
+    std::endl;
+  std::cout <<
+    "--warm-up <count>              " <<
+    "Same as --steady-state, but warm-up is first <count> launches" <<
+    std::endl;
+  std::cout <<
+    "--drill-down                   " <<
+    "Report device timing per kernel, launch config, tile and device" <<
+    std::endl;
+  std::cout <<
+    "--latency-histograms           " <<
+    "Dump latency histograms for API calls and kernels" <<
+    std::endl;
+  std::cout <<
+    "--iterations                   " <<
+    "Detect iterations from the kernel launch sequence" <<
+    std::endl;
+  std::cout <<
+    "--memory                       " <<
+    "Report device and USM memory footprint, peak and leaks" <<
+    std::endl;
+  std::cout <<
+    "--transfers                    " <<
+    "Report transfer bandwidth per direction, device and size" <<
+    std::endl;
+  std::cout <<
+    "--transfer-advice              " <<
+    "Report redundant uploads and small copies to coalesce" <<
+    std::endl;
+  std::cout <<
+    "--object-churn                 " <<
+    "Report objects rebuilt with identical contents" <<
+    std::endl;
+  std::cout <<
+    "--module-builds                " <<
+    "Report module build time and duplicate builds" <<
+    std::endl;
+  std::cout <<
+    "--module-index <filename>      " <<
+    "Same as --module-builds, but keep modules over runs in <filename>" <<
+    std::endl;
+  std::cout <<
+    "--kernel-resources             " <<
+    "Report private, spill and local memory, subgroup size and GRF" <<
+    std::endl;
+  std::cout <<
+    "--occupancy                    " <<
+    "Report theoretical occupancy and compare kernel group sizes" <<
+    std::endl;
+  std::cout <<
+    "--tile-balance                 " <<
+    "Report load imbalance between tiles for implicit scaling" <<
+    std::endl;
+  std::cout <<
+    "--scaling                      " <<
+    "Fit kernel time against launch size (fixed and per-unit cost)" <<
+    std::endl;
+  std::cout <<
+    "--raw-api-time                 " <<
+    "Do not subtract calibrated tracing overhead from API times" <<
+    std::endl;
+  std::cout <<
+    "--tracer-overhead              " <<
+    "Report time spent in the tracer itself" <<
+    std::endl;
   std::cout <<
     "--version                      " <<
     "Print version" <<
@@ -116,6 +218,9 @@ int ParseArgs(int argc, char* argv[]) {
     } else if (strcmp(argv[i], "--chrome-device-stages") == 0) {
       utils::SetEnv("FINETRACE_ChromeDeviceStages", "1");
       ++app_index;
+    } else if (strcmp(argv[i], "--chrome-no-engine-on-device") == 0) {
+      utils::SetEnv("FINETRACE_ChromeNoEngineOnDevice", "1");
+      ++app_index;
     } else if (strcmp(argv[i], "--verbose") == 0 ||
                strcmp(argv[i], "-v") == 0) {
       utils::SetEnv("FINETRACE_Verbose", "1");
@@ -145,6 +250,95 @@ int ParseArgs(int argc, char* argv[]) {
     } else if (strcmp(argv[i], "--conditional-collection") == 0) {
       utils::SetEnv("FINETRACE_ConditionalCollection", "1");
       ++app_index;
+    } else if (strcmp(argv[i], "--control-signals") == 0) {
+      utils::SetEnv("FINETRACE_ControlSignals", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--control-fifo") == 0) {
+      utils::SetEnv("FINETRACE_ControlFifo", "1");
+      ++i;
+      if (i >= argc) {
+        std::cerr << "[ERROR] Control FIFO name is not specified" << std::endl;
+        return -1;
+      }
+      utils::SetEnv("FINETRACE_ControlFifoName", argv[i]);
+      app_index += 2;
+    } else if (strcmp(argv[i], "--host-stalls") == 0) {
+      utils::SetEnv("FINETRACE_HostStalls", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--critical-path") == 0) {
+      utils::SetEnv("FINETRACE_CriticalPath", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--record-graph") == 0) {
+      utils::SetEnv("FINETRACE_RecordGraph", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--utilization") == 0) {
+      utils::SetEnv("FINETRACE_Utilization", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--steady-state") == 0) {
+      utils::SetEnv("FINETRACE_SteadyState", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--warm-up") == 0) {
+      utils::SetEnv("FINETRACE_SteadyState", "1");
+      ++i;
+      if (i >= argc || atoi(argv[i]) <= 0) {
+        std::cerr << "[ERROR] Warm-up launch count is not specified" <<
+          std::endl;
+        return -1;
+      }
+      utils::SetEnv("FINETRACE_WarmUpCount", argv[i]);
+      app_index += 2;
+    } else if (strcmp(argv[i], "--drill-down") == 0) {
+      utils::SetEnv("FINETRACE_DrillDown", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--latency-histograms") == 0) {
+      utils::SetEnv("FINETRACE_LatencyHistograms", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--iterations") == 0) {
+      utils::SetEnv("FINETRACE_Iterations", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--memory") == 0) {
+      utils::SetEnv("FINETRACE_Memory", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--transfers") == 0) {
+      utils::SetEnv("FINETRACE_Transfers", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--transfer-advice") == 0) {
+      utils::SetEnv("FINETRACE_TransferAdvice", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--object-churn") == 0) {
+      utils::SetEnv("FINETRACE_ObjectChurn", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--module-builds") == 0) {
+      utils::SetEnv("FINETRACE_ModuleBuilds", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--module-index") == 0) {
+      utils::SetEnv("FINETRACE_ModuleBuilds", "1");
+      ++i;
+      if (i >= argc) {
+        std::cerr << "[ERROR] Module index file name is not specified" <<
+          std::endl;
+        return -1;
+      }
+      utils::SetEnv("FINETRACE_ModuleIndexName", argv[i]);
+      app_index += 2;
+    } else if (strcmp(argv[i], "--kernel-resources") == 0) {
+      utils::SetEnv("FINETRACE_KernelResources", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--occupancy") == 0) {
+      utils::SetEnv("FINETRACE_Occupancy", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--tile-balance") == 0) {
+      utils::SetEnv("FINETRACE_TileBalance", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--scaling") == 0) {
+      utils::SetEnv("FINETRACE_Scaling", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--raw-api-time") == 0) {
+      utils::SetEnv("FINETRACE_RawApiTime", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--tracer-overhead") == 0) {
+      utils::SetEnv("FINETRACE_TracerOverhead", "1");
+      ++app_index;
     } else if (strcmp(argv[i], "--version") == 0) {
 #ifdef FTRACE_VERSION
       std::cout << TOSTRING(FTRACE_VERSION) << std::endl;
@@ -182,100 +376,253 @@ void SetToolEnv() {
 
 static TraceOptions ReadArgs() {
   std::string value;
-  uint32_t flags = 0;
+  uint64_t flags = 0;
   std::string log_file;
+  std::string control_fifo;
+  uint32_t warm_up_count = 0;
+  std::string module_index;
 
   value = utils::GetEnv("FINETRACE_CallLogging");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_CALL_LOGGING);
+    flags |= (1ull << TRACE_CALL_LOGGING);
   }
 
   value = utils::GetEnv("FINETRACE_HostTiming");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_HOST_TIMING);
+    flags |= (1ull << TRACE_HOST_TIMING);
   }
 
   value = utils::GetEnv("FINETRACE_DeviceTiming");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_DEVICE_TIMING);
+    flags |= (1ull << TRACE_DEVICE_TIMING);
   }
 
   value = utils::GetEnv("FINETRACE_KernelSubmission");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_KERNEL_SUBMITTING);
+    flags |= (1ull << TRACE_KERNEL_SUBMITTING);
   }
 
   value = utils::GetEnv("FINETRACE_DeviceTimeline");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_DEVICE_TIMELINE);
+    flags |= (1ull << TRACE_DEVICE_TIMELINE);
   }
 
   value = utils::GetEnv("FINETRACE_ChromeCallLogging");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_CHROME_CALL_LOGGING);
+    flags |= (1ull << TRACE_CHROME_CALL_LOGGING);
   }
 
   value = utils::GetEnv("FINETRACE_ChromeDeviceTimeline");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_CHROME_DEVICE_TIMELINE);
+    flags |= (1ull << TRACE_CHROME_DEVICE_TIMELINE);
   }
 
   value = utils::GetEnv("FINETRACE_ChromeKernelTimeline");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_CHROME_KERNEL_TIMELINE);
+    flags |= (1ull << TRACE_CHROME_KERNEL_TIMELINE);
   }
 
   value = utils::GetEnv("FINETRACE_ChromeDeviceStages");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_CHROME_DEVICE_STAGES);
+    flags |= (1ull << TRACE_CHROME_DEVICE_STAGES);
+  }
+
+  value = utils::GetEnv("FINETRACE_ChromeNoEngineOnDevice");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_CHROME_NO_ENGINE_ON_DEVICE);
   }
 
   value = utils::GetEnv("FINETRACE_Verbose");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_VERBOSE);
+    flags |= (1ull << TRACE_VERBOSE);
   }
 
   value = utils::GetEnv("FINETRACE_Demangle");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_DEMANGLE);
+    flags |= (1ull << TRACE_DEMANGLE);
   }
 
   value = utils::GetEnv("FINETRACE_KernelsPerTile");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_KERNELS_PER_TILE);
+    flags |= (1ull << TRACE_KERNELS_PER_TILE);
   }
 
   value = utils::GetEnv("FINETRACE_Tid");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_TID);
+    flags |= (1ull << TRACE_TID);
   }
 
   value = utils::GetEnv("FINETRACE_Pid");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_PID);
+    flags |= (1ull << TRACE_PID);
   }
 
   value = utils::GetEnv("FINETRACE_LogToFile");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_LOG_TO_FILE);
+    flags |= (1ull << TRACE_LOG_TO_FILE);
     log_file = utils::GetEnv("FINETRACE_LogFilename");
     FTRACE_ASSERT(!log_file.empty());
   }
 
   value = utils::GetEnv("FINETRACE_ConditionalCollection");
   if (!value.empty() && value == "1") {
-    flags |= (1 << TRACE_CONDITIONAL_COLLECTION);
+    flags |= (1ull << TRACE_CONDITIONAL_COLLECTION);
+  }
+
+  value = utils::GetEnv("FINETRACE_ControlSignals");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_CONTROL_SIGNALS);
+  }
+
+  value = utils::GetEnv("FINETRACE_ControlFifo");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_CONTROL_FIFO);
+    control_fifo = utils::GetEnv("FINETRACE_ControlFifoName");
+    FTRACE_ASSERT(!control_fifo.empty());
+  }
+
+  value = utils::GetEnv("FINETRACE_HostStalls");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_HOST_STALLS);
+  }
+
+  value = utils::GetEnv("FINETRACE_CriticalPath");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_CRITICAL_PATH);
+  }
+
+  value = utils::GetEnv("FINETRACE_RecordGraph");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_RECORD_GRAPH);
+  }
+
+  value = utils::GetEnv("FINETRACE_Utilization");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_UTILIZATION);
+  }
+
+  value = utils::GetEnv("FINETRACE_SteadyState");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_STEADY_STATE);
+    value = utils::GetEnv("FINETRACE_WarmUpCount");
+    if (!value.empty()) {
+      warm_up_count = static_cast<uint32_t>(atoi(value.c_str()));
+    }
+  }
+
+  value = utils::GetEnv("FINETRACE_DrillDown");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_DRILL_DOWN);
+  }
+
+  value = utils::GetEnv("FINETRACE_LatencyHistograms");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_LATENCY_HISTOGRAMS);
   }
 
-  return TraceOptions(flags, log_file);
+  value = utils::GetEnv("FINETRACE_Iterations");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_ITERATIONS);
+  }
+
+  value = utils::GetEnv("FINETRACE_Memory");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_MEMORY);
+  }
+
+  value = utils::GetEnv("FINETRACE_Transfers");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_TRANSFERS);
+  }
+
+  value = utils::GetEnv("FINETRACE_TransferAdvice");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_TRANSFER_ADVICE);
+  }
+
+  value = utils::GetEnv("FINETRACE_ObjectChurn");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_OBJECT_CHURN);
+  }
+
+  value = utils::GetEnv("FINETRACE_ModuleBuilds");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_MODULE_BUILDS);
+    module_index = utils::GetEnv("FINETRACE_ModuleIndexName");
+  }
+
+  value = utils::GetEnv("FINETRACE_KernelResources");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_KERNEL_RESOURCES);
+  }
+
+  value = utils::GetEnv("FINETRACE_Occupancy");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_OCCUPANCY);
+  }
+
+  value = utils::GetEnv("FINETRACE_TileBalance");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_TILE_BALANCE);
+  }
+
+  value = utils::GetEnv("FINETRACE_Scaling");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_SCALING);
+  }
+
+  value = utils::GetEnv("FINETRACE_RawApiTime");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_RAW_API_TIME);
+  }
+
+  value = utils::GetEnv("FINETRACE_TracerOverhead");
+  if (!value.empty() && value == "1") {
+    flags |= (1ull << TRACE_TRACER_OVERHEAD);
+  }
+
+  return TraceOptions(
+      flags, log_file, control_fifo, warm_up_count, module_index);
 }
 
 void EnableProfiling() {
-  tracer = UnifiedTracer::Create(ReadArgs());
+  UnifiedTracer* current = UnifiedTracer::Create(ReadArgs());
+  const std::lock_guard<std::mutex> lock(tracer_lock);
+  tracer = current;
 }
 
 void DisableProfiling() {
+  UnifiedTracer* current = nullptr;
+  {
+    const std::lock_guard<std::mutex> lock(tracer_lock);
+    current = tracer;
+    tracer = nullptr;
+  }
+  if (current != nullptr) {
+    delete current;
+  }
+}
+
+extern "C" FTRACE_EXPORT
+void ftraceStart() {
+  const std::lock_guard<std::mutex> lock(tracer_lock);
+  if (tracer != nullptr) {
+    tracer->StartCollection();
+  }
+}
+
+extern "C" FTRACE_EXPORT
+void ftraceStop() {
+  const std::lock_guard<std::mutex> lock(tracer_lock);
+  if (tracer != nullptr) {
+    tracer->StopCollection();
+  }
+}
+
+extern "C" FTRACE_EXPORT
+void ftraceMark(const char* label) {
+  const std::lock_guard<std::mutex> lock(tracer_lock);
   if (tracer != nullptr) {
-    delete tracer;
+    tracer->MarkCollection(label == nullptr ? std::string() : label);
   }
 }
\ No newline at end of file
@@ -1,25 +1,76 @@
 #ifndef FTRACE_TOOLS_FINETRACE_UNIFIED_TRACER_H_
 #define FTRACE_TOOLS_FINETRACE_UNIFIED_TRACER_H_
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "cl_ext_collector.h"
 #include "cl_ext_callbacks.h"
 #include "cl_api_collector.h"
 #include "cl_api_callbacks.h"
 #include "cl_kernel_collector.h"
+#include "control_channel.h"
+#include "exec_graph.h"
+#include "memory_tracker.h"
+#include "module_builds.h"
 #include "trace_options.h"
+#include "tracer_overhead.h"
 #include "utils.h"
 #include "ze_api_collector.h"
 #include "ze_kernel_collector.h"
 
 const char* kChromeTraceFileName = "finetrace";
+const char* kExecGraphFileName = "finetrace";
+const char* kExecGraphFileExt = "graph";
+
+struct CollectionTotals {
+  uint64_t time;
+  uint64_t call_count;
+
+  bool operator>(const CollectionTotals& r) const {
+    if (time != r.time) {
+      return time > r.time;
+    }
+    return call_count > r.call_count;
+  }
+
+  bool operator!=(const CollectionTotals& r) const {
+    if (time == r.time) {
+      return call_count != r.call_count;
+    }
+    return true;
+  }
+};
+
+using CollectionTotalsMap = std::map<std::string, CollectionTotals>;
+
+struct CollectionSnapshot {
+  CollectionTotalsMap ze_api;
+  CollectionTotalsMap cl_cpu_api;
+  CollectionTotalsMap cl_gpu_api;
+  CollectionTotalsMap ze_device;
+  CollectionTotalsMap cl_cpu_device;
+  CollectionTotalsMap cl_gpu_device;
+};
+
+struct CollectionWindow {
+  uint64_t start_time;
+  uint64_t end_time;
+  bool closed;
+  std::vector< std::pair<uint64_t, std::string> > marks;
+  CollectionSnapshot start;
+  CollectionSnapshot end;
+};
 
 class UnifiedTracer {
  public:
@@ -33,8 +84,41 @@ class UnifiedTracer {
     UnifiedTracer* tracer = new UnifiedTracer(options);
     FTRACE_ASSERT(tracer != nullptr);
 
+    if (tracer->CheckOption(TRACE_TRACER_OVERHEAD)) {
+      TracerOverhead::Enable();
+    }
+
+    if (tracer->CheckOption(TRACE_MEMORY)) {
+      OnMemoryCallback memory_callback = nullptr;
+      if (tracer->chrome_logger_ != nullptr) {
+        memory_callback = ChromeMemoryCallback;
+      }
+      MemoryTracker::Enable(memory_callback, tracer);
+    }
+
+    if (tracer->CheckOption(TRACE_MODULE_BUILDS)) {
+      ModuleBuilds::Enable(tracer->options_.GetModuleIndexName());
+    }
+
     if (tracer->CheckOption(TRACE_DEVICE_TIMING) ||
         tracer->CheckOption(TRACE_KERNEL_SUBMITTING) ||
+        tracer->CheckOption(TRACE_HOST_STALLS) ||
+        tracer->CheckOption(TRACE_CRITICAL_PATH) ||
+        tracer->CheckOption(TRACE_RECORD_GRAPH) ||
+        tracer->CheckOption(TRACE_UTILIZATION) ||
+        tracer->CheckOption(TRACE_LATENCY_HISTOGRAMS) ||
+        tracer->CheckOption(TRACE_DRILL_DOWN) ||
+        tracer->CheckOption(TRACE_STEADY_STATE) ||
+        tracer->CheckOption(TRACE_ITERATIONS) ||
+        tracer->CheckOption(TRACE_MEMORY) ||
+        tracer->CheckOption(TRACE_TRANSFERS) ||
+        tracer->CheckOption(TRACE_TRANSFER_ADVICE) ||
+        tracer->CheckOption(TRACE_OBJECT_CHURN) ||
+        tracer->CheckOption(TRACE_MODULE_BUILDS) ||
+        tracer->CheckOption(TRACE_KERNEL_RESOURCES) ||
+        tracer->CheckOption(TRACE_OCCUPANCY) ||
+        tracer->CheckOption(TRACE_TILE_BALANCE) ||
+        tracer->CheckOption(TRACE_SCALING) ||
         tracer->CheckOption(TRACE_DEVICE_TIMELINE) ||
         tracer->CheckOption(TRACE_CHROME_DEVICE_TIMELINE) ||
         tracer->CheckOption(TRACE_CHROME_KERNEL_TIMELINE) ||
@@ -86,15 +170,55 @@ class UnifiedTracer {
         cl_callback = ClChromeStagesCallback;
       }
 
+      OnHostStallCallback stall_callback = nullptr;
+      if (tracer->CheckOption(TRACE_HOST_STALLS) &&
+          tracer->chrome_logger_ != nullptr) {
+        stall_callback = ChromeHostStallCallback;
+      }
+
+      OnIterationCallback iteration_callback = nullptr;
+      if (tracer->CheckOption(TRACE_ITERATIONS) &&
+          tracer->chrome_logger_ != nullptr) {
+        iteration_callback = ChromeIterationCallback;
+      }
+
       KernelCollectorOptions kernel_options;
       kernel_options.verbose = tracer->CheckOption(TRACE_VERBOSE);
       kernel_options.demangle = tracer->CheckOption(TRACE_DEMANGLE);
       kernel_options.kernels_per_tile =
         tracer->CheckOption(TRACE_KERNELS_PER_TILE);
+      kernel_options.drill_down = tracer->CheckOption(TRACE_DRILL_DOWN);
+      kernel_options.steady_state = tracer->CheckOption(TRACE_STEADY_STATE);
+      kernel_options.warm_up_count = tracer->options_.GetWarmUpCount();
+      kernel_options.iterations = tracer->CheckOption(TRACE_ITERATIONS);
+      kernel_options.memory = tracer->CheckOption(TRACE_MEMORY);
+      kernel_options.transfers = tracer->CheckOption(TRACE_TRANSFERS);
+      kernel_options.transfer_advice =
+        tracer->CheckOption(TRACE_TRANSFER_ADVICE);
+      kernel_options.object_churn = tracer->CheckOption(TRACE_OBJECT_CHURN);
+      kernel_options.module_builds =
+        tracer->CheckOption(TRACE_MODULE_BUILDS);
+      kernel_options.kernel_resources =
+        tracer->CheckOption(TRACE_KERNEL_RESOURCES);
+      kernel_options.occupancy = tracer->CheckOption(TRACE_OCCUPANCY);
+      kernel_options.tile_balance = tracer->CheckOption(TRACE_TILE_BALANCE);
+      kernel_options.scaling = tracer->CheckOption(TRACE_SCALING);
+      kernel_options.host_stalls =
+        tracer->CheckOption(TRACE_HOST_STALLS) ||
+        tracer->CheckOption(TRACE_RECORD_GRAPH) ||
+        tracer->CheckOption(TRACE_UTILIZATION);
+      kernel_options.critical_path =
+        tracer->CheckOption(TRACE_CRITICAL_PATH) ||
+        tracer->CheckOption(TRACE_RECORD_GRAPH);
+      kernel_options.record_graph = tracer->CheckOption(TRACE_RECORD_GRAPH);
+      kernel_options.utilization = tracer->CheckOption(TRACE_UTILIZATION);
+      kernel_options.engine_on_device =
+        !tracer->CheckOption(TRACE_CHROME_NO_ENGINE_ON_DEVICE);
 
       if (status == ZE_RESULT_SUCCESS) {
         ze_kernel_collector = ZeKernelCollector::Create(
-            &tracer->correlator_, kernel_options, ze_callback, tracer);
+            &tracer->correlator_, kernel_options, ze_callback, tracer,
+            stall_callback, iteration_callback);
         if (ze_kernel_collector == nullptr) {
           std::cerr <<
             "[WARNING] Unable to create kernel collector for L0 backend" <<
@@ -106,7 +230,8 @@ class UnifiedTracer {
       if (cl_cpu_device != nullptr) {
         cl_cpu_kernel_collector = ClKernelCollector::Create(
             cl_cpu_device, &tracer->correlator_,
-            kernel_options, cl_callback, tracer);
+            kernel_options, cl_callback, tracer, stall_callback,
+            iteration_callback);
         if (cl_cpu_kernel_collector == nullptr) {
           std::cerr <<
             "[WARNING] Unable to create kernel collector for CL CPU backend" <<
@@ -118,7 +243,8 @@ class UnifiedTracer {
       if (cl_gpu_device != nullptr) {
         cl_gpu_kernel_collector = ClKernelCollector::Create(
             cl_gpu_device, &tracer->correlator_,
-            kernel_options, cl_callback, tracer);
+            kernel_options, cl_callback, tracer, stall_callback,
+            iteration_callback);
         if (cl_gpu_kernel_collector == nullptr) {
           std::cerr <<
             "[WARNING] Unable to create kernel collector for CL GPU backend" <<
@@ -138,7 +264,8 @@ class UnifiedTracer {
 
     if (tracer->CheckOption(TRACE_CALL_LOGGING) ||
         tracer->CheckOption(TRACE_CHROME_CALL_LOGGING) ||
-        tracer->CheckOption(TRACE_HOST_TIMING)) {
+        tracer->CheckOption(TRACE_HOST_TIMING) ||
+        tracer->CheckOption(TRACE_LATENCY_HISTOGRAMS)) {
 
       ZeApiCollector* ze_api_collector = nullptr;
       ClApiCollector* cl_cpu_api_collector = nullptr;
@@ -156,6 +283,7 @@ class UnifiedTracer {
       api_options.need_tid = tracer->CheckOption(TRACE_TID);
       api_options.need_pid = tracer->CheckOption(TRACE_PID);
       api_options.demangle = tracer->CheckOption(TRACE_DEMANGLE);
+      api_options.raw_time = tracer->CheckOption(TRACE_RAW_API_TIME);
 
       if (status == ZE_RESULT_SUCCESS) {
         ze_api_collector = ZeApiCollector::Create(
@@ -204,10 +332,30 @@ class UnifiedTracer {
       }
     }
 
+    if (tracer->correlator_.IsCollectionEnabled()) {
+      tracer->OpenCollectionWindow(0);
+    }
+
+    if (tracer->CheckOption(TRACE_CONTROL_SIGNALS) ||
+        tracer->CheckOption(TRACE_CONTROL_FIFO)) {
+      tracer->control_channel_ = ControlChannel::Create(
+          tracer->CheckOption(TRACE_CONTROL_SIGNALS),
+          tracer->options_.GetControlFifoName(),
+          OnControlCommand, tracer);
+      if (tracer->control_channel_ == nullptr) {
+        std::cerr << "[WARNING] Unable to create control channel" <<
+          std::endl;
+      }
+    }
+
     return tracer;
   }
 
   ~UnifiedTracer() {
+    if (control_channel_ != nullptr) {
+      delete control_channel_;
+    }
+
     total_execution_time_ = correlator_.GetTimestamp();
 
     if (cl_cpu_api_collector_ != nullptr) {
@@ -230,8 +378,24 @@ class UnifiedTracer {
       ze_kernel_collector_->DisableTracing();
     }
 
+    {
+      const std::lock_guard<std::mutex> lock(window_lock_);
+      if (!windows_.empty() && !windows_.back().closed) {
+        CloseCollectionWindow(total_execution_time_);
+      }
+    }
+
     Report();
 
+    if (CheckOption(TRACE_RECORD_GRAPH)) {
+      SaveExecGraph();
+    }
+
+    // CL USM wrappers and buffer destructor callbacks may still be called
+    if (CheckOption(TRACE_MEMORY)) {
+      MemoryTracker::Disable();
+    }
+
     if (cl_cpu_api_collector_ != nullptr) {
       delete cl_cpu_api_collector_;
     }
@@ -272,6 +436,39 @@ class UnifiedTracer {
     return options_.CheckFlag(option);
   }
 
+  void StartCollection() {
+    const std::lock_guard<std::mutex> lock(window_lock_);
+    control_used_ = true;
+    if (correlator_.SetCollectionEnabled(true)) {
+      return;
+    }
+    uint64_t timestamp = correlator_.GetTimestamp();
+    OpenCollectionWindow(timestamp);
+    LogControlEvent("Collection Start", timestamp);
+  }
+
+  void StopCollection() {
+    const std::lock_guard<std::mutex> lock(window_lock_);
+    control_used_ = true;
+    if (!correlator_.SetCollectionEnabled(false)) {
+      return;
+    }
+    uint64_t timestamp = correlator_.GetTimestamp();
+    CloseCollectionWindow(timestamp);
+    LogControlEvent("Collection Stop", timestamp);
+  }
+
+  void MarkCollection(const std::string& label) {
+    const std::lock_guard<std::mutex> lock(window_lock_);
+    control_used_ = true;
+    uint64_t timestamp = correlator_.GetTimestamp();
+    std::string name = label.empty() ? std::string("Mark") : label;
+    if (!windows_.empty() && !windows_.back().closed) {
+      windows_.back().marks.push_back(std::make_pair(timestamp, name));
+    }
+    LogControlEvent(name, timestamp);
+  }
+
   UnifiedTracer(const UnifiedTracer& copy) = delete;
   UnifiedTracer& operator=(const UnifiedTracer& copy) = delete;
 
@@ -338,11 +535,228 @@ class UnifiedTracer {
     }
   }
 
+  template <class InfoMap>
+  static CollectionTotalsMap GetApiTotals(
+      const InfoMap& info_map, uint64_t call_overhead) {
+    CollectionTotalsMap totals;
+    for (auto& value : utils::CompensateCallOverhead(info_map, call_overhead)) {
+      totals[value.first] = {value.second.total_time, value.second.call_count};
+    }
+    return totals;
+  }
+
+  template <class InfoMap>
+  static CollectionTotalsMap GetDeviceTotals(const InfoMap& info_map) {
+    CollectionTotalsMap totals;
+    for (auto& value : info_map) {
+      totals[value.first] =
+        {value.second.execute_time, value.second.call_count};
+    }
+    return totals;
+  }
+
+  CollectionSnapshot TakeSnapshot() {
+    CollectionSnapshot snapshot;
+    if (ze_api_collector_ != nullptr) {
+      snapshot.ze_api = GetApiTotals(
+          ze_api_collector_->GetFunctionInfoMapSnapshot(),
+          ze_api_collector_->GetCallOverhead());
+    }
+    if (cl_cpu_api_collector_ != nullptr) {
+      snapshot.cl_cpu_api = GetApiTotals(
+          cl_cpu_api_collector_->GetFunctionInfoMapSnapshot(),
+          cl_cpu_api_collector_->GetCallOverhead());
+    }
+    if (cl_gpu_api_collector_ != nullptr) {
+      snapshot.cl_gpu_api = GetApiTotals(
+          cl_gpu_api_collector_->GetFunctionInfoMapSnapshot(),
+          cl_gpu_api_collector_->GetCallOverhead());
+    }
+    if (ze_kernel_collector_ != nullptr) {
+      snapshot.ze_device = GetDeviceTotals(
+          ze_kernel_collector_->GetKernelInfoMapSnapshot());
+    }
+    if (cl_cpu_kernel_collector_ != nullptr) {
+      snapshot.cl_cpu_device = GetDeviceTotals(
+          cl_cpu_kernel_collector_->GetKernelInfoMapSnapshot());
+    }
+    if (cl_gpu_kernel_collector_ != nullptr) {
+      snapshot.cl_gpu_device = GetDeviceTotals(
+          cl_gpu_kernel_collector_->GetKernelInfoMapSnapshot());
+    }
+    return snapshot;
+  }
+
+  void OpenCollectionWindow(uint64_t timestamp) {
+    CollectionWindow window;
+    window.start_time = timestamp;
+    window.end_time = 0;
+    window.closed = false;
+    if (timestamp > 0) {
+      window.start = TakeSnapshot();
+    }
+    windows_.push_back(window);
+  }
+
+  void CloseCollectionWindow(uint64_t timestamp) {
+    FTRACE_ASSERT(!windows_.empty());
+    CollectionWindow& window = windows_.back();
+    FTRACE_ASSERT(!window.closed);
+    window.end_time = timestamp;
+    window.end = TakeSnapshot();
+    window.closed = true;
+  }
+
+  void LogControlEvent(const std::string& name, uint64_t timestamp) {
+    if (CheckOption(TRACE_CALL_LOGGING)) {
+      std::stringstream stream;
+      stream << "==== [" << timestamp << "] " << name << std::endl;
+      correlator_.Log(stream.str());
+    }
+
+    if (chrome_logger_ != nullptr) {
+      std::stringstream stream;
+      stream << "{\"ph\":\"i\", \"pid\":\"" << utils::GetPid() <<
+        "\", \"tid\":\"" << utils::GetTid() <<
+        "\", \"name\":\"" << name <<
+        "\", \"ts\": " << timestamp / NSEC_IN_USEC <<
+        ", \"s\":\"g\"" <<
+        "}," << std::endl;
+      chrome_logger_->Log(stream.str());
+    }
+  }
+
+  static CollectionTotalsMap GetWindowTotals(
+      const CollectionTotalsMap& start, const CollectionTotalsMap& end) {
+    CollectionTotalsMap totals;
+    for (auto& value : end) {
+      CollectionTotals total = value.second;
+      auto it = start.find(value.first);
+      if (it != start.end()) {
+        FTRACE_ASSERT(total.time >= it->second.time);
+        FTRACE_ASSERT(total.call_count >= it->second.call_count);
+        total.time -= it->second.time;
+        total.call_count -= it->second.call_count;
+      }
+      if (total.call_count > 0) {
+        totals[value.first] = total;
+      }
+    }
+    return totals;
+  }
+
+  void PrintWindowTable(
+      const CollectionTotalsMap& start, const CollectionTotalsMap& end,
+      const char* title, const char* column) {
+    CollectionTotalsMap totals = GetWindowTotals(start, end);
+
+    std::set< std::pair<std::string, CollectionTotals>,
+              utils::Comparator > sorted_list(totals.begin(), totals.end());
+
+    uint64_t total_duration = 0;
+    size_t max_name_length = kNameLength;
+    for (auto& value : sorted_list) {
+      total_duration += value.second.time;
+      if (value.first.size() > max_name_length) {
+        max_name_length = value.first.size();
+      }
+    }
+
+    if (total_duration == 0) {
+      return;
+    }
+
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "== " << title << ": ==" << std::endl;
+    stream << std::endl;
+    stream << std::setw(max_name_length) << column << "," <<
+      std::setw(kCallsLength) << "Calls" << "," <<
+      std::setw(kTimeLength) << "Time (ns)" << "," <<
+      std::setw(kPercentLength) << "Time (%)" << "," <<
+      std::setw(kTimeLength) << "Average (ns)" << std::endl;
+
+    for (auto& value : sorted_list) {
+      uint64_t call_count = value.second.call_count;
+      uint64_t duration = value.second.time;
+      float percent_duration = 100.0f * duration / total_duration;
+      stream << std::setw(max_name_length) << value.first << "," <<
+        std::setw(kCallsLength) << call_count << "," <<
+        std::setw(kTimeLength) << duration << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) <<
+          std::fixed << percent_duration << "," <<
+        std::setw(kTimeLength) << duration / call_count << std::endl;
+    }
+
+    correlator_.Log(stream.str());
+  }
+
+  void ReportCollectionWindows() {
+    for (size_t i = 0; i < windows_.size(); ++i) {
+      const CollectionWindow& window = windows_[i];
+      FTRACE_ASSERT(window.closed);
+
+      std::stringstream stream;
+      stream << std::endl;
+      stream << "=== Collection Window #" << i + 1 << ": ===" << std::endl;
+      stream << std::endl;
+      stream << "Start Time (ns): " << window.start_time << std::endl;
+      stream << "  End Time (ns): " << window.end_time << std::endl;
+      stream << "  Duration (ns): " <<
+        window.end_time - window.start_time << std::endl;
+      for (auto& mark : window.marks) {
+        stream << "           Mark: " << mark.second <<
+          " [" << mark.first << " ns]" << std::endl;
+      }
+      correlator_.Log(stream.str());
+
+      PrintWindowTable(
+          window.start.ze_api, window.end.ze_api,
+          "L0 API", "Function");
+      PrintWindowTable(
+          window.start.cl_cpu_api, window.end.cl_cpu_api,
+          "CL CPU API", "Function");
+      PrintWindowTable(
+          window.start.cl_gpu_api, window.end.cl_gpu_api,
+          "CL GPU API", "Function");
+      PrintWindowTable(
+          window.start.ze_device, window.end.ze_device,
+          "L0 Device", "Kernel");
+      PrintWindowTable(
+          window.start.cl_cpu_device, window.end.cl_cpu_device,
+          "CL CPU Device", "Kernel");
+      PrintWindowTable(
+          window.start.cl_gpu_device, window.end.cl_gpu_device,
+          "CL GPU Device", "Kernel");
+    }
+    correlator_.Log("\n");
+  }
+
+  static void OnControlCommand(
+      void* data, ControlCommand command, const std::string& label) {
+    UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
+    FTRACE_ASSERT(tracer != nullptr);
+    switch (command) {
+      case CONTROL_COMMAND_START:
+        tracer->StartCollection();
+        break;
+      case CONTROL_COMMAND_STOP:
+        tracer->StopCollection();
+        break;
+      case CONTROL_COMMAND_MARK:
+        tracer->MarkCollection(label);
+        break;
+      default:
+        break;
+    }
+  }
+
   static uint64_t CalculateTotalTime(const ZeApiCollector* collector) {
     FTRACE_ASSERT(collector != nullptr);
     uint64_t total_time = 0;
 
-    const ZeFunctionInfoMap& function_info_map = collector->GetFunctionInfoMap();
+    ZeFunctionInfoMap function_info_map = utils::CompensateCallOverhead(
+        collector->GetFunctionInfoMap(), collector->GetCallOverhead());
     if (function_info_map.size() != 0) {
       for (auto& value : function_info_map) {
         total_time += value.second.total_time;
@@ -370,7 +784,8 @@ class UnifiedTracer {
     FTRACE_ASSERT(collector != nullptr);
     uint64_t total_time = 0;
 
-    const ClFunctionInfoMap& function_info_map = collector->GetFunctionInfoMap();
+    ClFunctionInfoMap function_info_map = utils::CompensateCallOverhead(
+        collector->GetFunctionInfoMap(), collector->GetCallOverhead());
     if (function_info_map.size() != 0) {
       for (auto& value : function_info_map) {
         total_time += value.second.total_time;
@@ -638,6 +1053,7 @@ class UnifiedTracer {
           cl_cpu_api_collector_,
           cl_gpu_api_collector_,
           "API");
+      ReportApiCallHierarchy();
     }
     if (CheckOption(TRACE_DEVICE_TIMING)) {
       ReportTiming(
@@ -646,6 +1062,12 @@ class UnifiedTracer {
           cl_gpu_kernel_collector_,
           "Device");
     }
+    if (CheckOption(TRACE_DRILL_DOWN)) {
+      ReportDrillDown();
+    }
+    if (CheckOption(TRACE_STEADY_STATE)) {
+      ReportSteadyState();
+    }
     if (CheckOption(TRACE_KERNEL_SUBMITTING)) {
       ReportKernelSubmission(
           ze_kernel_collector_,
@@ -653,9 +1075,482 @@ class UnifiedTracer {
           cl_gpu_kernel_collector_,
           "Device");
     }
+    if (CheckOption(TRACE_HOST_STALLS)) {
+      ReportHostStalls();
+    }
+    if (CheckOption(TRACE_CRITICAL_PATH)) {
+      ReportCriticalPath();
+    }
+    if (CheckOption(TRACE_UTILIZATION)) {
+      ReportUtilization();
+    }
+    if (CheckOption(TRACE_LATENCY_HISTOGRAMS)) {
+      ReportLatencyHistograms();
+    }
+    if (CheckOption(TRACE_ITERATIONS)) {
+      ReportIterations();
+    }
+    if (CheckOption(TRACE_MEMORY)) {
+      ReportMemory();
+    }
+    if (CheckOption(TRACE_TRANSFERS)) {
+      ReportTransfers();
+    }
+    if (CheckOption(TRACE_TRANSFER_ADVICE)) {
+      ReportTransferAdvice();
+    }
+    if (CheckOption(TRACE_OBJECT_CHURN)) {
+      ReportObjectChurn();
+    }
+    if (CheckOption(TRACE_MODULE_BUILDS)) {
+      ReportModuleBuilds();
+    }
+    if (CheckOption(TRACE_KERNEL_RESOURCES)) {
+      ReportKernelResources();
+    }
+    if (CheckOption(TRACE_OCCUPANCY)) {
+      ReportOccupancy();
+    }
+    if (CheckOption(TRACE_TILE_BALANCE)) {
+      ReportTileBalance();
+    }
+    if (CheckOption(TRACE_SCALING)) {
+      ReportScaling();
+    }
+    if (control_used_) {
+      ReportCollectionWindows();
+    }
+    if (CheckOption(TRACE_TRACER_OVERHEAD)) {
+      ReportTracerOverhead();
+    }
+    correlator_.Log("\n");
+  }
+
+  template <class Collector, class Printer>
+  void PrintBackendTable(
+      Collector* collector, const char* device_type, Printer printer) {
+    if (collector == nullptr) {
+      return;
+    }
+
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "== " << device_type << " Backend: ==" << std::endl;
+    stream << std::endl;
+    correlator_.Log(stream.str());
+    (collector->*printer)();
+  }
+
+  // Logs one table per enabled backend under a common section title
+  template <class ZePrinter, class ClPrinter>
+  void ReportBackendTables(
+      const char* title, ZePrinter ze_printer, ClPrinter cl_printer) {
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== " << title << ": ===" << std::endl;
+    correlator_.Log(stream.str());
+
+    PrintBackendTable(ze_kernel_collector_, "L0", ze_printer);
+    PrintBackendTable(cl_cpu_kernel_collector_, "CL CPU", cl_printer);
+    PrintBackendTable(cl_gpu_kernel_collector_, "CL GPU", cl_printer);
+
+    correlator_.Log("\n");
+  }
+
+  template <class Collector>
+  void PrintHostStallTable(
+      const Collector* collector, const char* device_type) {
+    if (collector == nullptr || collector->GetHostStallInfoMap().empty()) {
+      return;
+    }
+
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "== " << device_type << " Backend: ==" << std::endl;
+    stream << std::endl;
+    correlator_.Log(stream.str());
+    collector->PrintHostStallTable();
+  }
+
+  void ReportHostStalls() {
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== Host Stall by Kernel: ===" << std::endl;
+    correlator_.Log(stream.str());
+
+    PrintHostStallTable(ze_kernel_collector_, "L0");
+    PrintHostStallTable(cl_cpu_kernel_collector_, "CL CPU");
+    PrintHostStallTable(cl_gpu_kernel_collector_, "CL GPU");
+
+    correlator_.Log("\n");
+  }
+
+  void ReportCriticalPath() {
+    ReportBackendTables("Device Critical Path",
+        &ZeKernelCollector::PrintCriticalPathTable,
+        &ClKernelCollector::PrintCriticalPathTable);
+  }
+
+  template <class Collector>
+  void PrintDrillDownTables(
+      const Collector* collector, const char* device_type,
+      const std::vector<uint32_t>& level_list) {
+    if (collector == nullptr) {
+      return;
+    }
+
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "== " << device_type << " Backend: ==" << std::endl;
+    correlator_.Log(stream.str());
+
+    for (uint32_t level : level_list) {
+      stream.str(std::string());
+      stream << std::endl;
+      stream << "By " << GetKernelKeyLevelName(level) << ":" << std::endl;
+      stream << std::endl;
+      correlator_.Log(stream.str());
+      collector->PrintKernelsTable(level);
+    }
+  }
+
+  void ReportDrillDown() {
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== Device Timing Drill-Down: ===" << std::endl;
+    correlator_.Log(stream.str());
+
+    std::vector<uint32_t> ze_level_list = {
+        KERNEL_KEY_NAME,
+        KERNEL_KEY_CONFIG,
+        KERNEL_KEY_CONFIG | KERNEL_KEY_TILE,
+        KERNEL_KEY_CONFIG | KERNEL_KEY_TILE | KERNEL_KEY_DEVICE};
+    PrintDrillDownTables(ze_kernel_collector_, "L0", ze_level_list);
+
+    // No per tile parts for OpenCL(TM)
+    std::vector<uint32_t> cl_level_list = {
+        KERNEL_KEY_NAME,
+        KERNEL_KEY_CONFIG,
+        KERNEL_KEY_CONFIG | KERNEL_KEY_DEVICE};
+    PrintDrillDownTables(cl_cpu_kernel_collector_, "CL CPU", cl_level_list);
+    PrintDrillDownTables(cl_gpu_kernel_collector_, "CL GPU", cl_level_list);
+
+    correlator_.Log("\n");
+  }
+
+  void ReportSteadyState() {
+    ReportBackendTables("Kernel Steady State",
+        &ZeKernelCollector::PrintSteadyStateTable,
+        &ClKernelCollector::PrintSteadyStateTable);
+  }
+
+  void ReportUtilization() {
+    ReportBackendTables("Device Utilization",
+        &ZeKernelCollector::PrintUtilizationTable,
+        &ClKernelCollector::PrintUtilizationTable);
+  }
+
+  template <class ApiCollector, class KernelCollector>
+  void PrintHistograms(
+      const ApiCollector* api_collector,
+      const KernelCollector* kernel_collector,
+      const char* device_type) {
+    if (api_collector == nullptr && kernel_collector == nullptr) {
+      return;
+    }
+
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "== " << device_type << " Backend: ==" << std::endl;
+    stream << std::endl;
+    correlator_.Log(stream.str());
+    if (api_collector != nullptr) {
+      api_collector->PrintHistograms();
+    }
+    if (kernel_collector != nullptr) {
+      kernel_collector->PrintHistograms();
+    }
+  }
+
+  void ReportLatencyHistograms() {
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== Latency Histograms: ===" << std::endl;
+    correlator_.Log(stream.str());
+
+    PrintHistograms(ze_api_collector_, ze_kernel_collector_, "L0");
+    PrintHistograms(cl_cpu_api_collector_, cl_cpu_kernel_collector_, "CL CPU");
+    PrintHistograms(cl_gpu_api_collector_, cl_gpu_kernel_collector_, "CL GPU");
+
+    correlator_.Log("\n");
+  }
+
+  void ReportIterations() {
+    ReportBackendTables("Iterations",
+        &ZeKernelCollector::PrintIterationTable,
+        &ClKernelCollector::PrintIterationTable);
+  }
+
+  void ReportMemory() {
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== Memory Footprint: ===" << std::endl;
+    stream << std::endl;
+    correlator_.Log(stream.str());
+
+    std::string table = MemoryTracker::GetMemoryTable();
+    if (!table.empty()) {
+      correlator_.Log(table);
+    }
+    table = MemoryTracker::GetPeakSiteTable();
+    if (!table.empty()) {
+      correlator_.Log("\n");
+      correlator_.Log(table);
+    }
+    table = MemoryTracker::GetLeakTable();
+    if (!table.empty()) {
+      correlator_.Log("\n");
+      correlator_.Log(table);
+    }
+
     correlator_.Log("\n");
   }
 
+  void ReportTransfers() {
+    ReportBackendTables("Transfer Bandwidth",
+        &ZeKernelCollector::PrintTransferTable,
+        &ClKernelCollector::PrintTransferTable);
+  }
+
+  void ReportTransferAdvice() {
+    ReportBackendTables("Transfer Advice",
+        &ZeKernelCollector::PrintTransferAdviceTable,
+        &ClKernelCollector::PrintTransferAdviceTable);
+  }
+
+  void ReportObjectChurn() {
+    ReportBackendTables("Object Churn",
+        &ZeKernelCollector::PrintObjectChurnTable,
+        &ClKernelCollector::PrintObjectChurnTable);
+  }
+
+  void ReportModuleBuilds() {
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== Module Builds: ===" << std::endl;
+    stream << std::endl;
+    correlator_.Log(stream.str());
+
+    std::string table = ModuleBuilds::GetBuildTable();
+    if (!table.empty()) {
+      correlator_.Log(table);
+    }
+    if (!ModuleBuilds::SaveIndex()) {
+      std::cerr << "[WARNING] Unable to save module build index to " <<
+        ModuleBuilds::GetIndexFileName() << std::endl;
+    }
+
+    correlator_.Log("\n");
+  }
+
+  void ReportKernelResources() {
+    ReportBackendTables("Kernel Resources",
+        &ZeKernelCollector::PrintKernelResourceTable,
+        &ClKernelCollector::PrintKernelResourceTable);
+  }
+
+  void ReportOccupancy() {
+    ReportBackendTables("Occupancy",
+        &ZeKernelCollector::PrintOccupancyTable,
+        &ClKernelCollector::PrintOccupancyTable);
+  }
+
+  // Tiles are used by Level Zero implicit scaling only
+  void ReportTileBalance() {
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== Tile Balance: ===" << std::endl;
+    correlator_.Log(stream.str());
+
+    PrintBackendTable(ze_kernel_collector_, "L0",
+        &ZeKernelCollector::PrintTileBalanceTable);
+
+    correlator_.Log("\n");
+  }
+
+  void ReportScaling() {
+    ReportBackendTables("Kernel Scaling",
+        &ZeKernelCollector::PrintScalingTable,
+        &ClKernelCollector::PrintScalingTable);
+  }
+
+  void SaveExecGraph() {
+    ExecGraph graph;
+    if (ze_kernel_collector_ != nullptr) {
+      ze_kernel_collector_->ExportGraph(&graph);
+    }
+    if (cl_cpu_kernel_collector_ != nullptr) {
+      cl_cpu_kernel_collector_->ExportGraph(&graph);
+    }
+    if (cl_gpu_kernel_collector_ != nullptr) {
+      cl_gpu_kernel_collector_->ExportGraph(&graph);
+    }
+
+    std::string file_name = TraceOptions::GetTraceFileName(
+        kExecGraphFileName, kExecGraphFileExt);
+    if (!graph.Save(file_name)) {
+      std::cerr << "[WARNING] Unable to store execution graph to " <<
+        file_name << std::endl;
+      return;
+    }
+    std::cerr << "[INFO] Execution graph was stored to " <<
+      file_name << std::endl;
+  }
+
+  static size_t GetApiCallNameLength(
+      const ApiCallNode& node, size_t level) {
+    size_t max_length = 0;
+    for (auto& child : node.children) {
+      max_length = std::max(max_length, level * 2 + child.first.size());
+      max_length = std::max(
+          max_length, GetApiCallNameLength(*child.second, level + 1));
+    }
+    return max_length;
+  }
+
+  static void PrintApiCallNode(
+      std::stringstream& stream, const ApiCallNode& node, size_t level,
+      size_t name_length, uint64_t total_time) {
+    std::vector< std::pair<std::string, const ApiCallNode*> > children;
+    for (auto& child : node.children) {
+      children.emplace_back(child.first, child.second.get());
+    }
+    std::sort(children.begin(), children.end(),
+              [](const std::pair<std::string, const ApiCallNode*>& left,
+                 const std::pair<std::string, const ApiCallNode*>& right) {
+      return left.second->inclusive_time > right.second->inclusive_time;
+    });
+
+    for (auto& child : children) {
+      const ApiCallNode* value = child.second;
+      FTRACE_ASSERT(value->call_count > 0);
+      float percent_time = 100.0f * value->exclusive_time / total_time;
+      stream << std::left << std::setw(name_length) <<
+          std::string(level * 2, ' ') + child.first << std::right << "," <<
+        std::setw(kCallsLength) << value->call_count << "," <<
+        std::setw(kTimeLength) << value->inclusive_time << "," <<
+        std::setw(kTimeLength) << value->exclusive_time << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) <<
+          std::fixed << percent_time << "," <<
+        std::setw(kTimeLength) <<
+          value->inclusive_time / value->call_count << std::endl;
+      PrintApiCallNode(stream, *value, level + 1, name_length, total_time);
+    }
+  }
+
+  // Calls are grouped by their call paths, exclusive time of the call
+  // does not include time of traced calls made from inside of it
+  void ReportApiCallHierarchy() {
+    ApiCallNode root = correlator_.GetApiCallTree();
+
+    uint64_t total_time = 0;
+    for (auto& child : root.children) {
+      total_time += child.second->inclusive_time;
+    }
+    if (total_time == 0) {
+      return;
+    }
+
+    size_t name_length =
+      std::max<size_t>(kNameLength, GetApiCallNameLength(root, 0));
+
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== API Call Hierarchy: ===" << std::endl;
+    stream << std::endl;
+    stream << "Total Time of Calls with Nested Calls (ns): " <<
+      total_time << std::endl;
+    stream << std::endl;
+    stream << std::left << std::setw(name_length) << "Function" <<
+        std::right << "," <<
+      std::setw(kCallsLength) << "Calls" << "," <<
+      std::setw(kTimeLength) << "Inclusive (ns)" << "," <<
+      std::setw(kTimeLength) << "Exclusive (ns)" << "," <<
+      std::setw(kPercentLength) << "Excl. (%)" << "," <<
+      std::setw(kTimeLength) << "Average (ns)" << std::endl;
+    PrintApiCallNode(stream, root, 0, name_length, total_time);
+
+    correlator_.Log(stream.str());
+  }
+
+  void ReportTracerOverhead() {
+    uint64_t total_time = 0;
+    uint64_t hook_time[TRACER_HOOK_COUNT] = {0};
+    for (int i = 0; i < TRACER_HOOK_COUNT; ++i) {
+      TracerHook hook = static_cast<TracerHook>(i);
+      hook_time[i] =
+        TracerOverhead::ConvertCyclesToNs(TracerOverhead::GetHookCycles(hook));
+      total_time += hook_time[i];
+    }
+
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== Tracer Overhead: ===" << std::endl;
+    stream << std::endl;
+
+    if (total_time > 0) {
+      stream << std::setw(kHookLength) << "Hook" << "," <<
+        std::setw(kCallsLength) << "Calls" << "," <<
+        std::setw(kTimeLength) << "Time (ns)" << "," <<
+        std::setw(kPercentLength) << "Time (%)" << "," <<
+        std::setw(kTimeLength) << "Average (ns)" << std::endl;
+
+      for (int i = 0; i < TRACER_HOOK_COUNT; ++i) {
+        TracerHook hook = static_cast<TracerHook>(i);
+        uint64_t call_count = TracerOverhead::GetHookCalls(hook);
+        if (call_count == 0) {
+          continue;
+        }
+        float percent_time = 100.0f * hook_time[i] / total_time;
+        stream << std::setw(kHookLength) <<
+            TracerOverhead::GetHookName(hook) << "," <<
+          std::setw(kCallsLength) << call_count << "," <<
+          std::setw(kTimeLength) << hook_time[i] << "," <<
+          std::setw(kPercentLength) << std::setprecision(2) <<
+            std::fixed << percent_time << "," <<
+          std::setw(kTimeLength) << hook_time[i] / call_count << std::endl;
+      }
+      stream << std::endl;
+    }
+
+    const size_t title_width = 40;
+    const size_t value_width = 20;
+    stream << std::setw(title_width) << "Total Tracer Time (ns): " <<
+      std::setw(value_width) << total_time << std::endl;
+    if (total_execution_time_ > 0) {
+      stream << std::setw(title_width) <<
+        "Tracer Time of Total Execution (%): " <<
+        std::setw(value_width) << std::setprecision(2) << std::fixed <<
+        100.0f * total_time / total_execution_time_ << std::endl;
+    }
+    stream << std::setw(title_width) << "Traced Threads: " <<
+      std::setw(value_width) << TracerOverhead::GetThreadCount() << std::endl;
+    stream << std::setw(title_width) << "Max Pending Device Calls: " <<
+      std::setw(value_width) << TracerOverhead::GetPendingDepthMax() <<
+      std::endl;
+    stream << std::setw(title_width) << "Log Bytes Emitted: " <<
+      std::setw(value_width) << correlator_.GetLoggedBytes() << std::endl;
+    if (chrome_logger_ != nullptr) {
+      stream << std::setw(title_width) << "Timeline Bytes Emitted: " <<
+        std::setw(value_width) << chrome_logger_->GetLoggedBytes() <<
+        std::endl;
+    }
+    stream << std::setw(title_width) << "Tracking Memory Peak (bytes): " <<
+      std::setw(value_width) << TracerOverhead::GetMemoryPeak() << std::endl;
+
+    correlator_.Log(stream.str());
+  }
+
   static void ZeDeviceTimelineCallback(
       void* data,
       const std::string& queue,
@@ -724,13 +1619,18 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << queue <<
       "\", \"name\":\"" << name <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
 
     FTRACE_ASSERT(tracer->chrome_logger_ != nullptr);
     tracer->chrome_logger_->Log(stream.str());
+
+    if (tracer->IsChromeFlowEnabled()) {
+      tracer->LogChromeFlow(
+          "f", "L0", id, queue, GetMicroseconds(started));
+    }
   }
 
   static void ClChromeDeviceCallback(
@@ -749,13 +1649,18 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << queue <<
       "\", \"name\":\"" << name <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
 
     FTRACE_ASSERT(tracer->chrome_logger_ != nullptr);
     tracer->chrome_logger_->Log(stream.str());
+
+    if (tracer->IsChromeFlowEnabled()) {
+      tracer->LogChromeFlow(
+          "f", "CL", id, queue, GetMicroseconds(started));
+    }
   }
 
   static void ZeChromeKernelCallback(
@@ -774,13 +1679,18 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
       "\", \"name\":\"" << name <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
 
     FTRACE_ASSERT(tracer->chrome_logger_ != nullptr);
     tracer->chrome_logger_->Log(stream.str());
+
+    if (tracer->IsChromeFlowEnabled()) {
+      tracer->LogChromeFlow(
+          "f", "L0", id, name, GetMicroseconds(started));
+    }
   }
 
   static void ClChromeKernelCallback(
@@ -799,13 +1709,18 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
       "\", \"name\":\"" << name <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
 
     FTRACE_ASSERT(tracer->chrome_logger_ != nullptr);
     tracer->chrome_logger_->Log(stream.str());
+
+    if (tracer->IsChromeFlowEnabled()) {
+      tracer->LogChromeFlow(
+          "f", "CL", id, name, GetMicroseconds(started));
+    }
   }
 
   static void ZeChromeStagesCallback(
@@ -828,8 +1743,8 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << tid <<
       "\", \"name\":\"" << name << " (Appended)" <<
-      "\", \"ts\": " << appended / NSEC_IN_USEC <<
-      ", \"dur\":" << (submitted - appended) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(appended) <<
+      ", \"dur\":" << GetMicroseconds(submitted - appended) <<
       ", \"cname\":\"thread_state_runnable\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
@@ -840,8 +1755,8 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << tid <<
       "\", \"name\":\"" << name << " (Submitted)" <<
-      "\", \"ts\": " << submitted / NSEC_IN_USEC <<
-      ", \"dur\":" << (started - submitted) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(submitted) <<
+      ", \"dur\":" << GetMicroseconds(started - submitted) <<
       ", \"cname\":\"cq_build_running\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
@@ -852,12 +1767,17 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << tid <<
       "\", \"name\":\"" << name << " (Executed)" <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"cname\":\"thread_state_iowait\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
     tracer->chrome_logger_->Log(stream.str());
+
+    if (tracer->IsChromeFlowEnabled()) {
+      tracer->LogChromeFlow(
+          "f", "L0", id, tid, GetMicroseconds(started));
+    }
   }
 
   static void ClChromeStagesCallback(
@@ -880,8 +1800,8 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << tid <<
       "\", \"name\":\"" << name << " (Queued)" <<
-      "\", \"ts\": " << queued / NSEC_IN_USEC <<
-      ", \"dur\":" << (submitted - queued) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(queued) <<
+      ", \"dur\":" << GetMicroseconds(submitted - queued) <<
       ", \"cname\":\"thread_state_runnable\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
@@ -892,8 +1812,8 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << tid <<
       "\", \"name\":\"" << name << " (Submitted)" <<
-      "\", \"ts\": " << submitted / NSEC_IN_USEC <<
-      ", \"dur\":" << (started - submitted) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(submitted) <<
+      ", \"dur\":" << GetMicroseconds(started - submitted) <<
       ", \"cname\":\"cq_build_running\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
@@ -904,12 +1824,17 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << tid <<
       "\", \"name\":\"" << name << " (Executed)" <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"cname\":\"thread_state_iowait\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
     tracer->chrome_logger_->Log(stream.str());
+
+    if (tracer->IsChromeFlowEnabled()) {
+      tracer->LogChromeFlow(
+          "f", "CL", id, tid, GetMicroseconds(started));
+    }
   }
 
   static void ZeChromeKernelStagesCallback(
@@ -930,8 +1855,8 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
       "\", \"name\":\"" << name << " (Appended)" <<
-      "\", \"ts\": " << appended / NSEC_IN_USEC <<
-      ", \"dur\":" << (submitted - appended) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(appended) <<
+      ", \"dur\":" << GetMicroseconds(submitted - appended) <<
       ", \"cname\":\"thread_state_runnable\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
@@ -942,8 +1867,8 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
       "\", \"name\":\"" << name << " (Submitted)" <<
-      "\", \"ts\": " << submitted / NSEC_IN_USEC <<
-      ", \"dur\":" << (started - submitted) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(submitted) <<
+      ", \"dur\":" << GetMicroseconds(started - submitted) <<
       ", \"cname\":\"cq_build_running\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
@@ -954,12 +1879,17 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
       "\", \"name\":\"" << name << " (Executed)" <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"cname\":\"thread_state_iowait\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
     tracer->chrome_logger_->Log(stream.str());
+
+    if (tracer->IsChromeFlowEnabled()) {
+      tracer->LogChromeFlow(
+          "f", "L0", id, name, GetMicroseconds(started));
+    }
   }
 
   static void ClChromeKernelStagesCallback(
@@ -980,8 +1910,8 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
       "\", \"name\":\"" << name << " (Queued)" <<
-      "\", \"ts\": " << queued / NSEC_IN_USEC <<
-      ", \"dur\":" << (submitted - queued) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(queued) <<
+      ", \"dur\":" << GetMicroseconds(submitted - queued) <<
       ", \"cname\":\"thread_state_runnable\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
@@ -992,8 +1922,8 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
       "\", \"name\":\"" << name << " (Submitted)" <<
-      "\", \"ts\": " << submitted / NSEC_IN_USEC <<
-      ", \"dur\":" << (started - submitted) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(submitted) <<
+      ", \"dur\":" << GetMicroseconds(started - submitted) <<
       ", \"cname\":\"cq_build_running\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
@@ -1004,12 +1934,17 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
       "\", \"name\":\"" << name << " (Executed)" <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"cname\":\"thread_state_iowait\"" <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
     tracer->chrome_logger_->Log(stream.str());
+
+    if (tracer->IsChromeFlowEnabled()) {
+      tracer->LogChromeFlow(
+          "f", "CL", id, name, GetMicroseconds(started));
+    }
   }
 
   static void ZeDeviceAndChromeDeviceCallback(
@@ -1132,6 +2067,106 @@ class UnifiedTracer {
         data, queue, id, name, queued, submitted, started, ended);
   }
 
+  // Flow events link API calls to the device activities they launched,
+  // so both call logging and device timeline should be dumped
+  bool IsChromeFlowEnabled() {
+    return CheckOption(TRACE_CHROME_CALL_LOGGING) &&
+      (CheckOption(TRACE_CHROME_DEVICE_TIMELINE) ||
+       CheckOption(TRACE_CHROME_KERNEL_TIMELINE) ||
+       CheckOption(TRACE_CHROME_DEVICE_STAGES));
+  }
+
+  // Both flow ends bind to the enclosing slice: the API call for start
+  // and the execution of the activity on device track for end, so the
+  // timestamp must be exactly the one of that slice
+  void LogChromeFlow(
+      const char* phase, const char* category, const std::string& id,
+      const std::string& tid, const std::string& timestamp) {
+    std::stringstream stream;
+    stream << "{\"ph\":\"" << phase <<
+      "\", \"pid\":\"" << utils::GetPid() <<
+      "\", \"tid\":\"" << tid <<
+      "\", \"name\":\"Launch\", \"cat\":\"" << category <<
+      "\", \"id\":\"" << id <<
+      "\", \"ts\": " << timestamp;
+    if (std::string(phase) == "f") {
+      stream << ", \"bp\":\"e\"";
+    }
+    stream << "}," << std::endl;
+
+    FTRACE_ASSERT(chrome_logger_ != nullptr);
+    chrome_logger_->Log(stream.str());
+  }
+
+  // Nanosecond precision keeps nested API slices inside of their parents
+  static std::string GetMicroseconds(uint64_t time) {
+    std::string fraction = std::to_string(time % NSEC_IN_USEC);
+    return std::to_string(time / NSEC_IN_USEC) + "." +
+      std::string(3 - fraction.size(), '0') + fraction;
+  }
+
+  static void ChromeHostStallCallback(
+      void* data, const std::string& id, const std::string& name,
+      uint64_t started, uint64_t ended) {
+    UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
+    FTRACE_ASSERT(tracer != nullptr);
+
+    std::stringstream stream;
+    stream << "{\"ph\":\"X\", \"pid\":\"" <<
+      utils::GetPid() << "\", \"tid\":\"" << utils::GetTid() <<
+      "\", \"name\":\"Stall: " << name <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
+      ", \"cname\":\"terrible\"" <<
+      ", \"args\": {\"id\": \"" << id << "\"}"
+      "}," << std::endl;
+
+    FTRACE_ASSERT(tracer->chrome_logger_ != nullptr);
+    tracer->chrome_logger_->Log(stream.str());
+  }
+
+  static void ChromeMemoryCallback(
+      void* data, const void* device, const uint64_t* live_bytes) {
+    UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
+    FTRACE_ASSERT(tracer != nullptr);
+    FTRACE_ASSERT(live_bytes != nullptr);
+
+    std::stringstream stream;
+    stream << "{\"ph\":\"C\", \"pid\":\"" << utils::GetPid() <<
+      "\", \"name\":\"Memory: " << MemoryTracker::GetDeviceName(device) <<
+      "\", \"ts\": " << GetMicroseconds(tracer->correlator_.GetTimestamp()) <<
+      ", \"args\": {";
+    for (uint32_t type = 0; type < MEMORY_TYPE_COUNT; ++type) {
+      if (type > 0) {
+        stream << ", ";
+      }
+      stream << "\"" <<
+        MemoryTracker::GetTypeName(static_cast<MemoryType>(type)) <<
+        "\": " << live_bytes[type];
+    }
+    stream << "}}," << std::endl;
+
+    FTRACE_ASSERT(tracer->chrome_logger_ != nullptr);
+    tracer->chrome_logger_->Log(stream.str());
+  }
+
+  static void ChromeIterationCallback(
+      void* data, uint64_t iteration, uint64_t timestamp) {
+    UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
+    FTRACE_ASSERT(tracer != nullptr);
+
+    std::stringstream stream;
+    stream << "{\"ph\":\"i\", \"pid\":\"" <<
+      utils::GetPid() << "\", \"tid\":\"" << utils::GetTid() <<
+      "\", \"name\":\"Iteration " << iteration <<
+      "\", \"ts\": " << GetMicroseconds(timestamp) <<
+      ", \"s\":\"p\"" <<
+      "}," << std::endl;
+
+    FTRACE_ASSERT(tracer->chrome_logger_ != nullptr);
+    tracer->chrome_logger_->Log(stream.str());
+  }
+
   static void ZeChromeLoggingCallback(
       void* data, const std::string& id, const std::string& name,
       uint64_t started, uint64_t ended) {
@@ -1142,13 +2177,25 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" <<
       utils::GetPid() << "\", \"tid\":\"" << utils::GetTid() <<
       "\", \"name\":\"" << name <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
 
     FTRACE_ASSERT(tracer->chrome_logger_ != nullptr);
     tracer->chrome_logger_->Log(stream.str());
+
+    if (tracer->IsChromeFlowEnabled()) {
+      std::stringstream id_stream(id);
+      std::string item;
+      while (std::getline(id_stream, item, ',')) {
+        if (item.find('.') != std::string::npos) { // Particular submission
+          tracer->LogChromeFlow(
+              "s", "L0", item, std::to_string(utils::GetTid()),
+              GetMicroseconds(started));
+        }
+      }
+    }
   }
 
   static void ClChromeLoggingCallback(
@@ -1161,13 +2208,19 @@ class UnifiedTracer {
     stream << "{\"ph\":\"X\", \"pid\":\"" <<
       utils::GetPid() << "\", \"tid\":\"" << utils::GetTid() <<
       "\", \"name\":\"" << name <<
-      "\", \"ts\": " << started / NSEC_IN_USEC <<
-      ", \"dur\":" << (ended - started) / NSEC_IN_USEC <<
+      "\", \"ts\": " << GetMicroseconds(started) <<
+      ", \"dur\":" << GetMicroseconds(ended - started) <<
       ", \"args\": {\"id\": \"" << id << "\"}"
       "}," << std::endl;
 
     FTRACE_ASSERT(tracer->chrome_logger_ != nullptr);
     tracer->chrome_logger_->Log(stream.str());
+
+    if (id > 0 && tracer->IsChromeFlowEnabled()) {
+      tracer->LogChromeFlow(
+          "s", "CL", std::to_string(id), std::to_string(utils::GetTid()),
+          GetMicroseconds(started));
+    }
   }
 
  private:
@@ -1186,6 +2239,17 @@ class UnifiedTracer {
 
   std::string chrome_trace_file_name_;
   Logger* chrome_logger_ = nullptr;
+
+  ControlChannel* control_channel_ = nullptr;
+  std::vector<CollectionWindow> windows_;
+  std::mutex window_lock_;
+  bool control_used_ = false;
+
+  static const uint32_t kNameLength = 10;
+  static const uint32_t kHookLength = 24;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 10;
 };
 
 #endif // FTRACE_TOOLS_FINETRACE_UNIFIED_TRACER_H_
\ No newline at end of file
@@ -0,0 +1,4 @@
+#include "alloc_index.h"
+
+std::shared_timed_mutex AllocIndex::lock_;
+std::map<uintptr_t, AllocRange> AllocIndex::range_map_;
@@ -0,0 +1,103 @@
+#ifndef FTRACE_TOOLS_UTILS_ALLOC_INDEX_H_
+#define FTRACE_TOOLS_UTILS_ALLOC_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+
+#include "finetrace_assert.h"
+
+enum AllocType {
+  ALLOC_TYPE_UNKNOWN = 0, // Not a USM allocation, e.g. malloc'ed memory
+  ALLOC_TYPE_HOST,
+  ALLOC_TYPE_DEVICE,
+  ALLOC_TYPE_SHARED
+};
+
+struct AllocRange {
+  uintptr_t base;
+  size_t size;
+  AllocType type;
+  const void* device; // nullptr for host allocations
+  const void* context;
+};
+
+// Process-wide index of live USM allocations (Level Zero and OpenCL(TM)
+// Intel extensions) ordered by base address, so the allocation holding
+// any pointer is found in O(log n) without calling into the driver.
+// Lookups take shared lock, allocation and free take exclusive one
+class AllocIndex {
+ public: // User Interface
+  static void Add(
+      const void* ptr, size_t size, AllocType type,
+      const void* device, const void* context) {
+    FTRACE_ASSERT(ptr != nullptr);
+    uintptr_t base = reinterpret_cast<uintptr_t>(ptr);
+    AllocRange range{base, (size > 0) ? size : 1, type, device, context};
+    std::unique_lock<std::shared_timed_mutex> lock(lock_);
+    range_map_[base] = range;
+  }
+
+  // Returns false if the pointer is not a base of live allocation
+  static bool Remove(const void* ptr, AllocRange* range = nullptr) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(ptr);
+    std::unique_lock<std::shared_timed_mutex> lock(lock_);
+    auto it = range_map_.find(base);
+    if (it == range_map_.end()) {
+      return false;
+    }
+    if (range != nullptr) {
+      *range = it->second;
+    }
+    range_map_.erase(it);
+    return true;
+  }
+
+  // Looks for the allocation containing the pointer
+  static bool Find(const void* ptr, AllocRange* range) {
+    FTRACE_ASSERT(range != nullptr);
+    uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+    std::shared_lock<std::shared_timed_mutex> lock(lock_);
+    auto it = range_map_.upper_bound(address);
+    if (it == range_map_.begin()) {
+      return false;
+    }
+    --it;
+    if (address - it->second.base >= it->second.size) {
+      return false;
+    }
+    *range = it->second;
+    return true;
+  }
+
+  static AllocType GetType(const void* ptr) {
+    AllocRange range{};
+    if (!Find(ptr, &range)) {
+      return ALLOC_TYPE_UNKNOWN;
+    }
+    return range.type;
+  }
+
+  // Letters used in transfer names, e.g. zeCommandListAppendMemoryCopy(D2H)
+  static char GetTypeLetter(AllocType type) {
+    switch (type) {
+      case ALLOC_TYPE_HOST:
+        return 'H';
+      case ALLOC_TYPE_DEVICE:
+        return 'D';
+      case ALLOC_TYPE_SHARED:
+        return 'S';
+      default:
+        break;
+    }
+    return 'M';
+  }
+
+ private: // Data
+  static std::shared_timed_mutex lock_;
+  static std::map<uintptr_t, AllocRange> range_map_;
+};
+
+#endif // FTRACE_TOOLS_UTILS_ALLOC_INDEX_H_
@@ -12,6 +12,12 @@
 #include "utils.h"
 
 #define CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE_KHR 0x2033
+#define CL_KERNEL_SPILL_MEM_SIZE_INTEL               0x4109
+#define CL_KERNEL_COMPILE_SUB_GROUP_SIZE_INTEL       0x410A
+#define CL_DEVICE_NUM_SLICES_INTEL                   0x4252
+#define CL_DEVICE_NUM_SUB_SLICES_PER_SLICE_INTEL     0x4253
+#define CL_DEVICE_NUM_EUS_PER_SUB_SLICE_INTEL        0x4254
+#define CL_DEVICE_NUM_THREADS_PER_EU_INTEL           0x4255
 
 namespace utils {
 namespace cl {
@@ -312,6 +318,103 @@ inline size_t GetKernelSimdWidth(cl_device_id device, cl_kernel kernel) {
   return simd_width;
 }
 
+// Zero if the device does not support cl_intel_device_attribute_query
+inline cl_uint GetDeviceAttribute(cl_device_id device, cl_device_info param) {
+  FTRACE_ASSERT(device != nullptr);
+  if (!CheckExtension(device, "cl_intel_device_attribute_query")) {
+    return 0;
+  }
+
+  cl_uint value = 0;
+  cl_int status = clGetDeviceInfo(
+      device, param, sizeof(cl_uint), &value, nullptr);
+  if (status != CL_SUCCESS) {
+    return 0;
+  }
+  return value;
+}
+
+// Zero if the value is not supported by the device
+inline cl_ulong GetKernelMemorySize(
+    cl_device_id device, cl_kernel kernel,
+    cl_kernel_work_group_info param) {
+  FTRACE_ASSERT(device != nullptr && kernel != nullptr);
+  cl_ulong size = 0;
+  cl_int status = clGetKernelWorkGroupInfo(
+      kernel, device, param, sizeof(cl_ulong), &size, nullptr);
+  if (status != CL_SUCCESS) {
+    return 0;
+  }
+  return size;
+}
+
+// Zero if the kernel has no required subgroup size
+inline size_t GetKernelRequiredSubgroupSize(
+    cl_device_id device, cl_kernel kernel) {
+  FTRACE_ASSERT(device != nullptr && kernel != nullptr);
+  cl_int status = CL_SUCCESS;
+
+  if (!CheckExtension(device, "cl_intel_required_subgroup_size")) {
+    return 0;
+  }
+
+  typedef cl_int (*clGetKernelSubGroupInfoKHR)(
+      cl_kernel kernel, cl_device_id device,
+      cl_kernel_sub_group_info param_name, size_t input_value_size,
+      const void* input_value, size_t param_value_size,
+      void* param_value, size_t* param_value_size_ret);
+
+  cl_platform_id platform = nullptr;
+  status = clGetDeviceInfo(
+      device, CL_DEVICE_PLATFORM, sizeof(cl_platform_id), &platform, nullptr);
+  FTRACE_ASSERT(status == CL_SUCCESS);
+  FTRACE_ASSERT(platform != nullptr);
+
+  clGetKernelSubGroupInfoKHR func =
+    reinterpret_cast<clGetKernelSubGroupInfoKHR>(
+        clGetExtensionFunctionAddressForPlatform(
+            platform, "clGetKernelSubGroupInfoKHR"));
+  if (func == nullptr) {
+    return 0;
+  }
+
+  size_t subgroup_size = 0;
+  status = func(
+      kernel, device, CL_KERNEL_COMPILE_SUB_GROUP_SIZE_INTEL,
+      0, nullptr, sizeof(size_t), &subgroup_size, nullptr);
+  if (status != CL_SUCCESS) {
+    return 0;
+  }
+
+  return subgroup_size;
+}
+
+inline std::string GetProgramBuildOptions(
+    cl_device_id device, cl_kernel kernel) {
+  FTRACE_ASSERT(device != nullptr && kernel != nullptr);
+
+  cl_program program = nullptr;
+  cl_int status = clGetKernelInfo(
+      kernel, CL_KERNEL_PROGRAM, sizeof(cl_program), &program, nullptr);
+  FTRACE_ASSERT(status == CL_SUCCESS);
+  FTRACE_ASSERT(program != nullptr);
+
+  size_t size = 0;
+  status = clGetProgramBuildInfo(
+      program, device, CL_PROGRAM_BUILD_OPTIONS, 0, nullptr, &size);
+  if (status != CL_SUCCESS || size == 0) {
+    return std::string();
+  }
+
+  std::vector<char> options(size, '\0');
+  status = clGetProgramBuildInfo(
+      program, device, CL_PROGRAM_BUILD_OPTIONS, size,
+      options.data(), nullptr);
+  FTRACE_ASSERT(status == CL_SUCCESS);
+
+  return options.data();
+}
+
 inline cl_command_queue GetCommandQueue(cl_event event) {
   FTRACE_ASSERT(event != nullptr);
 
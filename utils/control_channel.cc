@@ -0,0 +1,5 @@
+#include "control_channel.h"
+
+#if !defined(_WIN32)
+volatile sig_atomic_t ControlChannel::notify_fd_ = -1;
+#endif
\ No newline at end of file
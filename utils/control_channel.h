@@ -0,0 +1,262 @@
+#ifndef FTRACE_TOOLS_UTILS_CONTROL_CHANNEL_H_
+#define FTRACE_TOOLS_UTILS_CONTROL_CHANNEL_H_
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "finetrace_assert.h"
+
+enum ControlCommand {
+  CONTROL_COMMAND_START = 0,
+  CONTROL_COMMAND_STOP = 1,
+  CONTROL_COMMAND_MARK = 2
+};
+
+typedef void (*OnControlCommandCallback)(
+    void* data, ControlCommand command, const std::string& label);
+
+// Delivers start/stop/mark requests coming from outside of the process:
+// SIGUSR1 starts and SIGUSR2 stops collection, while the named FIFO
+// accepts "start", "stop" and "mark <label>" lines. Signal handlers only
+// write a byte into the internal pipe, all the processing is done by
+// the channel thread
+class ControlChannel {
+ public: // User Interface
+  static ControlChannel* Create(
+      bool use_signals, const std::string& fifo_name,
+      OnControlCommandCallback callback, void* callback_data) {
+    FTRACE_ASSERT(callback != nullptr);
+#if defined(_WIN32)
+    std::cerr << "[WARNING] Control channel is not supported on Windows" <<
+      std::endl;
+    return nullptr;
+#else
+    ControlChannel* channel = new ControlChannel(callback, callback_data);
+    FTRACE_ASSERT(channel != nullptr);
+
+    int status = pipe(channel->notify_pipe_);
+    FTRACE_ASSERT(status == 0);
+    for (int i = 0; i < 2; ++i) {
+      status = fcntl(channel->notify_pipe_[i], F_SETFD, FD_CLOEXEC);
+      FTRACE_ASSERT(status == 0);
+    }
+    status = fcntl(channel->notify_pipe_[1], F_SETFL, O_NONBLOCK);
+    FTRACE_ASSERT(status == 0);
+
+    if (!fifo_name.empty()) {
+      if (!channel->OpenFifo(fifo_name)) {
+        std::cerr << "[WARNING] Unable to open control FIFO " <<
+          fifo_name << std::endl;
+      }
+    }
+
+    channel->thread_ = std::thread(&ControlChannel::Run, channel);
+
+    if (use_signals) {
+      channel->EnableSignals();
+    }
+
+    return channel;
+#endif
+  }
+
+  ~ControlChannel() {
+#if !defined(_WIN32)
+    DisableSignals();
+
+    if (thread_.joinable()) {
+      char command = kQuitCommand;
+      ssize_t size = write(notify_pipe_[1], &command, sizeof(command));
+      FTRACE_ASSERT(size == sizeof(command));
+      thread_.join();
+    }
+
+    if (fifo_ >= 0) {
+      close(fifo_);
+      if (fifo_created_) {
+        unlink(fifo_name_.c_str());
+      }
+    }
+    for (int i = 0; i < 2; ++i) {
+      if (notify_pipe_[i] >= 0) {
+        close(notify_pipe_[i]);
+      }
+    }
+#endif
+  }
+
+  ControlChannel(const ControlChannel& copy) = delete;
+  ControlChannel& operator=(const ControlChannel& copy) = delete;
+
+ private: // Implementation
+  ControlChannel(OnControlCommandCallback callback, void* callback_data)
+      : callback_(callback), callback_data_(callback_data) {}
+
+#if !defined(_WIN32)
+  bool OpenFifo(const std::string& fifo_name) {
+    int status = mkfifo(fifo_name.c_str(), S_IRUSR | S_IWUSR);
+    if (status != 0 && errno != EEXIST) {
+      return false;
+    }
+    fifo_created_ = (status == 0);
+    fifo_name_ = fifo_name;
+
+    // Opening for both reading and writing keeps the FIFO alive after
+    // the external writer closes it, so poll() never reports POLLHUP
+    fifo_ = open(fifo_name.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fifo_ < 0) {
+      if (fifo_created_) {
+        unlink(fifo_name.c_str());
+        fifo_created_ = false;
+      }
+      return false;
+    }
+    return true;
+  }
+
+  void EnableSignals() {
+    FTRACE_ASSERT(notify_fd_ < 0);
+    notify_fd_ = notify_pipe_[1];
+
+    struct sigaction action{};
+    action.sa_handler = SignalHandler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    int status = sigaction(SIGUSR1, &action, &prev_start_action_);
+    FTRACE_ASSERT(status == 0);
+    status = sigaction(SIGUSR2, &action, &prev_stop_action_);
+    FTRACE_ASSERT(status == 0);
+    signals_enabled_ = true;
+  }
+
+  void DisableSignals() {
+    if (!signals_enabled_) {
+      return;
+    }
+    int status = sigaction(SIGUSR1, &prev_start_action_, nullptr);
+    FTRACE_ASSERT(status == 0);
+    status = sigaction(SIGUSR2, &prev_stop_action_, nullptr);
+    FTRACE_ASSERT(status == 0);
+    notify_fd_ = -1;
+    signals_enabled_ = false;
+  }
+
+  static void SignalHandler(int signal) {
+    int saved_errno = errno;
+    char command = (signal == SIGUSR1) ? kStartCommand : kStopCommand;
+    if (notify_fd_ >= 0) {
+      ssize_t size = write(notify_fd_, &command, sizeof(command));
+      (void)size;
+    }
+    errno = saved_errno;
+  }
+
+  void Run() {
+    pollfd fds[2];
+    fds[0] = {notify_pipe_[0], POLLIN, 0};
+    fds[1] = {fifo_, POLLIN, 0};
+    nfds_t count = (fifo_ >= 0) ? 2 : 1;
+
+    while (true) {
+      int status = poll(fds, count, -1);
+      if (status < 0) {
+        FTRACE_ASSERT(errno == EINTR);
+        continue;
+      }
+
+      if (fds[0].revents & POLLIN) {
+        char buffer[kBufferSize];
+        ssize_t size = read(notify_pipe_[0], buffer, sizeof(buffer));
+        for (ssize_t i = 0; i < size; ++i) {
+          if (buffer[i] == kQuitCommand) {
+            return;
+          } else if (buffer[i] == kStartCommand) {
+            callback_(callback_data_, CONTROL_COMMAND_START, std::string());
+          } else if (buffer[i] == kStopCommand) {
+            callback_(callback_data_, CONTROL_COMMAND_STOP, std::string());
+          }
+        }
+      }
+
+      if (count > 1 && (fds[1].revents & POLLIN)) {
+        ReadFifo();
+      }
+    }
+  }
+
+  void ReadFifo() {
+    char buffer[kBufferSize];
+    ssize_t size = 0;
+    while ((size = read(fifo_, buffer, sizeof(buffer))) > 0) {
+      fifo_data_.append(buffer, size);
+    }
+
+    size_t pos = 0;
+    while ((pos = fifo_data_.find('\n')) != std::string::npos) {
+      ProcessLine(fifo_data_.substr(0, pos));
+      fifo_data_.erase(0, pos + 1);
+    }
+  }
+
+  void ProcessLine(std::string line) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+
+    std::string command = line.substr(0, line.find(' '));
+    std::string label;
+    if (command.size() < line.size()) {
+      label = line.substr(command.size() + 1);
+    }
+
+    if (command == "start") {
+      callback_(callback_data_, CONTROL_COMMAND_START, label);
+    } else if (command == "stop") {
+      callback_(callback_data_, CONTROL_COMMAND_STOP, label);
+    } else if (command == "mark") {
+      callback_(callback_data_, CONTROL_COMMAND_MARK, label);
+    } else if (!command.empty()) {
+      std::cerr << "[WARNING] Unknown control command: " << line <<
+        std::endl;
+    }
+  }
+#endif
+
+ private: // Data
+  OnControlCommandCallback callback_ = nullptr;
+  void* callback_data_ = nullptr;
+
+  std::thread thread_;
+
+#if !defined(_WIN32)
+  int notify_pipe_[2] = {-1, -1};
+  int fifo_ = -1;
+  bool fifo_created_ = false;
+  std::string fifo_name_;
+  std::string fifo_data_;
+
+  bool signals_enabled_ = false;
+  struct sigaction prev_start_action_{};
+  struct sigaction prev_stop_action_{};
+
+  static volatile sig_atomic_t notify_fd_;
+#endif
+
+  static const char kStartCommand = 's';
+  static const char kStopCommand = 'p';
+  static const char kQuitCommand = 'q';
+  static const size_t kBufferSize = 256;
+};
+
+#endif // FTRACE_TOOLS_UTILS_CONTROL_CHANNEL_H_
@@ -1,3 +1,6 @@
 #include "correlator.h"
 
-thread_local uint64_t Correlator::kernel_id_ = 0;
\ No newline at end of file
+thread_local uint64_t Correlator::kernel_id_ = 0;
+thread_local uint64_t Correlator::call_id_ = 0;
+thread_local std::vector<ApiCallFrame> Correlator::api_call_stack_;
+thread_local ApiCallThreadTree* Correlator::api_call_tree_ = nullptr;
\ No newline at end of file
@@ -1,13 +1,19 @@
 #ifndef FTRACE_TOOLS_UTILS_CORRELATOR_H_
 #define FTRACE_TOOLS_UTILS_CORRELATOR_H_
 
+#include <string.h>
+
+#include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #ifdef FTRACE_LEVEL_ZERO
 #include <level_zero/ze_api.h>
 #endif // FTRACE_LEVEL_ZERO
 
+#include "host_clock.h"
 #include "logger.h"
 #include "finetrace_assert.h"
 #include "utils.h"
@@ -17,26 +23,84 @@ struct ApiCollectorOptions {
   bool need_tid = false;
   bool need_pid = false;
   bool demangle = false;
+  bool raw_time = false;
+};
+
+struct ApiCallFrame {
+  const char* name;
+  uint64_t start;
+  uint64_t nested_time;
+  bool nested;
+};
+
+// Per-thread call tree is keyed on function name pointers and is merged
+// by names only at report time
+struct ApiCallThreadNode {
+  uint64_t inclusive_time = 0;
+  uint64_t exclusive_time = 0;
+  uint64_t call_count = 0;
+  std::map<const char*, std::unique_ptr<ApiCallThreadNode> > children;
+};
+
+struct ApiCallThreadTree {
+  std::mutex lock; // Contended by the report only
+  ApiCallThreadNode root;
+};
+
+struct ApiCallNode {
+  uint64_t inclusive_time = 0;
+  uint64_t exclusive_time = 0;
+  uint64_t call_count = 0;
+  std::map<std::string, std::unique_ptr<ApiCallNode> > children;
 };
 
 struct KernelCollectorOptions {
   bool verbose = false;
   bool demangle = false;
   bool kernels_per_tile = false;
+  bool drill_down = false;
+  bool steady_state = false;
+  uint32_t warm_up_count = 0;
+  bool iterations = false;
+  bool memory = false;
+  bool transfers = false;
+  bool transfer_advice = false;
+  bool object_churn = false;
+  bool module_builds = false;
+  bool kernel_resources = false;
+  bool occupancy = false;
+  bool tile_balance = false;
+  bool scaling = false;
+  bool host_stalls = false;
+  bool critical_path = false;
+  bool record_graph = false;
+  bool utilization = false;
+  bool engine_on_device = false;
 };
 
 class Correlator {
  public:
   Correlator(const std::string& log_file, bool conditional_collection)
       : logger_(log_file), conditional_collection_(conditional_collection),
-        base_time_(utils::GetSystemTime()) {}
+        base_time_(clock_.GetTime()) {
+    bool enabled = true;
+    if (conditional_collection_) {
+      std::string value = utils::GetEnv("FTRACE_ENABLE_COLLECTION");
+      enabled = !(value.empty() || value == "0");
+    }
+    collection_enabled_.store(enabled, std::memory_order_release);
+  }
 
   void Log(const std::string& text) {
     logger_.Log(text);
   }
 
+  uint64_t GetLoggedBytes() const {
+    return logger_.GetLoggedBytes();
+  }
+
   uint64_t GetTimestamp() const {
-    return utils::GetSystemTime() - base_time_;
+    return clock_.GetTime() - base_time_;
   }
 
   uint64_t GetTimestamp(uint64_t timestamp) const {
@@ -56,14 +120,73 @@ class Correlator {
     kernel_id_ = kernel_id;
   }
 
+  // Non-zero for the kernels appended into immediate command lists only
+  uint64_t GetCallId() const {
+    return call_id_;
+  }
+
+  void SetCallId(uint64_t call_id) {
+    call_id_ = call_id;
+  }
+
   bool IsCollectionEnabled() const {
-    if (conditional_collection_) {
-      std::string enabled = utils::GetEnv("FTRACE_ENABLE_COLLECTION");
-      if (enabled.empty() || enabled == "0") {
-        return false;
-      }
+    return collection_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Returns previous state, so callers are able to detect real transitions
+  bool SetCollectionEnabled(bool enabled) {
+    return collection_enabled_.exchange(enabled, std::memory_order_acq_rel);
+  }
+
+  // Per-thread shadow stack of API calls shared by all the API collectors,
+  // so calls made from inside other traced calls get their parents
+  void EnterApiCall(const char* name, uint64_t start) {
+    FTRACE_ASSERT(name != nullptr);
+    api_call_stack_.push_back({name, start, 0, false});
+  }
+
+  // Returns the time of traced calls made from inside of the call (not
+  // greater than the call time), so callers are able to count exclusive
+  // time only
+  uint64_t ExitApiCall(const char* name, uint64_t end) {
+    FTRACE_ASSERT(name != nullptr);
+
+    // Frames left by calls without exit callback are dropped
+    size_t depth = api_call_stack_.size();
+    while (depth > 0 && strcmp(api_call_stack_[depth - 1].name, name) != 0) {
+      --depth;
+    }
+    if (depth == 0) {
+      return 0;
+    }
+    api_call_stack_.resize(depth);
+
+    ApiCallFrame frame = api_call_stack_.back();
+    api_call_stack_.pop_back();
+
+    uint64_t time = (end > frame.start) ? end - frame.start : 0;
+    if (!api_call_stack_.empty()) {
+      api_call_stack_.back().nested_time += time;
+      api_call_stack_.back().nested = true;
+    } else if (!frame.nested) {
+      // Top-level calls without nested ones are covered by flat tables
+      return 0;
     }
-    return true;
+
+    AddApiCallPath(frame, time);
+    return (frame.nested_time < time) ? frame.nested_time : time;
+  }
+
+  // Root node has no stats, its children are top-level calls having
+  // traced calls inside
+  ApiCallNode GetApiCallTree() {
+    ApiCallNode root;
+    const std::lock_guard<std::mutex> lock(api_call_lock_);
+    for (auto& tree : api_call_tree_list_) {
+      const std::lock_guard<std::mutex> tree_lock(tree->lock);
+      MergeApiCallNode(&root, tree->root);
+    }
+    return root;
   }
 
 #ifdef FTRACE_LEVEL_ZERO
@@ -131,10 +254,63 @@ class Correlator {
 #endif // FTRACE_LEVEL_ZERO
 
  private:
+  void AddApiCallPath(const ApiCallFrame& frame, uint64_t time) {
+    if (api_call_tree_ == nullptr) {
+      api_call_tree_ = new ApiCallThreadTree;
+      const std::lock_guard<std::mutex> lock(api_call_lock_);
+      api_call_tree_list_.emplace_back(api_call_tree_);
+    }
+
+    const std::lock_guard<std::mutex> lock(api_call_tree_->lock);
+    ApiCallThreadNode* node = &api_call_tree_->root;
+    for (const ApiCallFrame& parent : api_call_stack_) {
+      node = GetApiCallChild(node, parent.name);
+    }
+    node = GetApiCallChild(node, frame.name);
+    node->inclusive_time += time;
+    node->exclusive_time +=
+      (time > frame.nested_time) ? time - frame.nested_time : 0;
+    ++node->call_count;
+  }
+
+  static ApiCallThreadNode* GetApiCallChild(
+      ApiCallThreadNode* node, const char* name) {
+    FTRACE_ASSERT(node != nullptr);
+    std::unique_ptr<ApiCallThreadNode>& child = node->children[name];
+    if (child == nullptr) {
+      child.reset(new ApiCallThreadNode);
+    }
+    return child.get();
+  }
+
+  static void MergeApiCallNode(
+      ApiCallNode* target, const ApiCallThreadNode& source) {
+    FTRACE_ASSERT(target != nullptr);
+    for (auto& value : source.children) {
+      std::unique_ptr<ApiCallNode>& child = target->children[value.first];
+      if (child == nullptr) {
+        child.reset(new ApiCallNode);
+      }
+      child->inclusive_time += value.second->inclusive_time;
+      child->exclusive_time += value.second->exclusive_time;
+      child->call_count += value.second->call_count;
+      MergeApiCallNode(child.get(), *value.second);
+    }
+  }
+
+ private:
+  HostClock clock_;
   uint64_t base_time_;
   Logger logger_;
   bool conditional_collection_;
+  std::atomic<bool> collection_enabled_{true};
   static thread_local uint64_t kernel_id_;
+  static thread_local uint64_t call_id_;
+
+  static thread_local std::vector<ApiCallFrame> api_call_stack_;
+  static thread_local ApiCallThreadTree* api_call_tree_;
+  std::vector< std::unique_ptr<ApiCallThreadTree> > api_call_tree_list_;
+  std::mutex api_call_lock_;
 #ifdef FTRACE_LEVEL_ZERO
   std::map<ze_command_list_handle_t, std::vector<uint64_t> > kernel_id_map_;
   std::map<ze_command_list_handle_t, std::vector<uint64_t> > call_id_map_;
@@ -0,0 +1,474 @@
+#ifndef FTRACE_TOOLS_UTILS_DEPENDENCY_GRAPH_H_
+#define FTRACE_TOOLS_UTILS_DEPENDENCY_GRAPH_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "exec_graph.h"
+#include "finetrace_assert.h"
+#include "utils.h"
+
+struct DependencyNode {
+  std::string name;
+  const void* queue = nullptr;
+  uint64_t submitted = 0;
+  uint64_t start = 0;
+  uint64_t end = 0;
+  bool completed = false;
+  bool join = false;
+  std::vector<size_t> pred_list;
+  std::vector<size_t> event_pred_list;
+};
+
+struct CriticalPathInfo {
+  uint64_t call_count;
+  uint64_t total_time;
+  uint64_t path_time;
+  uint64_t path_count;
+  uint64_t total_slack;
+  uint64_t min_slack;
+
+  bool operator>(const CriticalPathInfo& r) const {
+    if (path_time != r.path_time) {
+      return path_time > r.path_time;
+    }
+    return total_time > r.total_time;
+  }
+
+  bool operator!=(const CriticalPathInfo& r) const {
+    if (path_time == r.path_time) {
+      return total_time != r.total_time;
+    }
+    return true;
+  }
+};
+
+using CriticalPathInfoMap = std::map<std::string, CriticalPathInfo>;
+
+// Nodes are added in submission order, so each edge goes from a lower index
+// to a higher one and node order is a topological order. Commands of one
+// submission to a queue are unordered unless separated by a barrier, while
+// submissions to the same queue are executed in order. Commands of an
+// in-order command list are to be added as barriers. Host synchronization
+// (fences, events, queue synchronize) is not an edge: a submission made
+// after a host wait depends only on its queue and wait events. To keep
+// memory bounded, the oldest nodes are analyzed and retired by windows
+// together with signal events and queue states referring only to them,
+// see SetWindowSize. Not thread-safe, the owner is responsible for locking
+class DependencyGraph {
+ public: // User Interface
+  static const size_t kNoNode = SIZE_MAX;
+  static const size_t kWindowSize = 65536;
+
+  DependencyGraph() = default;
+
+  DependencyGraph(const DependencyGraph& copy) = delete;
+  DependencyGraph& operator=(const DependencyGraph& copy) = delete;
+
+  // Zero window keeps all the nodes, e.g. to export the whole graph
+  void SetWindowSize(size_t window_size) {
+    FTRACE_ASSERT(base_ == 0);
+    window_size_ = window_size;
+  }
+
+  // Commands submitted later depend on all the commands submitted before
+  void BeginSubmission(const void* queue) {
+    FTRACE_ASSERT(queue != nullptr);
+    QueueState& state = queue_map_[queue];
+    if (state.scope.size() == 1) {
+      state.fence = state.scope.front();
+    } else if (state.scope.size() > 1) { // Join to keep edge count linear
+      state.fence = base_ + node_list_.size();
+      node_list_.emplace_back();
+      node_list_.back().join = true;
+      node_list_.back().queue = queue;
+      node_list_.back().pred_list.swap(state.scope);
+    }
+    state.scope.clear();
+  }
+
+  size_t AddNode(
+      const void* queue, uint64_t submitted, const void* signal_event,
+      const std::vector<const void*>& wait_event_list, bool barrier) {
+    FTRACE_ASSERT(queue != nullptr);
+    RetireNodes();
+    size_t node = base_ + node_list_.size();
+    node_list_.emplace_back();
+    node_list_.back().queue = queue;
+    node_list_.back().submitted = submitted;
+    std::vector<size_t>& pred_list = node_list_.back().pred_list;
+    std::vector<size_t>& event_pred_list = node_list_.back().event_pred_list;
+
+    for (const void* event : wait_event_list) {
+      auto it = signaler_map_.find(event);
+      if (it != signaler_map_.end()) {
+        event_pred_list.push_back(it->second);
+      }
+    }
+    std::sort(event_pred_list.begin(), event_pred_list.end());
+    event_pred_list.erase(
+        std::unique(event_pred_list.begin(), event_pred_list.end()),
+        event_pred_list.end());
+    pred_list = event_pred_list;
+
+    QueueState& state = queue_map_[queue];
+    if (state.fence != kNoNode) {
+      pred_list.push_back(state.fence);
+    }
+    if (barrier) {
+      pred_list.insert(
+          pred_list.end(), state.scope.begin(), state.scope.end());
+      state.scope.clear();
+      state.fence = node;
+    } else {
+      state.scope.push_back(node);
+    }
+
+    std::sort(pred_list.begin(), pred_list.end());
+    pred_list.erase(
+        std::unique(pred_list.begin(), pred_list.end()), pred_list.end());
+
+    if (signal_event != nullptr) {
+      signaler_map_[signal_event] = node;
+    }
+    return node;
+  }
+
+  // Nodes retired before completion are skipped
+  void CompleteNode(
+      size_t node, const std::string& name, uint64_t start, uint64_t end) {
+    FTRACE_ASSERT(node < base_ + node_list_.size());
+    FTRACE_ASSERT(start <= end);
+    if (node < base_) {
+      return;
+    }
+    DependencyNode& info = node_list_[node - base_];
+    FTRACE_ASSERT(!info.join);
+    info.name = name;
+    info.start = start;
+    info.end = end;
+    info.completed = true;
+  }
+
+  // Waits are needed only for export, which keeps all the nodes
+  void AddHostWait(uint64_t start, uint64_t end) {
+    FTRACE_ASSERT(start <= end);
+    if (window_size_ == 0) {
+      wait_list_.push_back({start, end});
+    }
+  }
+
+  // Event is reset or destroyed, so later waits on it are for new signals
+  void RemoveEvent(const void* event) {
+    signaler_map_.erase(event);
+  }
+
+  // Queue is destroyed, its handle may be reused for a new one
+  void RemoveQueue(const void* queue) {
+    queue_map_.erase(queue);
+  }
+
+  size_t GetNodeCount() const {
+    return base_ + node_list_.size();
+  }
+
+  // Activities not collected are exported as joins to keep the ordering
+  void Export(ExecGraph* graph, const std::string& backend) const {
+    FTRACE_ASSERT(graph != nullptr);
+    FTRACE_ASSERT(base_ == 0);
+    size_t offset = graph->GetNodeCount();
+
+    for (const DependencyNode& node : node_list_) {
+      ExecGraphNode exported;
+      exported.join = !node.completed;
+      for (size_t pred : node.pred_list) {
+        if (exported.join || !std::binary_search(
+                node.event_pred_list.begin(),
+                node.event_pred_list.end(), pred)) {
+          exported.order_pred_list.push_back(pred + offset);
+        }
+      }
+
+      if (!exported.join) {
+        for (size_t pred : node.event_pred_list) {
+          exported.event_pred_list.push_back(pred + offset);
+        }
+        std::stringstream queue;
+        queue << backend << ":" << node.queue;
+        exported.queue = queue.str();
+        exported.name = node.name;
+        exported.submitted = node.submitted;
+        exported.start = node.start;
+        exported.end = node.end;
+      }
+      graph->AddNode(exported);
+    }
+
+    for (const ExecGraphWait& wait : wait_list_) {
+      graph->AddWait(wait.start, wait.end);
+    }
+  }
+
+  // Critical path is traced back from the last finished activity through
+  // its latest finished predecessor. Slack is the time an activity could be
+  // delayed without moving the end of the last one. Joins and activities
+  // not collected are passed through with zero duration. Retired windows
+  // are analyzed on their own: the path of a window stops where the path
+  // of the previous ones ends and slack is bounded by the window end
+  CriticalPathInfoMap Analyze(uint64_t& span, uint64_t& path_time) const {
+    PathTotals totals = totals_;
+    AnalyzeWindow(node_list_.size(), totals);
+    span = (totals.last_end > totals.first_start) ?
+      totals.last_end - totals.first_start : 0;
+    path_time = totals.path_time;
+    return totals.info_map;
+  }
+
+  std::string GetCriticalPathTable() const {
+    uint64_t span = 0, path_time = 0;
+    CriticalPathInfoMap info_map = Analyze(span, path_time);
+    if (span == 0) {
+      return std::string();
+    }
+
+    std::set< std::pair<std::string, CriticalPathInfo>,
+              utils::Comparator > sorted_list(
+        info_map.begin(), info_map.end());
+
+    size_t max_name_length = kKernelLength;
+    for (auto& value : sorted_list) {
+      if (value.first.size() > max_name_length) {
+        max_name_length = value.first.size();
+      }
+    }
+
+    std::stringstream stream;
+    stream << "Device Span (ns): " << span <<
+      ", Critical Path Busy Time (ns): " << path_time <<
+      ", Critical Path (%): " << std::setprecision(2) << std::fixed <<
+      100.0f * path_time / span << std::endl;
+    if (base_ > 0) {
+      stream << "Analyzed by windows of " << window_size_ <<
+        " activities, " << base_ << " of " << GetNodeCount() <<
+        " retired" << std::endl;
+    }
+    stream << "Edges: queue order, barriers, in-order command lists and " <<
+      "wait events; host synchronization is not modeled" << std::endl;
+    stream << std::endl;
+
+    stream << std::setw(max_name_length) << "Kernel" << "," <<
+      std::setw(kCallsLength) << "Calls" << "," <<
+      std::setw(kTimeLength) << "Time (ns)" << "," <<
+      std::setw(kCallsLength) << "On Path" << "," <<
+      std::setw(kTimeLength) << "Path Time (ns)" << "," <<
+      std::setw(kPercentLength) << "Path (%)" << "," <<
+      std::setw(kTimeLength) << "Avg Slack (ns)" << "," <<
+      std::setw(kTimeLength) << "Min Slack (ns)" << std::endl;
+
+    for (auto& value : sorted_list) {
+      const CriticalPathInfo& info = value.second;
+      float path_percent = 100.0f * info.path_time / span;
+      stream << std::setw(max_name_length) << value.first << "," <<
+        std::setw(kCallsLength) << info.call_count << "," <<
+        std::setw(kTimeLength) << info.total_time << "," <<
+        std::setw(kCallsLength) << info.path_count << "," <<
+        std::setw(kTimeLength) << info.path_time << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) <<
+          std::fixed << path_percent << "," <<
+        std::setw(kTimeLength) << info.total_slack / info.call_count << "," <<
+        std::setw(kTimeLength) << info.min_slack << std::endl;
+    }
+
+    return stream.str();
+  }
+
+ private: // Implementation
+  struct QueueState {
+    size_t fence = kNoNode;
+    std::vector<size_t> scope;
+  };
+
+  struct PathTotals {
+    CriticalPathInfoMap info_map;
+    uint64_t first_start = UINT64_MAX;
+    uint64_t last_end = 0;
+    uint64_t path_time = 0;
+  };
+
+  // Oldest window is retired once two are collected, it ends before the
+  // first activity not completed yet unless four windows are collected
+  void RetireNodes() {
+    if (window_size_ == 0 || node_list_.size() < 2 * window_size_) {
+      return;
+    }
+
+    size_t count = 0;
+    while (count < window_size_ &&
+           (node_list_[count].completed || node_list_[count].join)) {
+      ++count;
+    }
+    if (count == 0) {
+      if (node_list_.size() < 4 * window_size_) {
+        return;
+      }
+      count = window_size_;
+    }
+
+    AnalyzeWindow(count, totals_);
+    node_list_.erase(node_list_.begin(), node_list_.begin() + count);
+    base_ += count;
+    PruneRetired();
+  }
+
+  // Edges to retired nodes are skipped anyway, so entries that lead only
+  // to them are dropped
+  void PruneRetired() {
+    for (auto it = signaler_map_.begin(); it != signaler_map_.end();) {
+      if (it->second < base_) {
+        it = signaler_map_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    for (auto it = queue_map_.begin(); it != queue_map_.end();) {
+      QueueState& state = it->second;
+      if (state.fence != kNoNode && state.fence < base_) {
+        state.fence = kNoNode;
+      }
+      state.scope.erase(
+          std::remove_if(
+              state.scope.begin(), state.scope.end(),
+              [this](size_t node) { return node < base_; }),
+          state.scope.end());
+      if (state.fence == kNoNode && state.scope.empty()) {
+        it = queue_map_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // Analyzes the first count nodes, edges to retired nodes are skipped
+  void AnalyzeWindow(size_t count, PathTotals& totals) const {
+    FTRACE_ASSERT(count <= node_list_.size());
+    std::vector<uint64_t> start(count, 0), end(count, 0);
+    std::vector<bool> valid(count, false);
+    std::vector< std::vector<size_t> > pred_list(count);
+
+    size_t sink = kNoNode;
+    uint64_t first_start = UINT64_MAX;
+    for (size_t i = 0; i < count; ++i) {
+      const DependencyNode& node = node_list_[i];
+      for (size_t pred : node.pred_list) {
+        if (pred >= base_) {
+          pred_list[i].push_back(pred - base_);
+        }
+      }
+
+      if (node.completed) {
+        start[i] = node.start;
+        end[i] = node.end;
+        valid[i] = true;
+        first_start = std::min(first_start, node.start);
+        if (sink == kNoNode || node.end > end[sink]) {
+          sink = i;
+        }
+      } else {
+        for (size_t pred : pred_list[i]) {
+          if (valid[pred]) {
+            end[i] = std::max(end[i], end[pred]);
+            valid[i] = true;
+          }
+        }
+        start[i] = end[i];
+      }
+    }
+    if (sink == kNoNode) {
+      return;
+    }
+    uint64_t last_end = end[sink];
+
+    std::vector<uint64_t> slack(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+      slack[i] = last_end - end[i];
+    }
+    for (size_t i = count; i > 0; --i) {
+      if (!valid[i - 1]) {
+        continue;
+      }
+      for (size_t pred : pred_list[i - 1]) {
+        if (!valid[pred]) {
+          continue;
+        }
+        uint64_t gap = (start[i - 1] > end[pred]) ?
+          start[i - 1] - end[pred] : 0;
+        slack[pred] = std::min(slack[pred], gap + slack[i - 1]);
+      }
+    }
+
+    CriticalPathInfoMap& info_map = totals.info_map;
+    for (size_t i = 0; i < count; ++i) {
+      const DependencyNode& node = node_list_[i];
+      if (!node.completed) {
+        continue;
+      }
+      uint64_t time = node.end - node.start;
+      if (info_map.count(node.name) == 0) {
+        info_map[node.name] = {1, time, 0, 0, slack[i], slack[i]};
+      } else {
+        CriticalPathInfo& info = info_map[node.name];
+        info.call_count += 1;
+        info.total_time += time;
+        info.total_slack += slack[i];
+        info.min_slack = std::min(info.min_slack, slack[i]);
+      }
+    }
+
+    // Part of the path finished before the end of the previous windows is
+    // already covered by their paths
+    size_t current = sink;
+    while (current != kNoNode && end[current] > totals.last_end) {
+      const DependencyNode& node = node_list_[current];
+      if (node.completed) {
+        CriticalPathInfo& info = info_map[node.name];
+        info.path_time += node.end - node.start;
+        info.path_count += 1;
+        totals.path_time += node.end - node.start;
+      }
+
+      size_t next = kNoNode;
+      for (size_t pred : pred_list[current]) {
+        if (valid[pred] && (next == kNoNode || end[pred] > end[next])) {
+          next = pred;
+        }
+      }
+      current = next;
+    }
+
+    totals.first_start = std::min(totals.first_start, first_start);
+    totals.last_end = std::max(totals.last_end, last_end);
+  }
+
+ private: // Data
+  std::vector<DependencyNode> node_list_;
+  size_t base_ = 0; // Index of the first node not retired
+  size_t window_size_ = kWindowSize;
+  PathTotals totals_;
+  std::map<const void*, size_t> signaler_map_;
+  std::map<const void*, QueueState> queue_map_;
+  std::vector<ExecGraphWait> wait_list_;
+
+  static const uint32_t kKernelLength = 10;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 12;
+};
+
+#endif // FTRACE_TOOLS_UTILS_DEPENDENCY_GRAPH_H_
@@ -0,0 +1,306 @@
+#ifndef FTRACE_TOOLS_UTILS_DEVICE_UTILIZATION_H_
+#define FTRACE_TOOLS_UTILS_DEVICE_UTILIZATION_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+enum UtilizationKind {
+  UTILIZATION_COMPUTE,
+  UTILIZATION_TRANSFER,
+  UTILIZATION_OTHER
+};
+
+struct UtilizationInterval {
+  uint64_t submitted;
+  uint64_t start;
+  uint64_t end;
+  UtilizationKind kind;
+};
+
+// Completed device intervals grouped into tracks. Track path goes from
+// device to queue (e.g. device, tile, engine group, engine, queue), every
+// prefix of the path is a track as well.
+// Idle gap inside a track is charged to what delayed the activity after it:
+// host submission if it was submitted when the track was already idle
+// (host sync if a host wait finished in between), dependency otherwise.
+// Not thread-safe, the owner is responsible for locking
+class DeviceUtilization {
+ public: // User Interface
+  DeviceUtilization() = default;
+
+  DeviceUtilization(const DeviceUtilization& copy) = delete;
+  DeviceUtilization& operator=(const DeviceUtilization& copy) = delete;
+
+  static std::string GetTrackName(
+      const std::vector<std::string>& path, size_t size) {
+    FTRACE_ASSERT(size <= path.size());
+    std::string name;
+    for (size_t i = 0; i < size; ++i) {
+      if (i > 0) {
+        name += " / ";
+      }
+      name += path[i];
+    }
+    return name;
+  }
+
+  void AddInterval(
+      const std::vector<std::string>& path, UtilizationKind kind,
+      uint64_t submitted, uint64_t start, uint64_t end) {
+    FTRACE_ASSERT(start <= end);
+    device_list_.push_back({submitted, start, end, kind});
+    AddTrackInterval(path, 0, kind, submitted, start, end);
+  }
+
+  // Adds the interval to the tracks deeper than the given path level only,
+  // e.g. per tile part of the activity that is already counted for device
+  void AddTrackInterval(
+      const std::vector<std::string>& path, size_t level, UtilizationKind kind,
+      uint64_t submitted, uint64_t start, uint64_t end) {
+    FTRACE_ASSERT(level < path.size());
+    FTRACE_ASSERT(start <= end);
+    for (size_t size = level + 1; size <= path.size(); ++size) {
+      track_map_[GetTrackName(path, size)].push_back(
+          {submitted, start, end, kind});
+    }
+  }
+
+  void AddHostWait(uint64_t start, uint64_t end) {
+    FTRACE_ASSERT(start <= end);
+    wait_end_list_.push_back(end);
+  }
+
+  std::string GetUtilizationTable() {
+    if (device_list_.empty()) {
+      return std::string();
+    }
+    std::sort(wait_end_list_.begin(), wait_end_list_.end());
+
+    std::stringstream stream;
+    uint64_t span = PrintDeviceSummary(stream);
+    if (span == 0) {
+      return std::string();
+    }
+    PrintTracks(stream, span);
+    return stream.str();
+  }
+
+ private: // Implementation
+  struct TrackInfo {
+    uint64_t busy_time = 0;
+    uint64_t gap_count = 0;
+    uint64_t max_gap = 0;
+    uint64_t submission_time = 0;
+    uint64_t sync_time = 0;
+    uint64_t dependency_time = 0;
+    uint64_t histogram[5] = {0, 0, 0, 0, 0};
+  };
+
+  static size_t GetBucket(uint64_t gap) {
+    size_t bucket = 0;
+    uint64_t bound = 1000; // 1 us
+    while (bucket + 1 < kBucketCount && gap >= bound) {
+      ++bucket;
+      bound *= 10;
+    }
+    return bucket;
+  }
+
+  bool IsHostWaitEnded(uint64_t from, uint64_t to) const {
+    auto it = std::upper_bound(
+        wait_end_list_.begin(), wait_end_list_.end(), from);
+    return it != wait_end_list_.end() && *it <= to;
+  }
+
+  TrackInfo AnalyzeTrack(std::vector<UtilizationInterval>& interval_list) {
+    TrackInfo info;
+    std::sort(interval_list.begin(), interval_list.end(),
+              [](const UtilizationInterval& l, const UtilizationInterval& r) {
+                return l.start < r.start;
+              });
+
+    uint64_t block_start = interval_list.front().start;
+    uint64_t block_end = interval_list.front().end;
+    for (size_t i = 1; i < interval_list.size(); ++i) {
+      const UtilizationInterval& interval = interval_list[i];
+      if (interval.start <= block_end) {
+        block_end = std::max(block_end, interval.end);
+        continue;
+      }
+
+      info.busy_time += block_end - block_start;
+      uint64_t gap = interval.start - block_end;
+      ++info.gap_count;
+      info.max_gap = std::max(info.max_gap, gap);
+      ++info.histogram[GetBucket(gap)];
+      if (interval.submitted > block_end) {
+        if (IsHostWaitEnded(block_end, interval.submitted)) {
+          info.sync_time += gap;
+        } else {
+          info.submission_time += gap;
+        }
+      } else {
+        info.dependency_time += gap;
+      }
+
+      block_start = interval.start;
+      block_end = interval.end;
+    }
+    info.busy_time += block_end - block_start;
+    return info;
+  }
+
+  // Sweep over all the intervals of the device
+  uint64_t PrintDeviceSummary(std::stringstream& stream) {
+    std::vector< std::pair<uint64_t, int> > event_list;
+    event_list.reserve(2 * device_list_.size());
+    for (size_t i = 0; i < device_list_.size(); ++i) {
+      const UtilizationInterval& interval = device_list_[i];
+      int code = static_cast<int>(interval.kind) + 1;
+      event_list.push_back(std::make_pair(interval.start, code));
+      event_list.push_back(std::make_pair(interval.end, -code));
+    }
+    std::sort(event_list.begin(), event_list.end()); // Ends go first
+
+    std::vector<uint64_t> level_time(kMaxLevel + 1, 0);
+    uint64_t active[3] = {0, 0, 0};
+    uint64_t busy_time = 0, compute_time = 0, transfer_time = 0;
+    uint64_t overlap_time = 0, weighted_time = 0, max_level = 0;
+
+    uint64_t first = event_list.front().first;
+    uint64_t last = event_list.back().first;
+    uint64_t previous = first;
+    for (const auto& event : event_list) {
+      uint64_t time = event.first - previous;
+      uint64_t level = active[0] + active[1] + active[2];
+      level_time[std::min(level, static_cast<uint64_t>(kMaxLevel))] += time;
+      weighted_time += level * time;
+      if (level > 0) {
+        busy_time += time;
+      }
+      if (active[UTILIZATION_COMPUTE] > 0) {
+        compute_time += time;
+      }
+      if (active[UTILIZATION_TRANSFER] > 0) {
+        transfer_time += time;
+        if (active[UTILIZATION_COMPUTE] > 0) {
+          overlap_time += time;
+        }
+      }
+      previous = event.first;
+
+      if (event.second > 0) {
+        ++active[event.second - 1];
+      } else {
+        FTRACE_ASSERT(active[-event.second - 1] > 0);
+        --active[-event.second - 1];
+      }
+      max_level = std::max(max_level, active[0] + active[1] + active[2]);
+    }
+
+    uint64_t span = last - first;
+    if (span == 0) {
+      return 0;
+    }
+
+    stream << "Device Span (ns): " << span <<
+      ", Busy (ns): " << busy_time <<
+      ", Busy (%): " << std::setprecision(2) << std::fixed <<
+        100.0f * busy_time / span <<
+      ", Avg Concurrency: " << static_cast<float>(weighted_time) / span <<
+      ", Max Concurrency: " << max_level << std::endl;
+    stream << "Compute (ns): " << compute_time <<
+      ", Transfer (ns): " << transfer_time <<
+      ", Overlapped Transfer (ns): " << overlap_time <<
+      ", Exposed Transfer (ns): " << transfer_time - overlap_time <<
+      std::endl;
+    stream << std::endl;
+
+    stream << std::setw(kCallsLength) << "Concurrency" << "," <<
+      std::setw(kTimeLength) << "Time (ns)" << "," <<
+      std::setw(kPercentLength) << "Time (%)" << std::endl;
+    for (uint64_t level = 0;
+         level <= std::min(max_level, static_cast<uint64_t>(kMaxLevel));
+         ++level) {
+      std::string label = std::to_string(level);
+      if (level == kMaxLevel) {
+        label += "+";
+      }
+      stream << std::setw(kCallsLength) << label << "," <<
+        std::setw(kTimeLength) << level_time[level] << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          100.0f * level_time[level] / span << std::endl;
+    }
+    stream << std::endl;
+
+    return span;
+  }
+
+  void PrintTracks(std::stringstream& stream, uint64_t span) {
+    std::vector< std::pair<std::string, TrackInfo> > track_list;
+    size_t max_name_length = kTrackLength;
+    for (auto& track : track_map_) {
+      track_list.push_back(
+          std::make_pair(track.first, AnalyzeTrack(track.second)));
+      max_name_length = std::max(max_name_length, track.first.size());
+    }
+
+    stream << std::setw(max_name_length) << "Track" << "," <<
+      std::setw(kTimeLength) << "Busy (ns)" << "," <<
+      std::setw(kPercentLength) << "Busy (%)" << "," <<
+      std::setw(kCallsLength) << "Idle Gaps" << "," <<
+      std::setw(kTimeLength) << "Max Gap (ns)" << "," <<
+      std::setw(kTimeLength) << "Submission (ns)" << "," <<
+      std::setw(kTimeLength) << "Sync (ns)" << "," <<
+      std::setw(kTimeLength) << "Dependency (ns)" << std::endl;
+    for (const auto& track : track_list) {
+      const TrackInfo& info = track.second;
+      stream << std::setw(max_name_length) << track.first << "," <<
+        std::setw(kTimeLength) << info.busy_time << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          100.0f * info.busy_time / span << "," <<
+        std::setw(kCallsLength) << info.gap_count << "," <<
+        std::setw(kTimeLength) << info.max_gap << "," <<
+        std::setw(kTimeLength) << info.submission_time << "," <<
+        std::setw(kTimeLength) << info.sync_time << "," <<
+        std::setw(kTimeLength) << info.dependency_time << std::endl;
+    }
+    stream << std::endl;
+
+    stream << std::setw(max_name_length) << "Track" << "," <<
+      std::setw(kCallsLength) << "Gaps <1us" << "," <<
+      std::setw(kCallsLength) << "1-10us" << "," <<
+      std::setw(kCallsLength) << "10-100us" << "," <<
+      std::setw(kCallsLength) << "0.1-1ms" << "," <<
+      std::setw(kCallsLength) << ">=1ms" << std::endl;
+    for (const auto& track : track_list) {
+      stream << std::setw(max_name_length) << track.first;
+      for (size_t i = 0; i < kBucketCount; ++i) {
+        stream << "," << std::setw(kCallsLength) << track.second.histogram[i];
+      }
+      stream << std::endl;
+    }
+  }
+
+ private: // Data
+  std::vector<UtilizationInterval> device_list_;
+  std::map<std::string, std::vector<UtilizationInterval> > track_map_;
+  std::vector<uint64_t> wait_end_list_;
+
+  static const size_t kBucketCount = 5;
+  static const uint64_t kMaxLevel = 8;
+  static const uint32_t kTrackLength = 10;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 12;
+};
+
+#endif // FTRACE_TOOLS_UTILS_DEVICE_UTILIZATION_H_
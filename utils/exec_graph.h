@@ -0,0 +1,215 @@
+#ifndef FTRACE_TOOLS_UTILS_EXEC_GRAPH_H_
+#define FTRACE_TOOLS_UTILS_EXEC_GRAPH_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+const char* const kExecGraphHeader = "# FineTrace Execution Graph v1";
+
+// Device activity of the recorded run. Order predecessors come from queue
+// semantics (in-order execution, barriers), event predecessors from explicit
+// wait lists. Join nodes have no duration and only merge predecessors
+struct ExecGraphNode {
+  std::string name;
+  std::string queue;
+  uint64_t submitted = 0;
+  uint64_t start = 0;
+  uint64_t end = 0;
+  bool join = false;
+  std::vector<size_t> order_pred_list;
+  std::vector<size_t> event_pred_list;
+};
+
+struct ExecGraphWait {
+  uint64_t start;
+  uint64_t end;
+};
+
+// Text format, one record per line (names may contain spaces, so go last):
+//   node <id> <queue> <submitted> <start> <end> <order> <event> <name>
+//   join <id> <order preds>
+//   wait <start> <end>
+// Predecessors are comma separated node ids or "-" if none
+class ExecGraph {
+ public: // User Interface
+  ExecGraph() = default;
+
+  size_t AddNode(const ExecGraphNode& node) {
+    for (size_t pred : node.order_pred_list) {
+      FTRACE_ASSERT(pred < node_list_.size());
+    }
+    for (size_t pred : node.event_pred_list) {
+      FTRACE_ASSERT(pred < node_list_.size());
+    }
+    node_list_.push_back(node);
+    return node_list_.size() - 1;
+  }
+
+  void AddWait(uint64_t start, uint64_t end) {
+    FTRACE_ASSERT(start <= end);
+    wait_list_.push_back({start, end});
+  }
+
+  size_t GetNodeCount() const {
+    return node_list_.size();
+  }
+
+  const std::vector<ExecGraphNode>& GetNodeList() const {
+    return node_list_;
+  }
+
+  const std::vector<ExecGraphWait>& GetWaitList() const {
+    return wait_list_;
+  }
+
+  bool Save(const std::string& filename) const {
+    std::ofstream stream(filename);
+    if (!stream.is_open()) {
+      return false;
+    }
+
+    stream << kExecGraphHeader << std::endl;
+    for (size_t i = 0; i < node_list_.size(); ++i) {
+      const ExecGraphNode& node = node_list_[i];
+      if (node.join) {
+        stream << "join " << i << " " <<
+          JoinIds(node.order_pred_list) << std::endl;
+      } else {
+        stream << "node " << i << " " << node.queue << " " <<
+          node.submitted << " " << node.start << " " << node.end << " " <<
+          JoinIds(node.order_pred_list) << " " <<
+          JoinIds(node.event_pred_list) << " " << node.name << std::endl;
+      }
+    }
+    for (const ExecGraphWait& wait : wait_list_) {
+      stream << "wait " << wait.start << " " << wait.end << std::endl;
+    }
+    return stream.good();
+  }
+
+  bool Load(const std::string& filename) {
+    std::ifstream stream(filename);
+    if (!stream.is_open()) {
+      std::cerr << "[ERROR] Unable to open " << filename << std::endl;
+      return false;
+    }
+
+    std::string line;
+    if (!std::getline(stream, line) || line != kExecGraphHeader) {
+      std::cerr << "[ERROR] " << filename <<
+        " is not an execution graph file" << std::endl;
+      return false;
+    }
+
+    node_list_.clear();
+    wait_list_.clear();
+    size_t line_number = 1;
+    while (std::getline(stream, line)) {
+      ++line_number;
+      if (line.empty()) {
+        continue;
+      }
+      if (!ParseLine(line)) {
+        std::cerr << "[ERROR] Malformed record at " << filename << ":" <<
+          line_number << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private: // Implementation
+  bool ParseLine(const std::string& line) {
+    std::istringstream record(line);
+    std::string type;
+    record >> type;
+
+    if (type == "wait") {
+      ExecGraphWait wait{0, 0};
+      if (!(record >> wait.start >> wait.end) || wait.start > wait.end) {
+        return false;
+      }
+      wait_list_.push_back(wait);
+      return true;
+    }
+
+    size_t id = 0;
+    if (!(record >> id) || id != node_list_.size()) {
+      return false;
+    }
+
+    ExecGraphNode node;
+    std::string order_preds, event_preds;
+    if (type == "join") {
+      node.join = true;
+      if (!(record >> order_preds) ||
+          !SplitIds(order_preds, id, node.order_pred_list)) {
+        return false;
+      }
+    } else if (type == "node") {
+      if (!(record >> node.queue >> node.submitted >>
+            node.start >> node.end >> order_preds >> event_preds) ||
+          node.start > node.end ||
+          !SplitIds(order_preds, id, node.order_pred_list) ||
+          !SplitIds(event_preds, id, node.event_pred_list)) {
+        return false;
+      }
+      record >> std::ws;
+      std::getline(record, node.name);
+      if (node.name.empty()) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+
+    node_list_.push_back(node);
+    return true;
+  }
+
+  static std::string JoinIds(const std::vector<size_t>& id_list) {
+    if (id_list.empty()) {
+      return "-";
+    }
+    std::stringstream stream;
+    for (size_t i = 0; i < id_list.size(); ++i) {
+      if (i > 0) {
+        stream << ",";
+      }
+      stream << id_list[i];
+    }
+    return stream.str();
+  }
+
+  // Predecessors always precede the node, so graph stays acyclic
+  static bool SplitIds(
+      const std::string& value, size_t node, std::vector<size_t>& id_list) {
+    if (value == "-") {
+      return true;
+    }
+    std::istringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+      char* end = nullptr;
+      unsigned long long id = std::strtoull(item.c_str(), &end, 10);
+      if (item.empty() || *end != '\0' || id >= node) {
+        return false;
+      }
+      id_list.push_back(static_cast<size_t>(id));
+    }
+    return true;
+  }
+
+ private: // Data
+  std::vector<ExecGraphNode> node_list_;
+  std::vector<ExecGraphWait> wait_list_;
+};
+
+#endif // FTRACE_TOOLS_UTILS_EXEC_GRAPH_H_
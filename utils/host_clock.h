@@ -0,0 +1,250 @@
+#ifndef FTRACE_TOOLS_UTILS_HOST_CLOCK_H_
+#define FTRACE_TOOLS_UTILS_HOST_CLOCK_H_
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#if defined(__gnu_linux__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+#include "finetrace_assert.h"
+#include "utils.h"
+
+#if defined(__gnu_linux__) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))
+#define FTRACE_HOST_CLOCK_CYCLES
+#endif
+
+// Host time in CLOCK_MONOTONIC_RAW domain (nanoseconds) computed from
+// CPU cycle counter. The rate is measured against CLOCK_MONOTONIC_RAW at
+// startup and refined periodically over the whole run, so no system call
+// is needed on each read. Offset from system time found at refinement is
+// corrected by slewing the rate, so the clock never steps. Falls back to
+// utils::GetSystemTime() if cycle counter is not invariant or behaves
+// unexpectedly
+class HostClock {
+ public: // User Interface
+  HostClock() {
+#ifdef FTRACE_HOST_CLOCK_CYCLES
+    std::string value = utils::GetEnv("FTRACE_HOST_CLOCK");
+    if (value == "system" || !IsCycleCounterInvariant()) {
+      return;
+    }
+
+    Sample(start_cycles_, start_time_);
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(
+            static_cast<uint64_t>(kStartupCalibrationMs)));
+
+    uint64_t cycles = 0, time = 0;
+    Sample(cycles, time);
+    if (cycles <= start_cycles_ || time <= start_time_) {
+      return;
+    }
+
+    rate_ = GetRate(cycles, time);
+    SetBase(cycles, time, rate_, rate_);
+    recalibration_cycles_ = (cycles - start_cycles_) *
+      (kRecalibrationMs / kStartupCalibrationMs);
+    use_cycles_.store(true, std::memory_order_release);
+#endif
+  }
+
+  HostClock(const HostClock& copy) = delete;
+  HostClock& operator=(const HostClock& copy) = delete;
+
+  uint64_t GetTime() const {
+#ifdef FTRACE_HOST_CLOCK_CYCLES
+    if (use_cycles_.load(std::memory_order_relaxed)) {
+      uint64_t cycles = utils::GetCycles();
+      uint64_t base_cycles = 0, base_time = 0, mult = 0, rate = 0;
+      GetBase(base_cycles, base_time, mult, rate);
+      if (cycles < base_cycles) { // Read on another core before the update
+        return base_time;
+      }
+      if (cycles - base_cycles > recalibration_cycles_) {
+        const_cast<HostClock*>(this)->Recalibrate(cycles);
+      }
+      return Convert(cycles, base_cycles, base_time, mult, rate);
+    }
+#endif
+    return utils::GetSystemTime();
+  }
+
+  bool IsCycleBased() const {
+    return use_cycles_.load(std::memory_order_relaxed);
+  }
+
+ private: // Implementation
+#ifdef FTRACE_HOST_CLOCK_CYCLES
+  static bool IsCycleCounterInvariant() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) ||
+        !(edx & (1u << 8))) {
+      return false;
+    }
+
+    // Kernel switches away from TSC if finds it unsynchronized between CPUs
+    std::ifstream file(
+        "/sys/devices/system/clocksource/clocksource0/current_clocksource");
+    std::string clocksource;
+    if (file.is_open() && (file >> clocksource) && clocksource != "tsc") {
+      return false;
+    }
+    return true;
+#else
+    return true; // Generic timer has fixed frequency by architecture
+#endif
+  }
+
+  // The closest pair of counter and system time readings
+  static void Sample(uint64_t& cycles, uint64_t& time) {
+    uint64_t min_delta = UINT64_MAX;
+    for (uint32_t i = 0; i < kSampleCount; ++i) {
+      uint64_t before = utils::GetCycles();
+      uint64_t current = utils::GetSystemTime();
+      uint64_t after = utils::GetCycles();
+      if (after - before < min_delta) {
+        min_delta = after - before;
+        cycles = before + (after - before) / 2;
+        time = current;
+      }
+    }
+  }
+
+  // Nanoseconds per cycle in fixed point
+  uint64_t GetRate(uint64_t cycles, uint64_t time) const {
+    FTRACE_ASSERT(cycles > start_cycles_);
+    return static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(time - start_time_) << kRateShift) /
+        (cycles - start_cycles_));
+  }
+
+  static uint64_t Scale(uint64_t cycles, uint64_t mult) {
+    return static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(cycles) * mult) >> kRateShift);
+  }
+
+  // Slewed rate holds for one recalibration period, measured one after it
+  uint64_t Convert(
+      uint64_t cycles, uint64_t base_cycles, uint64_t base_time,
+      uint64_t mult, uint64_t rate) const {
+    uint64_t delta = cycles - base_cycles;
+    if (delta <= recalibration_cycles_) {
+      return base_time + Scale(delta, mult);
+    }
+    return base_time + Scale(recalibration_cycles_, mult) +
+      Scale(delta - recalibration_cycles_, rate);
+  }
+
+  void GetBase(
+      uint64_t& cycles, uint64_t& time,
+      uint64_t& mult, uint64_t& rate) const {
+    uint32_t sequence = 0;
+    do {
+      sequence = sequence_.load(std::memory_order_acquire);
+      cycles = base_cycles_.load(std::memory_order_relaxed);
+      time = base_time_.load(std::memory_order_relaxed);
+      mult = mult_.load(std::memory_order_relaxed);
+      rate = base_rate_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) ||
+             sequence != sequence_.load(std::memory_order_relaxed));
+  }
+
+  void SetBase(
+      uint64_t cycles, uint64_t time, uint64_t mult, uint64_t rate) {
+    sequence_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base_cycles_.store(cycles, std::memory_order_relaxed);
+    base_time_.store(time, std::memory_order_relaxed);
+    mult_.store(mult, std::memory_order_relaxed);
+    base_rate_.store(rate, std::memory_order_relaxed);
+    sequence_.fetch_add(1, std::memory_order_release);
+  }
+
+  void Recalibrate(uint64_t current_cycles) {
+    std::unique_lock<std::mutex> lock(lock_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+      return;
+    }
+
+    uint64_t base_cycles = 0, base_time = 0, mult = 0, base_rate = 0;
+    GetBase(base_cycles, base_time, mult, base_rate);
+    if (current_cycles - base_cycles <= recalibration_cycles_) {
+      return; // Already done by another thread
+    }
+
+    uint64_t cycles = 0, time = 0;
+    Sample(cycles, time);
+    if (cycles <= base_cycles || time <= start_time_) {
+      use_cycles_.store(false, std::memory_order_relaxed);
+      return;
+    }
+
+    uint64_t rate = GetRate(cycles, time);
+    uint64_t deviation = (rate > rate_) ? rate - rate_ : rate_ - rate;
+    if (deviation > rate_ / kMaxRateDeviation) {
+      std::cerr << "[WARNING] CPU cycle counter is unstable, " <<
+        "switching to system clock" << std::endl;
+      use_cycles_.store(false, std::memory_order_relaxed);
+      return;
+    }
+    rate_ = rate;
+
+    // Clock continues from its current value with the rate that brings it
+    // to system time by the end of the next period. Slew is limited, so a
+    // large offset takes several periods, but the clock stays monotonic
+    uint64_t converted =
+      Convert(cycles, base_cycles, base_time, mult, base_rate);
+    uint64_t target = time + Scale(recalibration_cycles_, rate);
+    uint64_t min_mult = rate - rate / kMaxSlew;
+    uint64_t max_mult = rate + rate / kMaxSlew;
+    uint64_t slewed = min_mult;
+    if (target > converted) {
+      slewed = static_cast<uint64_t>(
+          (static_cast<unsigned __int128>(target - converted) << kRateShift) /
+          recalibration_cycles_);
+      if (slewed < min_mult) {
+        slewed = min_mult;
+      } else if (slewed > max_mult) {
+        slewed = max_mult;
+      }
+    }
+    SetBase(cycles, converted, slewed, rate);
+  }
+#endif
+
+ private: // Data
+  std::atomic<bool> use_cycles_{false};
+
+#ifdef FTRACE_HOST_CLOCK_CYCLES
+  uint64_t start_cycles_ = 0;
+  uint64_t start_time_ = 0;
+  uint64_t rate_ = 0;
+  uint64_t recalibration_cycles_ = UINT64_MAX;
+
+  std::atomic<uint32_t> sequence_{0};
+  std::atomic<uint64_t> base_cycles_{0};
+  std::atomic<uint64_t> base_time_{0};
+  std::atomic<uint64_t> mult_{0};
+  std::atomic<uint64_t> base_rate_{0};
+  std::mutex lock_;
+
+  static const uint32_t kRateShift = 32;
+  static const uint32_t kSampleCount = 16;
+  static const uint32_t kStartupCalibrationMs = 10;
+  static const uint32_t kRecalibrationMs = 1000;
+  static const uint64_t kMaxRateDeviation = 100; // 1%
+  static const uint64_t kMaxSlew = 1000; // 0.1%
+#endif
+};
+
+#endif // FTRACE_TOOLS_UTILS_HOST_CLOCK_H_
@@ -0,0 +1,231 @@
+#ifndef FTRACE_TOOLS_UTILS_HOST_STALL_H_
+#define FTRACE_TOOLS_UTILS_HOST_STALL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "finetrace_assert.h"
+#include "utils.h"
+
+struct HostStallInfo {
+  uint64_t stall_time;
+  uint64_t min_time;
+  uint64_t max_time;
+  uint64_t wait_count;
+
+  bool operator>(const HostStallInfo& r) const {
+    if (stall_time != r.stall_time) {
+      return stall_time > r.stall_time;
+    }
+    return wait_count > r.wait_count;
+  }
+
+  bool operator!=(const HostStallInfo& r) const {
+    if (stall_time == r.stall_time) {
+      return wait_count != r.wait_count;
+    }
+    return true;
+  }
+};
+
+struct HostCompletion {
+  std::string name;
+  std::string id;
+  uint64_t started;
+  uint64_t ended;
+};
+
+using HostStallInfoMap = std::map<std::string, HostStallInfo>;
+
+typedef void (*OnHostStallCallback)(
+    void* data,
+    const std::string& id,
+    const std::string& name,
+    uint64_t started,
+    uint64_t ended);
+
+// Host wait interval is split at the completion points of the device
+// activities finished inside it: each piece is charged to the activity
+// completed at its end, i.e. the one the host was still waiting for.
+// Wake-up latency after the last completion goes to the last activity
+class HostStallTracker {
+ public: // User Interface
+  HostStallTracker() = default;
+
+  HostStallTracker(const HostStallTracker& copy) = delete;
+  HostStallTracker& operator=(const HostStallTracker& copy) = delete;
+
+  bool IsWaiting() const {
+    return wait_count_.load(std::memory_order_acquire) > 0;
+  }
+
+  void BeginWait(uint64_t start) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    wait_start_set_.insert(start);
+    wait_count_.fetch_add(1, std::memory_order_release);
+  }
+
+  void AddCompletion(
+      const std::string& name, const std::string& id,
+      uint64_t started, uint64_t ended) {
+    FTRACE_ASSERT(!name.empty());
+    FTRACE_ASSERT(started <= ended);
+    const std::lock_guard<std::mutex> lock(lock_);
+    if (wait_start_set_.empty()) {
+      return;
+    }
+    completion_list_.push_back({name, id, started, ended});
+  }
+
+  void EndWait(
+      uint64_t start, uint64_t end,
+      OnHostStallCallback callback, void* callback_data) {
+    FTRACE_ASSERT(start <= end);
+    const std::lock_guard<std::mutex> lock(lock_);
+
+    auto it = wait_start_set_.find(start);
+    FTRACE_ASSERT(it != wait_start_set_.end());
+    wait_start_set_.erase(it);
+    wait_count_.fetch_sub(1, std::memory_order_release);
+
+    std::vector<const HostCompletion*> completed;
+    for (const auto& completion : completion_list_) {
+      if (completion.ended > start && completion.ended <= end) {
+        completed.push_back(&completion);
+      }
+    }
+    std::sort(completed.begin(), completed.end(),
+              [](const HostCompletion* l, const HostCompletion* r) {
+                return l->ended < r->ended;
+              });
+
+    total_wait_time_ += end - start;
+    ++total_wait_count_;
+
+    if (completed.empty()) {
+      unattributed_time_ += end - start;
+    } else {
+      uint64_t segment_start = start;
+      for (size_t i = 0; i < completed.size(); ++i) {
+        const HostCompletion* completion = completed[i];
+        uint64_t segment_end =
+          (i + 1 == completed.size()) ? end : completion->ended;
+        if (segment_end > segment_start) {
+          AddStall(completion->name, segment_end - segment_start);
+          if (callback != nullptr) {
+            callback(
+                callback_data, completion->id,
+                completion->name, segment_start, segment_end);
+          }
+        }
+        segment_start = segment_end;
+      }
+    }
+
+    // Activities completed before the earliest active wait are never used
+    if (wait_start_set_.empty()) {
+      completion_list_.clear();
+    } else {
+      uint64_t earliest = *wait_start_set_.begin();
+      completion_list_.erase(
+          std::remove_if(
+              completion_list_.begin(), completion_list_.end(),
+              [earliest](const HostCompletion& completion) {
+                return completion.ended <= earliest;
+              }),
+          completion_list_.end());
+    }
+  }
+
+  HostStallInfoMap GetStallInfoMap() const {
+    const std::lock_guard<std::mutex> lock(lock_);
+    return stall_info_map_;
+  }
+
+  std::string GetStallTable() const {
+    const std::lock_guard<std::mutex> lock(lock_);
+    if (total_wait_time_ == 0) {
+      return std::string();
+    }
+
+    std::set< std::pair<std::string, HostStallInfo>,
+              utils::Comparator > sorted_list(
+        stall_info_map_.begin(), stall_info_map_.end());
+
+    size_t max_name_length = kKernelLength;
+    for (auto& value : sorted_list) {
+      if (value.first.size() > max_name_length) {
+        max_name_length = value.first.size();
+      }
+    }
+
+    std::stringstream stream;
+    stream << "Host Waits: " << total_wait_count_ <<
+      ", Wait Time (ns): " << total_wait_time_ <<
+      ", Unattributed (ns): " << unattributed_time_ << std::endl;
+    stream << std::endl;
+
+    stream << std::setw(max_name_length) << "Kernel" << "," <<
+      std::setw(kCallsLength) << "Waits" << "," <<
+      std::setw(kTimeLength) << "Stall (ns)" << "," <<
+      std::setw(kPercentLength) << "Stall (%)" << "," <<
+      std::setw(kTimeLength) << "Average (ns)" << "," <<
+      std::setw(kTimeLength) << "Min (ns)" << "," <<
+      std::setw(kTimeLength) << "Max (ns)" << std::endl;
+
+    for (auto& value : sorted_list) {
+      const std::string& kernel = value.first;
+      uint64_t wait_count = value.second.wait_count;
+      uint64_t duration = value.second.stall_time;
+      float percent_duration = 100.0f * duration / total_wait_time_;
+      stream << std::setw(max_name_length) << kernel << "," <<
+        std::setw(kCallsLength) << wait_count << "," <<
+        std::setw(kTimeLength) << duration << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) <<
+          std::fixed << percent_duration << "," <<
+        std::setw(kTimeLength) << duration / wait_count << "," <<
+        std::setw(kTimeLength) << value.second.min_time << "," <<
+        std::setw(kTimeLength) << value.second.max_time << std::endl;
+    }
+
+    return stream.str();
+  }
+
+ private: // Implementation
+  void AddStall(const std::string& name, uint64_t time) {
+    if (stall_info_map_.count(name) == 0) {
+      stall_info_map_[name] = {time, time, time, 1};
+    } else {
+      HostStallInfo& info = stall_info_map_[name];
+      info.stall_time += time;
+      info.min_time = std::min(info.min_time, time);
+      info.max_time = std::max(info.max_time, time);
+      info.wait_count += 1;
+    }
+  }
+
+ private: // Data
+  mutable std::mutex lock_;
+  std::atomic<uint32_t> wait_count_{0};
+  std::multiset<uint64_t> wait_start_set_;
+  std::vector<HostCompletion> completion_list_;
+
+  HostStallInfoMap stall_info_map_;
+  uint64_t total_wait_time_ = 0;
+  uint64_t total_wait_count_ = 0;
+  uint64_t unattributed_time_ = 0;
+
+  static const uint32_t kKernelLength = 10;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 12;
+};
+
+#endif // FTRACE_TOOLS_UTILS_HOST_STALL_H_
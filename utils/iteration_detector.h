@@ -0,0 +1,313 @@
+#ifndef FTRACE_TOOLS_UTILS_ITERATION_DETECTOR_H_
+#define FTRACE_TOOLS_UTILS_ITERATION_DETECTOR_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "finetrace_assert.h"
+#include "launch_statistics.h"
+
+typedef void (*OnIterationCallback)(
+    void* data, uint64_t iteration, uint64_t timestamp);
+
+// Finds the dominant repeating period in the stream of launched kernel
+// name ids. First kDetectCount launches are buffered and the smallest
+// period with at least kMinMatchRatio of launches equal to the ones one
+// period before is taken (autocorrelation over the second half of the
+// buffer, so setup launches are skipped). After that each launch is
+// matched against the period pattern in O(1), iteration starts with the
+// first pattern launch. If no period is found, detection starts over on
+// the next launches. Only the last kOpenCount iterations are kept to
+// collect device time of their launches, older ones are folded into
+// running statistics (device time completed later than that is lost).
+// Not thread-safe, the owner is responsible for locking
+class IterationDetector {
+ public: // User Interface
+  IterationDetector(OnIterationCallback callback, void* callback_data)
+      : callback_(callback), callback_data_(callback_data) {}
+
+  IterationDetector(const IterationDetector& copy) = delete;
+  IterationDetector& operator=(const IterationDetector& copy) = delete;
+
+  // Returns launch index to be passed into AddDeviceTime on completion
+  uint64_t AddLaunch(uint32_t name_id, uint64_t timestamp) {
+    uint64_t launch = launch_count_;
+    ++launch_count_;
+    if (pattern_.empty()) {
+      buffer_.push_back({name_id, timestamp, 0});
+      if (buffer_.size() == kDetectCount) {
+        Detect();
+      }
+    } else {
+      MatchLaunch(launch, name_id, timestamp);
+    }
+    return launch;
+  }
+
+  void AddDeviceTime(uint64_t launch, uint64_t time) {
+    if (pattern_.empty()) {
+      if (launch >= buffer_start_ && launch - buffer_start_ < buffer_.size()) {
+        buffer_[launch - buffer_start_].device_time += time;
+      }
+      return;
+    }
+
+    if (iteration_list_.empty() ||
+        launch < iteration_list_.front().first_launch) {
+      return;
+    }
+    auto it = std::upper_bound(
+        iteration_list_.begin(), iteration_list_.end(), launch,
+        [](uint64_t value, const Iteration& iteration) {
+          return value < iteration.first_launch;
+        });
+    if (it != iteration_list_.begin()) {
+      (it - 1)->device_time += time;
+    }
+  }
+
+  std::string GetIterationTable() {
+    if (pattern_.empty()) {
+      Detect();
+    }
+    if (iteration_count_ < 2) {
+      return std::string();
+    }
+
+    // Last iteration is not finished
+    uint64_t count = iteration_count_ - 1;
+    IterationTotals totals = totals_;
+    std::vector<uint64_t> wall_list;
+    for (size_t i = 0; i + 1 < iteration_list_.size(); ++i) {
+      wall_list.push_back(AddIteration(totals, i));
+    }
+
+    uint64_t span = iteration_list_.back().start - first_start_;
+    uint64_t part = std::max<uint64_t>(count / 10, 1);
+    if (part > kDriftCount) {
+      part = kDriftCount;
+    }
+    FTRACE_ASSERT(part <= wall_list.size());
+    double first = 0.0, last = 0.0;
+    for (uint64_t i = 0; i < part; ++i) {
+      first += (i < first_wall_list_.size()) ?
+        first_wall_list_[i] : wall_list[i - first_wall_list_.size()];
+      last += wall_list[wall_list.size() - i - 1];
+    }
+
+    std::stringstream stream;
+    stream << "Period (launches): " << pattern_.size() <<
+      ", Iterations: " << count <<
+      ", Iterations/s: " << std::setprecision(2) << std::fixed <<
+        ((span > 0) ? 1e9 * count / span : 0.0) <<
+      ", Unmatched Launches: " << mismatch_count_ << std::endl;
+    stream << "Drift (first vs last " << part << " iterations, %): " <<
+      std::setprecision(2) << std::fixed << std::showpos <<
+        ((first > 0) ? 100.0 * (last - first) / first : 0.0) <<
+      std::noshowpos << std::endl;
+    stream << std::endl;
+
+    stream << std::setw(kNameLength) << "Per Iteration" << "," <<
+      std::setw(kTimeLength) << "Average (ns)" << "," <<
+      std::setw(kTimeLength) << "StdDev (ns)" << std::endl;
+    PrintRow(stream, "Wall Time", totals.wall);
+    PrintRow(stream, "Device Time", totals.device);
+    PrintRow(stream, "Host Overhead", totals.host);
+    stream << std::setw(kNameLength) << "Min Wall Time" << "," <<
+      std::setw(kTimeLength) << totals.min_wall << "," <<
+      std::setw(kTimeLength) << "" << std::endl;
+    stream << std::setw(kNameLength) << "Max Wall Time" << "," <<
+      std::setw(kTimeLength) << totals.max_wall << "," <<
+      std::setw(kTimeLength) << "" << std::endl;
+    return stream.str();
+  }
+
+ private: // Implementation
+  struct Launch {
+    uint32_t name_id;
+    uint64_t timestamp;
+    uint64_t device_time;
+  };
+
+  struct Iteration {
+    uint64_t first_launch;
+    uint64_t start;
+    uint64_t device_time;
+  };
+
+  struct IterationTotals {
+    RunningStatistics wall;
+    RunningStatistics device;
+    RunningStatistics host;
+    uint64_t min_wall = UINT64_MAX;
+    uint64_t max_wall = 0;
+  };
+
+  // Iteration ends where the next one starts, returns its wall time
+  uint64_t AddIteration(IterationTotals& totals, size_t index) const {
+    FTRACE_ASSERT(index + 1 < iteration_list_.size());
+    uint64_t wall_time =
+      iteration_list_[index + 1].start - iteration_list_[index].start;
+    uint64_t device_time = iteration_list_[index].device_time;
+    totals.wall.Add(wall_time);
+    totals.device.Add(device_time);
+    totals.host.Add(wall_time > device_time ? wall_time - device_time : 0);
+    totals.min_wall = std::min(totals.min_wall, wall_time);
+    totals.max_wall = std::max(totals.max_wall, wall_time);
+    return wall_time;
+  }
+
+  static void PrintRow(
+      std::stringstream& stream, const char* name,
+      const RunningStatistics& stats) {
+    stream << std::setw(kNameLength) << name << "," <<
+      std::setw(kTimeLength) << static_cast<uint64_t>(stats.mean) << "," <<
+      std::setw(kTimeLength) << static_cast<uint64_t>(stats.GetStdDev()) <<
+      std::endl;
+  }
+
+  size_t FindPeriod() const {
+    size_t size = buffer_.size();
+    size_t max_period = size / kMinPeriodCount;
+    if (max_period > kMaxPeriod) {
+      max_period = kMaxPeriod;
+    }
+    size_t from = size / 2;
+    for (size_t period = 1; period <= max_period; ++period) {
+      size_t begin = std::max(from, period);
+      if (begin >= size) {
+        break;
+      }
+      size_t match_count = 0;
+      for (size_t i = begin; i < size; ++i) {
+        if (buffer_[i].name_id == buffer_[i - period].name_id) {
+          ++match_count;
+        }
+      }
+      if (match_count >= kMinMatchRatio * (size - begin)) {
+        return period;
+      }
+    }
+    return 0;
+  }
+
+  void Detect() {
+    size_t period = FindPeriod();
+    if (period == 0) {
+      buffer_start_ += buffer_.size();
+      buffer_.clear();
+      return;
+    }
+
+    // Iterations start where two periods in a row match
+    size_t start = 0;
+    while (start + 2 * period < buffer_.size()) {
+      size_t i = start;
+      while (i < start + period &&
+             buffer_[i].name_id == buffer_[i + period].name_id) {
+        ++i;
+      }
+      if (i == start + period) {
+        break;
+      }
+      ++start;
+    }
+
+    // Prefer pattern starting with the kernel launched once per iteration,
+    // so matching can recover on it
+    for (size_t shift = 0;
+         shift < period && start + shift + period <= buffer_.size();
+         ++shift) {
+      uint32_t name_id = buffer_[start + shift].name_id;
+      size_t count = 0;
+      for (size_t i = 0; i < period; ++i) {
+        if (buffer_[start + shift + i].name_id == name_id) {
+          ++count;
+        }
+      }
+      if (count == 1) {
+        start += shift;
+        break;
+      }
+    }
+    FTRACE_ASSERT(start + period <= buffer_.size());
+
+    for (size_t i = 0; i < period; ++i) {
+      pattern_.push_back(buffer_[start + i].name_id);
+    }
+    for (size_t i = start; i < buffer_.size(); ++i) {
+      MatchLaunch(buffer_start_ + i, buffer_[i].name_id, buffer_[i].timestamp);
+      iteration_list_.back().device_time += buffer_[i].device_time;
+    }
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+  }
+
+  void MatchLaunch(uint64_t launch, uint32_t name_id, uint64_t timestamp) {
+    FTRACE_ASSERT(!pattern_.empty());
+    bool boundary = false;
+    if (name_id == pattern_[position_]) {
+      boundary = (position_ == 0);
+      position_ = (position_ + 1) % pattern_.size();
+    } else if (name_id == pattern_[0]) { // Resynchronize
+      ++mismatch_count_;
+      boundary = true;
+      position_ = 1 % pattern_.size();
+    } else { // Assume substituted launch
+      ++mismatch_count_;
+      position_ = (position_ + 1) % pattern_.size();
+    }
+
+    if (boundary) {
+      if (iteration_count_ == 0) {
+        first_start_ = timestamp;
+      }
+      ++iteration_count_;
+      iteration_list_.push_back({launch, timestamp, 0});
+      if (iteration_list_.size() > kOpenCount) {
+        uint64_t wall_time = AddIteration(totals_, 0);
+        if (first_wall_list_.size() < kDriftCount) {
+          first_wall_list_.push_back(wall_time);
+        }
+        iteration_list_.pop_front();
+      }
+      if (callback_ != nullptr) {
+        callback_(callback_data_, iteration_count_, timestamp);
+      }
+    }
+  }
+
+ private: // Data
+  OnIterationCallback callback_ = nullptr;
+  void* callback_data_ = nullptr;
+
+  uint64_t launch_count_ = 0;
+  uint64_t buffer_start_ = 0;
+  std::vector<Launch> buffer_;
+
+  std::vector<uint32_t> pattern_;
+  size_t position_ = 0;
+  uint64_t mismatch_count_ = 0;
+  uint64_t iteration_count_ = 0;
+  uint64_t first_start_ = 0;
+  std::deque<Iteration> iteration_list_;
+  IterationTotals totals_;
+  std::vector<uint64_t> first_wall_list_;
+
+  static const size_t kDetectCount = 4096;
+  static const size_t kOpenCount = 1024;
+  static const size_t kDriftCount = 100;
+  static const size_t kMaxPeriod = 1024;
+  static const size_t kMinPeriodCount = 3;
+  static constexpr double kMinMatchRatio = 0.9;
+
+  static const uint32_t kNameLength = 16;
+  static const uint32_t kTimeLength = 20;
+};
+
+#endif // FTRACE_TOOLS_UTILS_ITERATION_DETECTOR_H_
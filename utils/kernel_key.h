@@ -0,0 +1,146 @@
+#ifndef FTRACE_TOOLS_UTILS_KERNEL_KEY_H_
+#define FTRACE_TOOLS_UTILS_KERNEL_KEY_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+// Aggregation levels on top of kernel name, can be combined
+enum KernelKeyLevel {
+  KERNEL_KEY_NAME = 0,
+  KERNEL_KEY_CONFIG = 1,
+  KERNEL_KEY_TILE = 2,
+  KERNEL_KEY_DEVICE = 4
+};
+
+// Fixed size aggregation key: kernel, launch config, tile and device
+struct KernelKey {
+  uint32_t name_id;
+  int32_t tile; // -1 for the whole kernel
+  uint64_t simd_width;
+  uint64_t bytes_transferred;
+  uint64_t size[6]; // Group count and size for L0, global and local for CL
+  const void* device;
+
+  bool operator==(const KernelKey& r) const {
+    if (name_id != r.name_id || tile != r.tile || device != r.device ||
+        simd_width != r.simd_width ||
+        bytes_transferred != r.bytes_transferred) {
+      return false;
+    }
+    for (size_t i = 0; i < 6; ++i) {
+      if (size[i] != r.size[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+struct KernelKeyHash {
+  size_t operator()(const KernelKey& key) const {
+    uint64_t hash = 14695981039346656037ull; // FNV-1a offset basis
+    Combine(hash, key.name_id);
+    Combine(hash, static_cast<uint32_t>(key.tile));
+    Combine(hash, key.simd_width);
+    Combine(hash, key.bytes_transferred);
+    for (size_t i = 0; i < 6; ++i) {
+      Combine(hash, key.size[i]);
+    }
+    Combine(hash, reinterpret_cast<uintptr_t>(key.device));
+    return static_cast<size_t>(hash);
+  }
+
+  static void Combine(uint64_t& hash, uint64_t value) {
+    hash ^= value;
+    hash *= 1099511628211ull; // FNV-1a prime
+  }
+};
+
+template <class Info>
+using KernelKeyMap = std::unordered_map<KernelKey, Info, KernelKeyHash>;
+
+// Interns kernel names, so the key has no strings in it.
+// Not thread-safe, the owner is responsible for locking
+class KernelNameTable {
+ public: // User Interface
+  uint32_t GetId(const std::string& name) {
+    auto it = id_map_.find(name);
+    if (it != id_map_.end()) {
+      return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(name_list_.size());
+    name_list_.push_back(name);
+    id_map_[name] = id;
+    return id;
+  }
+
+  const std::string& GetName(uint32_t id) const {
+    FTRACE_ASSERT(id < name_list_.size());
+    return name_list_[id];
+  }
+
+ private: // Data
+  std::vector<std::string> name_list_;
+  std::unordered_map<std::string, uint32_t> id_map_;
+};
+
+inline std::string GetKernelKeyLevelName(uint32_t level) {
+  std::string name = "Kernel";
+  if (level & KERNEL_KEY_CONFIG) {
+    name += " / Config";
+  }
+  if (level & KERNEL_KEY_TILE) {
+    name += " / Tile";
+  }
+  if (level & KERNEL_KEY_DEVICE) {
+    name += " / Device";
+  }
+  return name;
+}
+
+// Rolls the aggregates up to the given level, all the keys with the same
+// name on this level are merged. Whole kernel entries are replaced with
+// their per tile parts on tile level and ignored otherwise
+template <class Info, class GetName, class Merge>
+std::map<std::string, Info> RollUpKernelKeys(
+    const KernelKeyMap<Info>& key_map, uint32_t level,
+    GetName get_name, Merge merge) {
+  std::unordered_set<KernelKey, KernelKeyHash> split_set;
+  if (level & KERNEL_KEY_TILE) {
+    for (auto& value : key_map) {
+      if (value.first.tile >= 0) {
+        KernelKey whole = value.first;
+        whole.tile = -1;
+        split_set.insert(whole);
+      }
+    }
+  }
+
+  std::map<std::string, Info> info_map;
+  for (auto& value : key_map) {
+    if (level & KERNEL_KEY_TILE) {
+      if (split_set.count(value.first) > 0) {
+        continue;
+      }
+    } else if (value.first.tile >= 0) {
+      continue;
+    }
+
+    std::string name = get_name(value.first, level);
+    auto it = info_map.find(name);
+    if (it == info_map.end()) {
+      info_map[name] = value.second;
+    } else {
+      merge(it->second, value.second);
+    }
+  }
+  return info_map;
+}
+
+#endif // FTRACE_TOOLS_UTILS_KERNEL_KEY_H_
@@ -0,0 +1,164 @@
+#ifndef FTRACE_TOOLS_UTILS_KERNEL_RESOURCES_H_
+#define FTRACE_TOOLS_UTILS_KERNEL_RESOURCES_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+// Zero means the value is not reported by the driver (or, for GRF count,
+// is not set in build options, so the default register file is used)
+struct KernelResources {
+  uint64_t private_memory = 0;
+  uint64_t spill_memory = 0;
+  uint64_t local_memory = 0;
+  uint32_t required_subgroup_size = 0;
+  uint32_t grf_count = 0;
+};
+
+// Resources of device kernels per name next to their execution time. If
+// the same kernel is built several times with different resources (e.g.
+// with different build options), the largest value of each is kept.
+// Not thread-safe, the owner is responsible for locking
+class KernelResourceTable {
+ public: // User Interface
+  void AddKernel(const std::string& name, const KernelResources& resources) {
+    FTRACE_ASSERT(!name.empty());
+    Kernel& kernel = kernel_map_[name];
+    KernelResources& current = kernel.resources;
+    current.private_memory =
+      std::max(current.private_memory, resources.private_memory);
+    current.spill_memory =
+      std::max(current.spill_memory, resources.spill_memory);
+    current.local_memory =
+      std::max(current.local_memory, resources.local_memory);
+    current.required_subgroup_size = std::max(
+        current.required_subgroup_size, resources.required_subgroup_size);
+    current.grf_count = std::max(current.grf_count, resources.grf_count);
+  }
+
+  // Time of kernels without captured resources counts only into total
+  void AddTime(const std::string& name, uint64_t time) {
+    total_time_ += time;
+    auto it = kernel_map_.find(name);
+    if (it == kernel_map_.end()) {
+      return;
+    }
+    ++it->second.call_count;
+    it->second.time += time;
+  }
+
+  std::string GetResourceTable() const {
+    std::vector<const std::pair<const std::string, Kernel>*> list;
+    size_t max_name_length = kKernelLength;
+    uint64_t spill_count = 0, spill_time = 0;
+    for (auto& value : kernel_map_) {
+      list.push_back(&value);
+      max_name_length = std::max(max_name_length, value.first.size());
+      if (value.second.resources.spill_memory > 0) {
+        ++spill_count;
+        spill_time += value.second.time;
+      }
+    }
+    if (list.empty()) {
+      return std::string();
+    }
+
+    std::sort(list.begin(), list.end(),
+              [](const std::pair<const std::string, Kernel>* l,
+                 const std::pair<const std::string, Kernel>* r) {
+                if (l->second.time != r->second.time) {
+                  return l->second.time > r->second.time;
+                }
+                return l->first < r->first;
+              });
+
+    std::stringstream stream;
+    stream << "Kernels with Register Spills: " << spill_count << " of " <<
+      list.size() << ", " << std::setprecision(2) << std::fixed <<
+      GetPercent(spill_time) << "% of kernel time" << std::endl;
+    stream << std::endl;
+
+    stream << std::setw(max_name_length) << "Kernel" << "," <<
+      std::setw(kCallsLength) << "Calls" << "," <<
+      std::setw(kTimeLength) << "Time (ns)" << "," <<
+      std::setw(kPercentLength) << "Time (%)" << "," <<
+      std::setw(kBytesLength) << "Private (bytes)" << "," <<
+      std::setw(kBytesLength) << "Spill (bytes)" << "," <<
+      std::setw(kBytesLength) << "SLM (bytes)" << "," <<
+      std::setw(kSizeLength) << "Req SG" << "," <<
+      std::setw(kSizeLength) << "GRF" << std::endl;
+    for (auto value : list) {
+      const Kernel& kernel = value->second;
+      stream << std::setw(max_name_length) << value->first << "," <<
+        std::setw(kCallsLength) << kernel.call_count << "," <<
+        std::setw(kTimeLength) << kernel.time << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          GetPercent(kernel.time) << "," <<
+        std::setw(kBytesLength) << kernel.resources.private_memory << "," <<
+        std::setw(kBytesLength) << kernel.resources.spill_memory << "," <<
+        std::setw(kBytesLength) << kernel.resources.local_memory << "," <<
+        std::setw(kSizeLength) <<
+          GetValue(kernel.resources.required_subgroup_size) << "," <<
+        std::setw(kSizeLength) <<
+          GetValue(kernel.resources.grf_count) << std::endl;
+    }
+    return stream.str();
+  }
+
+  // Register file size is not reported by the drivers, so it is taken
+  // from Level Zero and OpenCL(TM) build options where it is set
+  static uint32_t GetGrfCount(const char* options) {
+    if (options == nullptr) {
+      return 0;
+    }
+    const char* size = strstr(options, "-ze-exp-register-file-size=");
+    if (size != nullptr) {
+      return static_cast<uint32_t>(
+          atoi(size + strlen("-ze-exp-register-file-size=")));
+    }
+    if (strstr(options, "-ze-opt-large-register-file") != nullptr ||
+        strstr(options, "-cl-intel-256-GRF-per-thread") != nullptr) {
+      return 256;
+    }
+    if (strstr(options, "-cl-intel-128-GRF-per-thread") != nullptr) {
+      return 128;
+    }
+    return 0;
+  }
+
+ private: // Implementation
+  struct Kernel {
+    KernelResources resources;
+    uint64_t call_count = 0;
+    uint64_t time = 0;
+  };
+
+  static std::string GetValue(uint32_t value) {
+    return (value > 0) ? std::to_string(value) : "-";
+  }
+
+  double GetPercent(uint64_t time) const {
+    return (total_time_ > 0) ? 100.0 * time / total_time_ : 0.0;
+  }
+
+ private: // Data
+  std::map<std::string, Kernel> kernel_map_;
+  uint64_t total_time_ = 0;
+
+  static const uint32_t kKernelLength = 10;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 10;
+  static const uint32_t kBytesLength = 16;
+  static const uint32_t kSizeLength = 8;
+};
+
+#endif // FTRACE_TOOLS_UTILS_KERNEL_RESOURCES_H_
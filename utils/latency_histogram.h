@@ -0,0 +1,203 @@
+#ifndef FTRACE_TOOLS_UTILS_LATENCY_HISTOGRAM_H_
+#define FTRACE_TOOLS_UTILS_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+// Log-linear (HDR-like) histogram of nanosecond values: values below
+// 2 * kSubBucketCount are exact, larger ones fall into one of
+// kSubBucketCount linear sub-buckets of their power of two, so relative
+// error is below 1 / kSubBucketCount. Bucket list grows up to the largest
+// recorded value below 2^kMaxValueBits ns (about 18 minutes), so it never
+// exceeds kMaxBucketCount entries. Larger values are only counted as
+// overflow, with the maximum kept exact
+class LatencyHistogram {
+ public: // User Interface
+  void Record(uint64_t value) {
+    if (value >= kMaxValue) {
+      ++overflow_count_;
+    } else {
+      size_t bucket = GetBucket(value);
+      if (bucket >= count_list_.size()) {
+        count_list_.resize(bucket + 1, 0);
+      }
+      ++count_list_[bucket];
+    }
+
+    if (total_count_ == 0 || value < min_value_) {
+      min_value_ = value;
+    }
+    if (total_count_ == 0 || value > max_value_) {
+      max_value_ = value;
+    }
+    ++total_count_;
+  }
+
+  void Merge(const LatencyHistogram& other) {
+    FTRACE_ASSERT(offset_ == other.offset_);
+    if (other.total_count_ == 0) {
+      return;
+    }
+    if (other.count_list_.size() > count_list_.size()) {
+      count_list_.resize(other.count_list_.size(), 0);
+    }
+    for (size_t i = 0; i < other.count_list_.size(); ++i) {
+      count_list_[i] += other.count_list_[i];
+    }
+    overflow_count_ += other.overflow_count_;
+
+    if (total_count_ == 0 || other.min_value_ < min_value_) {
+      min_value_ = other.min_value_;
+    }
+    if (total_count_ == 0 || other.max_value_ > max_value_) {
+      max_value_ = other.max_value_;
+    }
+    total_count_ += other.total_count_;
+  }
+
+  // Fixed cost (e.g. calibrated tracing overhead) to be excluded from
+  // every reported value
+  void Subtract(uint64_t value) {
+    offset_ += value;
+  }
+
+  uint64_t GetCount() const {
+    return total_count_;
+  }
+
+  // Returns the highest value equivalent to the one at the given
+  // percentile, i.e. upper bound of its bucket (limited by the maximum)
+  uint64_t GetPercentile(double percentile) const {
+    if (total_count_ == 0) {
+      return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(
+        percentile / 100.0 * total_count_ + 0.5);
+    if (rank == 0) {
+      rank = 1;
+    }
+    if (rank > total_count_) {
+      rank = total_count_;
+    }
+
+    uint64_t count = 0;
+    for (size_t i = 0; i < count_list_.size(); ++i) {
+      count += count_list_[i];
+      if (count >= rank) {
+        uint64_t value = GetBucketEnd(i);
+        if (value > max_value_) {
+          value = max_value_;
+        }
+        if (value < min_value_) {
+          value = min_value_;
+        }
+        return Compensate(value);
+      }
+    }
+
+    FTRACE_ASSERT(count + overflow_count_ >= rank);
+    return Compensate(max_value_);
+  }
+
+  std::string GetBucketTable() const {
+    std::stringstream stream;
+    stream << std::setw(kTimeLength) << "From (ns)" << "," <<
+      std::setw(kTimeLength) << "To (ns)" << "," <<
+      std::setw(kCallsLength) << "Count" << "," <<
+      std::setw(kPercentLength) << "Count (%)" << "," <<
+      std::setw(kPercentLength) << "Total (%)" << std::endl;
+
+    uint64_t count = 0;
+    for (size_t i = 0; i < count_list_.size(); ++i) {
+      if (count_list_[i] == 0) {
+        continue;
+      }
+      count += count_list_[i];
+      stream << std::setw(kTimeLength) << Compensate(GetBucketStart(i)) <<
+        "," << std::setw(kTimeLength) << Compensate(GetBucketEnd(i)) <<
+        "," << std::setw(kCallsLength) << count_list_[i] << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          100.0f * count_list_[i] / total_count_ << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          100.0f * count / total_count_ << std::endl;
+    }
+    if (overflow_count_ > 0) {
+      count += overflow_count_;
+      stream << std::setw(kTimeLength) << Compensate(kMaxValue) << "," <<
+        std::setw(kTimeLength) << Compensate(max_value_) << "," <<
+        std::setw(kCallsLength) << overflow_count_ << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          100.0f * overflow_count_ / total_count_ << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          100.0f * count / total_count_ << std::endl;
+    }
+    return stream.str();
+  }
+
+ private: // Implementation
+  static const uint32_t kSubBucketBits = 4;
+  static const uint64_t kSubBucketCount = 1ull << kSubBucketBits;
+  static const uint32_t kMaxValueBits = 40;
+  static const uint64_t kMaxValue = 1ull << kMaxValueBits;
+  static const size_t kMaxBucketCount =
+    (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+  static uint32_t GetHighestBit(uint64_t value) {
+    FTRACE_ASSERT(value > 0);
+    uint32_t bit = 0;
+    for (uint32_t shift = 32; shift > 0; shift /= 2) {
+      if (value >= (1ull << shift)) {
+        value >>= shift;
+        bit += shift;
+      }
+    }
+    return bit;
+  }
+
+  static size_t GetBucket(uint64_t value) {
+    if (value < 2 * kSubBucketCount) {
+      return static_cast<size_t>(value);
+    }
+    uint32_t shift = GetHighestBit(value) - kSubBucketBits;
+    size_t bucket = static_cast<size_t>(
+        (shift + 1) * kSubBucketCount + (value >> shift) - kSubBucketCount);
+    FTRACE_ASSERT(bucket < kMaxBucketCount);
+    return bucket;
+  }
+
+  static uint64_t GetBucketStart(size_t bucket) {
+    if (bucket < 2 * kSubBucketCount) {
+      return bucket;
+    }
+    uint64_t shift = bucket / kSubBucketCount - 1;
+    return (bucket % kSubBucketCount + kSubBucketCount) << shift;
+  }
+
+  static uint64_t GetBucketEnd(size_t bucket) {
+    return GetBucketStart(bucket + 1) - 1;
+  }
+
+  uint64_t Compensate(uint64_t value) const {
+    return (value > offset_) ? value - offset_ : 0;
+  }
+
+ private: // Data
+  std::vector<uint64_t> count_list_;
+  uint64_t overflow_count_ = 0;
+  uint64_t total_count_ = 0;
+  uint64_t min_value_ = 0;
+  uint64_t max_value_ = 0;
+  uint64_t offset_ = 0;
+
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 12;
+};
+
+#endif // FTRACE_TOOLS_UTILS_LATENCY_HISTOGRAM_H_
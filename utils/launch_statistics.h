@@ -0,0 +1,252 @@
+#ifndef FTRACE_TOOLS_UTILS_LAUNCH_STATISTICS_H_
+#define FTRACE_TOOLS_UTILS_LAUNCH_STATISTICS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+struct LaunchOutlier {
+  uint64_t kernel_id;
+  uint64_t call_id; // 0 if launches are identified by kernel id only
+  uint64_t time;
+};
+
+// Welford's online mean and variance
+struct RunningStatistics {
+  uint64_t count = 0;
+  uint64_t total = 0;
+  double mean = 0.0;
+  double m2 = 0.0;
+
+  void Add(uint64_t value) {
+    ++count;
+    total += value;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+  }
+
+  double GetStdDev() const {
+    return (count > 1) ? std::sqrt(m2 / (count - 1)) : 0.0;
+  }
+};
+
+// Online statistics of the launches of a single kernel. First launches
+// (JIT compilation, page faults, cold caches) form a warm-up phase: either
+// the given number of launches, or, if it is zero, launches until the time
+// stays close to its EWMA for several launches in a row. Steady state
+// launches deviating from the EWMA by more than kOutlierSigma standard
+// deviations are flagged as outliers.
+// Not thread-safe, the owner is responsible for locking
+class LaunchStatistics {
+ public: // User Interface
+  void Record(
+      uint64_t time, uint64_t kernel_id, uint64_t call_id,
+      uint32_t warm_up_count) {
+    LaunchOutlier launch{kernel_id, call_id, time};
+    if (!steady_) {
+      if (warm_up_count > 0) {
+        if (cold_.count < warm_up_count) {
+          cold_.Add(time);
+          return;
+        }
+        steady_ = true;
+      } else {
+        bool settled = ewma_ready_ &&
+          std::fabs(time - ewma_) <= kSettleRatio * ewma_;
+        if (!settled) { // Warm-up goes on, EWMA starts over
+          ewma_ready_ = false;
+        }
+        UpdateEwma(time);
+        if (!settled) {
+          for (const LaunchOutlier& pending : pending_list_) {
+            cold_.Add(pending.time);
+          }
+          pending_list_.clear();
+          cold_.Add(time);
+          if (cold_.count >= kMaxWarmUpCount) {
+            steady_ = true;
+          }
+          return;
+        }
+
+        pending_list_.push_back(launch);
+        if (pending_list_.size() < kSettleCount) {
+          return;
+        }
+        steady_ = true;
+        for (const LaunchOutlier& pending : pending_list_) {
+          steady_stats_.Add(pending.time);
+        }
+        pending_list_.clear();
+        return;
+      }
+    }
+
+    AddSteady(launch);
+  }
+
+  static std::string GetSteadyStateTable(
+      const std::map<std::string, LaunchStatistics>& stats_map) {
+    std::vector< std::pair<std::string, const LaunchStatistics*> > list;
+    size_t max_name_length = kKernelLength;
+    for (auto& value : stats_map) {
+      list.push_back(std::make_pair(value.first, &value.second));
+      max_name_length = std::max(max_name_length, value.first.size());
+    }
+    std::sort(list.begin(), list.end(),
+              [](const std::pair<std::string, const LaunchStatistics*>& l,
+                 const std::pair<std::string, const LaunchStatistics*>& r) {
+                if (l.second->GetTotalTime() != r.second->GetTotalTime()) {
+                  return l.second->GetTotalTime() > r.second->GetTotalTime();
+                }
+                return l.first < r.first;
+              });
+    if (list.empty()) {
+      return std::string();
+    }
+
+    std::stringstream stream;
+    stream << std::setw(max_name_length) << "Kernel" << "," <<
+      std::setw(kCallsLength) << "Cold Calls" << "," <<
+      std::setw(kTimeLength) << "Cold Average (ns)" << "," <<
+      std::setw(kCallsLength) << "Steady Calls" << "," <<
+      std::setw(kTimeLength) << "Steady Average (ns)" << "," <<
+      std::setw(kTimeLength) << "Steady StdDev (ns)" << "," <<
+      std::setw(kPercentLength) << "CV (%)" << "," <<
+      std::setw(kCallsLength) << "Outliers" << std::endl;
+    for (auto& value : list) {
+      const LaunchStatistics* stats = value.second;
+      RunningStatistics cold = stats->cold_;
+      for (const LaunchOutlier& pending : stats->pending_list_) {
+        cold.Add(pending.time);
+      }
+      const RunningStatistics& steady = stats->steady_stats_;
+      double std_dev = steady.GetStdDev();
+      stream << std::setw(max_name_length) << value.first << "," <<
+        std::setw(kCallsLength) << cold.count << "," <<
+        std::setw(kTimeLength) << static_cast<uint64_t>(cold.mean) << "," <<
+        std::setw(kCallsLength) << steady.count << "," <<
+        std::setw(kTimeLength) << static_cast<uint64_t>(steady.mean) << "," <<
+        std::setw(kTimeLength) << static_cast<uint64_t>(std_dev) << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          ((steady.mean > 0) ? 100.0 * std_dev / steady.mean : 0.0) << "," <<
+        std::setw(kCallsLength) << stats->outlier_count_ << std::endl;
+    }
+
+    bool has_outliers = false;
+    for (auto& value : list) {
+      if (!value.second->outlier_list_.empty()) {
+        has_outliers = true;
+        break;
+      }
+    }
+    if (!has_outliers) {
+      return stream.str();
+    }
+
+    stream << std::endl;
+    stream << std::setw(max_name_length) << "Kernel" << "," <<
+      std::setw(kTimeLength) << "Id" << "," <<
+      std::setw(kTimeLength) << "Time (ns)" << "," <<
+      std::setw(kTimeLength) << "Steady Average (ns)" << std::endl;
+    for (auto& value : list) {
+      const LaunchStatistics* stats = value.second;
+      std::vector<LaunchOutlier> outlier_list = stats->outlier_list_;
+      std::sort(outlier_list.begin(), outlier_list.end(),
+                [](const LaunchOutlier& l, const LaunchOutlier& r) {
+                  return l.time > r.time;
+                });
+      for (const LaunchOutlier& outlier : outlier_list) {
+        std::string id = std::to_string(outlier.kernel_id);
+        if (outlier.call_id > 0) {
+          id += "." + std::to_string(outlier.call_id);
+        }
+        stream << std::setw(max_name_length) << value.first << "," <<
+          std::setw(kTimeLength) << id << "," <<
+          std::setw(kTimeLength) << outlier.time << "," <<
+          std::setw(kTimeLength) <<
+            static_cast<uint64_t>(stats->steady_stats_.mean) << std::endl;
+      }
+    }
+    return stream.str();
+  }
+
+ private: // Implementation
+  uint64_t GetTotalTime() const {
+    uint64_t total = cold_.total + steady_stats_.total;
+    for (const LaunchOutlier& pending : pending_list_) {
+      total += pending.time;
+    }
+    return total;
+  }
+
+  void UpdateEwma(uint64_t time) {
+    if (!ewma_ready_) {
+      ewma_ = static_cast<double>(time);
+      ewma_ready_ = true;
+    } else {
+      ewma_ += kEwmaWeight * (time - ewma_);
+    }
+  }
+
+  void AddSteady(const LaunchOutlier& launch) {
+    bool outlier = steady_stats_.count >= kMinSteadyCount &&
+      std::fabs(launch.time - ewma_) >
+        kOutlierSigma * steady_stats_.GetStdDev();
+    // EWMA follows all the launches, so level shift is not reported
+    // as outliers forever
+    UpdateEwma(launch.time);
+    steady_stats_.Add(launch.time);
+    if (!outlier) {
+      return;
+    }
+
+    ++outlier_count_;
+    if (outlier_list_.size() < kMaxOutlierCount) {
+      outlier_list_.push_back(launch);
+      return;
+    }
+    auto it = std::min_element(
+        outlier_list_.begin(), outlier_list_.end(),
+        [](const LaunchOutlier& l, const LaunchOutlier& r) {
+          return l.time < r.time;
+        });
+    if (it->time < launch.time) {
+      *it = launch;
+    }
+  }
+
+ private: // Data
+  RunningStatistics cold_;
+  RunningStatistics steady_stats_;
+  std::vector<LaunchOutlier> pending_list_;
+  std::vector<LaunchOutlier> outlier_list_; // The slowest ones are kept
+  uint64_t outlier_count_ = 0;
+  double ewma_ = 0.0;
+  bool ewma_ready_ = false;
+  bool steady_ = false;
+
+  static constexpr double kEwmaWeight = 0.125;
+  static constexpr double kSettleRatio = 0.1;
+  static constexpr double kOutlierSigma = 3.0;
+  static const size_t kSettleCount = 3;
+  static const uint64_t kMaxWarmUpCount = 64;
+  static const uint64_t kMinSteadyCount = 8;
+  static const size_t kMaxOutlierCount = 8;
+
+  static const uint32_t kKernelLength = 10;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 12;
+};
+
+#endif // FTRACE_TOOLS_UTILS_LAUNCH_STATISTICS_H_
@@ -1,6 +1,7 @@
 #ifndef FTRACE_TOOLS_UTILS_LOGGER_H_
 #define FTRACE_TOOLS_UTILS_LOGGER_H_
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
 #include <mutex>
@@ -30,6 +31,7 @@ class Logger {
   }
 
   void Log(const std::string& text) {
+    logged_bytes_.fetch_add(text.size(), std::memory_order_relaxed);
     if (file_.is_open()) {
       if (lock_free_) {
         file_ << text;
@@ -70,6 +72,10 @@ class Logger {
     return log_file_name_;
   }
 
+  uint64_t GetLoggedBytes() const {
+    return logged_bytes_.load(std::memory_order_relaxed);
+  }
+
   std::iostream::pos_type GetLogFilePosition() {
     return file_.tellp();
   }
@@ -80,6 +86,7 @@ class Logger {
   std::ofstream file_;
   bool lazy_flush_;
   bool lock_free_;	// caller deal with concurrency?
+  std::atomic<uint64_t> logged_bytes_{0};
 };
 
 #endif // FTRACE_TOOLS_UTILS_LOGGER_H_
@@ -0,0 +1,24 @@
+#include "memory_tracker.h"
+
+std::atomic<bool> MemoryTracker::enabled_{false};
+OnMemoryCallback MemoryTracker::callback_ = nullptr;
+void* MemoryTracker::callback_data_ = nullptr;
+std::mutex MemoryTracker::callback_lock_;
+
+std::mutex MemoryTracker::lock_;
+std::unordered_map<const void*, MemoryTracker::Allocation>
+  MemoryTracker::live_map_;
+std::unordered_map<
+    MemoryTracker::PoolKey, uint32_t, MemoryTracker::KeyHash>
+  MemoryTracker::pool_map_;
+std::vector<MemoryTracker::Pool> MemoryTracker::pool_list_;
+std::unordered_map<
+    MemoryTracker::SiteKey, uint32_t, MemoryTracker::KeyHash>
+  MemoryTracker::site_map_;
+std::vector<MemoryTracker::Site> MemoryTracker::site_list_;
+std::unordered_map<const void*, MemoryTracker::DeviceUsage>
+  MemoryTracker::device_map_;
+uint64_t MemoryTracker::live_ = 0;
+uint64_t MemoryTracker::peak_ = 0;
+std::vector<MemoryTracker::SiteBytes> MemoryTracker::snapshot_;
+uint64_t MemoryTracker::snapshot_bytes_ = 0;
@@ -0,0 +1,457 @@
+#ifndef FTRACE_TOOLS_UTILS_MEMORY_TRACKER_H_
+#define FTRACE_TOOLS_UTILS_MEMORY_TRACKER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+enum MemoryType {
+  MEMORY_TYPE_HOST = 0,
+  MEMORY_TYPE_DEVICE,
+  MEMORY_TYPE_SHARED,
+  MEMORY_TYPE_BUFFER,
+  MEMORY_TYPE_IMAGE,
+  MEMORY_TYPE_COUNT
+};
+
+// Live bytes of all the types on the device (nullptr for host memory)
+typedef void (*OnMemoryCallback)(
+    void* data, const void* device, const uint64_t* live_bytes);
+
+// Process-wide footprint of device and USM memory. Live and peak bytes are
+// kept per device, context and type, allocation site is the allocating
+// function, device and size. Allocation and free cost O(1); sites live at
+// peak are copied when the peak grows by more than 1 / kSnapshotRatio since
+// the previous copy, so their number is logarithmic in the peak. The
+// callback is called out of the tracker lock with a copy of the usage
+class MemoryTracker {
+ public: // User Interface
+  static void Enable(OnMemoryCallback callback, void* callback_data) {
+    {
+      const std::lock_guard<std::mutex> lock(callback_lock_);
+      callback_ = callback;
+      callback_data_ = callback_data;
+    }
+    enabled_.store(true, std::memory_order_release);
+  }
+
+  // Callback is not called after return, so its data can be released,
+  // while memory is still tracked for hooks that outlive the tracer
+  static void Disable() {
+    const std::lock_guard<std::mutex> lock(callback_lock_);
+    callback_ = nullptr;
+    callback_data_ = nullptr;
+  }
+
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  static void Add(
+      const void* handle, uint64_t size, MemoryType type,
+      const void* device, const void* context, const char* function) {
+    if (!IsEnabled()) {
+      return;
+    }
+    FTRACE_ASSERT(handle != nullptr);
+    FTRACE_ASSERT(type < MEMORY_TYPE_COUNT);
+    FTRACE_ASSERT(function != nullptr);
+
+    const void* removed_device = nullptr;
+    bool removed = false;
+    {
+      const std::lock_guard<std::mutex> lock(lock_);
+      // Missed free, e.g. implicit one
+      removed = RemoveLive(handle, &removed_device);
+      AddLive(handle, size, type, device, context, function);
+    }
+
+    if (removed && removed_device != device) {
+      Notify(removed_device);
+    }
+    Notify(device);
+  }
+
+  static void Remove(const void* handle) {
+    if (!IsEnabled()) {
+      return;
+    }
+    const void* device = nullptr;
+    bool removed = false;
+    {
+      const std::lock_guard<std::mutex> lock(lock_);
+      removed = RemoveLive(handle, &device);
+    }
+    if (removed) {
+      Notify(device);
+    }
+  }
+
+  static std::string GetMemoryTable() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    if (pool_list_.empty()) {
+      return std::string();
+    }
+
+    std::vector<const Pool*> list;
+    for (const Pool& pool : pool_list_) {
+      list.push_back(&pool);
+    }
+    std::sort(list.begin(), list.end(),
+              [](const Pool* l, const Pool* r) {
+                return l->peak > r->peak;
+              });
+
+    std::stringstream stream;
+    stream << "Total Peak (bytes): " << peak_ <<
+      ", Live at Exit (bytes): " << live_ << std::endl;
+    stream << std::endl;
+    stream << std::setw(kHandleLength) << "Device" << "," <<
+      std::setw(kHandleLength) << "Context" << "," <<
+      std::setw(kTypeLength) << "Type" << "," <<
+      std::setw(kCallsLength) << "Allocations" << "," <<
+      std::setw(kCallsLength) << "Frees" << "," <<
+      std::setw(kBytesLength) << "Peak (bytes)" << "," <<
+      std::setw(kBytesLength) << "Live at Exit (bytes)" << std::endl;
+    for (const Pool* pool : list) {
+      stream << std::setw(kHandleLength) << GetDeviceName(pool->key.device) <<
+        "," << std::setw(kHandleLength) << pool->key.context << "," <<
+        std::setw(kTypeLength) << GetTypeName(pool->key.type) << "," <<
+        std::setw(kCallsLength) << pool->alloc_count << "," <<
+        std::setw(kCallsLength) << pool->free_count << "," <<
+        std::setw(kBytesLength) << pool->peak << "," <<
+        std::setw(kBytesLength) << pool->live << std::endl;
+    }
+    return stream.str();
+  }
+
+  static std::string GetPeakSiteTable() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    if (snapshot_.empty()) {
+      return std::string();
+    }
+
+    std::vector<SiteBytes> list = snapshot_;
+    std::sort(list.begin(), list.end(),
+              [](const SiteBytes& l, const SiteBytes& r) {
+                return l.bytes > r.bytes;
+              });
+    if (list.size() > kMaxSiteCount) {
+      list.resize(kMaxSiteCount);
+    }
+
+    std::stringstream stream;
+    stream << "Top Sites at Peak (" << snapshot_bytes_ << " bytes):" <<
+      std::endl;
+    PrintSites(stream, list, "Peak (%)", snapshot_bytes_);
+    return stream.str();
+  }
+
+  static std::string GetLeakTable() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    if (live_map_.empty()) {
+      return std::string();
+    }
+
+    std::vector<SiteBytes> list;
+    for (size_t i = 0; i < site_list_.size(); ++i) {
+      if (site_list_[i].live_count > 0) {
+        list.push_back({static_cast<uint32_t>(i),
+                        site_list_[i].live_count, site_list_[i].live});
+      }
+    }
+    std::sort(list.begin(), list.end(),
+              [](const SiteBytes& l, const SiteBytes& r) {
+                return l.bytes > r.bytes;
+              });
+
+    std::stringstream stream;
+    stream << "Leaks (" << live_map_.size() << " allocations, " <<
+      live_ << " bytes not released at exit):" << std::endl;
+    PrintSites(stream, list, "Leaked (%)", live_);
+    return stream.str();
+  }
+
+  static const char* GetTypeName(MemoryType type) {
+    switch (type) {
+      case MEMORY_TYPE_HOST:
+        return "Host";
+      case MEMORY_TYPE_DEVICE:
+        return "Device";
+      case MEMORY_TYPE_SHARED:
+        return "Shared";
+      case MEMORY_TYPE_BUFFER:
+        return "Buffer";
+      case MEMORY_TYPE_IMAGE:
+        return "Image";
+      default:
+        break;
+    }
+    return "Unknown";
+  }
+
+  static std::string GetDeviceName(const void* device) {
+    if (device == nullptr) {
+      return "Host";
+    }
+    std::stringstream stream;
+    stream << device;
+    return stream.str();
+  }
+
+ private: // Implementation
+  struct PoolKey {
+    const void* device;
+    const void* context;
+    MemoryType type;
+
+    bool operator==(const PoolKey& r) const {
+      return device == r.device && context == r.context && type == r.type;
+    }
+  };
+
+  struct SiteKey {
+    const char* function;
+    const void* device;
+    uint64_t size;
+
+    bool operator==(const SiteKey& r) const {
+      return function == r.function && device == r.device && size == r.size;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const PoolKey& key) const {
+      uint64_t hash = kOffsetBasis;
+      Combine(hash, reinterpret_cast<uintptr_t>(key.device));
+      Combine(hash, reinterpret_cast<uintptr_t>(key.context));
+      Combine(hash, key.type);
+      return static_cast<size_t>(hash);
+    }
+
+    size_t operator()(const SiteKey& key) const {
+      uint64_t hash = kOffsetBasis;
+      Combine(hash, reinterpret_cast<uintptr_t>(key.function));
+      Combine(hash, reinterpret_cast<uintptr_t>(key.device));
+      Combine(hash, key.size);
+      return static_cast<size_t>(hash);
+    }
+
+    static void Combine(uint64_t& hash, uint64_t value) {
+      hash ^= value;
+      hash *= 1099511628211ull; // FNV-1a prime
+    }
+
+    static const uint64_t kOffsetBasis = 14695981039346656037ull;
+  };
+
+  struct Pool {
+    PoolKey key;
+    uint64_t live;
+    uint64_t peak;
+    uint64_t alloc_count;
+    uint64_t free_count;
+  };
+
+  struct Site {
+    SiteKey key;
+    uint64_t live;
+    uint64_t live_count;
+  };
+
+  struct SiteBytes {
+    uint32_t site;
+    uint64_t count;
+    uint64_t bytes;
+  };
+
+  struct Allocation {
+    uint64_t size;
+    uint32_t pool;
+    uint32_t site;
+  };
+
+  struct DeviceUsage {
+    uint64_t live[MEMORY_TYPE_COUNT];
+  };
+
+  static uint32_t GetPool(const PoolKey& key) {
+    auto it = pool_map_.find(key);
+    if (it != pool_map_.end()) {
+      return it->second;
+    }
+    uint32_t pool = static_cast<uint32_t>(pool_list_.size());
+    pool_list_.push_back({key, 0, 0, 0, 0});
+    pool_map_[key] = pool;
+    return pool;
+  }
+
+  static uint32_t GetSite(const SiteKey& key) {
+    auto it = site_map_.find(key);
+    if (it != site_map_.end()) {
+      return it->second;
+    }
+    uint32_t site = static_cast<uint32_t>(site_list_.size());
+    site_list_.push_back({key, 0, 0});
+    site_map_[key] = site;
+    return site;
+  }
+
+  static void AddLive(
+      const void* handle, uint64_t size, MemoryType type,
+      const void* device, const void* context, const char* function) {
+    uint32_t pool = GetPool({device, context, type});
+    uint32_t site = GetSite({function, device, size});
+    live_map_[handle] = {size, pool, site};
+
+    Pool& pool_info = pool_list_[pool];
+    pool_info.live += size;
+    pool_info.peak = std::max(pool_info.peak, pool_info.live);
+    ++pool_info.alloc_count;
+
+    Site& site_info = site_list_[site];
+    site_info.live += size;
+    ++site_info.live_count;
+
+    live_ += size;
+    if (live_ > peak_) {
+      peak_ = live_;
+      if (peak_ > snapshot_bytes_ + snapshot_bytes_ / kSnapshotRatio) {
+        TakeSnapshot();
+      }
+    }
+
+    UpdateUsage(device, type, size, true);
+  }
+
+  // Returns false if the handle is not live
+  static bool RemoveLive(const void* handle, const void** device) {
+    FTRACE_ASSERT(device != nullptr);
+    auto it = live_map_.find(handle);
+    if (it == live_map_.end()) {
+      return false;
+    }
+    Allocation allocation = it->second;
+    live_map_.erase(it);
+
+    Pool& pool = pool_list_[allocation.pool];
+    FTRACE_ASSERT(pool.live >= allocation.size);
+    pool.live -= allocation.size;
+    ++pool.free_count;
+
+    Site& site = site_list_[allocation.site];
+    FTRACE_ASSERT(site.live_count > 0);
+    site.live -= allocation.size;
+    --site.live_count;
+
+    FTRACE_ASSERT(live_ >= allocation.size);
+    live_ -= allocation.size;
+
+    UpdateUsage(pool.key.device, pool.key.type, allocation.size, false);
+    *device = pool.key.device;
+    return true;
+  }
+
+  static void TakeSnapshot() {
+    snapshot_.clear();
+    for (size_t i = 0; i < site_list_.size(); ++i) {
+      if (site_list_[i].live_count > 0) {
+        snapshot_.push_back({static_cast<uint32_t>(i),
+                             site_list_[i].live_count, site_list_[i].live});
+      }
+    }
+    snapshot_bytes_ = live_;
+  }
+
+  static void UpdateUsage(
+      const void* device, MemoryType type, uint64_t size, bool added) {
+    DeviceUsage& usage = device_map_[device];
+    if (added) {
+      usage.live[type] += size;
+    } else {
+      FTRACE_ASSERT(usage.live[type] >= size);
+      usage.live[type] -= size;
+    }
+  }
+
+  // Usage is copied under the callback lock, so callbacks for the same
+  // device are never delivered out of order
+  static void Notify(const void* device) {
+    const std::lock_guard<std::mutex> callback_lock(callback_lock_);
+    if (callback_ == nullptr) {
+      return;
+    }
+    DeviceUsage usage{};
+    {
+      const std::lock_guard<std::mutex> lock(lock_);
+      usage = device_map_[device];
+    }
+    callback_(callback_data_, device, usage.live);
+  }
+
+  static void PrintSites(
+      std::stringstream& stream, const std::vector<SiteBytes>& list,
+      const char* percent_name, uint64_t total) {
+    size_t max_name_length = kFunctionLength;
+    for (const SiteBytes& value : list) {
+      max_name_length = std::max(
+          max_name_length,
+          std::string(site_list_[value.site].key.function).size());
+    }
+
+    stream << std::setw(max_name_length) << "Function" << "," <<
+      std::setw(kHandleLength) << "Device" << "," <<
+      std::setw(kBytesLength) << "Size (bytes)" << "," <<
+      std::setw(kCallsLength) << "Count" << "," <<
+      std::setw(kBytesLength) << "Total (bytes)" << "," <<
+      std::setw(kPercentLength) << percent_name << std::endl;
+    for (const SiteBytes& value : list) {
+      const SiteKey& key = site_list_[value.site].key;
+      stream << std::setw(max_name_length) << key.function << "," <<
+        std::setw(kHandleLength) << GetDeviceName(key.device) << "," <<
+        std::setw(kBytesLength) << key.size << "," <<
+        std::setw(kCallsLength) << value.count << "," <<
+        std::setw(kBytesLength) << value.bytes << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          ((total > 0) ? 100.0 * value.bytes / total : 0.0) << std::endl;
+    }
+  }
+
+ private: // Data
+  static std::atomic<bool> enabled_;
+  static OnMemoryCallback callback_;
+  static void* callback_data_;
+  static std::mutex callback_lock_;
+
+  static std::mutex lock_;
+  static std::unordered_map<const void*, Allocation> live_map_;
+  static std::unordered_map<PoolKey, uint32_t, KeyHash> pool_map_;
+  static std::vector<Pool> pool_list_;
+  static std::unordered_map<SiteKey, uint32_t, KeyHash> site_map_;
+  static std::vector<Site> site_list_;
+  static std::unordered_map<const void*, DeviceUsage> device_map_;
+  static uint64_t live_;
+  static uint64_t peak_;
+  static std::vector<SiteBytes> snapshot_;
+  static uint64_t snapshot_bytes_;
+
+  static const uint64_t kSnapshotRatio = 64;
+  static const size_t kMaxSiteCount = 10;
+
+  static const uint32_t kFunctionLength = 10;
+  static const uint32_t kHandleLength = 16;
+  static const uint32_t kTypeLength = 8;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kBytesLength = 20;
+  static const uint32_t kPercentLength = 12;
+};
+
+#endif // FTRACE_TOOLS_UTILS_MEMORY_TRACKER_H_
@@ -0,0 +1,7 @@
+#include "module_builds.h"
+
+std::atomic<bool> ModuleBuilds::enabled_{false};
+std::mutex ModuleBuilds::lock_;
+std::string ModuleBuilds::index_file_;
+ModuleBuilds::BuildMap ModuleBuilds::build_map_;
+std::map<uint64_t, ModuleBuilds::IndexEntry> ModuleBuilds::index_map_;
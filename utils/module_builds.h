@@ -0,0 +1,287 @@
+#ifndef FTRACE_TOOLS_UTILS_MODULE_BUILDS_H_
+#define FTRACE_TOOLS_UTILS_MODULE_BUILDS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+const char* const kModuleIndexHeader = "# FineTrace Module Build Index v1";
+
+// Process-wide build time of device modules (Level Zero modules and
+// OpenCL(TM) programs) per fingerprint of the input and build options
+// and per device. Any build of the same module on the same device after
+// the first one is a duplicate. Optional index file keeps modules over
+// runs, modules built again in each run would benefit from a persistent
+// (on disk) cache, duplicates within the run - from module reuse or
+// driver in-memory cache
+class ModuleBuilds {
+ public: // User Interface
+  static void Enable(const std::string& index_file) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    index_file_ = index_file;
+    if (!index_file_.empty()) {
+      LoadIndex();
+    }
+    enabled_.store(true, std::memory_order_release);
+  }
+
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  static uint64_t GetFingerprint(uint64_t input_hash, const char* options) {
+    uint64_t fingerprint = kOffsetBasis;
+    Combine(fingerprint, input_hash);
+    if (options != nullptr) {
+      for (const char* c = options; *c != '\0'; ++c) {
+        Combine(fingerprint, static_cast<uint8_t>(*c));
+      }
+    }
+    return fingerprint;
+  }
+
+  // Specialization constants select different variants of the same
+  // input, so their ids and values are a part of it
+  static uint64_t GetConstantHash(
+      uint32_t id, const void* value, size_t size) {
+    uint64_t hash = kOffsetBasis;
+    Combine(hash, id);
+    if (value != nullptr) {
+      const uint8_t* data = static_cast<const uint8_t*>(value);
+      for (size_t i = 0; i < size; ++i) {
+        Combine(hash, data[i]);
+      }
+    }
+    return hash;
+  }
+
+  static void AddBuild(
+      const char* function, uint64_t fingerprint, uint64_t size,
+      const void* device, uint64_t time) {
+    if (!IsEnabled()) {
+      return;
+    }
+    FTRACE_ASSERT(function != nullptr);
+
+    const std::lock_guard<std::mutex> lock(lock_);
+    Build& build = build_map_[std::make_pair(fingerprint, device)];
+    if (build.count == 0) {
+      build.function = function;
+      build.size = size;
+      build.first_time = time;
+    }
+    ++build.count;
+    build.time += time;
+  }
+
+  static std::string GetBuildTable() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    if (build_map_.empty()) {
+      return std::string();
+    }
+
+    std::vector<const BuildMap::value_type*> list;
+    size_t max_function_length = kFunctionLength;
+    uint64_t build_count = 0, duplicate_count = 0;
+    uint64_t total_time = 0, duplicate_time = 0;
+    uint64_t cached_count = 0, cached_time = 0;
+    for (auto& value : build_map_) {
+      const Build& build = value.second;
+      list.push_back(&value);
+      max_function_length =
+        std::max(max_function_length, build.function.size());
+      build_count += build.count;
+      duplicate_count += build.count - 1;
+      total_time += build.time;
+      duplicate_time += build.time - build.first_time;
+      if (GetPreviousRuns(value.first.first) > 0) {
+        ++cached_count;
+        cached_time += build.first_time;
+      }
+    }
+
+    std::sort(list.begin(), list.end(),
+              [](const BuildMap::value_type* l,
+                 const BuildMap::value_type* r) {
+                if (l->second.time != r->second.time) {
+                  return l->second.time > r->second.time;
+                }
+                return l->first < r->first;
+              });
+
+    std::stringstream stream;
+    stream << "Builds: " << build_count << ", Unique: " << list.size() <<
+      ", Duplicates: " << duplicate_count << ", Build Time (ns): " <<
+      total_time << ", Duplicate Time (ns): " << duplicate_time << std::endl;
+    if (!index_file_.empty()) {
+      stream << "Built in Previous Runs: " << cached_count <<
+        ", First Build Time (ns): " << cached_time << std::endl;
+    }
+    stream << std::endl;
+
+    stream << std::setw(kFingerprintLength) << "Fingerprint" << "," <<
+      std::setw(max_function_length) << "Function" << "," <<
+      std::setw(kHandleLength) << "Device" << "," <<
+      std::setw(kBytesLength) << "Size (bytes)" << "," <<
+      std::setw(kCallsLength) << "Builds" << "," <<
+      std::setw(kTimeLength) << "Total (ns)" << "," <<
+      std::setw(kTimeLength) << "First (ns)" << "," <<
+      std::setw(kTimeLength) << "Duplicate (ns)";
+    if (!index_file_.empty()) {
+      stream << "," << std::setw(kCallsLength) << "Prev Runs";
+    }
+    stream << std::endl;
+    for (auto value : list) {
+      const Build& build = value->second;
+      std::stringstream fingerprint;
+      fingerprint << std::hex << std::setw(16) << std::setfill('0') <<
+        value->first.first;
+      stream << std::setw(kFingerprintLength) << fingerprint.str() << "," <<
+        std::setw(max_function_length) << build.function << "," <<
+        std::setw(kHandleLength) << value->first.second << "," <<
+        std::setw(kBytesLength) << build.size << "," <<
+        std::setw(kCallsLength) << build.count << "," <<
+        std::setw(kTimeLength) << build.time << "," <<
+        std::setw(kTimeLength) << build.first_time << "," <<
+        std::setw(kTimeLength) << build.time - build.first_time;
+      if (!index_file_.empty()) {
+        stream << "," << std::setw(kCallsLength) <<
+          GetPreviousRuns(value->first.first);
+      }
+      stream << std::endl;
+    }
+    return stream.str();
+  }
+
+  // Adds modules of this run to the index, device handles are not stable
+  // over runs so modules are merged over devices
+  static bool SaveIndex() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    if (index_file_.empty()) {
+      return true;
+    }
+
+    std::map<uint64_t, IndexEntry> index_map = index_map_;
+    std::map<uint64_t, bool> seen;
+    for (auto& value : build_map_) {
+      uint64_t fingerprint = value.first.first;
+      IndexEntry& entry = index_map[fingerprint];
+      if (!seen[fingerprint]) {
+        seen[fingerprint] = true;
+        ++entry.runs;
+      }
+      entry.size = value.second.size;
+      entry.builds += value.second.count;
+      entry.time += value.second.time;
+    }
+
+    std::ofstream stream(index_file_);
+    if (!stream.is_open()) {
+      return false;
+    }
+    stream << kModuleIndexHeader << std::endl;
+    for (auto& value : index_map) {
+      stream << std::hex << value.first << std::dec << " " <<
+        value.second.size << " " << value.second.runs << " " <<
+        value.second.builds << " " << value.second.time << std::endl;
+    }
+    return stream.good();
+  }
+
+  static std::string GetIndexFileName() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    return index_file_;
+  }
+
+ private: // Implementation
+  struct Build {
+    std::string function;
+    uint64_t size = 0;
+    uint64_t count = 0;
+    uint64_t time = 0;
+    uint64_t first_time = 0;
+  };
+
+  struct IndexEntry {
+    uint64_t size = 0;
+    uint64_t runs = 0;
+    uint64_t builds = 0;
+    uint64_t time = 0;
+  };
+
+  using BuildMap = std::map<std::pair<uint64_t, const void*>, Build>;
+
+  // Missing or malformed index is started from scratch
+  static void LoadIndex() {
+    std::ifstream stream(index_file_);
+    if (!stream.is_open()) {
+      return;
+    }
+
+    std::string line;
+    if (!std::getline(stream, line) || line != kModuleIndexHeader) {
+      std::cerr << "[WARNING] " << index_file_ <<
+        " is not a module build index, it will be overwritten" << std::endl;
+      return;
+    }
+
+    while (std::getline(stream, line)) {
+      if (line.empty()) {
+        continue;
+      }
+      std::stringstream record(line);
+      uint64_t fingerprint = 0;
+      IndexEntry entry;
+      if (!(record >> std::hex >> fingerprint >> std::dec >> entry.size >>
+            entry.runs >> entry.builds >> entry.time)) {
+        std::cerr << "[WARNING] Malformed record in " << index_file_ <<
+          std::endl;
+        index_map_.clear();
+        return;
+      }
+      index_map_[fingerprint] = entry;
+    }
+  }
+
+  static uint64_t GetPreviousRuns(uint64_t fingerprint) {
+    auto it = index_map_.find(fingerprint);
+    if (it == index_map_.end()) {
+      return 0;
+    }
+    return it->second.runs;
+  }
+
+  static void Combine(uint64_t& hash, uint64_t value) {
+    hash ^= value;
+    hash *= 1099511628211ull; // FNV-1a prime
+  }
+
+ private: // Data
+  static std::atomic<bool> enabled_;
+  static std::mutex lock_;
+  static std::string index_file_;
+  static BuildMap build_map_;
+  static std::map<uint64_t, IndexEntry> index_map_;
+
+  static const uint64_t kOffsetBasis = 14695981039346656037ull;
+
+  static const uint32_t kFingerprintLength = 16;
+  static const uint32_t kFunctionLength = 10;
+  static const uint32_t kHandleLength = 16;
+  static const uint32_t kBytesLength = 16;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+};
+
+#endif // FTRACE_TOOLS_UTILS_MODULE_BUILDS_H_
@@ -0,0 +1,254 @@
+#ifndef FTRACE_TOOLS_UTILS_OBJECT_CHURN_H_
+#define FTRACE_TOOLS_UTILS_OBJECT_CHURN_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+enum ObjectType {
+  OBJECT_TYPE_COMMAND_LIST = 0,
+  OBJECT_TYPE_EVENT_POOL,
+  OBJECT_TYPE_MODULE,
+  OBJECT_TYPE_KERNEL,
+  OBJECT_TYPE_PROGRAM,
+  OBJECT_TYPE_BUFFER,
+  OBJECT_TYPE_COUNT
+};
+
+// Lifetimes of driver objects the application could reuse. Each object
+// lives through generations: from creation or reset to the next reset or
+// destruction. Generation signature is the object type, fingerprint of
+// creation parameters and fingerprint of commands appended to it (for
+// command lists, builds for OpenCL(TM) programs), so generations with the
+// same signature are rebuilds of the same object. Host time of a
+// generation is the time spent in create, append (build), reset and
+// destroy calls, all but one rebuild of the same object are counted as
+// recoverable by reuse.
+// Not thread-safe, the owner is responsible for locking
+class ObjectChurn {
+ public: // User Interface
+  void AddObject(
+      ObjectType type, const void* handle, uint64_t fingerprint,
+      const std::string& label, uint64_t time) {
+    FTRACE_ASSERT(type < OBJECT_TYPE_COUNT);
+    FTRACE_ASSERT(handle != nullptr);
+    Live& live = live_map_[handle];
+    live = Live{type, fingerprint, kOffsetBasis, 0, time, label};
+    ++type_list_[type].create_count;
+    type_list_[type].time += time;
+  }
+
+  // Creation fingerprint of a live object, e.g. module of the kernel
+  uint64_t GetFingerprint(const void* handle) const {
+    auto it = live_map_.find(handle);
+    if (it == live_map_.end()) {
+      return 0;
+    }
+    return it->second.fingerprint;
+  }
+
+  void AddCommand(const void* handle, uint64_t fingerprint, uint64_t time) {
+    auto it = live_map_.find(handle);
+    if (it == live_map_.end()) {
+      return;
+    }
+    Combine(it->second.content, fingerprint);
+    ++it->second.command_count;
+    it->second.time += time;
+    type_list_[it->second.type].time += time;
+  }
+
+  void ResetObject(const void* handle, uint64_t time) {
+    auto it = live_map_.find(handle);
+    if (it == live_map_.end()) {
+      return;
+    }
+    Live& live = it->second;
+    CloseGeneration(live);
+    live.content = kOffsetBasis;
+    live.command_count = 0;
+    live.time = time;
+    ++type_list_[live.type].reset_count;
+    type_list_[live.type].time += time;
+  }
+
+  void RemoveObject(const void* handle, uint64_t time) {
+    auto it = live_map_.find(handle);
+    if (it == live_map_.end()) {
+      return;
+    }
+    Live& live = it->second;
+    live.time += time;
+    ++type_list_[live.type].destroy_count;
+    type_list_[live.type].time += time;
+    CloseGeneration(live);
+    live_map_.erase(it);
+  }
+
+  std::string GetChurnTable() const {
+    uint64_t total_count = 0;
+    for (uint32_t type = 0; type < OBJECT_TYPE_COUNT; ++type) {
+      total_count += type_list_[type].create_count;
+    }
+    if (total_count == 0) {
+      return std::string();
+    }
+
+    std::vector<const Group*> list;
+    size_t max_label_length = kLabelLength;
+    uint64_t recoverable_time = 0;
+    for (auto& value : group_map_) {
+      const Group& group = value.second;
+      if (group.count < 2) {
+        continue;
+      }
+      list.push_back(&group);
+      max_label_length = std::max(max_label_length, group.label.size());
+      recoverable_time += GetRecoverableTime(group);
+    }
+
+    std::stringstream stream;
+    stream << std::setw(kTypeLength) << "Type" << "," <<
+      std::setw(kCallsLength) << "Created" << "," <<
+      std::setw(kCallsLength) << "Reset" << "," <<
+      std::setw(kCallsLength) << "Destroyed" << "," <<
+      std::setw(kTimeLength) << "Host Time (ns)" << std::endl;
+    for (uint32_t type = 0; type < OBJECT_TYPE_COUNT; ++type) {
+      const TypeInfo& info = type_list_[type];
+      if (info.create_count == 0) {
+        continue;
+      }
+      stream << std::setw(kTypeLength) <<
+          GetTypeName(static_cast<ObjectType>(type)) << "," <<
+        std::setw(kCallsLength) << info.create_count << "," <<
+        std::setw(kCallsLength) << info.reset_count << "," <<
+        std::setw(kCallsLength) << info.destroy_count << "," <<
+        std::setw(kTimeLength) << info.time << std::endl;
+    }
+
+    if (list.empty()) {
+      return stream.str();
+    }
+
+    std::sort(list.begin(), list.end(),
+              [](const Group* l, const Group* r) {
+                uint64_t l_time = GetRecoverableTime(*l);
+                uint64_t r_time = GetRecoverableTime(*r);
+                if (l_time != r_time) {
+                  return l_time > r_time;
+                }
+                return l->count > r->count;
+              });
+
+    stream << std::endl;
+    stream << "Objects Rebuilt with Identical Contents (recoverable " <<
+      "host time " << recoverable_time << " ns):" << std::endl;
+    stream << std::setw(kTypeLength) << "Type" << "," <<
+      std::setw(max_label_length) << "Object" << "," <<
+      std::setw(kCallsLength) << "Rebuilds" << "," <<
+      std::setw(kCallsLength) << "Commands" << "," <<
+      std::setw(kTimeLength) << "Host Time (ns)" << "," <<
+      std::setw(kTimeLength) << "Recoverable (ns)" << std::endl;
+    for (auto group : list) {
+      stream << std::setw(kTypeLength) << GetTypeName(group->type) << "," <<
+        std::setw(max_label_length) << group->label << "," <<
+        std::setw(kCallsLength) << group->count << "," <<
+        std::setw(kCallsLength) << group->command_count << "," <<
+        std::setw(kTimeLength) << group->time << "," <<
+        std::setw(kTimeLength) << GetRecoverableTime(*group) << std::endl;
+    }
+    return stream.str();
+  }
+
+  static const char* GetTypeName(ObjectType type) {
+    switch (type) {
+      case OBJECT_TYPE_COMMAND_LIST:
+        return "Command List";
+      case OBJECT_TYPE_EVENT_POOL:
+        return "Event Pool";
+      case OBJECT_TYPE_MODULE:
+        return "Module";
+      case OBJECT_TYPE_KERNEL:
+        return "Kernel";
+      case OBJECT_TYPE_PROGRAM:
+        return "Program";
+      case OBJECT_TYPE_BUFFER:
+        return "Buffer";
+      default:
+        break;
+    }
+    return "Unknown";
+  }
+
+  static void Combine(uint64_t& hash, uint64_t value) {
+    hash ^= value;
+    hash *= 1099511628211ull; // FNV-1a prime
+  }
+
+  static const uint64_t kOffsetBasis = 14695981039346656037ull;
+
+ private: // Implementation
+  struct Live {
+    ObjectType type;
+    uint64_t fingerprint;
+    uint64_t content;
+    uint64_t command_count;
+    uint64_t time;
+    std::string label;
+  };
+
+  struct Group {
+    ObjectType type;
+    std::string label;
+    uint64_t command_count; // Per generation
+    uint64_t count;
+    uint64_t time;
+  };
+
+  struct TypeInfo {
+    uint64_t create_count;
+    uint64_t reset_count;
+    uint64_t destroy_count;
+    uint64_t time;
+  };
+
+  void CloseGeneration(const Live& live) {
+    uint64_t signature = kOffsetBasis;
+    Combine(signature, live.type);
+    Combine(signature, live.fingerprint);
+    Combine(signature, live.content);
+
+    auto it = group_map_.find(signature);
+    if (it == group_map_.end()) {
+      group_map_[signature] =
+        Group{live.type, live.label, live.command_count, 1, live.time};
+    } else {
+      ++it->second.count;
+      it->second.time += live.time;
+    }
+  }
+
+  // Expected to be paid once if the object is kept and reused
+  static uint64_t GetRecoverableTime(const Group& group) {
+    FTRACE_ASSERT(group.count > 0);
+    return group.time - group.time / group.count;
+  }
+
+ private: // Data
+  std::unordered_map<const void*, Live> live_map_;
+  std::unordered_map<uint64_t, Group> group_map_;
+  TypeInfo type_list_[OBJECT_TYPE_COUNT] = {};
+
+  static const uint32_t kTypeLength = 12;
+  static const uint32_t kLabelLength = 10;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+};
+
+#endif // FTRACE_TOOLS_UTILS_OBJECT_CHURN_H_
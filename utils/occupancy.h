@@ -0,0 +1,298 @@
+#ifndef FTRACE_TOOLS_UTILS_OCCUPANCY_H_
+#define FTRACE_TOOLS_UTILS_OCCUPANCY_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+// Zero subslice count means the layout of the device is unknown
+struct DeviceLayout {
+  uint32_t subslice_count = 0;
+  uint32_t threads_per_subslice = 0; // Hardware threads
+  // Maximum shared local memory of a group, drivers do not report the
+  // one of a subslice
+  uint64_t local_memory = 0;
+};
+
+struct LaunchShape {
+  uint32_t group_size[3];
+  uint64_t group_count; // Total number of groups
+  uint32_t simd_width;
+  uint64_t local_memory; // Shared local memory per group
+};
+
+struct Occupancy {
+  bool resident; // False if a group does not fit into a subslice
+  bool upper_bound; // Shared local memory may limit occupancy further
+  double occupancy; // Share of subslice threads resident at once
+  double wave_efficiency; // Share of the last wave not wasted
+  double lane_utilization; // Share of SIMD lanes with work-items
+};
+
+// Theoretical occupancy of kernel launches computed from launch shape and
+// device layout: groups resident on a subslice at once are limited by
+// hardware threads, groups over all subslices form waves, and the last
+// wave may be partial. Shared local memory of a subslice is unknown, so
+// for launches using it occupancy is only an upper bound. Launches with
+// groups larger than a subslice can hold are counted as not resident.
+// Occupancy loss of a launch is the part of its time not covered by
+// occupancy, wave efficiency and lane utilization together. Launches of
+// the same kernel are also compared over the group sizes seen in the run.
+// Not thread-safe, the owner is responsible for locking
+class OccupancyTable {
+ public: // User Interface
+  // Returns false if the shape or the layout is unknown
+  static bool GetOccupancy(
+      const DeviceLayout& layout, const LaunchShape& shape,
+      Occupancy& result) {
+    uint64_t group_items = static_cast<uint64_t>(shape.group_size[0]) *
+      shape.group_size[1] * shape.group_size[2];
+    if (group_items == 0 || shape.group_count == 0 ||
+        shape.simd_width == 0 || layout.subslice_count == 0 ||
+        layout.threads_per_subslice == 0) {
+      return false;
+    }
+
+    uint64_t group_threads =
+      (group_items + shape.simd_width - 1) / shape.simd_width;
+    result.upper_bound = (shape.local_memory > 0);
+    result.resident = (group_threads <= layout.threads_per_subslice) &&
+      (layout.local_memory == 0 || shape.local_memory <= layout.local_memory);
+    if (!result.resident) {
+      result.occupancy = 0.0;
+      result.wave_efficiency = 0.0;
+      result.lane_utilization = 0.0;
+      return true;
+    }
+
+    uint64_t resident_groups = layout.threads_per_subslice / group_threads;
+    FTRACE_ASSERT(resident_groups > 0);
+
+    uint64_t wave_groups = resident_groups * layout.subslice_count;
+    uint64_t wave_count = (shape.group_count + wave_groups - 1) / wave_groups;
+
+    result.occupancy = std::min(
+        1.0, static_cast<double>(resident_groups * group_threads) /
+        layout.threads_per_subslice);
+    result.wave_efficiency =
+      static_cast<double>(shape.group_count) / (wave_count * wave_groups);
+    result.lane_utilization =
+      static_cast<double>(group_items) / (group_threads * shape.simd_width);
+    return true;
+  }
+
+  // Time of launches with unknown occupancy counts only into total
+  void AddLaunch(
+      const std::string& name, const DeviceLayout& layout,
+      const LaunchShape& shape, uint64_t time) {
+    FTRACE_ASSERT(!name.empty());
+    total_time_ += time;
+
+    Occupancy occupancy{};
+    if (!GetOccupancy(layout, shape, occupancy)) {
+      return;
+    }
+
+    Kernel& kernel = kernel_map_[name];
+    ++kernel.call_count;
+    kernel.time += time;
+    if (!occupancy.resident) {
+      ++kernel.nonresident_count;
+      return;
+    }
+    double efficiency = occupancy.occupancy * occupancy.wave_efficiency *
+      occupancy.lane_utilization;
+
+    kernel.resident_time += time;
+    kernel.upper_bound = kernel.upper_bound || occupancy.upper_bound;
+    kernel.occupancy_time += occupancy.occupancy * time;
+    kernel.wave_time += occupancy.wave_efficiency * time;
+    kernel.lane_time += occupancy.lane_utilization * time;
+    kernel.loss_time += static_cast<uint64_t>((1.0 - efficiency) * time);
+
+    std::stringstream group_size;
+    group_size << shape.group_size[0] << "x" << shape.group_size[1] <<
+      "x" << shape.group_size[2];
+    Shape& entry = kernel.shape_map[group_size.str()];
+    entry.upper_bound = entry.upper_bound || occupancy.upper_bound;
+    ++entry.call_count;
+    entry.time += time;
+    entry.group_count += shape.group_count;
+    entry.simd_width = shape.simd_width;
+    entry.occupancy_time += occupancy.occupancy * time;
+  }
+
+  std::string GetOccupancyTable() const {
+    std::vector<const KernelMap::value_type*> list;
+    size_t max_name_length = kKernelLength;
+    uint64_t loss_time = 0;
+    for (auto& value : kernel_map_) {
+      list.push_back(&value);
+      max_name_length = std::max(max_name_length, value.first.size());
+      loss_time += value.second.loss_time;
+    }
+    if (list.empty()) {
+      return std::string();
+    }
+
+    std::sort(list.begin(), list.end(),
+              [](const KernelMap::value_type* l,
+                 const KernelMap::value_type* r) {
+                if (l->second.loss_time != r->second.loss_time) {
+                  return l->second.loss_time > r->second.loss_time;
+                }
+                return l->first < r->first;
+              });
+
+    std::stringstream stream;
+    stream << std::setprecision(2) << std::fixed;
+    stream << "Occupancy Loss (ns): " << loss_time << " of " <<
+      total_time_ << " (" << GetPercent(loss_time, total_time_) << "%)" <<
+      std::endl;
+    stream << std::endl;
+
+    stream << std::setw(max_name_length) << "Kernel" << "," <<
+      std::setw(kCallsLength) << "Calls" << "," <<
+      std::setw(kTimeLength) << "Time (ns)" << "," <<
+      std::setw(kPercentLength) << "Occupancy (%)" << "," <<
+      std::setw(kPercentLength) << "Wave Eff (%)" << "," <<
+      std::setw(kPercentLength) << "Lane Util (%)" << "," <<
+      std::setw(kTimeLength) << "Loss (ns)" << "," <<
+      std::setw(kPercentLength) << "Loss (%)" << "," <<
+      std::setw(kBoundLength) << "Bound" << "," <<
+      std::setw(kCallsLength) << "Not Resident" << std::endl;
+    for (auto value : list) {
+      const Kernel& kernel = value->second;
+      stream << std::setw(max_name_length) << value->first << "," <<
+        std::setw(kCallsLength) << kernel.call_count << "," <<
+        std::setw(kTimeLength) << kernel.time << ",";
+      if (kernel.resident_time == 0) { // No launch fits a subslice
+        stream << std::setw(kPercentLength) << "-" << "," <<
+          std::setw(kPercentLength) << "-" << "," <<
+          std::setw(kPercentLength) << "-" << ",";
+      } else {
+        stream << std::setw(kPercentLength) <<
+            GetAverage(kernel.occupancy_time, kernel.resident_time) << "," <<
+          std::setw(kPercentLength) <<
+            GetAverage(kernel.wave_time, kernel.resident_time) << "," <<
+          std::setw(kPercentLength) <<
+            GetAverage(kernel.lane_time, kernel.resident_time) << ",";
+      }
+      stream << std::setw(kTimeLength) << kernel.loss_time << "," <<
+        std::setw(kPercentLength) <<
+          GetPercent(kernel.loss_time, kernel.time) << "," <<
+        std::setw(kBoundLength) << GetBoundName(kernel.upper_bound) << "," <<
+        std::setw(kCallsLength) << kernel.nonresident_count << std::endl;
+    }
+
+    std::stringstream shapes;
+    shapes << std::setprecision(2) << std::fixed;
+    for (auto value : list) {
+      const Kernel& kernel = value->second;
+      if (kernel.shape_map.size() < 2) {
+        continue;
+      }
+
+      uint64_t best_time = 0;
+      for (auto& shape : kernel.shape_map) {
+        uint64_t average = shape.second.time / shape.second.call_count;
+        if (best_time == 0 || average < best_time) {
+          best_time = average;
+        }
+      }
+
+      for (auto& shape : kernel.shape_map) {
+        const Shape& entry = shape.second;
+        uint64_t average = entry.time / entry.call_count;
+        shapes << std::setw(max_name_length) << value->first << "," <<
+          std::setw(kShapeLength) << shape.first << "," <<
+          std::setw(kSimdLength) << entry.simd_width << "," <<
+          std::setw(kCallsLength) << entry.call_count << "," <<
+          std::setw(kCallsLength) <<
+            entry.group_count / entry.call_count << "," <<
+          std::setw(kPercentLength) <<
+            GetAverage(entry.occupancy_time, entry.time) << "," <<
+          std::setw(kBoundLength) << GetBoundName(entry.upper_bound) << "," <<
+          std::setw(kTimeLength) << average << "," <<
+          std::setw(kPercentLength) <<
+            ((best_time > 0) ? static_cast<double>(average) / best_time :
+             1.0) << std::endl;
+      }
+    }
+
+    if (!shapes.str().empty()) {
+      stream << std::endl;
+      stream << "Kernels Launched with Different Group Sizes:" << std::endl;
+      stream << std::setw(max_name_length) << "Kernel" << "," <<
+        std::setw(kShapeLength) << "Group Size" << "," <<
+        std::setw(kSimdLength) << "SIMD" << "," <<
+        std::setw(kCallsLength) << "Calls" << "," <<
+        std::setw(kCallsLength) << "Groups" << "," <<
+        std::setw(kPercentLength) << "Occupancy (%)" << "," <<
+        std::setw(kBoundLength) << "Bound" << "," <<
+        std::setw(kTimeLength) << "Average (ns)" << "," <<
+        std::setw(kPercentLength) << "vs Best (x)" << std::endl;
+      stream << shapes.str();
+    }
+    return stream.str();
+  }
+
+ private: // Implementation
+  struct Shape {
+    uint64_t call_count = 0;
+    uint64_t time = 0;
+    uint64_t group_count = 0;
+    uint32_t simd_width = 0;
+    bool upper_bound = false;
+    double occupancy_time = 0.0;
+  };
+
+  // Shares are accumulated weighted by time of resident launches
+  struct Kernel {
+    uint64_t call_count = 0;
+    uint64_t nonresident_count = 0;
+    uint64_t time = 0;
+    uint64_t resident_time = 0;
+    uint64_t loss_time = 0;
+    bool upper_bound = false;
+    double occupancy_time = 0.0;
+    double wave_time = 0.0;
+    double lane_time = 0.0;
+    std::map<std::string, Shape> shape_map;
+  };
+
+  using KernelMap = std::map<std::string, Kernel>;
+
+  static double GetAverage(double weighted_time, uint64_t time) {
+    return (time > 0) ? 100.0 * weighted_time / time : 0.0;
+  }
+
+  static const char* GetBoundName(bool upper_bound) {
+    return upper_bound ? "upper" : "exact";
+  }
+
+  static double GetPercent(uint64_t part, uint64_t total) {
+    return (total > 0) ? 100.0 * part / total : 0.0;
+  }
+
+ private: // Data
+  KernelMap kernel_map_;
+  uint64_t total_time_ = 0;
+
+  static const uint32_t kKernelLength = 10;
+  static const uint32_t kShapeLength = 14;
+  static const uint32_t kSimdLength = 6;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 14;
+  static const uint32_t kBoundLength = 6;
+};
+
+#endif // FTRACE_TOOLS_UTILS_OCCUPANCY_H_
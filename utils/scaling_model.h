@@ -0,0 +1,211 @@
+#ifndef FTRACE_TOOLS_UTILS_SCALING_MODEL_H_
+#define FTRACE_TOOLS_UTILS_SCALING_MODEL_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+// Online least-squares fit of launch time against launch size (work-items
+// for kernels, bytes for transfers) per kernel and device:
+// time = fixed + per_unit * size. Only running means and centered
+// co-moments of size, size squared and time are kept (updated like in
+// Welford's algorithm, raw sums would cancel catastrophically), sizes are
+// divided by the first one seen to keep them in range. Residuals are
+// correlated with size squared to find kernels growing faster than
+// linearly (convex time curve), such kernels are marked as super-linear
+// unless the line already explains nearly all the variance.
+// Not thread-safe, the owner is responsible for locking
+class ScalingModel {
+ public: // User Interface
+  void AddLaunch(
+      const std::string& name, const void* device, bool transfer,
+      uint64_t size, uint64_t time) {
+    FTRACE_ASSERT(!name.empty());
+    if (size == 0) {
+      return;
+    }
+
+    Fit& fit = fit_map_[std::make_pair(name, device)];
+    if (fit.count == 0) {
+      fit.transfer = transfer;
+      fit.scale = static_cast<double>(size);
+      fit.min_size = size;
+      fit.max_size = size;
+    }
+    fit.min_size = std::min(fit.min_size, size);
+    fit.max_size = std::max(fit.max_size, size);
+    fit.total_time += time;
+
+    double x = size / fit.scale;
+    double q = x * x;
+    double y = static_cast<double>(time);
+    ++fit.count;
+    double dx = x - fit.mean_x;
+    double dq = q - fit.mean_q;
+    double dy = y - fit.mean_y;
+    fit.mean_x += dx / fit.count;
+    fit.mean_q += dq / fit.count;
+    fit.mean_y += dy / fit.count;
+    fit.c_xx += dx * (x - fit.mean_x);
+    fit.c_xq += dx * (q - fit.mean_q);
+    fit.c_qq += dq * (q - fit.mean_q);
+    fit.c_xy += dx * (y - fit.mean_y);
+    fit.c_qy += dq * (y - fit.mean_y);
+    fit.c_yy += dy * (y - fit.mean_y);
+  }
+
+  std::string GetScalingTable() const {
+    std::vector<const FitMap::value_type*> list;
+    size_t max_name_length = kKernelLength;
+    for (auto& value : fit_map_) {
+      list.push_back(&value);
+      max_name_length = std::max(max_name_length, value.first.first.size());
+    }
+    if (list.empty()) {
+      return std::string();
+    }
+
+    std::sort(list.begin(), list.end(),
+              [](const FitMap::value_type* l,
+                 const FitMap::value_type* r) {
+                if (l->second.total_time != r->second.total_time) {
+                  return l->second.total_time > r->second.total_time;
+                }
+                return l->first < r->first;
+              });
+
+    std::stringstream stream;
+    stream << std::setw(max_name_length) << "Kernel" << "," <<
+      std::setw(kDeviceLength) << "Device" << "," <<
+      std::setw(kUnitLength) << "Unit" << "," <<
+      std::setw(kCallsLength) << "Calls" << "," <<
+      std::setw(kSizeLength) << "Min Size" << "," <<
+      std::setw(kSizeLength) << "Max Size" << "," <<
+      std::setw(kTimeLength) << "Fixed (ns)" << "," <<
+      std::setw(kTimeLength) << "Per Unit (ns)" << "," <<
+      std::setw(kValueLength) << "R^2" << "," <<
+      std::setw(kValueLength) << "Fixed (%)" << "," <<
+      std::setw(kTrendLength) << "Trend" << std::endl;
+    for (auto value : list) {
+      const Fit& fit = value->second;
+      stream << std::setw(max_name_length) << value->first.first << "," <<
+        std::setw(kDeviceLength) << value->first.second << "," <<
+        std::setw(kUnitLength) << (fit.transfer ? "bytes" : "items") << "," <<
+        std::setw(kCallsLength) << fit.count << "," <<
+        std::setw(kSizeLength) << fit.min_size << "," <<
+        std::setw(kSizeLength) << fit.max_size << ",";
+
+      Line line{};
+      if (!GetLine(fit, line)) {
+        stream << std::setw(kTimeLength) << "-" << "," <<
+          std::setw(kTimeLength) << "-" << "," <<
+          std::setw(kValueLength) << "-" << "," <<
+          std::setw(kValueLength) << "-" << "," <<
+          std::setw(kTrendLength) << "-" << std::endl;
+        continue;
+      }
+
+      double mean_time = fit.mean_y;
+      double fixed_share = (mean_time > 0.0) ?
+        100.0 * std::max(line.fixed, 0.0) / mean_time : 0.0;
+      stream << std::setprecision(2) << std::fixed <<
+        std::setw(kTimeLength) << line.fixed << "," <<
+        std::setw(kTimeLength) << std::setprecision(6) <<
+          line.per_unit / fit.scale << "," <<
+        std::setw(kValueLength) << std::setprecision(4) <<
+          line.r_squared << "," <<
+        std::setw(kValueLength) << std::setprecision(2) <<
+          std::min(fixed_share, 100.0) << "," <<
+        std::setw(kTrendLength) <<
+          (line.super_linear ? "super-linear" : "linear") << std::endl;
+    }
+    return stream.str();
+  }
+
+ private: // Implementation
+  struct Fit {
+    bool transfer = false;
+    double scale = 1.0;
+    uint64_t count = 0;
+    uint64_t min_size = 0;
+    uint64_t max_size = 0;
+    uint64_t total_time = 0;
+    double mean_x = 0.0; // Scaled size
+    double mean_q = 0.0; // Scaled size squared
+    double mean_y = 0.0; // Time
+    double c_xx = 0.0;
+    double c_xq = 0.0;
+    double c_qq = 0.0;
+    double c_xy = 0.0;
+    double c_qy = 0.0;
+    double c_yy = 0.0;
+  };
+
+  struct Line {
+    double fixed;
+    double per_unit; // For scaled size
+    double r_squared;
+    bool super_linear;
+  };
+
+  using FitMap = std::map<std::pair<std::string, const void*>, Fit>;
+
+  // Returns false if sizes do not vary enough to fit the line
+  static bool GetLine(const Fit& fit, Line& line) {
+    if (fit.count < kMinCount || fit.min_size == fit.max_size) {
+      return false;
+    }
+
+    double sxx = fit.c_xx;
+    double sxy = fit.c_xy;
+    double syy = fit.c_yy;
+    if (sxx <= 0.0) {
+      return false;
+    }
+
+    line.per_unit = sxy / sxx;
+    line.fixed = fit.mean_y - line.per_unit * fit.mean_x;
+    line.r_squared = (syy > 0.0) ? (sxy * sxy) / (sxx * syy) : 1.0;
+
+    // Residuals are orthogonal to constant and size, so their covariance
+    // with the part of size squared not explained by size is the sum of
+    // centered time and size squared products less the part along size
+    double sse = std::max(syy - line.per_unit * sxy, 0.0);
+    double sqq = fit.c_qq - fit.c_xq * fit.c_xq / sxx;
+    double srq = fit.c_qy - line.per_unit * fit.c_xq;
+    line.super_linear = false;
+    if (fit.count >= kMinTrendCount && line.r_squared < kMaxTrendRSquared &&
+        sse > 0.0 && sqq > 0.0) {
+      double correlation = srq / std::sqrt(sse * sqq);
+      line.super_linear = (correlation > kTrendCorrelation);
+    }
+    return true;
+  }
+
+ private: // Data
+  FitMap fit_map_;
+
+  static const uint64_t kMinCount = 3;
+  static const uint64_t kMinTrendCount = 5;
+  static constexpr double kMaxTrendRSquared = 0.99;
+  static constexpr double kTrendCorrelation = 0.5;
+
+  static const uint32_t kKernelLength = 10;
+  static const uint32_t kDeviceLength = 16;
+  static const uint32_t kUnitLength = 6;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kSizeLength = 16;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kValueLength = 10;
+  static const uint32_t kTrendLength = 14;
+};
+
+#endif // FTRACE_TOOLS_UTILS_SCALING_MODEL_H_
@@ -0,0 +1,165 @@
+#ifndef FTRACE_TOOLS_UTILS_TILE_BALANCE_H_
+#define FTRACE_TOOLS_UTILS_TILE_BALANCE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+struct TileInterval {
+  int tile;
+  uint64_t start;
+  uint64_t end;
+};
+
+// Load imbalance between tiles of kernels split by implicit scaling. For
+// each launch skew is the difference between the end of the slowest and
+// the fastest tile, and wait time is the time tiles stay idle till the
+// slowest one finishes (sum over tiles). The tile finishing last in most
+// launches of the kernel is reported as systematically slowest.
+// Not thread-safe, the owner is responsible for locking
+class TileBalance {
+ public: // User Interface
+  void AddLaunch(
+      const std::string& name, const std::vector<TileInterval>& tile_list) {
+    FTRACE_ASSERT(!name.empty());
+    if (tile_list.size() < 2) {
+      return;
+    }
+
+    uint64_t min_start = tile_list[0].start, max_start = tile_list[0].start;
+    uint64_t min_end = tile_list[0].end, max_end = tile_list[0].end;
+    int slowest = tile_list[0].tile;
+    for (auto& interval : tile_list) {
+      FTRACE_ASSERT(interval.start <= interval.end);
+      min_start = std::min(min_start, interval.start);
+      max_start = std::max(max_start, interval.start);
+      min_end = std::min(min_end, interval.end);
+      if (interval.end > max_end) {
+        max_end = interval.end;
+        slowest = interval.tile;
+      }
+    }
+
+    uint64_t wait_time = 0;
+    for (auto& interval : tile_list) {
+      wait_time += max_end - interval.end;
+    }
+    uint64_t skew = max_end - min_end;
+
+    Kernel& kernel = kernel_map_[name];
+    ++kernel.call_count;
+    kernel.time += max_end - min_start;
+    kernel.tile_time += (max_end - min_start) * tile_list.size();
+    kernel.skew_time += skew;
+    kernel.max_skew = std::max(kernel.max_skew, skew);
+    kernel.start_skew_time += max_start - min_start;
+    kernel.wait_time += wait_time;
+    ++kernel.slowest_map[slowest];
+  }
+
+  std::string GetBalanceTable() const {
+    std::vector<const KernelMap::value_type*> list;
+    size_t max_name_length = kKernelLength;
+    uint64_t wait_time = 0, tile_time = 0;
+    for (auto& value : kernel_map_) {
+      list.push_back(&value);
+      max_name_length = std::max(max_name_length, value.first.size());
+      wait_time += value.second.wait_time;
+      tile_time += value.second.tile_time;
+    }
+    if (list.empty()) {
+      return std::string();
+    }
+
+    std::sort(list.begin(), list.end(),
+              [](const KernelMap::value_type* l,
+                 const KernelMap::value_type* r) {
+                if (l->second.wait_time != r->second.wait_time) {
+                  return l->second.wait_time > r->second.wait_time;
+                }
+                return l->first < r->first;
+              });
+
+    std::stringstream stream;
+    stream << std::setprecision(2) << std::fixed;
+    stream << "Tile Wait Time (ns): " << wait_time << " of " << tile_time <<
+      " (" << GetPercent(wait_time, tile_time) << "% of tile time)" <<
+      std::endl;
+    stream << std::endl;
+
+    stream << std::setw(max_name_length) << "Kernel" << "," <<
+      std::setw(kCallsLength) << "Calls" << "," <<
+      std::setw(kTimeLength) << "Time (ns)" << "," <<
+      std::setw(kTimeLength) << "Avg Skew (ns)" << "," <<
+      std::setw(kTimeLength) << "Max Skew (ns)" << "," <<
+      std::setw(kTimeLength) << "Avg Start Skew (ns)" << "," <<
+      std::setw(kTimeLength) << "Wait (ns)" << "," <<
+      std::setw(kPercentLength) << "Wait (%)" << "," <<
+      std::setw(kTileLength) << "Slowest Tile" << "," <<
+      std::setw(kPercentLength) << "Slowest (%)" << std::endl;
+    for (auto value : list) {
+      const Kernel& kernel = value->second;
+      FTRACE_ASSERT(kernel.call_count > 0);
+
+      int slowest = -1;
+      uint64_t slowest_count = 0;
+      for (auto& tile : kernel.slowest_map) {
+        if (tile.second > slowest_count) {
+          slowest = tile.first;
+          slowest_count = tile.second;
+        }
+      }
+
+      stream << std::setw(max_name_length) << value->first << "," <<
+        std::setw(kCallsLength) << kernel.call_count << "," <<
+        std::setw(kTimeLength) << kernel.time << "," <<
+        std::setw(kTimeLength) << kernel.skew_time / kernel.call_count <<
+          "," <<
+        std::setw(kTimeLength) << kernel.max_skew << "," <<
+        std::setw(kTimeLength) <<
+          kernel.start_skew_time / kernel.call_count << "," <<
+        std::setw(kTimeLength) << kernel.wait_time << "," <<
+        std::setw(kPercentLength) <<
+          GetPercent(kernel.wait_time, kernel.tile_time) << "," <<
+        std::setw(kTileLength) << slowest << "," <<
+        std::setw(kPercentLength) <<
+          GetPercent(slowest_count, kernel.call_count) << std::endl;
+    }
+    return stream.str();
+  }
+
+ private: // Implementation
+  struct Kernel {
+    uint64_t call_count = 0;
+    uint64_t time = 0; // From the first tile start to the last tile end
+    uint64_t tile_time = 0; // Time multiplied by the number of tiles
+    uint64_t skew_time = 0;
+    uint64_t max_skew = 0;
+    uint64_t start_skew_time = 0;
+    uint64_t wait_time = 0;
+    std::map<int, uint64_t> slowest_map;
+  };
+
+  using KernelMap = std::map<std::string, Kernel>;
+
+  static double GetPercent(uint64_t part, uint64_t total) {
+    return (total > 0) ? 100.0 * part / total : 0.0;
+  }
+
+ private: // Data
+  KernelMap kernel_map_;
+
+  static const uint32_t kKernelLength = 10;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 12;
+  static const uint32_t kTileLength = 14;
+};
+
+#endif // FTRACE_TOOLS_UTILS_TILE_BALANCE_H_
@@ -39,24 +39,66 @@
 #define TRACE_METRIC_STREAM          29
 #define TRACE_CCL_SUMMARY_REPORT     30
 #define TRACE_CHROME_MPI_LOGGING     31
+#define TRACE_CONTROL_SIGNALS        32
+#define TRACE_CONTROL_FIFO           33
+#define TRACE_TRACER_OVERHEAD        34
+#define TRACE_RAW_API_TIME           35
+#define TRACE_HOST_STALLS            36
+#define TRACE_CRITICAL_PATH          37
+#define TRACE_RECORD_GRAPH           38
+#define TRACE_UTILIZATION            39
+#define TRACE_LATENCY_HISTOGRAMS     40
+#define TRACE_DRILL_DOWN             41
+#define TRACE_STEADY_STATE           42
+#define TRACE_ITERATIONS             43
+#define TRACE_MEMORY                 44
+#define TRACE_TRANSFERS              45
+#define TRACE_TRANSFER_ADVICE        46
+#define TRACE_OBJECT_CHURN           47
+#define TRACE_MODULE_BUILDS          48
+#define TRACE_KERNEL_RESOURCES       49
+#define TRACE_OCCUPANCY              50
+#define TRACE_TILE_BALANCE           51
+#define TRACE_SCALING                52
 
 const char* kChromeTraceFileExt = "json";
 
 class TraceOptions {
  public:
-  TraceOptions(uint32_t flags, const std::string& log_file)
-      : flags_(flags), log_file_(log_file) {
+  TraceOptions(uint64_t flags, const std::string& log_file,
+               const std::string& control_fifo = std::string(),
+               uint32_t warm_up_count = 0,
+               const std::string& module_index = std::string())
+      : flags_(flags), log_file_(log_file), control_fifo_(control_fifo),
+        warm_up_count_(warm_up_count), module_index_(module_index) {
     if (CheckFlag(TRACE_LOG_TO_FILE)) {
       FTRACE_ASSERT(!log_file_.empty());
     }
+    if (CheckFlag(TRACE_CONTROL_FIFO)) {
+      FTRACE_ASSERT(!control_fifo_.empty());
+    }
     if (flags_ == 0) {
-      flags_ |= (1 << TRACE_HOST_TIMING);
-      flags_ |= (1 << TRACE_DEVICE_TIMING);
+      flags_ |= (1ull << TRACE_HOST_TIMING);
+      flags_ |= (1ull << TRACE_DEVICE_TIMING);
     }
   }
 
   bool CheckFlag(uint32_t flag) const {
-    return (flags_ & (1 << flag));
+    return (flags_ & (1ull << flag));
+  }
+
+  std::string GetControlFifoName() const {
+    return control_fifo_;
+  }
+
+  // Zero means warm-up phase is detected automatically
+  uint32_t GetWarmUpCount() const {
+    return warm_up_count_;
+  }
+
+  // Empty means module builds are not kept over runs
+  std::string GetModuleIndexName() const {
+    return module_index_;
   }
 
   std::string GetLogFileName() const {
@@ -90,23 +132,30 @@ class TraceOptions {
   }
 
   static std::string GetChromeTraceFileName(const char* filename) {
+    return GetTraceFileName(filename, kChromeTraceFileExt);
+  }
+
+  static std::string GetTraceFileName(const char* filename, const char* ext) {
     std::string rank = (utils::GetEnv("PMI_RANK").empty()) ? utils::GetEnv("PMIX_RANK") : utils::GetEnv("PMI_RANK");
     if (!rank.empty()) {
       return
         std::string(filename) +
         "." + std::to_string(utils::GetPid()) +
         "." + rank +
-        "." + kChromeTraceFileExt;
+        "." + ext;
     }
     return
         std::string(filename) +
         "." + std::to_string(utils::GetPid()) +
-        "." + kChromeTraceFileExt;
+        "." + ext;
   }
 
  private:
-  uint32_t flags_;
+  uint64_t flags_;
   std::string log_file_;
+  std::string control_fifo_;
+  uint32_t warm_up_count_;
+  std::string module_index_;
 };
 
 #endif // FTRACE_TOOLS_UTILS_TRACE_OPTIONS_H_
@@ -0,0 +1,13 @@
+#include "tracer_overhead.h"
+
+std::atomic<bool> TracerOverhead::enabled_{false};
+uint64_t TracerOverhead::start_cycles_ = 0;
+uint64_t TracerOverhead::start_time_ = 0;
+
+std::atomic<TracerThreadCounters*> TracerOverhead::counter_list_{nullptr};
+thread_local TracerThreadCounters* TracerOverhead::thread_counters_ = nullptr;
+thread_local TracerOverheadScope* TracerOverhead::active_scope_ = nullptr;
+
+std::atomic<uint64_t> TracerOverhead::pending_depth_max_{0};
+std::atomic<uint64_t> TracerOverhead::memory_{0};
+std::atomic<uint64_t> TracerOverhead::memory_peak_{0};
\ No newline at end of file
@@ -0,0 +1,241 @@
+#ifndef FTRACE_TOOLS_UTILS_TRACER_OVERHEAD_H_
+#define FTRACE_TOOLS_UTILS_TRACER_OVERHEAD_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "finetrace_assert.h"
+#include "utils.h"
+
+enum TracerHook {
+  TRACER_HOOK_ZE_API = 0,
+  TRACER_HOOK_CL_API,
+  TRACER_HOOK_CL_EXT,
+  TRACER_HOOK_ZE_KERNEL_ENTER,
+  TRACER_HOOK_ZE_KERNEL_EXIT,
+  TRACER_HOOK_ZE_PROCESS_CALLS,
+  TRACER_HOOK_CL_KERNEL,
+  TRACER_HOOK_COUNT
+};
+
+struct TracerHookCounter {
+  std::atomic<uint64_t> cycles{0};
+  std::atomic<uint64_t> calls{0};
+};
+
+struct TracerThreadCounters {
+  TracerHookCounter hooks[TRACER_HOOK_COUNT];
+  TracerThreadCounters* next = nullptr;
+};
+
+class TracerOverheadScope;
+
+// Per-thread counters are written by the owner thread only and never released
+class TracerOverhead {
+ public: // User Interface
+  static void Enable() {
+    start_cycles_ = utils::GetCycles();
+    start_time_ = utils::GetSystemTime();
+    enabled_.store(true, std::memory_order_release);
+  }
+
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  static void AddHookTime(TracerHook hook, uint64_t cycles) {
+    FTRACE_ASSERT(hook < TRACER_HOOK_COUNT);
+    TracerHookCounter& counter = GetThreadCounters()->hooks[hook];
+    counter.cycles.store(
+        counter.cycles.load(std::memory_order_relaxed) + cycles,
+        std::memory_order_relaxed);
+    counter.calls.store(
+        counter.calls.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+  }
+
+  static void UpdatePendingDepth(size_t depth) {
+    if (!IsEnabled()) {
+      return;
+    }
+    UpdateMax(pending_depth_max_, depth);
+  }
+
+  static void AddMemory(size_t bytes) {
+    if (!IsEnabled()) {
+      return;
+    }
+    uint64_t current =
+      memory_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    UpdateMax(memory_peak_, current);
+  }
+
+  static void RemoveMemory(size_t bytes) {
+    if (!IsEnabled()) {
+      return;
+    }
+    memory_.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  static uint64_t GetHookCycles(TracerHook hook) {
+    FTRACE_ASSERT(hook < TRACER_HOOK_COUNT);
+    uint64_t cycles = 0;
+    for (TracerThreadCounters* counters =
+           counter_list_.load(std::memory_order_acquire);
+         counters != nullptr; counters = counters->next) {
+      cycles += counters->hooks[hook].cycles.load(std::memory_order_relaxed);
+    }
+    return cycles;
+  }
+
+  static uint64_t GetHookCalls(TracerHook hook) {
+    FTRACE_ASSERT(hook < TRACER_HOOK_COUNT);
+    uint64_t calls = 0;
+    for (TracerThreadCounters* counters =
+           counter_list_.load(std::memory_order_acquire);
+         counters != nullptr; counters = counters->next) {
+      calls += counters->hooks[hook].calls.load(std::memory_order_relaxed);
+    }
+    return calls;
+  }
+
+  static uint64_t GetThreadCount() {
+    uint64_t count = 0;
+    for (TracerThreadCounters* counters =
+           counter_list_.load(std::memory_order_acquire);
+         counters != nullptr; counters = counters->next) {
+      ++count;
+    }
+    return count;
+  }
+
+  static uint64_t GetPendingDepthMax() {
+    return pending_depth_max_.load(std::memory_order_relaxed);
+  }
+
+  static uint64_t GetMemoryPeak() {
+    return memory_peak_.load(std::memory_order_relaxed);
+  }
+
+  // Cycle counter rate is measured over the whole tracing interval
+  static uint64_t ConvertCyclesToNs(uint64_t cycles) {
+    uint64_t cycles_elapsed = utils::GetCycles() - start_cycles_;
+    uint64_t time_elapsed = utils::GetSystemTime() - start_time_;
+    if (cycles_elapsed == 0) {
+      return 0;
+    }
+    return static_cast<uint64_t>(
+        static_cast<double>(cycles) * time_elapsed / cycles_elapsed);
+  }
+
+  static const char* GetHookName(TracerHook hook) {
+    switch (hook) {
+      case TRACER_HOOK_ZE_API:
+        return "L0 API Callbacks";
+      case TRACER_HOOK_CL_API:
+        return "CL API Callbacks";
+      case TRACER_HOOK_CL_EXT:
+        return "CL Extension Wrappers";
+      case TRACER_HOOK_ZE_KERNEL_ENTER:
+        return "L0 Kernel OnEnter";
+      case TRACER_HOOK_ZE_KERNEL_EXIT:
+        return "L0 Kernel OnExit";
+      case TRACER_HOOK_ZE_PROCESS_CALLS:
+        return "L0 Kernel ProcessCalls";
+      case TRACER_HOOK_CL_KERNEL:
+        return "CL Kernel Callbacks";
+      default:
+        break;
+    }
+    return "Unknown";
+  }
+
+ private: // Implementation
+  friend class TracerOverheadScope;
+
+  static TracerThreadCounters* GetThreadCounters() {
+    if (thread_counters_ == nullptr) {
+      TracerThreadCounters* counters = new TracerThreadCounters;
+      FTRACE_ASSERT(counters != nullptr);
+      counters->next = counter_list_.load(std::memory_order_relaxed);
+      while (!counter_list_.compare_exchange_weak(
+                 counters->next, counters,
+                 std::memory_order_release, std::memory_order_relaxed)) {}
+      thread_counters_ = counters;
+    }
+    return thread_counters_;
+  }
+
+  static void UpdateMax(std::atomic<uint64_t>& max, uint64_t value) {
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max.compare_exchange_weak(
+               current, value, std::memory_order_relaxed)) {}
+  }
+
+ private: // Data
+  static std::atomic<bool> enabled_;
+  static uint64_t start_cycles_;
+  static uint64_t start_time_;
+
+  static std::atomic<TracerThreadCounters*> counter_list_;
+  static thread_local TracerThreadCounters* thread_counters_;
+  static thread_local TracerOverheadScope* active_scope_;
+
+  static std::atomic<uint64_t> pending_depth_max_;
+  static std::atomic<uint64_t> memory_;
+  static std::atomic<uint64_t> memory_peak_;
+};
+
+// Exclusive time: nested scopes are charged to their own hooks
+class TracerOverheadScope {
+ public:
+  explicit TracerOverheadScope(TracerHook hook) : hook_(hook) {
+    if (TracerOverhead::IsEnabled()) {
+      parent_ = TracerOverhead::active_scope_;
+      TracerOverhead::active_scope_ = this;
+      start_ = utils::GetCycles();
+      active_ = true;
+    }
+  }
+
+  TracerOverheadScope(const TracerOverheadScope& that) = delete;
+  TracerOverheadScope& operator=(const TracerOverheadScope& that) = delete;
+
+  ~TracerOverheadScope() {
+    if (active_) {
+      Suspend();
+      FTRACE_ASSERT(TracerOverhead::active_scope_ == this);
+      TracerOverhead::active_scope_ = parent_;
+      uint64_t cycles = (elapsed_ > excluded_) ? elapsed_ - excluded_ : 0;
+      TracerOverhead::AddHookTime(hook_, cycles);
+      if (parent_ != nullptr && parent_->start_ != 0) {
+        parent_->excluded_ += elapsed_;
+      }
+    }
+  }
+
+  void Suspend() {
+    if (active_ && start_ != 0) {
+      elapsed_ += utils::GetCycles() - start_;
+      start_ = 0;
+    }
+  }
+
+  void Resume() {
+    if (active_ && start_ == 0) {
+      start_ = utils::GetCycles();
+    }
+  }
+
+ private:
+  TracerHook hook_;
+  TracerOverheadScope* parent_ = nullptr;
+  uint64_t start_ = 0;
+  uint64_t elapsed_ = 0;
+  uint64_t excluded_ = 0;
+  bool active_ = false;
+};
+
+#endif // FTRACE_TOOLS_UTILS_TRACER_OVERHEAD_H_
@@ -0,0 +1,324 @@
+#ifndef FTRACE_TOOLS_UTILS_TRANSFER_ADVISOR_H_
+#define FTRACE_TOOLS_UTILS_TRANSFER_ADVISOR_H_
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FTRACE_TRANSFER_HASH_SSE2
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "finetrace_assert.h"
+
+// Memory object (e.g. cl_mem) and offset in it, object is nullptr for
+// USM and host pointers, so offset is the address itself
+struct TransferLocation {
+  const void* object = nullptr;
+  uint64_t offset = 0;
+};
+
+struct TransferPattern {
+  TransferLocation src;
+  TransferLocation dst;
+  uint64_t fingerprint = 0; // Zero if source is not readable from host
+  uint32_t site = 0; // Zero if transfer is not classified
+  bool redundant = false;
+  bool adjacent = false;
+};
+
+// Finds avoidable transfers at append time: uploads of the same data
+// into the same destination as the previous upload there (redundant) and
+// small copies continuing the previous copy in the same queue or command
+// list (adjacent, could be coalesced with it). Call site is the transfer
+// function with direction and size. Avoidable time is the whole execution
+// time of redundant and adjacent transfers, so runs of N adjacent copies
+// are expected to take the time of a single one when coalesced.
+// Not thread-safe, the owner is responsible for locking
+class TransferAdvisor {
+ public: // User Interface
+  // Sampled hash of the range, at most kHashBytes are read: the whole
+  // range if it is small enough, otherwise kBlockCount evenly spaced
+  // blocks including the first and the last ones
+  static uint64_t GetFingerprint(const void* data, size_t size) {
+    FTRACE_ASSERT(data != nullptr);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    uint64_t acc[2] = {kSecretLow ^ size, kSecretHigh};
+    uint64_t stripe = 0;
+    if (size <= kHashBytes) {
+      HashRange(bytes, size, acc, stripe);
+    } else {
+      uint64_t step = (size - kBlockSize) / (kBlockCount - 1);
+      for (uint32_t i = 0; i < kBlockCount - 1; ++i) {
+        HashRange(bytes + i * step, kBlockSize, acc, stripe);
+      }
+      HashRange(bytes + size - kBlockSize, kBlockSize, acc, stripe);
+    }
+
+    uint64_t hash = Mix(acc[0] ^ ((acc[1] << 31) | (acc[1] >> 33)));
+    return (hash == 0) ? 1 : hash;
+  }
+
+  // Hash of the whole range with the same stripe function
+  static uint64_t GetHash(const void* data, size_t size) {
+    FTRACE_ASSERT(data != nullptr);
+    uint64_t acc[2] = {kSecretLow ^ size, kSecretHigh};
+    uint64_t stripe = 0;
+    HashRange(static_cast<const uint8_t*>(data), size, acc, stripe);
+    return Mix(acc[0] ^ ((acc[1] << 31) | (acc[1] >> 33)));
+  }
+
+  // Source and destination of the pattern are given by the collector,
+  // classification is stored back to it
+  void AddTransfer(
+      const void* queue, const std::string& name, size_t size,
+      TransferPattern& pattern) {
+    FTRACE_ASSERT(queue != nullptr);
+    if (size == 0 || (pattern.src.object == nullptr &&
+                      pattern.src.offset == 0)) {
+      last_map_.erase(queue);
+      return;
+    }
+
+    pattern.site = GetSite(name, size);
+    Site& site = site_list_[pattern.site - 1];
+
+    if (pattern.fingerprint != 0) {
+      if (upload_map_.size() >= kMaxUploadCount) {
+        upload_map_.clear();
+      }
+      auto key = std::make_tuple(
+          pattern.dst.object, pattern.dst.offset, size);
+      auto it = upload_map_.find(key);
+      if (it != upload_map_.end() && it->second == pattern.fingerprint) {
+        pattern.redundant = true;
+      } else {
+        upload_map_[key] = pattern.fingerprint;
+      }
+    }
+
+    if (size < kSmallSize) {
+      auto it = last_map_.find(queue);
+      if (it != last_map_.end() && it->second.name == name &&
+          IsNext(it->second.src, pattern.src) &&
+          IsNext(it->second.dst, pattern.dst)) {
+        pattern.adjacent = true;
+        if (!it->second.adjacent) {
+          ++site.run_count;
+        }
+      }
+      Last& last = last_map_[queue];
+      last.name = name;
+      last.src = pattern.src;
+      last.src.offset += size;
+      last.dst = pattern.dst;
+      last.dst.offset += size;
+      last.adjacent = pattern.adjacent;
+    } else {
+      last_map_.erase(queue);
+    }
+  }
+
+  // Any other command ends the run of adjacent copies
+  void AddCommand(const void* queue) {
+    last_map_.erase(queue);
+  }
+
+  void AddTime(const TransferPattern& pattern, uint64_t time) {
+    total_time_ += time;
+    if (pattern.site == 0) {
+      return;
+    }
+
+    FTRACE_ASSERT(pattern.site <= site_list_.size());
+    Site& site = site_list_[pattern.site - 1];
+    ++site.count;
+    site.time += time;
+    if (pattern.redundant) {
+      ++site.redundant_count;
+      site.avoidable_time += time;
+    } else if (pattern.adjacent) {
+      ++site.adjacent_count;
+      site.avoidable_time += time;
+    }
+  }
+
+  std::string GetAdviceTable() const {
+    std::vector<const Site*> list;
+    size_t max_name_length = kNameLength;
+    uint64_t avoidable_time = 0;
+    for (auto& site : site_list_) {
+      if (site.redundant_count == 0 && site.adjacent_count == 0) {
+        continue;
+      }
+      list.push_back(&site);
+      max_name_length = std::max(max_name_length, site.name.size());
+      avoidable_time += site.avoidable_time;
+    }
+    if (list.empty()) {
+      return std::string();
+    }
+
+    std::sort(list.begin(), list.end(),
+              [](const Site* l, const Site* r) {
+                if (l->avoidable_time != r->avoidable_time) {
+                  return l->avoidable_time > r->avoidable_time;
+                }
+                return l->time > r->time;
+              });
+
+    std::stringstream stream;
+    stream << "Avoidable Transfer Time (ns): " << avoidable_time <<
+      " of " << total_time_ << " (" << std::setprecision(2) <<
+      std::fixed << GetPercent(avoidable_time) << "%)" << std::endl;
+    stream << std::endl;
+
+    stream << std::setw(max_name_length) << "Function" << "," <<
+      std::setw(kSizeLength) << "Size (bytes)" << "," <<
+      std::setw(kCallsLength) << "Transfers" << "," <<
+      std::setw(kCallsLength) << "Redundant" << "," <<
+      std::setw(kCallsLength) << "Adjacent" << "," <<
+      std::setw(kCallsLength) << "Runs" << "," <<
+      std::setw(kTimeLength) << "Time (ns)" << "," <<
+      std::setw(kTimeLength) << "Avoidable (ns)" << "," <<
+      std::setw(kPercentLength) << "Avoidable (%)" << std::endl;
+    for (auto site : list) {
+      stream << std::setw(max_name_length) << site->name << "," <<
+        std::setw(kSizeLength) << site->size << "," <<
+        std::setw(kCallsLength) << site->count << "," <<
+        std::setw(kCallsLength) << site->redundant_count << "," <<
+        std::setw(kCallsLength) << site->adjacent_count << "," <<
+        std::setw(kCallsLength) << site->run_count << "," <<
+        std::setw(kTimeLength) << site->time << "," <<
+        std::setw(kTimeLength) << site->avoidable_time << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+          GetPercent(site->avoidable_time) << std::endl;
+    }
+    return stream.str();
+  }
+
+ private: // Implementation
+  struct Site {
+    std::string name;
+    size_t size;
+    uint64_t run_count;
+    uint64_t count;
+    uint64_t redundant_count;
+    uint64_t adjacent_count;
+    uint64_t time;
+    uint64_t avoidable_time;
+  };
+
+  struct Last {
+    std::string name;
+    TransferLocation src; // End of the previous copy
+    TransferLocation dst;
+    bool adjacent;
+  };
+
+  uint32_t GetSite(const std::string& name, size_t size) {
+    auto key = std::make_pair(name, size);
+    auto it = site_map_.find(key);
+    if (it != site_map_.end()) {
+      return it->second;
+    }
+    site_list_.push_back(Site{name, size, 0, 0, 0, 0, 0, 0});
+    uint32_t site = static_cast<uint32_t>(site_list_.size());
+    site_map_[key] = site;
+    return site;
+  }
+
+  static bool IsNext(
+      const TransferLocation& last, const TransferLocation& next) {
+    return last.object == next.object && last.offset == next.offset;
+  }
+
+  double GetPercent(uint64_t time) const {
+    return (total_time_ > 0) ? 100.0 * time / total_time_ : 0.0;
+  }
+
+  // Each 16-byte stripe is mixed into two 64-bit lanes with 32x32-bit
+  // multiplication, stripe index is mixed into the key so the order of
+  // blocks matters
+  static void HashStripe(
+      const uint8_t* data, uint64_t acc[2], uint64_t stripe) {
+    uint64_t key = stripe * kPrime;
+#ifdef FTRACE_TRANSFER_HASH_SSE2
+    __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc));
+    __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i secret = _mm_add_epi64(
+        _mm_set_epi64x(kSecretHigh, kSecretLow),
+        _mm_set1_epi64x(key));
+    __m128i mixed = _mm_xor_si128(value, secret);
+    __m128i product = _mm_mul_epu32(
+        mixed, _mm_shuffle_epi32(mixed, _MM_SHUFFLE(0, 3, 0, 1)));
+    __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+    lanes = _mm_add_epi64(lanes, _mm_add_epi64(product, swapped));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc), lanes);
+#else
+    const uint64_t secret[2] = {kSecretLow, kSecretHigh};
+    uint64_t value[2];
+    memcpy(value, data, sizeof(value));
+    for (int i = 0; i < 2; ++i) {
+      uint64_t mixed = value[i] ^ (secret[i] + key);
+      acc[i] += value[i ^ 1] + (mixed & 0xffffffffull) * (mixed >> 32);
+    }
+#endif
+  }
+
+  static void HashRange(
+      const uint8_t* data, size_t size, uint64_t acc[2], uint64_t& stripe) {
+    size_t offset = 0;
+    for (; offset + kStripeSize <= size; offset += kStripeSize) {
+      HashStripe(data + offset, acc, stripe++);
+    }
+    if (offset < size) {
+      uint8_t tail[kStripeSize] = {0};
+      memcpy(tail, data + offset, size - offset);
+      HashStripe(tail, acc, stripe++);
+    }
+  }
+
+  static uint64_t Mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+    return value;
+  }
+
+ private: // Data
+  std::map<std::pair<std::string, size_t>, uint32_t> site_map_;
+  std::vector<Site> site_list_;
+  std::map<std::tuple<const void*, uint64_t, size_t>, uint64_t> upload_map_;
+  std::map<const void*, Last> last_map_;
+  uint64_t total_time_ = 0;
+
+  static const uint64_t kSecretLow = 0x9e3779b97f4a7c15ull;
+  static const uint64_t kSecretHigh = 0xc2b2ae3d27d4eb4full;
+  static const uint64_t kPrime = 0x165667b19e3779f9ull;
+  static const size_t kStripeSize = 16;
+  static const size_t kBlockSize = 64;
+  static const uint32_t kBlockCount = 64;
+  static const size_t kHashBytes = kBlockSize * kBlockCount;
+  static const size_t kSmallSize = 64 * 1024;
+  static const size_t kMaxUploadCount = 1 << 16;
+
+  static const uint32_t kNameLength = 10;
+  static const uint32_t kSizeLength = 20;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 16;
+};
+
+#endif // FTRACE_TOOLS_UTILS_TRANSFER_ADVISOR_H_
@@ -0,0 +1,207 @@
+#ifndef FTRACE_TOOLS_UTILS_TRANSFER_STATISTICS_H_
+#define FTRACE_TOOLS_UTILS_TRANSFER_STATISTICS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "finetrace_assert.h"
+#include "latency_histogram.h"
+
+// Achieved bandwidth of memory transfers per direction (e.g. M2D), device
+// and power of two size bucket. Per transfer bandwidth is kept in MB/s in
+// a log-linear histogram for percentiles.
+// Not thread-safe, the owner is responsible for locking
+class TransferStatistics {
+ public: // User Interface
+  void Add(
+      const std::string& direction, const void* device,
+      uint64_t bytes, uint64_t time) {
+    if (bytes == 0 || time == 0) {
+      return;
+    }
+
+    Info& info = info_map_[std::make_pair(direction, device)];
+    uint32_t bucket = GetBucket(bytes);
+    AddTransfer(info.total, bytes, time);
+    AddTransfer(info.bucket_map[bucket], bytes, time);
+
+    total_time_ += time;
+    ++total_count_;
+    if (bytes < kSmallSize) {
+      small_time_ += time;
+      ++small_count_;
+    }
+  }
+
+  // Direction letters are given in brackets by the collector, e.g.
+  // zeCommandListAppendMemoryCopy(M2D), fills have destination only
+  static std::string GetDirection(const std::string& name) {
+    std::string direction = name;
+    size_t start = name.find('(');
+    size_t end = name.rfind(')');
+    if (start != std::string::npos && end != std::string::npos &&
+        start < end) {
+      direction = name.substr(start + 1, end - start - 1);
+    }
+    if (name.find("Fill") != std::string::npos) {
+      direction = "Fill " + direction;
+    }
+    return direction;
+  }
+
+  std::string GetTransferTable() const {
+    if (info_map_.empty()) {
+      return std::string();
+    }
+
+    std::vector<const InfoMap::value_type*> list;
+    size_t max_direction_length = kDirectionLength;
+    for (auto& value : info_map_) {
+      list.push_back(&value);
+      max_direction_length =
+        std::max(max_direction_length, value.first.first.size());
+    }
+    std::sort(list.begin(), list.end(),
+              [](const InfoMap::value_type* l,
+                 const InfoMap::value_type* r) {
+                if (l->second.total.time != r->second.total.time) {
+                  return l->second.total.time > r->second.total.time;
+                }
+                return l->first < r->first;
+              });
+
+    std::stringstream stream;
+    stream << std::setw(max_direction_length) << "Direction" << "," <<
+      std::setw(kDeviceLength) << "Device" << "," <<
+      std::setw(kSizeLength) << "Size" << "," <<
+      std::setw(kCallsLength) << "Transfers" << "," <<
+      std::setw(kBytesLength) << "Bytes" << "," <<
+      std::setw(kTimeLength) << "Time (ns)" << "," <<
+      std::setw(kPercentLength) << "Time (%)" << "," <<
+      std::setw(kBandwidthLength) << "Total (GB/s)" << "," <<
+      std::setw(kBandwidthLength) << "p50 (GB/s)" << "," <<
+      std::setw(kBandwidthLength) << "p99 Low (GB/s)" << std::endl;
+    for (auto value : list) {
+      const std::string& direction = value->first.first;
+      const void* device = value->first.second;
+      PrintRow(stream, max_direction_length, direction, device,
+               "Total", value->second.total);
+      for (auto& bucket : value->second.bucket_map) {
+        PrintRow(stream, max_direction_length, direction, device,
+                 GetBucketName(bucket.first), bucket.second);
+      }
+    }
+
+    stream << std::endl;
+    stream << "Transfers below " << GetSizeName(kSmallSize) << ": " <<
+      small_count_ << " of " << total_count_ << ", " <<
+      std::setprecision(2) << std::fixed <<
+        ((total_time_ > 0) ? 100.0 * small_time_ / total_time_ : 0.0) <<
+      "% of transfer time" << std::endl;
+    return stream.str();
+  }
+
+ private: // Implementation
+  struct Bucket {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    uint64_t time = 0;
+    LatencyHistogram bandwidth; // MB/s
+  };
+
+  struct Info {
+    Bucket total;
+    std::map<uint32_t, Bucket> bucket_map;
+  };
+
+  using InfoMap = std::map<std::pair<std::string, const void*>, Info>;
+
+  static void AddTransfer(Bucket& bucket, uint64_t bytes, uint64_t time) {
+    ++bucket.count;
+    bucket.bytes += bytes;
+    bucket.time += time;
+    bucket.bandwidth.Record(GetBandwidth(bytes, time));
+  }
+
+  // Bytes per nanosecond are GB/s, so MB/s keep three decimal digits
+  static uint64_t GetBandwidth(uint64_t bytes, uint64_t time) {
+    FTRACE_ASSERT(time > 0);
+    return static_cast<uint64_t>(1000.0 * bytes / time);
+  }
+
+  static uint32_t GetBucket(uint64_t bytes) {
+    FTRACE_ASSERT(bytes > 0);
+    uint32_t bucket = 0;
+    while (bytes > 1) {
+      bytes >>= 1;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  static std::string GetSizeName(uint64_t bytes) {
+    const char* unit_list[] = {"B", "KB", "MB", "GB", "TB", "PB", "EB"};
+    size_t unit = 0;
+    while (bytes >= 1024 && bytes % 1024 == 0) {
+      bytes /= 1024;
+      ++unit;
+    }
+    return std::to_string(bytes) + unit_list[unit];
+  }
+
+  static std::string GetBucketName(uint32_t bucket) {
+    FTRACE_ASSERT(bucket < 64);
+    if (bucket == 63) {
+      return GetSizeName(1ull << bucket) + "+";
+    }
+    return GetSizeName(1ull << bucket) + "-" +
+      GetSizeName(1ull << (bucket + 1));
+  }
+
+  void PrintRow(
+      std::stringstream& stream, size_t direction_length,
+      const std::string& direction, const void* device,
+      const std::string& size, const Bucket& bucket) const {
+    stream << std::setw(direction_length) << direction << "," <<
+      std::setw(kDeviceLength) << device << "," <<
+      std::setw(kSizeLength) << size << "," <<
+      std::setw(kCallsLength) << bucket.count << "," <<
+      std::setw(kBytesLength) << bucket.bytes << "," <<
+      std::setw(kTimeLength) << bucket.time << "," <<
+      std::setw(kPercentLength) << std::setprecision(2) << std::fixed <<
+        ((total_time_ > 0) ? 100.0 * bucket.time / total_time_ : 0.0) <<
+        "," <<
+      std::setw(kBandwidthLength) << std::setprecision(2) << std::fixed <<
+        static_cast<double>(bucket.bytes) / bucket.time << "," <<
+      std::setw(kBandwidthLength) << std::setprecision(2) << std::fixed <<
+        bucket.bandwidth.GetPercentile(50.0) / 1000.0 << "," <<
+      std::setw(kBandwidthLength) << std::setprecision(2) << std::fixed <<
+        bucket.bandwidth.GetPercentile(1.0) / 1000.0 << std::endl;
+  }
+
+ private: // Data
+  InfoMap info_map_;
+  uint64_t total_time_ = 0;
+  uint64_t total_count_ = 0;
+  uint64_t small_time_ = 0;
+  uint64_t small_count_ = 0;
+
+  static const uint64_t kSmallSize = 64 * 1024;
+
+  static const uint32_t kDirectionLength = 10;
+  static const uint32_t kDeviceLength = 16;
+  static const uint32_t kSizeLength = 12;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kBytesLength = 16;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 12;
+  static const uint32_t kBandwidthLength = 16;
+};
+
+#endif // FTRACE_TOOLS_UTILS_TRANSFER_STATISTICS_H_
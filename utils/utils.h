@@ -3,9 +3,13 @@
 
 #if defined(_WIN32)
 #include <windows.h>
+#include <intrin.h>
 #else
 #include <unistd.h>
 #include <sys/syscall.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 #endif
 
 #include <stdint.h>
@@ -71,6 +75,32 @@ struct ComparatorPciAddress {
   }
 };
 
+// Subtracts fixed tracing cost of a single call from API function stats.
+// Calibration baseline includes the cheapest driver call as well, so the
+// correction is clamped to half of the fastest call of each function
+template <class InfoMap>
+InfoMap CompensateCallOverhead(const InfoMap& info_map, uint64_t baseline) {
+  InfoMap result(info_map);
+  if (baseline == 0) {
+    return result;
+  }
+  for (auto& value : result) {
+    uint64_t overhead = baseline;
+    if (overhead > value.second.min_time / 2) {
+      overhead = value.second.min_time / 2;
+    }
+    uint64_t total_overhead = overhead * value.second.call_count;
+    value.second.total_time = (value.second.total_time > total_overhead) ?
+      value.second.total_time - total_overhead : 0;
+    value.second.min_time = (value.second.min_time > overhead) ?
+      value.second.min_time - overhead : 0;
+    value.second.max_time = (value.second.max_time > overhead) ?
+      value.second.max_time - overhead : 0;
+    value.second.histogram.Subtract(overhead);
+  }
+  return result;
+}
+
 #if defined(__gnu_linux__)
 
 inline uint64_t GetTime(clockid_t id) {
@@ -214,6 +244,18 @@ inline uint64_t GetSystemTime() {
 #endif
 }
 
+inline uint64_t GetCycles() {
+#if defined(_WIN32) || defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t value = 0;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+#else
+  return GetSystemTime();
+#endif
+}
+
 inline size_t LowerBound(const std::vector<uint64_t>& data, uint64_t value) {
   size_t start = 0;
   size_t end = data.size();
@@ -86,6 +86,36 @@ inline std::vector<ze_device_handle_t> GetSubDeviceList(
   return sub_device_list;
 }
 
+inline std::string GetCommandQueueGroupName(
+    ze_device_handle_t device, uint32_t ordinal) {
+  FTRACE_ASSERT(device != nullptr);
+  ze_result_t status = ZE_RESULT_SUCCESS;
+
+  uint32_t group_count = 0;
+  status = zeDeviceGetCommandQueueGroupProperties(
+      device, &group_count, nullptr);
+  FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+
+  std::string name = "Group";
+  if (ordinal < group_count) {
+    std::vector<ze_command_queue_group_properties_t> group_list(
+        group_count,
+        {ZE_STRUCTURE_TYPE_COMMAND_QUEUE_GROUP_PROPERTIES, });
+    status = zeDeviceGetCommandQueueGroupProperties(
+        device, &group_count, group_list.data());
+    FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+
+    ze_command_queue_group_property_flags_t flags = group_list[ordinal].flags;
+    if (flags & ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
+      name = "Compute";
+    } else if (flags & ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY) {
+      name = "Copy";
+    }
+  }
+
+  return name + " " + std::to_string(ordinal);
+}
+
 inline ze_driver_handle_t GetGpuDriver() {
   std::vector<ze_driver_handle_t> driver_list;
 
@@ -284,6 +314,14 @@ inline size_t GetKernelMaxSubgroupSize(ze_kernel_handle_t kernel) {
   return props.maxSubgroupSize;
 }
 
+inline ze_kernel_properties_t GetKernelProperties(ze_kernel_handle_t kernel) {
+  FTRACE_ASSERT(kernel != nullptr);
+  ze_kernel_properties_t props{ZE_STRUCTURE_TYPE_KERNEL_PROPERTIES, };
+  ze_result_t status = zeKernelGetProperties(kernel, &props);
+  FTRACE_ASSERT(status == ZE_RESULT_SUCCESS);
+  return props;
+}
+
 inline std::string GetKernelName(
     ze_kernel_handle_t kernel, bool demangle = false) {
   FTRACE_ASSERT(kernel != nullptr);
@@ -0,0 +1,618 @@
+#ifndef FTRACE_TOOLS_WHATIF_TIMELINE_SIMULATOR_H_
+#define FTRACE_TOOLS_WHATIF_TIMELINE_SIMULATOR_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "exec_graph.h"
+#include "finetrace_assert.h"
+#include "utils.h"
+
+const char* kHostActivityName = "[Host]";
+
+struct WhatIfScale {
+  std::string pattern;
+  double factor;
+};
+
+struct WhatIfOptions {
+  std::vector<WhatIfScale> scale_list;
+  std::vector<std::string> async_list;
+  bool no_host_waits = false;
+};
+
+struct SimulatedPathInfo {
+  uint64_t path_time;
+  uint64_t path_count;
+
+  bool operator>(const SimulatedPathInfo& r) const {
+    if (path_time != r.path_time) {
+      return path_time > r.path_time;
+    }
+    return path_count > r.path_count;
+  }
+
+  bool operator!=(const SimulatedPathInfo& r) const {
+    if (path_time == r.path_time) {
+      return path_count != r.path_count;
+    }
+    return true;
+  }
+};
+
+using SimulatedPathInfoMap = std::map<std::string, SimulatedPathInfo>;
+
+struct SimulationResult {
+  uint64_t wall_time = 0;
+  SimulatedPathInfoMap path_info_map;
+};
+
+// Discrete-event replay of the recorded run. Every queue is an engine
+// executing one activity at a time, an activity starts when it is submitted,
+// all its predecessors are done and its engine is free. The host is a single
+// sequence of submissions and waits separated by the recorded host work.
+// A wait is released by the activities that finished inside it in the
+// recorded run, keeping the recorded wake-up latency
+class TimelineSimulator {
+ public: // User Interface
+  explicit TimelineSimulator(const ExecGraph& graph)
+      : node_list_(graph.GetNodeList()) {
+    const std::vector<ExecGraphWait>& wait_list = graph.GetWaitList();
+
+    origin_ = UINT64_MAX;
+    uint64_t last = 0;
+    for (size_t i = 0; i < node_list_.size(); ++i) {
+      const ExecGraphNode& node = node_list_[i];
+      if (node.join) {
+        continue;
+      }
+      origin_ = std::min(origin_, std::min(node.submitted, node.start));
+      last = std::max(last, node.end);
+      host_item_list_.push_back({node.submitted, node.submitted, i, false, 0});
+    }
+    for (const ExecGraphWait& wait : wait_list) {
+      origin_ = std::min(origin_, wait.start);
+      last = std::max(last, wait.end);
+      host_item_list_.push_back(
+          {wait.start, wait.end, wait_list_.size(), true, 0});
+      wait_list_.push_back({std::vector<size_t>(), 0, wait.end - wait.start});
+    }
+    if (origin_ == UINT64_MAX) {
+      origin_ = 0;
+    }
+    recorded_time_ = last - origin_;
+
+    std::stable_sort(host_item_list_.begin(), host_item_list_.end(),
+                     [](const HostItem& l, const HostItem& r) {
+                       if (l.start != r.start) {
+                         return l.start < r.start;
+                       }
+                       return !l.wait && r.wait;
+                     });
+
+    uint64_t previous = origin_;
+    for (HostItem& item : host_item_list_) {
+      item.gap = (item.start > previous) ? item.start - previous : 0;
+      previous = std::max(previous, item.end);
+    }
+
+    AssignWaitedNodes(wait_list);
+  }
+
+  TimelineSimulator(const TimelineSimulator& copy) = delete;
+  TimelineSimulator& operator=(const TimelineSimulator& copy) = delete;
+
+  uint64_t GetRecordedTime() const {
+    return recorded_time_;
+  }
+
+  SimulationResult Simulate(const WhatIfOptions& options) {
+    Prepare(options);
+
+    if (!host_item_list_.empty()) {
+      Schedule(host_item_list_[0].gap, kEventHost, 0);
+    }
+    uint64_t time = 0;
+    while (!event_queue_.empty()) {
+      Event event = event_queue_.top();
+      event_queue_.pop();
+      time = event.time;
+      if (event.type == kEventFinish) {
+        OnFinish(event.time, event.id);
+      } else {
+        OnHostItem(event.time, event.id);
+      }
+
+      // Recorded from several threads, the wait is not for this work
+      if (event_queue_.empty() && blocked_item_ != kNone) {
+        for (NodeState& state : state_list_) {
+          state.waited = false;
+        }
+        outstanding_ = 0;
+        size_t item = blocked_item_;
+        blocked_item_ = kNone;
+        CompleteHostItem(item, time);
+      }
+    }
+
+    SimulationResult result;
+    size_t last_node = kNone;
+    for (size_t i = 0; i < state_list_.size(); ++i) {
+      FTRACE_ASSERT(state_list_[i].finished);
+      if (last_node == kNone ||
+          state_list_[i].end > state_list_[last_node].end) {
+        last_node = i;
+      }
+    }
+    uint64_t device_end =
+      (last_node == kNone) ? 0 : state_list_[last_node].end;
+    result.wall_time = std::max(device_end, host_end_);
+
+    if (!host_item_list_.empty() && host_end_ > device_end) {
+      TracePath(kNone, host_item_list_.size() - 1, result.path_info_map);
+    } else if (last_node != kNone) {
+      TracePath(last_node, kNone, result.path_info_map);
+    }
+    return result;
+  }
+
+  static std::string GetPathTable(const SimulationResult& result) {
+    if (result.wall_time == 0) {
+      return std::string();
+    }
+
+    std::set< std::pair<std::string, SimulatedPathInfo>,
+              utils::Comparator > sorted_list(
+        result.path_info_map.begin(), result.path_info_map.end());
+
+    size_t max_name_length = kKernelLength;
+    for (auto& value : sorted_list) {
+      if (value.first.size() > max_name_length) {
+        max_name_length = value.first.size();
+      }
+    }
+
+    std::stringstream stream;
+    stream << std::setw(max_name_length) << "Activity" << "," <<
+      std::setw(kCallsLength) << "On Path" << "," <<
+      std::setw(kTimeLength) << "Path Time (ns)" << "," <<
+      std::setw(kPercentLength) << "Path (%)" << std::endl;
+
+    for (auto& value : sorted_list) {
+      const SimulatedPathInfo& info = value.second;
+      float percent = 100.0f * info.path_time / result.wall_time;
+      stream << std::setw(max_name_length) << value.first << "," <<
+        std::setw(kCallsLength) << info.path_count << "," <<
+        std::setw(kTimeLength) << info.path_time << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) <<
+          std::fixed << percent << std::endl;
+    }
+
+    return stream.str();
+  }
+
+ private: // Implementation
+  static const size_t kNone = SIZE_MAX;
+
+  enum EventType {
+    kEventFinish = 0, // Device completions go before host steps at a tie
+    kEventHost = 1
+  };
+
+  struct Event {
+    uint64_t time;
+    uint32_t type;
+    uint64_t sequence;
+    size_t id;
+
+    bool operator>(const Event& r) const {
+      if (time != r.time) {
+        return time > r.time;
+      }
+      if (type != r.type) {
+        return type > r.type;
+      }
+      return sequence > r.sequence;
+    }
+  };
+
+  struct HostItem {
+    uint64_t start;
+    uint64_t end;
+    size_t id; // Node for submission, wait index otherwise
+    bool wait;
+    uint64_t gap; // Recorded host work before the item
+  };
+
+  struct WaitInfo {
+    std::vector<size_t> node_list;
+    uint64_t latency;
+    uint64_t duration;
+  };
+
+  struct NodeState {
+    uint64_t duration = 0;
+    size_t engine = kNone;
+    std::vector<size_t> pred_list;
+    std::vector<size_t> succ_list;
+    size_t remaining = 0;
+    bool submitted = false;
+    bool finished = false;
+    bool waited = false;
+    uint64_t ready = 0;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    size_t ready_pred = kNone; // kNone means submission was the last
+    size_t ready_host_item = kNone;
+    size_t engine_pred = kNone;
+  };
+
+  struct HostItemState {
+    uint64_t start = 0;
+    uint64_t end = 0;
+    size_t release_node = kNone;
+  };
+
+  typedef std::pair<uint64_t, size_t> ReadyEntry;
+
+  struct EngineState {
+    bool busy = false;
+    size_t last = kNone;
+    std::priority_queue<ReadyEntry, std::vector<ReadyEntry>,
+                        std::greater<ReadyEntry> > ready_queue;
+  };
+
+  // Waiting thread could be released only by work submitted before the wait
+  void AssignWaitedNodes(const std::vector<ExecGraphWait>& wait_list) {
+    std::vector<size_t> sorted_list;
+    for (size_t i = 0; i < node_list_.size(); ++i) {
+      if (!node_list_[i].join) {
+        sorted_list.push_back(i);
+      }
+    }
+    std::sort(sorted_list.begin(), sorted_list.end(),
+              [this](size_t l, size_t r) {
+                return node_list_[l].end < node_list_[r].end;
+              });
+
+    for (size_t i = 0; i < wait_list.size(); ++i) {
+      const ExecGraphWait& wait = wait_list[i];
+      auto first = std::upper_bound(
+          sorted_list.begin(), sorted_list.end(), wait.start,
+          [this](uint64_t value, size_t node) {
+            return value < node_list_[node].end;
+          });
+      uint64_t last_end = 0;
+      for (auto it = first; it != sorted_list.end(); ++it) {
+        const ExecGraphNode& node = node_list_[*it];
+        if (node.end > wait.end) {
+          break;
+        }
+        if (node.submitted <= wait.start) {
+          wait_list_[i].node_list.push_back(*it);
+          last_end = std::max(last_end, node.end);
+        }
+      }
+      wait_list_[i].latency =
+        wait_list_[i].node_list.empty() ? 0 : wait.end - last_end;
+    }
+  }
+
+  static bool IsMatched(
+      const std::string& name, const std::vector<std::string>& pattern_list) {
+    for (const std::string& pattern : pattern_list) {
+      if (name.find(pattern) != std::string::npos) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Asynchronous activity leaves its queue: it waits only for its events
+  // and the previous asynchronous activity of the same queue, while its
+  // queue successors wait for it and for its former queue predecessors
+  void Prepare(const WhatIfOptions& options) {
+    size_t count = node_list_.size();
+    state_list_.assign(count, NodeState());
+    engine_list_.clear();
+    while (!event_queue_.empty()) {
+      event_queue_.pop();
+    }
+    sequence_ = 0;
+    host_end_ = 0;
+    blocked_item_ = kNone;
+    outstanding_ = 0;
+    host_state_list_.assign(host_item_list_.size(), HostItemState());
+
+    std::map<std::string, size_t> engine_map;
+    std::map<std::string, size_t> last_async_map;
+    std::vector<std::vector<size_t> > order_anchor_list(count);
+
+    for (size_t i = 0; i < count; ++i) {
+      const ExecGraphNode& node = node_list_[i];
+      NodeState& state = state_list_[i];
+
+      std::vector<size_t> order_pred_list;
+      for (size_t pred : node.order_pred_list) {
+        order_pred_list.insert(
+            order_pred_list.end(),
+            order_anchor_list[pred].begin(), order_anchor_list[pred].end());
+      }
+
+      if (node.join) {
+        state.pred_list = order_pred_list;
+        state.submitted = true;
+        order_anchor_list[i].push_back(i);
+      } else {
+        double duration = static_cast<double>(node.end - node.start);
+        for (const WhatIfScale& scale : options.scale_list) {
+          if (node.name.find(scale.pattern) != std::string::npos) {
+            duration *= scale.factor;
+          }
+        }
+        state.duration = static_cast<uint64_t>(std::llround(duration));
+
+        std::string engine = node.queue;
+        if (IsMatched(node.name, options.async_list)) {
+          engine += "#async";
+          state.pred_list = node.event_pred_list;
+          if (last_async_map.count(engine) > 0) {
+            state.pred_list.push_back(last_async_map[engine]);
+          }
+          last_async_map[engine] = i;
+          order_anchor_list[i] = order_pred_list;
+          order_anchor_list[i].push_back(i);
+        } else {
+          state.pred_list = order_pred_list;
+          state.pred_list.insert(
+              state.pred_list.end(),
+              node.event_pred_list.begin(), node.event_pred_list.end());
+          order_anchor_list[i].push_back(i);
+        }
+
+        if (engine_map.count(engine) == 0) {
+          engine_map[engine] = engine_list_.size();
+          engine_list_.emplace_back();
+        }
+        state.engine = engine_map[engine];
+      }
+
+      std::sort(order_anchor_list[i].begin(), order_anchor_list[i].end());
+      order_anchor_list[i].erase(
+          std::unique(order_anchor_list[i].begin(), order_anchor_list[i].end()),
+          order_anchor_list[i].end());
+      std::sort(state.pred_list.begin(), state.pred_list.end());
+      state.pred_list.erase(
+          std::unique(state.pred_list.begin(), state.pred_list.end()),
+          state.pred_list.end());
+
+      state.remaining = state.pred_list.size();
+      for (size_t pred : state.pred_list) {
+        FTRACE_ASSERT(pred < i);
+        state_list_[pred].succ_list.push_back(i);
+      }
+    }
+
+    no_host_waits_ = options.no_host_waits;
+
+    for (size_t i = 0; i < count; ++i) {
+      if (node_list_[i].join && state_list_[i].remaining == 0) {
+        MakeReady(0, i);
+      }
+    }
+  }
+
+  void Schedule(uint64_t time, uint32_t type, size_t id) {
+    event_queue_.push({time, type, sequence_++, id});
+  }
+
+  void MakeReady(uint64_t time, size_t node) {
+    NodeState& state = state_list_[node];
+    state.ready = time;
+    if (state.engine == kNone) { // Join
+      state.start = time;
+      Schedule(time, kEventFinish, node);
+      return;
+    }
+    EngineState& engine = engine_list_[state.engine];
+    engine.ready_queue.push(std::make_pair(time, node));
+    Dispatch(time, state.engine);
+  }
+
+  void Dispatch(uint64_t time, size_t engine_id) {
+    EngineState& engine = engine_list_[engine_id];
+    if (engine.busy || engine.ready_queue.empty()) {
+      return;
+    }
+    size_t node = engine.ready_queue.top().second;
+    engine.ready_queue.pop();
+
+    NodeState& state = state_list_[node];
+    state.start = std::max(time, state.ready);
+    if (state.start > state.ready) {
+      state.engine_pred = engine.last;
+    }
+    engine.busy = true;
+    engine.last = node;
+    Schedule(state.start + state.duration, kEventFinish, node);
+  }
+
+  void OnFinish(uint64_t time, size_t node) {
+    NodeState& state = state_list_[node];
+    state.end = time;
+    state.finished = true;
+
+    if (state.engine != kNone) {
+      engine_list_[state.engine].busy = false;
+      Dispatch(time, state.engine);
+    }
+
+    for (size_t succ : state.succ_list) {
+      NodeState& succ_state = state_list_[succ];
+      FTRACE_ASSERT(succ_state.remaining > 0);
+      --succ_state.remaining;
+      if (succ_state.remaining == 0) {
+        succ_state.ready_pred = node;
+        if (succ_state.submitted) {
+          MakeReady(time, succ);
+        }
+      }
+    }
+
+    if (state.waited) {
+      state.waited = false;
+      FTRACE_ASSERT(outstanding_ > 0);
+      --outstanding_;
+      if (outstanding_ == 0) {
+        FTRACE_ASSERT(blocked_item_ != kNone);
+        size_t item = blocked_item_;
+        blocked_item_ = kNone;
+        const WaitInfo& wait = wait_list_[host_item_list_[item].id];
+        host_state_list_[item].release_node = node;
+        CompleteHostItem(item, time + wait.latency);
+      }
+    }
+  }
+
+  void OnHostItem(uint64_t time, size_t item) {
+    const HostItem& host_item = host_item_list_[item];
+    host_state_list_[item].start = time;
+
+    if (!host_item.wait) {
+      size_t node = host_item.id;
+      NodeState& state = state_list_[node];
+      state.submitted = true;
+      state.ready_host_item = item;
+      if (state.remaining == 0) {
+        state.ready_pred = kNone;
+        MakeReady(time, node);
+      }
+      CompleteHostItem(item, time);
+      return;
+    }
+
+    const WaitInfo& wait = wait_list_[host_item.id];
+    if (no_host_waits_) {
+      CompleteHostItem(item, time);
+      return;
+    }
+    if (wait.node_list.empty()) {
+      CompleteHostItem(item, time + wait.duration);
+      return;
+    }
+
+    size_t last_node = kNone;
+    for (size_t node : wait.node_list) {
+      NodeState& state = state_list_[node];
+      if (!state.finished) {
+        state.waited = true;
+        ++outstanding_;
+      } else if (last_node == kNone || state.end > state_list_[last_node].end) {
+        last_node = node;
+      }
+    }
+    if (outstanding_ > 0) {
+      blocked_item_ = item;
+      return;
+    }
+
+    uint64_t release = state_list_[last_node].end + wait.latency;
+    if (release > time) {
+      host_state_list_[item].release_node = last_node;
+      CompleteHostItem(item, release);
+    } else {
+      CompleteHostItem(item, time);
+    }
+  }
+
+  void CompleteHostItem(size_t item, uint64_t time) {
+    host_state_list_[item].end = time;
+    host_end_ = std::max(host_end_, time);
+    if (item + 1 < host_item_list_.size()) {
+      Schedule(time + host_item_list_[item + 1].gap, kEventHost, item + 1);
+    }
+  }
+
+  static void AddPathTime(
+      SimulatedPathInfoMap& info_map, const std::string& name, uint64_t time) {
+    if (time == 0) {
+      return;
+    }
+    SimulatedPathInfo& info = info_map[name];
+    info.path_time += time;
+    info.path_count += 1;
+  }
+
+  // Walks back through whatever delayed each step the most: a predecessor,
+  // the previous activity on the engine or the host submitting the work
+  void TracePath(
+      size_t node, size_t item, SimulatedPathInfoMap& info_map) const {
+    while (node != kNone || item != kNone) {
+      if (node != kNone) {
+        const NodeState& state = state_list_[node];
+        if (state.engine != kNone) {
+          AddPathTime(info_map, node_list_[node].name, state.duration);
+        }
+
+        if (state.engine_pred != kNone) {
+          node = state.engine_pred;
+        } else if (state.ready_pred != kNone) {
+          node = state.ready_pred;
+        } else {
+          item = state.ready_host_item;
+          node = kNone;
+        }
+        continue;
+      }
+
+      const HostItemState& host_state = host_state_list_[item];
+      if (host_state.release_node != kNone) {
+        const NodeState& state = state_list_[host_state.release_node];
+        AddPathTime(info_map, kHostActivityName, host_state.end - state.end);
+        node = host_state.release_node;
+        item = kNone;
+        continue;
+      }
+
+      AddPathTime(info_map, kHostActivityName,
+                  host_state.end - host_state.start +
+                  host_item_list_[item].gap);
+      item = (item > 0) ? item - 1 : kNone;
+    }
+  }
+
+ private: // Data
+  const std::vector<ExecGraphNode>& node_list_;
+  std::vector<HostItem> host_item_list_;
+  std::vector<WaitInfo> wait_list_;
+  uint64_t origin_ = 0;
+  uint64_t recorded_time_ = 0;
+
+  std::vector<NodeState> state_list_;
+  std::vector<HostItemState> host_state_list_;
+  std::vector<EngineState> engine_list_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event> >
+    event_queue_;
+  uint64_t sequence_ = 0;
+  uint64_t host_end_ = 0;
+  size_t blocked_item_ = kNone;
+  size_t outstanding_ = 0;
+  bool no_host_waits_ = false;
+
+  static const uint32_t kKernelLength = 10;
+  static const uint32_t kCallsLength = 12;
+  static const uint32_t kTimeLength = 20;
+  static const uint32_t kPercentLength = 12;
+};
+
+#endif // FTRACE_TOOLS_WHATIF_TIMELINE_SIMULATOR_H_
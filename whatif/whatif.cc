@@ -0,0 +1,175 @@
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "exec_graph.h"
+#include "timeline_simulator.h"
+
+// Predictions differing from the recorded run more than that are flagged
+const double kMaxBaselineDeviation = 0.1;
+
+static void Usage() {
+  std::cout <<
+    "Usage: ./finetrace-whatif[.exe] [options] <graph file>" <<
+    std::endl;
+  std::cout <<
+    "Replays execution graph stored by finetrace --record-graph" <<
+    std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout <<
+    "--scale <kernel>=<factor>      " <<
+    "Multiply duration of matching device activities by the factor" <<
+    std::endl;
+  std::cout <<
+    "--async <kernel>               " <<
+    "Move matching device activities to a separate engine" <<
+    std::endl;
+  std::cout <<
+    "--no-host-waits                " <<
+    "Remove host synchronization waits" <<
+    std::endl;
+  std::cout <<
+    "--help                         " <<
+    "Print this help" <<
+    std::endl;
+}
+
+static bool ParseScale(const char* value, WhatIfScale& scale) {
+  std::string option(value);
+  size_t pos = option.find_last_of('=');
+  if (pos == std::string::npos || pos == 0 || pos + 1 == option.size()) {
+    return false;
+  }
+
+  char* end = nullptr;
+  std::string factor = option.substr(pos + 1);
+  scale.factor = strtod(factor.c_str(), &end);
+  if (*end != '\0' || scale.factor < 0) {
+    return false;
+  }
+  scale.pattern = option.substr(0, pos);
+  return true;
+}
+
+static int ParseArgs(
+    int argc, char* argv[], WhatIfOptions& options, std::string& file_name) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--scale") == 0) {
+      WhatIfScale scale;
+      if (i + 1 >= argc || !ParseScale(argv[i + 1], scale)) {
+        std::cout << "[ERROR] Expected <kernel>=<factor> after --scale" <<
+          std::endl;
+        return -1;
+      }
+      options.scale_list.push_back(scale);
+      ++i;
+    } else if (strcmp(argv[i], "--async") == 0) {
+      if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+        std::cout << "[ERROR] Expected kernel name after --async" <<
+          std::endl;
+        return -1;
+      }
+      options.async_list.push_back(argv[i + 1]);
+      ++i;
+    } else if (strcmp(argv[i], "--no-host-waits") == 0) {
+      options.no_host_waits = true;
+    } else if (strcmp(argv[i], "--help") == 0) {
+      return 0;
+    } else if (argv[i][0] == '-') {
+      std::cout << "[ERROR] Unknown option " << argv[i] << std::endl;
+      return -1;
+    } else if (file_name.empty()) {
+      file_name = argv[i];
+    } else {
+      std::cout << "[ERROR] Only one graph file is expected" << std::endl;
+      return -1;
+    }
+  }
+  return file_name.empty() ? 0 : 1;
+}
+
+static std::string GetTransformations(const WhatIfOptions& options) {
+  std::stringstream stream;
+  for (const WhatIfScale& scale : options.scale_list) {
+    stream << std::endl << "  Scale " << scale.pattern << " by " <<
+      scale.factor;
+  }
+  for (const std::string& pattern : options.async_list) {
+    stream << std::endl << "  Move " << pattern << " to a separate engine";
+  }
+  if (options.no_host_waits) {
+    stream << std::endl << "  Remove host waits";
+  }
+  return stream.str();
+}
+
+int main(int argc, char* argv[]) {
+  WhatIfOptions options;
+  std::string file_name;
+  int status = ParseArgs(argc, argv, options, file_name);
+  if (status <= 0) {
+    Usage();
+    return (status < 0) ? -1 : 0;
+  }
+
+  ExecGraph graph;
+  if (!graph.Load(file_name)) {
+    return -1;
+  }
+  if (graph.GetNodeCount() == 0) {
+    std::cout << "[WARNING] No device activities were recorded" << std::endl;
+    return 0;
+  }
+
+  TimelineSimulator simulator(graph);
+  SimulationResult baseline = simulator.Simulate(WhatIfOptions());
+  SimulationResult predicted = simulator.Simulate(options);
+
+  uint64_t recorded_time = simulator.GetRecordedTime();
+  std::cout << std::endl;
+  std::cout << "=== What-If Simulation: ===" << std::endl;
+  std::cout << std::endl;
+  std::cout << "Transformations:";
+  std::string transformations = GetTransformations(options);
+  std::cout << (transformations.empty() ? " None" : transformations) <<
+    std::endl;
+  std::cout << std::endl;
+  std::cout << "     Recorded Wall Time (ns): " << std::setw(20) <<
+    recorded_time << std::endl;
+  std::cout << "Simulated Baseline Time (ns): " << std::setw(20) <<
+    baseline.wall_time << std::endl;
+  std::cout << "    Predicted Wall Time (ns): " << std::setw(20) <<
+    predicted.wall_time << std::endl;
+  if (predicted.wall_time > 0) {
+    std::cout << "           Predicted Speedup: " << std::setw(20) <<
+      std::setprecision(2) << std::fixed <<
+      static_cast<double>(baseline.wall_time) / predicted.wall_time <<
+      std::endl;
+  }
+
+  if (recorded_time > 0) {
+    double deviation =
+      (static_cast<double>(baseline.wall_time) - recorded_time) /
+      recorded_time;
+    if (deviation > kMaxBaselineDeviation ||
+        deviation < -kMaxBaselineDeviation) {
+      std::cout << std::endl;
+      std::cout << "[WARNING] Simulated baseline differs from the " <<
+        "recorded run by " << std::setprecision(2) << std::fixed <<
+        100.0 * deviation << "%, predictions are less accurate" <<
+        std::endl;
+    }
+  }
+
+  std::cout << std::endl;
+  std::cout << "== Predicted Critical Path: ==" << std::endl;
+  std::cout << std::endl;
+  std::cout << TimelineSimulator::GetPathTable(predicted);
+  std::cout << std::endl;
+
+  return 0;
+}